@@ -6,9 +6,10 @@ layout(push_constant) uniform Transformation
 }
 transformation;
 
+// Affine3x4 on cpu side, three rows with translation in w
 layout(set = 0, binding = 0) uniform UBO
 {
-  mat4 joint_matrix[64];
+  layout(row_major) mat4x3 joint_matrix[64];
 }
 ubo;
 
@@ -22,9 +23,9 @@ layout(location = 0) out vec3 outPosition;
 
 void main()
 {
-  mat4 skin_matrix = inWeight.x * ubo.joint_matrix[inJoint.x] + inWeight.y * ubo.joint_matrix[inJoint.y] +
-                     inWeight.z * ubo.joint_matrix[inJoint.z] + inWeight.w * ubo.joint_matrix[inJoint.w];
+  mat4x3 skin_matrix = inWeight.x * ubo.joint_matrix[inJoint.x] + inWeight.y * ubo.joint_matrix[inJoint.y] +
+                       inWeight.z * ubo.joint_matrix[inJoint.z] + inWeight.w * ubo.joint_matrix[inJoint.w];
 
-  gl_Position = transformation.projection_view * skin_matrix * vec4(inPosition, 1.0);
+  gl_Position = transformation.projection_view * vec4(skin_matrix * vec4(inPosition, 1.0), 1.0);
   outPosition = inNormal;
 }
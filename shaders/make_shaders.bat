@@ -10,6 +10,7 @@ call:compile imgui.frag
 call:compile imgui.vert
 call:compile triangle_push.frag
 call:compile triangle_push.vert
+call:compile triangle_push_instanced.vert
 call:compile skybox.frag
 call:compile skybox.vert
 call:compile colored_geometry.frag
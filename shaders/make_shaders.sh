@@ -14,6 +14,7 @@ compile imgui.frag
 compile imgui.vert
 compile triangle_push.frag
 compile triangle_push.vert
+compile triangle_push_instanced.vert
 compile skybox.frag
 compile skybox.vert
 compile colored_geometry.frag
@@ -0,0 +1,28 @@
+#version 450
+
+layout(push_constant) uniform PushConst
+{
+  mat4 projection;
+  mat4 view;
+  mat4 model; // unused, model matrix of every instance comes from the instance buffer
+}
+push_const;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+layout(location = 3) in mat4 inModel;
+
+layout(location = 0) out vec4 outNormal;
+layout(location = 1) out vec2 outTexCoord;
+layout(location = 2) out vec3 outWorldPos;
+layout(location = 3) out vec3 outViewPos;
+
+void main()
+{
+  outWorldPos = vec3(inModel * vec4(inPosition, 1.0));
+  gl_Position = push_const.projection * push_const.view * vec4(outWorldPos, 1.0);
+  outNormal   = inModel * vec4(inNormal, 0.0);
+  outViewPos  = gl_Position.xyz;
+  outTexCoord = inTexCoord;
+}
@@ -0,0 +1,269 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include "engine/glb_collector.hh"
+#include "engine/hierarchical_allocator.hh"
+#include "stb_image.h"
+#include <SDL2/SDL.h>
+
+//
+// Offline tool writing baked scene files (see baked_scene.hh) next to the glb files given on the command line:
+//
+//   asset_baker ../assets/rock.glb ../assets/Monster.glb
+//   asset_baker --benchmark ../assets/*.glb
+//
+// Benchmark mode bakes nothing, it compares cpu side of loading the glb (parsing, image decoding, staging copies)
+// with cpu side of loading an already baked file (mapping, relocation, staging copies).
+//
+
+namespace {
+
+bool IsInArgumentsList(const char** argv, const uint32_t argc, const char* search)
+{
+  for (uint32_t i = 0; i < argc; ++i)
+    if (0 == SDL_strcmp(argv[i], search))
+      return true;
+  return false;
+}
+
+float ms_since(uint64_t start)
+{
+  return 1000.0f * (static_cast<float>(SDL_GetPerformanceCounter() - start) /
+                    static_cast<float>(SDL_GetPerformanceFrequency()));
+}
+
+struct FileContent
+{
+  uint8_t* data;
+  uint32_t size;
+
+  bool read(const char* path, HierarchicalAllocator& allocator)
+  {
+    SDL_RWops* ctx = SDL_RWFromFile(path, "rb");
+    if (nullptr == ctx)
+      return false;
+
+    size = static_cast<uint32_t>(SDL_RWsize(ctx));
+    data = allocator.allocate<uint8_t>(size);
+    SDL_RWread(ctx, data, sizeof(uint8_t), size);
+    SDL_RWclose(ctx);
+    return true;
+  }
+
+  void free(HierarchicalAllocator& allocator)
+  {
+    allocator.free(data, size);
+  }
+};
+
+template <typename T> T* as_offset(uint64_t offset)
+{
+  return reinterpret_cast<T*>(static_cast<uintptr_t>(offset));
+}
+
+// writes array contents and turns its pointer into a file offset
+template <typename T> void store(ByteStream& stream, ArrayView<T>& view)
+{
+  view.data = as_offset<T>((0 < view.count) ? stream.append(view.data, sizeof(T) * view.count) : 0);
+}
+
+bool bake(const char* glb_path, HierarchicalAllocator& allocator)
+{
+  FileContent glb = {};
+  if (not glb.read(glb_path, allocator))
+  {
+    SDL_Log("can't open %s", glb_path);
+    return false;
+  }
+
+  GlbCollector collector{};
+  SceneGraph   graph = parseGLB(glb.data, allocator, collector);
+
+  for (uint32_t i = 0; i < collector.images_count; ++i)
+    collector.decode_image(i, true);
+
+  ByteStream       stream = {};
+  BakedSceneHeader header = {
+      .magic          = BakedSceneHeader::MAGIC,
+      .version        = BakedSceneHeader::VERSION,
+      .layout         = baked_scene_layout(),
+      .textures_count = collector.images_count,
+  };
+
+  stream.append(nullptr, sizeof(BakedSceneHeader));
+
+  //
+  // Nested arrays go first, so the structs holding them are written with offsets already in place.
+  // Scene graph is not used after baking, pointers are overwritten in place.
+  //
+  const uint64_t material_textures_size = 5 * sizeof(uint32_t) * graph.materials.count;
+  uint32_t*      material_textures      = reinterpret_cast<uint32_t*>(SDL_malloc(material_textures_size));
+  collector.fill_material_textures(graph.materials, material_textures);
+
+  for (Node& node : graph.nodes)
+    store(stream, node.children);
+
+  for (Scene& scene : graph.scenes)
+    store(stream, scene.nodes);
+
+  for (Animation& animation : graph.animations)
+  {
+    for (AnimationSampler& sampler : animation.samplers)
+    {
+      sampler.times  = as_offset<float>(stream.append(sampler.times, sizeof(float) * sampler.keyframes_count));
+      sampler.values = as_offset<float>(stream.append(sampler.values, sizeof(float) * sampler.values_count));
+    }
+
+    store(stream, animation.channels);
+    store(stream, animation.samplers);
+  }
+
+  for (Skin& skin : graph.skins)
+  {
+    store(stream, skin.inverse_bind_matrices);
+    store(stream, skin.joints);
+  }
+
+  // textures are runtime handles, loader fills materials in place
+  graph.materials.fill_with_zeros();
+
+  store(stream, graph.materials);
+  store(stream, graph.meshes);
+  store(stream, graph.nodes);
+  store(stream, graph.scenes);
+  store(stream, graph.animations);
+  store(stream, graph.skins);
+  store(stream, graph.node_order);
+  store(stream, graph.node_parents);
+
+  header.scene_graph              = graph;
+  header.material_textures_offset = stream.append(material_textures, material_textures_size);
+
+  const uint64_t textures_offset = stream.append(nullptr, sizeof(BakedTexture) * collector.images_count);
+  header.textures_offset         = textures_offset;
+  header.geometry_size           = collector.geometry.size;
+  header.geometry_offset         = stream.append(collector.geometry.data, collector.geometry.size);
+
+  for (uint32_t i = 0; i < collector.images_count; ++i)
+  {
+    DecodedImage& image             = collector.images[i];
+    image.description.pixels_offset = stream.append(image.pixels, image.description.pixels_size);
+    SDL_memcpy(&stream.data[textures_offset + (sizeof(BakedTexture) * i)], &image.description, sizeof(BakedTexture));
+  }
+
+  header.file_size = stream.size;
+  SDL_memcpy(stream.data, &header, sizeof(BakedSceneHeader));
+
+  char baked_path[256] = {};
+  baked_scene_path(glb_path, baked_path, sizeof(baked_path));
+
+  SDL_RWops* ctx    = SDL_RWFromFile(baked_path, "wb");
+  const bool result = (nullptr != ctx) and (1 == SDL_RWwrite(ctx, stream.data, stream.size, 1));
+  if (ctx)
+    SDL_RWclose(ctx);
+
+  SDL_Log("%s: %u textures, %.2f MB (%s)", baked_path, collector.images_count,
+          static_cast<float>(stream.size) / (1024.0f * 1024.0f), result ? "ok" : "write failed");
+
+  SDL_free(material_textures);
+  stream.teardown();
+  collector.teardown();
+  glb.free(allocator);
+
+  return result;
+}
+
+//
+// Benchmark counterpart of the runtime loaders, every gpu upload is replaced with a copy to "staging".
+//
+class StagingConsumer : public GlbConsumer
+{
+public:
+  explicit StagingConsumer(uint8_t* staging)
+      : staging(staging)
+  {
+  }
+
+  void texture(Texture&, const uint8_t* image, uint32_t size) override
+  {
+    int      x           = 0;
+    int      y           = 0;
+    int      real_format = 0;
+    stbi_uc* pixels = stbi_load_from_memory(image, static_cast<int>(size), &x, &y, &real_format, STBI_rgb_alpha);
+
+    SDL_memcpy(staging, pixels, 4ull * x * y);
+    stbi_image_free(pixels);
+  }
+
+  void mesh(Mesh&, const uint8_t* data, uint32_t indices_size, uint32_t vertices_size) override
+  {
+    SDL_memcpy(staging, data, indices_size + vertices_size);
+  }
+
+private:
+  uint8_t* staging;
+};
+
+void benchmark(const char* glb_path, HierarchicalAllocator& allocator, uint8_t* staging)
+{
+  char baked_path[256] = {};
+  baked_scene_path(glb_path, baked_path, sizeof(baked_path));
+
+  uint64_t start = SDL_GetPerformanceCounter();
+  {
+    FileContent glb = {};
+    if (not glb.read(glb_path, allocator))
+      return;
+
+    StagingConsumer consumer(staging);
+    parseGLB(glb.data, allocator, consumer);
+    glb.free(allocator);
+  }
+  const float glb_ms = ms_since(start);
+
+  start = SDL_GetPerformanceCounter();
+  BakedScene baked = {};
+  if (not baked.map(baked_path))
+  {
+    SDL_Log("%-28s glb: %8.3f ms, not baked", glb_path, glb_ms);
+    return;
+  }
+
+  const BakedSceneHeader& header = baked.header();
+  SDL_memcpy(staging, baked.geometry(), header.geometry_size);
+  for (uint32_t i = 0; i < header.textures_count; ++i)
+    SDL_memcpy(staging, baked.pixels(baked.textures()[i]), baked.textures()[i].pixels_size);
+
+  const float baked_ms = ms_since(start);
+  baked.unmap();
+
+  SDL_Log("%-28s glb: %8.3f ms, baked: %8.3f ms (%.1fx)", glb_path, glb_ms, baked_ms, glb_ms / baked_ms);
+}
+
+} // namespace
+
+int main(int argc, const char* argv[])
+{
+  SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_VERBOSE);
+
+  const bool benchmark_mode = IsInArgumentsList(argv, static_cast<uint32_t>(argc), "--benchmark");
+
+  // biggest texture mip chain of the shipped assets is ~22MB
+  constexpr uint64_t staging_size = 64ull * 1024 * 1024;
+  uint8_t*           staging      = benchmark_mode ? reinterpret_cast<uint8_t*>(SDL_malloc(staging_size)) : nullptr;
+
+  HierarchicalAllocator allocator;
+  int                   result = 0;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if ('-' == argv[i][0])
+      continue;
+
+    if (benchmark_mode)
+      benchmark(argv[i], allocator, staging);
+    else if (not bake(argv[i], allocator))
+      result = 1;
+  }
+
+  SDL_free(staging);
+  return result;
+}
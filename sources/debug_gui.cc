@@ -3,7 +3,6 @@
 #include "engine/engine.hh"
 #include "engine/free_list_visualizer.hh"
 #include "engine/gpu_memory_visualizer.hh"
-#include "engine/memory_map.hh"
 #include "game.hh"
 #include "profiler_visualizer.hh"
 #include <SDL2/SDL_clipboard.h>
@@ -182,30 +181,38 @@ void draw_performence_tab(Engine& engine, Game& game)
 {
   static char highlight_filter[64];
 
+  // every profiler lane is 15 pixels high and there is one lane per job system thread
+  const float update_lanes_height = 15.0f * static_cast<float>(game.update_profiler.workers_count);
+  const float render_lanes_height = 15.0f * static_cast<float>(game.render_profiler.workers_count);
+  const float render_y_offset     = 55.0f + update_lanes_height;
+  const float pause_y_offset      = render_y_offset + 35.0f + render_lanes_height;
+
   ImGui::Text("Update");
   ImGui::Separator();
   profiler_visualize(game.update_profiler, "update", highlight_filter, 50.0f);
 
   // Cursor reposition is needed because the rendering above finishes up with variable height.
   // In the end everything rendered afterwards shakes teremdously without this
-  ImGui::SetCursorPos(ImVec2(5, 100.0f));
+  ImGui::SetCursorPos(ImVec2(5, render_y_offset));
   ImGui::Text("Render");
   ImGui::Separator();
-  profiler_visualize(game.render_profiler, "render", highlight_filter, 130.0f);
+  profiler_visualize(game.render_profiler, "render", highlight_filter, render_y_offset + 30.0f);
 
-  ImGui::SetCursorPos(ImVec2(5, 200.0f));
+  ImGui::SetCursorPos(ImVec2(5, pause_y_offset));
   if (ImGui::Button("pause"))
   {
     game.update_profiler.paused = !game.update_profiler.paused;
     game.render_profiler.paused = !game.render_profiler.paused;
   }
 
-  ImGui::SetCursorPos(ImVec2(5, 230.0f));
+  ImGui::SetCursorPos(ImVec2(5, pause_y_offset + 30.0f));
   ImGui::InputText("filter", highlight_filter, SDL_arraysize(highlight_filter));
   ImGui::Separator();
 
   auto gpu_mem_printer = [](const char* name, GpuMemoryAllocator& allocator) {
-    ImGui::Text("[GPU] %s memory (%uMB pool)", name, bytes_as_mb(allocator.max_size));
+    ImGui::Text("[GPU] %s memory (%uMB pool, %uMB free in %u ranges, largest %uMB)", name,
+                bytes_as_mb(allocator.max_size), bytes_as_mb(allocator.free_size), allocator.free_ranges_count,
+                bytes_as_mb(allocator.largest_free_range()));
     gpu_memory_visualize(allocator);
   };
 
@@ -214,19 +221,39 @@ void draw_performence_tab(Engine& engine, Game& game)
   gpu_mem_printer("host-visible", engine.memory_blocks.host_coherent.allocator);
   gpu_mem_printer("UBO", engine.memory_blocks.host_coherent_ubo.allocator);
 
-  ImGui::Text("[HOST] general purpose allocator (%uMB pool)",
-              bytes_as_mb(engine.generic_allocator->free_list_5MB.capacity));
-  free_list_visualize(engine.generic_allocator->free_list_5MB);
+  auto frame_ring_printer = [](const char* name, const GpuFrameRing& ring) {
+    ImGui::Text("[GPU] %s frame ring: %uKB / %uKB in flight, biggest frame %uKB", name,
+                bytes_as_kb(static_cast<uint32_t>(ring.get_used())), bytes_as_kb(static_cast<uint32_t>(ring.capacity)),
+                bytes_as_kb(static_cast<uint32_t>(ring.high_water)));
+  };
+
+  frame_ring_printer("host-visible", engine.host_coherent_ring);
+  frame_ring_printer("UBO", engine.host_coherent_ubo_ring);
+
+  HierarchicalAllocator& generic = *engine.generic_allocator;
+
+  ImGui::Text("[HOST] general purpose allocator (%uMB pool)", bytes_as_mb(generic.free_list_5MB.capacity));
+  free_list_visualize(generic.free_list_5MB, generic.get_free_list_stats());
 
-  auto calc_max_size = [](const BlockAllocator& allocator){ return allocator.m_BlockSize * allocator.m_BlockCapacity; };
+  auto block_tier_printer = [](const char* name, const BlockTier& tier) {
+    const AllocatorStats stats = tier.get_stats();
+    ImGui::Text("[HOST] %s block allocator (%uKB pool)", name, bytes_as_kb(static_cast<uint32_t>(stats.capacity_bytes)));
+    allocator_stats_visualize(stats);
+    block_allocator_visualize(tier.backing);
+  };
 
-  ImGui::Text("[HOST] small (1KB) block allocator (%uKB pool)",
-              bytes_as_kb(calc_max_size(engine.generic_allocator->block_allocator_1kb)));
-  block_allocator_visualize(engine.generic_allocator->block_allocator_1kb);
+  block_tier_printer("small (1KB)", generic.block_allocator_1kb);
+  block_tier_printer("normal (10KB)", generic.block_allocator_10kb);
 
-  ImGui::Text("[HOST] normal (10KB) block allocator (%uMB pool)",
-              bytes_as_mb(calc_max_size(engine.generic_allocator->block_allocator_10kb)));
-  block_allocator_visualize(engine.generic_allocator->block_allocator_10kb);
+  const FrameArenas& arenas = engine.job_system.frame_arenas;
+  ImGui::Text("[HOST] frame arenas (%uKB per thread per image)",
+              bytes_as_kb(static_cast<uint32_t>(arenas.arena_capacity)));
+  for (uint32_t thread_id = 0; thread_id < arenas.threads_count; ++thread_id)
+  {
+    ImGui::Text("thread %2u: last frame %4uKB, high water %4uKB", thread_id,
+                bytes_as_kb(static_cast<uint32_t>(arenas.thread_last_frame_used(thread_id))),
+                bytes_as_kb(static_cast<uint32_t>(arenas.thread_high_water(thread_id))));
+  }
 }
 
 void draw_debug_tab(Engine& engine, Game& game)
@@ -247,11 +274,8 @@ void draw_debug_tab(Engine& engine, Game& game)
       }
       if (ImGui::Button(names[i]))
       {
-        if (not e->flags.animation_start_time)
-        {
-          e->animation_start_time       = game.current_time_sec;
-          e->flags.animation_start_time = true;
-        }
+        // restarting animation which is still playing fades out of its current pose
+        e->play_animation(e->animation_idx, game.current_time_sec, 0.25f);
       }
     }
   }
@@ -443,19 +467,25 @@ void DebugGui::render(Engine& engine, Game& game)
 
   if (0 < vertex_size)
   {
-    MemoryMap vtx_dst(engine.device, engine.memory_blocks.host_coherent.memory,
-                      game.materials.imgui_vertex_buffer_offsets[game.image_index], vertex_size);
+    GpuMemoryBlock&    block    = engine.memory_blocks.host_coherent;
+    const VkDeviceSize offset   = game.materials.imgui_vertex_buffer_offsets[game.image_index];
+    const uint32_t     count    = static_cast<uint32_t>(draw_data->TotalVtxCount);
+    ImDrawVert*        vertices = block.host_span<ImDrawVert>(offset, count).begin();
 
-    std::accumulate(view.begin(), view.end(), reinterpret_cast<ImDrawVert*>(*vtx_dst),
+    std::accumulate(view.begin(), view.end(), vertices,
                     [](ImDrawVert* dst, const ImDrawList* cmd_list) { return serialize(dst, cmd_list->VtxBuffer); });
+    block.flush(engine.device, offset, vertex_size);
   }
 
   if (0 < index_size)
   {
-    MemoryMap idx_dst(engine.device, engine.memory_blocks.host_coherent.memory,
-                      game.materials.imgui_index_buffer_offsets[game.image_index], index_size);
+    GpuMemoryBlock&    block   = engine.memory_blocks.host_coherent;
+    const VkDeviceSize offset  = game.materials.imgui_index_buffer_offsets[game.image_index];
+    const uint32_t     count   = static_cast<uint32_t>(draw_data->TotalIdxCount);
+    ImDrawIdx*         indices = block.host_span<ImDrawIdx>(offset, count).begin();
 
-    std::accumulate(view.begin(), view.end(), reinterpret_cast<ImDrawIdx*>(*idx_dst),
+    std::accumulate(view.begin(), view.end(), indices,
                     [](ImDrawIdx* dst, const ImDrawList* cmd_list) { return serialize(dst, cmd_list->IdxBuffer); });
+    block.flush(engine.device, offset, index_size);
   }
 }
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <SDL2/SDL_stdinc.h>
+
+//
+// Numbers reported for a single tier. Only consistent when no other thread is allocating at the same time,
+// which is the case for the debug gui running between frames.
+//
+struct AllocatorStats
+{
+  uint64_t capacity_bytes;
+  uint64_t used_bytes;   // taken from the backing allocator, includes blocks parked in thread caches
+  uint64_t cached_bytes; // part of "used_bytes" which sits in thread caches / depot ready for reuse
+  uint64_t peak_used_bytes;
+  uint64_t allocations_count;
+  uint64_t frees_count;
+};
@@ -0,0 +1,286 @@
+#include "animation.hh"
+#include <SDL2/SDL_assert.h>
+#include <algorithm>
+
+namespace {
+
+//
+// https://github.com/KhronosGroup/glTF/blob/master/specification/2.0/README.md#appendix-c-spline-interpolation
+//
+
+[[nodiscard]] float hermite_cubic_spline(const Vec2& P, const Vec2& M, const float& t)
+{
+  const float a = (2.0f * P.x) + M.x + (-2.0f * P.y) + M.y;
+  const float b = (-3.0f * P.x) - (2.0f * M.x) + (3.0f * P.y) - M.y;
+  return (a * t * t * t) + (b * t * t) + (M.x * t) + P.x;
+}
+
+//
+// Keyframe data layout:
+//   Vec<DIM> in_tangent
+//   Vec<DIM> spline vertex
+//   Vec<DIM> out_tangent
+//
+void hermite_cubic_spline_interpolation(const float a_in[], const float b_in[], float result[], int dim, float t,
+                                        float total_duration)
+{
+  const float* a_spline_vertex = &a_in[dim];
+  const float* a_out_tangent   = &a_in[2 * dim];
+
+  const float* b_in_tangent    = &b_in[0];
+  const float* b_spline_vertex = &b_in[dim];
+
+  for (int i = 0; i < dim; ++i)
+  {
+    const Vec2 P = Vec2(a_spline_vertex[i], b_spline_vertex[i]);
+    const Vec2 M = Vec2(a_out_tangent[i], b_in_tangent[i]).scale(total_duration);
+    result[i]    = hermite_cubic_spline(P, M, t);
+  }
+}
+
+bool is_sampler_active(const AnimationSampler& sampler, const float& animation_time)
+{
+  return (sampler.time_frame[0] < animation_time) and (sampler.time_frame[1] > animation_time);
+}
+
+//
+// Lower keyframe of the interval containing "animation_time": times[lower] < animation_time <= times[lower + 1].
+// Sampler has to be active, so the last keyframe always stops the forward scan.
+//
+uint32_t advance_cursor(const AnimationSampler& sampler, uint32_t cursor, float animation_time)
+{
+  const float* times = sampler.times;
+
+  if (times[cursor] >= animation_time)
+  {
+    const float* upper = std::lower_bound(times, times + sampler.keyframes_count, animation_time);
+    return static_cast<uint32_t>(upper - times) - 1;
+  }
+
+  while (times[cursor + 1] < animation_time)
+    cursor += 1;
+
+  return cursor;
+}
+
+// interpolated sampler value, "dim" floats
+template <int dim> void interpolate(const AnimationSampler& sampler, uint32_t keyframe_lower, float t, float* dst)
+{
+  const uint32_t keyframe_upper = keyframe_lower + 1;
+
+  if (AnimationSampler::Interpolation::Linear == sampler.interpolation)
+  {
+    const float* a = &sampler.values[dim * keyframe_lower];
+    const float* b = &sampler.values[dim * keyframe_upper];
+
+    for (int i = 0; i < dim; ++i)
+      dst[i] = a[i] + (t * (b[i] - a[i]));
+  }
+  else if (AnimationSampler::Interpolation::CubicSpline == sampler.interpolation)
+  {
+    const float* a = &sampler.values[3 * dim * keyframe_lower];
+    const float* b = &sampler.values[3 * dim * keyframe_upper];
+
+    hermite_cubic_spline_interpolation(a, b, dst, dim, t, sampler.time_frame[1] - sampler.time_frame[0]);
+  }
+  else
+  {
+    SDL_memcpy(dst, &sampler.values[dim * keyframe_lower], dim * sizeof(float));
+  }
+}
+
+Quaternion conjugate(const Quaternion& q)
+{
+  Quaternion result;
+  result.data = Vec4(q.data.x * -1.0f, q.data.y * -1.0f, q.data.z * -1.0f, q.data.w);
+  return result;
+}
+
+} // namespace
+
+void rest_pose(const SceneGraph& model, const Pose& dst)
+{
+  Quaternion identity_rotation;
+  identity_rotation.data = Vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+  for (uint32_t i = 0; i < model.nodes.count; ++i)
+  {
+    const Node& node    = model.nodes[i];
+    dst.rotations[i]    = node.flags.rotation ? node.rotation : identity_rotation;
+    dst.translations[i] = node.flags.translation ? node.translation : Vec3(0.0f);
+    dst.scales[i]       = node.flags.scale ? node.scale : Vec3(1.0f);
+  }
+}
+
+void copy_pose(const Pose& src, const Pose& dst, uint32_t nodes_count)
+{
+  SDL_memcpy(dst.rotations, src.rotations, nodes_count * sizeof(Quaternion));
+  SDL_memcpy(dst.translations, src.translations, nodes_count * sizeof(Vec3));
+  SDL_memcpy(dst.scales, src.scales, nodes_count * sizeof(Vec3));
+}
+
+void sample_animation(const Animation& animation, float animation_time, uint32_t* cursors, const Pose& dst)
+{
+  const AnimationChannel* channels       = animation.channels.data;
+  const uint32_t          channels_count = animation.channels.count;
+
+  // keyframe interval of the track the last sampler was on
+  int      track_idx             = -1;
+  uint32_t keyframe_lower        = 0;
+  float    keyframe_uniform_time = 0.0f;
+
+  for (uint32_t first = 0, last = 0; first < channels_count; first = last)
+  {
+    const int sampler_idx = channels[first].sampler_idx;
+
+    last = first + 1;
+    while ((last < channels_count) and (sampler_idx == channels[last].sampler_idx))
+      last += 1;
+
+    const AnimationSampler&      sampler = animation.samplers[sampler_idx];
+    const AnimationChannel::Path path    = channels[first].target_path;
+
+    if (not is_sampler_active(sampler, animation_time))
+      continue;
+
+    if (sampler.track_idx != track_idx)
+    {
+      track_idx          = sampler.track_idx;
+      keyframe_lower     = advance_cursor(sampler, cursors[track_idx], animation_time);
+      cursors[track_idx] = keyframe_lower;
+
+      const float time_between_keyframes = sampler.times[keyframe_lower + 1] - sampler.times[keyframe_lower];
+      keyframe_uniform_time = (animation_time - sampler.times[keyframe_lower]) / time_between_keyframes;
+    }
+
+    if (AnimationChannel::Path::Rotation == path)
+    {
+      Vec4 value;
+      interpolate<4>(sampler, keyframe_lower, keyframe_uniform_time, &value.x);
+      value = value.normalize();
+
+      for (uint32_t i = first; i < last; ++i)
+        dst.rotations[channels[i].target_node_idx].data = value;
+    }
+    else
+    {
+      Vec3* targets = (AnimationChannel::Path::Translation == path) ? dst.translations : dst.scales;
+      Vec3  value;
+      interpolate<3>(sampler, keyframe_lower, keyframe_uniform_time, &value.x);
+
+      for (uint32_t i = first; i < last; ++i)
+        targets[channels[i].target_node_idx] = value;
+    }
+  }
+}
+
+void PosePool::setup(MemoryAllocator& allocator, uint32_t new_nodes_count, uint32_t new_capacity)
+{
+  nodes_count = new_nodes_count;
+  capacity    = new_capacity;
+  used        = 0;
+  memory      = reinterpret_cast<uint8_t*>(
+      allocator.Allocate(SDL_max(capacity * nodes_count, 1u) * (sizeof(Quaternion) + (2 * sizeof(Vec3)))));
+}
+
+void PosePool::teardown(MemoryAllocator& allocator)
+{
+  allocator.Free(memory, SDL_max(capacity * nodes_count, 1u) * (sizeof(Quaternion) + (2 * sizeof(Vec3))));
+}
+
+Pose PosePool::acquire()
+{
+  SDL_assert(used < capacity);
+
+  const uint32_t elements_count = capacity * nodes_count;
+  const uint32_t first          = used * nodes_count;
+  Quaternion*    rotations      = reinterpret_cast<Quaternion*>(memory);
+  Vec3*          vectors        = reinterpret_cast<Vec3*>(&rotations[elements_count]);
+
+  used += 1;
+  return {&rotations[first], &vectors[first], &vectors[elements_count + first]};
+}
+
+void blend_poses(const PoseLayer* layers, uint32_t layers_count, uint32_t nodes_count, const Pose& dst)
+{
+  //
+  // Nodes are processed in batches small enough for the stack, every layer is applied to a batch before moving on
+  // to the next one so the destination stays in cache.
+  //
+  constexpr uint32_t batch_size = 64;
+
+  float      weights[batch_size];
+  Quaternion rotations[batch_size];
+  Vec3       translations[batch_size];
+  Vec3       scales[batch_size];
+
+  for (uint32_t batch_start = 0; batch_start < nodes_count; batch_start += batch_size)
+  {
+    const uint32_t batch_count = SDL_min(batch_size, nodes_count - batch_start);
+
+    Quaternion* dst_rotations    = &dst.rotations[batch_start];
+    Vec3*       dst_translations = &dst.translations[batch_start];
+    Vec3*       dst_scales       = &dst.scales[batch_start];
+
+    for (uint32_t layer_idx = 0; layer_idx < layers_count; ++layer_idx)
+    {
+      const PoseLayer& layer      = layers[layer_idx];
+      float            min_weight = 1.0f;
+      float            max_weight = 0.0f;
+
+      for (uint32_t j = 0; j < batch_count; ++j)
+      {
+        weights[j] = layer.mask ? (layer.weight * layer.mask[batch_start + j]) : layer.weight;
+        min_weight = SDL_min(min_weight, weights[j]);
+        max_weight = SDL_max(max_weight, weights[j]);
+      }
+
+      // whole batch masked out, common for upper / lower body masks
+      if (0.0f == max_weight)
+        continue;
+
+      const Quaternion* src_rotations    = &layer.pose->rotations[batch_start];
+      const Vec3*       src_translations = &layer.pose->translations[batch_start];
+      const Vec3*       src_scales       = &layer.pose->scales[batch_start];
+
+      // fully weighted override replaces the pose, base layer usually is one
+      if ((PoseLayer::Mode::Override == layer.mode) and (1.0f == min_weight))
+      {
+        SDL_memcpy(dst_rotations, src_rotations, batch_count * sizeof(Quaternion));
+        SDL_memcpy(dst_translations, src_translations, batch_count * sizeof(Vec3));
+        SDL_memcpy(dst_scales, src_scales, batch_count * sizeof(Vec3));
+        continue;
+      }
+
+      if (PoseLayer::Mode::Override == layer.mode)
+      {
+        nlerp_many(dst_rotations, src_rotations, weights, dst_rotations, batch_count);
+        lerp_many(dst_translations, src_translations, weights, dst_translations, batch_count);
+        lerp_many(dst_scales, src_scales, weights, dst_scales, batch_count);
+        continue;
+      }
+
+      //
+      // Additive layer: the full difference applied on top of the current pose is blended towards like an override
+      // layer. Rotation difference is in the node local space: current * (reference^-1 * layer). Scale composes by
+      // multiplication, so its difference is a ratio: current * (layer / reference) per component.
+      //
+      const Quaternion* reference_rotations    = &layer.reference->rotations[batch_start];
+      const Vec3*       reference_translations = &layer.reference->translations[batch_start];
+      const Vec3*       reference_scales       = &layer.reference->scales[batch_start];
+
+      for (uint32_t j = 0; j < batch_count; ++j)
+      {
+        rotations[j]    = dst_rotations[j] * (conjugate(reference_rotations[j]) * src_rotations[j]);
+        translations[j] = dst_translations[j] + (src_translations[j] - reference_translations[j]);
+        scales[j]       = Vec3(dst_scales[j].x * (src_scales[j].x / reference_scales[j].x),
+                               dst_scales[j].y * (src_scales[j].y / reference_scales[j].y),
+                               dst_scales[j].z * (src_scales[j].z / reference_scales[j].z));
+      }
+
+      nlerp_many(dst_rotations, rotations, weights, dst_rotations, batch_count);
+      lerp_many(dst_translations, translations, weights, dst_translations, batch_count);
+      lerp_many(dst_scales, scales, weights, dst_scales, batch_count);
+    }
+  }
+}
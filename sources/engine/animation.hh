@@ -0,0 +1,78 @@
+#pragma once
+
+#include "gltf.hh"
+#include "memory_allocator.hh"
+
+//
+// Local transforms of every node of a model, each array has one element per node.
+//
+struct Pose
+{
+  Quaternion* rotations;
+  Vec3*       translations;
+  Vec3*       scales;
+};
+
+// transforms the scene graph nodes were loaded with, identity where a node has none
+void rest_pose(const SceneGraph& model, const Pose& dst);
+
+void copy_pose(const Pose& src, const Pose& dst, uint32_t nodes_count);
+
+//
+// Sampling of a glTF animation into a pose.
+//
+// Every track (samplers with identical keyframe times) keeps a cursor at the keyframe interval it was sampled at
+// last time, "cursors" has Animation::tracks_count elements. Playback time only moves forward between frames, so the
+// cursor is advanced by a step or two instead of searching the whole track. Going back in time (animation restarted)
+// falls back to a binary search. Channels are grouped by track and sampler at load time: the interval is found once
+// per track, a sampler shared by several channels is interpolated once and the result copied to every target node.
+//
+// Only samplers active at "animation_time" are written, the rest of "dst" is left as it was. Starting from the rest
+// pose gives a complete pose.
+//
+void sample_animation(const Animation& animation, float animation_time, uint32_t* cursors, const Pose& dst);
+
+//
+// Pose buffers of a single skeleton, allocated once. Blending needs a few temporary poses every frame (one for each
+// sampled clip), "acquire" hands them out and "reset" takes all of them back at once.
+//
+struct PosePool
+{
+  void setup(MemoryAllocator& allocator, uint32_t nodes_count, uint32_t capacity);
+  void teardown(MemoryAllocator& allocator);
+
+  [[nodiscard]] Pose acquire();
+
+  void reset()
+  {
+    used = 0;
+  }
+
+  // rotations of every pose first, then translations and scales, so all arrays stay aligned
+  uint8_t* memory;
+  uint32_t nodes_count;
+  uint32_t capacity;
+  uint32_t used;
+};
+
+struct PoseLayer
+{
+  enum class Mode
+  {
+    Override, // blends towards the layer pose
+    Additive  // applies difference between the layer pose and its reference pose (scale as a ratio)
+  };
+
+  const Pose*  pose;
+  const Pose*  reference; // additive layers only, usually the first frame of the clip
+  const float* mask;      // per node multiplier of "weight", nullptr applies the layer to every node
+  float        weight;
+  Mode         mode;
+};
+
+//
+// Applies layers in order on top of "dst", which holds the base pose (usually the sampled locomotion clip).
+// Rotations are blended with normalized lerp, which for weights between 0 and 1 and poses that are already close
+// (neighbouring clips of one skeleton) is indistinguishable from slerp and a lot cheaper.
+//
+void blend_poses(const PoseLayer* layers, uint32_t layers_count, uint32_t nodes_count, const Pose& dst);
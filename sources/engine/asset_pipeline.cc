@@ -0,0 +1,173 @@
+#include "asset_pipeline.hh"
+#include "stb_image.h"
+#include <SDL2/SDL_log.h>
+#include <SDL2/SDL_rwops.h>
+#include <SDL2/SDL_timer.h>
+#include <new>
+
+namespace {
+
+void read_scenes_job(ThreadJobData tjd)
+{
+  AssetPipeline& pipeline = *reinterpret_cast<AssetPipeline*>(tjd.user_data);
+
+  auto read = [&pipeline](ThreadJobData, uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; ++i)
+      pipeline.read_scene(pipeline.scenes[i]);
+  };
+
+  tjd.scheduler->parallel_for(tjd, 0, pipeline.scenes_count, 1, read);
+}
+
+void decode_images_job(ThreadJobData tjd)
+{
+  AssetPipeline& pipeline = *reinterpret_cast<AssetPipeline*>(tjd.user_data);
+  pipeline.gather_image_tasks();
+
+  auto decode = [&pipeline](ThreadJobData, uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; ++i)
+      pipeline.decode_image(pipeline.image_tasks[i]);
+  };
+
+  tjd.scheduler->parallel_for(tjd, 0, pipeline.image_tasks_count, 1, decode);
+}
+
+} // namespace
+
+void AssetPipeline::setup(HierarchicalAllocator& new_allocator, bool new_use_baked_assets)
+{
+  allocator         = &new_allocator;
+  use_baked_assets  = new_use_baked_assets;
+  scenes_count      = 0;
+  textures_count    = 0;
+  image_tasks_count = 0;
+}
+
+void AssetPipeline::teardown()
+{
+  for (uint32_t i = 0; i < scenes_count; ++i)
+  {
+    SceneRequest& scene = scenes[i];
+    if (scene.collector)
+    {
+      scene.collector->teardown();
+      allocator->free(scene.collector);
+    }
+  }
+
+  for (uint32_t i = 0; i < textures_count; ++i)
+    stbi_image_free(textures[i].pixels);
+
+  scenes_count   = 0;
+  textures_count = 0;
+}
+
+void AssetPipeline::add_scene(SceneGraph& dst, const char* glb_path)
+{
+  SDL_assert(MAX_SCENES > scenes_count);
+  scenes[scenes_count++] = {.dst = &dst, .glb_path = glb_path};
+}
+
+void AssetPipeline::add_texture(Texture& dst, const char* path)
+{
+  SDL_assert(MAX_TEXTURES > textures_count);
+  textures[textures_count++] = {.dst = &dst, .path = path};
+}
+
+void AssetPipeline::decode(JobScheduler& scheduler)
+{
+  const uint64_t start     = SDL_GetPerformanceCounter();
+  void*          user_data = scheduler.user_data;
+
+  scheduler.user_data = this;
+  scheduler.clear_jobs();
+  scheduler.add_job(decode_images_job, {scheduler.add_job(read_scenes_job)});
+  scheduler.start();
+  scheduler.wait_for_finish();
+  scheduler.user_data = user_data;
+
+  // embedded images are decoded, glb content is not needed anymore
+  for (uint32_t i = 0; i < scenes_count; ++i)
+  {
+    SDL_free(scenes[i].glb);
+    scenes[i].glb = nullptr;
+  }
+
+  const float elapsed_ms = 1000.0f * (static_cast<float>(SDL_GetPerformanceCounter() - start) /
+                                      static_cast<float>(SDL_GetPerformanceFrequency()));
+  SDL_Log("asset pipeline: %u scenes, %u images decoded in %.2f ms on %u threads", scenes_count, image_tasks_count,
+          elapsed_ms, scheduler.threads_count);
+}
+
+void AssetPipeline::read_scene(SceneRequest& scene)
+{
+  if (use_baked_assets)
+  {
+    char baked_path[256] = {};
+    baked_scene_path(scene.glb_path, baked_path, sizeof(baked_path));
+
+    if (scene.baked.map(baked_path))
+    {
+      scene.graph = scene.baked.header().scene_graph;
+      return;
+    }
+  }
+
+  //
+  // Content goes to SDL_malloc. Every glb is read at the same time and together they'd overflow the free list tier.
+  //
+  SDL_RWops* ctx = SDL_RWFromFile(scene.glb_path, "rb");
+  SDL_assert(ctx);
+
+  const uint64_t glb_size = static_cast<uint64_t>(SDL_RWsize(ctx));
+  scene.glb               = reinterpret_cast<uint8_t*>(SDL_malloc(glb_size));
+  SDL_RWread(ctx, scene.glb, sizeof(uint8_t), glb_size);
+  SDL_RWclose(ctx);
+
+  scene.collector = new (allocator->allocate<GlbCollector>()) GlbCollector();
+  scene.graph     = parseGLB(scene.glb, *allocator, *scene.collector);
+}
+
+void AssetPipeline::gather_image_tasks()
+{
+  image_tasks_count = 0;
+
+  for (uint32_t i = 0; i < scenes_count; ++i)
+  {
+    SceneRequest& scene = scenes[i];
+    if (nullptr == scene.collector)
+      continue;
+
+    for (uint32_t image = 0; image < scene.collector->images_count; ++image)
+    {
+      SDL_assert(MAX_IMAGE_TASKS > image_tasks_count);
+      image_tasks[image_tasks_count++] = {&scene, image};
+    }
+  }
+
+  for (uint32_t i = 0; i < textures_count; ++i)
+  {
+    SDL_assert(MAX_IMAGE_TASKS > image_tasks_count);
+    image_tasks[image_tasks_count++] = {nullptr, i};
+  }
+}
+
+void AssetPipeline::decode_image(const ImageTask& task)
+{
+  if (task.scene)
+  {
+    // glb assets keep the single level textures they always had, mip chains come with baking
+    task.scene->collector->decode_image(task.idx, false);
+    return;
+  }
+
+  TextureRequest& texture     = textures[task.idx];
+  int             x           = 0;
+  int             y           = 0;
+  int             real_format = 0;
+
+  texture.pixels = stbi_load(texture.path, &x, &y, &real_format, STBI_rgb_alpha);
+  texture.width  = static_cast<uint32_t>(x);
+  texture.height = static_cast<uint32_t>(y);
+  SDL_assert(texture.pixels);
+}
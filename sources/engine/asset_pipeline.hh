@@ -0,0 +1,78 @@
+#pragma once
+
+#include "glb_collector.hh"
+#include "job_scheduler.hh"
+
+//
+// Loads every scene and texture requested during startup in three stages:
+//
+// 1. reading  - jobs map baked scenes (or read and parse glb files when there is no baked version) in parallel
+// 2. decoding - jobs decode every image, both glb embedded and standalone ones, in parallel
+// 3. uploading - main thread copies the data into a pair of big staging buffers. Each full buffer goes to the gpu in
+//    a single submission guarded by a fence, the other one is filled in the meantime. Scene graphs and textures are
+//    published to their destinations once the fence of their last batch signals.
+//
+// Stages 1 and 2 don't touch the gpu, so they can be run (and benchmarked) without an Engine.
+//
+struct AssetPipeline
+{
+  static constexpr uint32_t MAX_SCENES      = 16;
+  static constexpr uint32_t MAX_TEXTURES    = 16;
+  static constexpr uint32_t MAX_IMAGE_TASKS = 128;
+
+  struct SceneRequest
+  {
+    SceneGraph*   dst;
+    const char*   glb_path;
+    SceneGraph    graph;
+    BakedScene    baked;     // scene graph lives in the mapping, so it's never released
+    GlbCollector* collector; // only for scenes loaded from glb
+    uint8_t*      glb;       // embedded images point into the file content until they're decoded
+    uint32_t      last_batch;
+  };
+
+  struct TextureRequest
+  {
+    Texture*    dst;
+    const char* path;
+    uint8_t*    pixels; // RGBA8, single level
+    uint32_t    width;
+    uint32_t    height;
+    Texture     uploaded;
+    uint32_t    last_batch;
+  };
+
+  // glb embedded image or a standalone texture when "scene" is null
+  struct ImageTask
+  {
+    SceneRequest* scene;
+    uint32_t      idx;
+  };
+
+  HierarchicalAllocator* allocator;
+  bool                   use_baked_assets;
+  SceneRequest           scenes[MAX_SCENES];
+  uint32_t               scenes_count;
+  TextureRequest         textures[MAX_TEXTURES];
+  uint32_t               textures_count;
+  ImageTask              image_tasks[MAX_IMAGE_TASKS];
+  uint32_t               image_tasks_count;
+
+  void setup(HierarchicalAllocator& allocator, bool use_baked_assets);
+  void teardown();
+
+  // paths have to stay alive until teardown, destinations until upload
+  void add_scene(SceneGraph& dst, const char* glb_path);
+  void add_texture(Texture& dst, const char* path);
+
+  // stages 1 and 2, runs jobs on "scheduler" and returns once everything is decoded
+  void decode(JobScheduler& scheduler);
+
+  // stage 3, main thread only
+  void upload(Engine& engine);
+
+  // used by jobs
+  void read_scene(SceneRequest& scene);
+  void gather_image_tasks();
+  void decode_image(const ImageTask& task);
+};
@@ -0,0 +1,346 @@
+#include "asset_pipeline.hh"
+#include <SDL2/SDL_log.h>
+#include <SDL2/SDL_timer.h>
+
+namespace {
+
+struct StagingBatch
+{
+  VkBuffer        buffer;
+  VkDeviceMemory  memory;
+  uint8_t*        mapped;
+  VkCommandBuffer cmd;
+  VkFence         fence;
+  VkDeviceSize    used;
+  bool            in_flight;
+};
+
+//
+// Two staging buffers used in turns. While the gpu copies out of one of them, the other is being filled.
+//
+struct Uploader
+{
+  static constexpr VkDeviceSize DEFAULT_CAPACITY = 64_MB;
+
+  Engine&        engine;
+  AssetPipeline& pipeline;
+  VkDeviceSize   capacity;
+  StagingBatch   batches[2];
+  uint32_t       submitted_count; // also the sequential number of the batch being filled
+
+  StagingBatch& current()
+  {
+    return batches[submitted_count % SDL_arraysize(batches)];
+  }
+
+  void setup()
+  {
+    for (StagingBatch& batch : batches)
+    {
+      batch        = {};
+      batch.buffer = engine.create_staging_buffer(capacity, batch.memory);
+      vkMapMemory(engine.device, batch.memory, 0, capacity, 0, reinterpret_cast<void**>(&batch.mapped));
+
+      {
+        VkCommandBufferAllocateInfo allocate = {
+            .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool        = engine.graphics_command_pool,
+            .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        };
+
+        vkAllocateCommandBuffers(engine.device, &allocate, &batch.cmd);
+      }
+
+      {
+        VkFenceCreateInfo ci = {.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+        vkCreateFence(engine.device, &ci, nullptr, &batch.fence);
+      }
+    }
+
+    begin();
+  }
+
+  void teardown()
+  {
+    for (StagingBatch& batch : batches)
+    {
+      vkDestroyFence(engine.device, batch.fence, nullptr);
+      vkFreeCommandBuffers(engine.device, engine.graphics_command_pool, 1, &batch.cmd);
+      vkUnmapMemory(engine.device, batch.memory);
+      vkFreeMemory(engine.device, batch.memory, nullptr);
+      vkDestroyBuffer(engine.device, batch.buffer, nullptr);
+    }
+  }
+
+  void begin()
+  {
+    StagingBatch& batch = current();
+
+    if (batch.in_flight)
+    {
+      vkWaitForFences(engine.device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+      vkResetFences(engine.device, 1, &batch.fence);
+      batch.in_flight = false;
+      publish(submitted_count - SDL_arraysize(batches));
+    }
+
+    batch.used = 0;
+
+    VkCommandBufferBeginInfo begin = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+
+    vkBeginCommandBuffer(batch.cmd, &begin);
+  }
+
+  void submit()
+  {
+    StagingBatch& batch = current();
+
+    // textures have their own barriers, geometry copies are made visible to vertex input in one go
+    VkMemoryBarrier barrier = {
+        .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+    };
+
+    vkCmdPipelineBarrier(batch.cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier,
+                         0, nullptr, 0, nullptr);
+    vkEndCommandBuffer(batch.cmd);
+
+    VkSubmitInfo submit = {
+        .sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers    = &batch.cmd,
+    };
+
+    vkQueueSubmit(engine.graphics_queue, 1, &submit, batch.fence);
+    batch.in_flight = true;
+    submitted_count += 1;
+  }
+
+  // submits the last batch and waits for every batch still in flight
+  void finish()
+  {
+    submit();
+
+    for (StagingBatch& batch : batches)
+    {
+      if (batch.in_flight)
+      {
+        vkWaitForFences(engine.device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+        batch.in_flight = false;
+      }
+    }
+
+    publish(UINT32_MAX);
+  }
+
+  // staging space for "size" bytes, starts the next batch when the current one is full
+  VkDeviceSize reserve(VkDeviceSize size)
+  {
+    SDL_assert(capacity >= size);
+
+    if ((capacity - current().used) < size)
+    {
+      submit();
+      begin();
+    }
+
+    // capacity is a multiple of 16, so alignment never goes past it
+    const VkDeviceSize offset = current().used;
+    current().used            = (offset + size + 15) & ~VkDeviceSize(15);
+    return offset;
+  }
+
+  void upload_texture(Texture& dst, const uint8_t* pixels, const BakedTexture& description)
+  {
+    const VkDeviceSize offset = reserve(description.pixels_size);
+    StagingBatch&      batch  = current();
+
+    SDL_memcpy(&batch.mapped[offset], pixels, description.pixels_size);
+    dst = engine.create_texture(description.width, description.height, description.mip_levels);
+    engine.record_texture_upload(batch.cmd, batch.buffer, offset, dst, description.width, description.height,
+                                 description.mip_levels);
+  }
+
+  // big blobs are split between as many batches as needed
+  void upload_geometry(VkDeviceSize dst_offset, const uint8_t* data, VkDeviceSize size)
+  {
+    for (VkDeviceSize done = 0; done < size;)
+    {
+      if (capacity == current().used)
+      {
+        submit();
+        begin();
+      }
+
+      const VkDeviceSize length = SDL_min(size - done, capacity - current().used);
+      const VkDeviceSize offset = reserve(length);
+      StagingBatch&      batch  = current();
+
+      VkBufferCopy copy = {
+          .srcOffset = offset,
+          .dstOffset = dst_offset + done,
+          .size      = length,
+      };
+
+      SDL_memcpy(&batch.mapped[offset], &data[done], length);
+      vkCmdCopyBuffer(batch.cmd, batch.buffer, engine.gpu_device_local_memory_buffer, 1, &copy);
+      done += length;
+    }
+  }
+
+  // everything up to and including batch "last_done" is on the gpu
+  void publish(uint32_t last_done)
+  {
+    for (uint32_t i = 0; i < pipeline.scenes_count; ++i)
+    {
+      AssetPipeline::SceneRequest& scene = pipeline.scenes[i];
+      if ((nullptr != scene.dst) and (scene.last_batch <= last_done))
+      {
+        *scene.dst = scene.graph;
+        scene.dst  = nullptr;
+      }
+    }
+
+    for (uint32_t i = 0; i < pipeline.textures_count; ++i)
+    {
+      AssetPipeline::TextureRequest& texture = pipeline.textures[i];
+      if ((nullptr != texture.dst) and (texture.last_batch <= last_done))
+      {
+        *texture.dst = texture.uploaded;
+        texture.dst  = nullptr;
+      }
+    }
+  }
+};
+
+} // namespace
+
+void AssetPipeline::upload(Engine& engine)
+{
+  const uint64_t start = SDL_GetPerformanceCounter();
+
+  // every texture has to fit into a single batch
+  VkDeviceSize capacity = Uploader::DEFAULT_CAPACITY;
+
+  for (uint32_t i = 0; i < scenes_count; ++i)
+  {
+    const SceneRequest& scene = scenes[i];
+    if (scene.collector)
+    {
+      for (uint32_t image = 0; image < scene.collector->images_count; ++image)
+        capacity = SDL_max(capacity, scene.collector->images[image].description.pixels_size);
+    }
+    else
+    {
+      for (uint32_t texture = 0; texture < scene.baked.header().textures_count; ++texture)
+        capacity = SDL_max(capacity, scene.baked.textures()[texture].pixels_size);
+    }
+  }
+
+  for (uint32_t i = 0; i < textures_count; ++i)
+    capacity = SDL_max(capacity, rgba8_mip_chain_size(textures[i].width, textures[i].height, 1));
+
+  capacity = (capacity + 15) & ~VkDeviceSize(15);
+
+  Uploader uploader = {.engine = engine, .pipeline = *this, .capacity = capacity};
+  uploader.setup();
+
+  for (uint32_t i = 0; i < scenes_count; ++i)
+  {
+    SceneRequest& scene = scenes[i];
+
+    //
+    // glb and baked scenes differ only in where the data comes from:
+    // images, flat material texture table and geometry blob with mesh offsets relative to it
+    //
+    const bool      baked                 = (nullptr == scene.collector);
+    const uint32_t  images_count          = baked ? scene.baked.header().textures_count : scene.collector->images_count;
+    const uint8_t*  geometry              = baked ? scene.baked.geometry() : scene.collector->geometry.data;
+    const uint64_t  geometry_size         = baked ? scene.baked.header().geometry_size : scene.collector->geometry.size;
+    const uint32_t* material_textures     = nullptr;
+    uint32_t*       glb_material_textures = nullptr;
+
+    if (baked)
+    {
+      material_textures = scene.baked.material_textures();
+    }
+    else
+    {
+      glb_material_textures = allocator->allocate<uint32_t>(5 * SDL_max(scene.graph.materials.count, 1u));
+      scene.collector->fill_material_textures(scene.graph.materials, glb_material_textures);
+      material_textures = glb_material_textures;
+    }
+
+    Texture* uploaded = allocator->allocate<Texture>(SDL_max(images_count, 1u));
+
+    for (uint32_t image = 0; image < images_count; ++image)
+    {
+      if (baked)
+      {
+        const BakedTexture& description = scene.baked.textures()[image];
+        uploader.upload_texture(uploaded[image], scene.baked.pixels(description), description);
+      }
+      else
+      {
+        const DecodedImage& decoded = scene.collector->images[image];
+        uploader.upload_texture(uploaded[image], decoded.pixels, decoded.description);
+      }
+    }
+
+    for (uint32_t material = 0; material < scene.graph.materials.count; ++material)
+    {
+      Texture* dst = reinterpret_cast<Texture*>(&scene.graph.materials[material]);
+      for (uint32_t j = 0; j < 5; ++j)
+      {
+        const uint32_t texture_idx = material_textures[(5 * material) + j];
+        dst[j]                     = (BakedSceneHeader::NO_TEXTURE == texture_idx) ? Texture{} : uploaded[texture_idx];
+      }
+    }
+
+    if (0 < geometry_size)
+    {
+      GpuMemoryBlock&    block = engine.memory_blocks.device_local;
+      const VkDeviceSize base  = block.allocator.allocate_bytes(geometry_size, block.alignment);
+
+      uploader.upload_geometry(base, geometry, geometry_size);
+
+      for (Mesh& mesh : scene.graph.meshes)
+      {
+        mesh.indices_offset += base;
+        mesh.vertices_offset += base;
+      }
+    }
+
+    scene.last_batch = uploader.submitted_count;
+
+    allocator->free(uploaded, SDL_max(images_count, 1u));
+    if (glb_material_textures)
+      allocator->free(glb_material_textures, 5 * SDL_max(scene.graph.materials.count, 1u));
+  }
+
+  for (uint32_t i = 0; i < textures_count; ++i)
+  {
+    TextureRequest&    texture     = textures[i];
+    const BakedTexture description = {
+        .width       = texture.width,
+        .height      = texture.height,
+        .mip_levels  = 1,
+        .pixels_size = rgba8_mip_chain_size(texture.width, texture.height, 1),
+    };
+
+    uploader.upload_texture(texture.uploaded, texture.pixels, description);
+    texture.last_batch = uploader.submitted_count;
+  }
+
+  uploader.finish();
+  uploader.teardown();
+
+  const float elapsed_ms = 1000.0f * (static_cast<float>(SDL_GetPerformanceCounter() - start) /
+                                      static_cast<float>(SDL_GetPerformanceFrequency()));
+  SDL_Log("asset pipeline: uploaded in %u batches, %.2f ms", uploader.submitted_count, elapsed_ms);
+}
@@ -0,0 +1,209 @@
+#include "baked_scene.hh"
+#include <SDL2/SDL_log.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+//
+// Private (copy on write) mapping. Relocation dirties only the few pages holding scene graph structs, geometry and
+// pixels stay shared with the page cache.
+//
+uint8_t* map_file(const char* path, uint64_t& size)
+{
+#ifdef _WIN32
+  HANDLE file =
+      CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (INVALID_HANDLE_VALUE == file)
+    return nullptr;
+
+  LARGE_INTEGER file_size = {};
+  GetFileSizeEx(file, &file_size);
+  size = static_cast<uint64_t>(file_size.QuadPart);
+
+  HANDLE   mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+  uint8_t* result  = mapping ? reinterpret_cast<uint8_t*>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0)) : nullptr;
+
+  // view keeps the file alive on its own
+  if (mapping)
+    CloseHandle(mapping);
+  CloseHandle(file);
+
+  return result;
+#else
+  const int fd = open(path, O_RDONLY);
+  if (0 > fd)
+    return nullptr;
+
+  struct stat file_stat = {};
+  fstat(fd, &file_stat);
+  size = static_cast<uint64_t>(file_stat.st_size);
+
+  void* result = (0 < size) ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  close(fd);
+
+  return (MAP_FAILED == result) ? nullptr : reinterpret_cast<uint8_t*>(result);
+#endif
+}
+
+void unmap_file(uint8_t* data, uint64_t size)
+{
+#ifdef _WIN32
+  (void)size;
+  UnmapViewOfFile(data);
+#else
+  munmap(data, size);
+#endif
+}
+
+struct Relocator
+{
+  uint8_t* base;
+  uint64_t size;
+  bool     valid;
+
+  bool contains(uint64_t offset, uint64_t bytes) const
+  {
+    return (offset <= size) and (bytes <= (size - offset));
+  }
+
+  template <typename T> T* pointer(T* stored, uint64_t count)
+  {
+    const uint64_t offset = reinterpret_cast<uintptr_t>(stored);
+    if (0 == count)
+      return nullptr;
+
+    if (not contains(offset, count * sizeof(T)))
+    {
+      valid = false;
+      return nullptr;
+    }
+
+    return reinterpret_cast<T*>(&base[offset]);
+  }
+
+  template <typename T> void operator()(ArrayView<T>& view)
+  {
+    view.data = pointer(view.data, view.count);
+    if (nullptr == view.data)
+      view.count = 0;
+  }
+};
+
+} // namespace
+
+uint32_t baked_scene_layout()
+{
+  const uint32_t sizes[] = {
+      sizeof(void*), sizeof(BakedSceneHeader), sizeof(BakedTexture), sizeof(Material),
+      sizeof(Mesh),  sizeof(Node),             sizeof(Scene),        sizeof(Animation),
+      sizeof(Skin),  sizeof(AnimationChannel), sizeof(AnimationSampler),
+  };
+
+  // FNV-1a over struct sizes
+  uint32_t result = 2166136261u;
+  for (uint32_t size : sizes)
+    result = (result ^ size) * 16777619u;
+  return result;
+}
+
+void baked_scene_path(const char* glb_path, char* dst, uint32_t dst_size)
+{
+  const char* extension = SDL_strrchr(glb_path, '.');
+  const int   stem      = extension ? static_cast<int>(extension - glb_path) : static_cast<int>(SDL_strlen(glb_path));
+  SDL_snprintf(dst, dst_size, "%.*s.vvne", stem, glb_path);
+}
+
+bool BakedScene::map(const char* path)
+{
+  data = map_file(path, size);
+  if (nullptr == data)
+    return false;
+
+  BakedSceneHeader& h = header();
+
+  const bool compatible = (sizeof(BakedSceneHeader) <= size) and (BakedSceneHeader::MAGIC == h.magic) and
+                          (BakedSceneHeader::VERSION == h.version) and (baked_scene_layout() == h.layout) and
+                          (size == h.file_size);
+  if (not compatible)
+  {
+    SDL_Log("%s was baked by an incompatible build, bake it again", path);
+    unmap();
+    return false;
+  }
+
+  Relocator   relocate = {data, size, true};
+  SceneGraph& graph    = h.scene_graph;
+
+  relocate(graph.materials);
+  relocate(graph.meshes);
+  relocate(graph.nodes);
+  relocate(graph.scenes);
+  relocate(graph.animations);
+  relocate(graph.skins);
+  relocate(graph.node_order);
+  relocate(graph.node_parents);
+
+  // arrays which failed to relocate are left empty, so nested ones can be walked unconditionally
+  for (Node& node : graph.nodes)
+    relocate(node.children);
+
+  for (Scene& scene : graph.scenes)
+    relocate(scene.nodes);
+
+  for (Animation& animation : graph.animations)
+  {
+    relocate(animation.channels);
+    relocate(animation.samplers);
+
+    for (AnimationSampler& sampler : animation.samplers)
+    {
+      sampler.times  = relocate.pointer(sampler.times, static_cast<uint64_t>(sampler.keyframes_count));
+      sampler.values = relocate.pointer(sampler.values, static_cast<uint64_t>(sampler.values_count));
+    }
+  }
+
+  for (Skin& skin : graph.skins)
+  {
+    relocate(skin.inverse_bind_matrices);
+    relocate(skin.joints);
+  }
+
+  relocate.valid = relocate.valid and (graph.nodes.count == graph.node_order.count) and
+                   (graph.nodes.count == graph.node_parents.count) and
+                   relocate.contains(h.material_textures_offset, 5 * sizeof(uint32_t) * graph.materials.count) and
+                   relocate.contains(h.textures_offset, sizeof(BakedTexture) * h.textures_count) and
+                   relocate.contains(h.geometry_offset, h.geometry_size);
+
+  for (uint32_t i = 0; relocate.valid and (i < h.textures_count); ++i)
+    relocate.valid = relocate.contains(textures()[i].pixels_offset, textures()[i].pixels_size);
+
+  for (uint32_t i = 0; relocate.valid and (i < (5 * graph.materials.count)); ++i)
+  {
+    const uint32_t texture_idx = material_textures()[i];
+    relocate.valid             = (BakedSceneHeader::NO_TEXTURE == texture_idx) or (texture_idx < h.textures_count);
+  }
+
+  if (not relocate.valid)
+  {
+    SDL_Log("%s is corrupted", path);
+    unmap();
+    return false;
+  }
+
+  return true;
+}
+
+void BakedScene::unmap()
+{
+  unmap_file(data, size);
+  data = nullptr;
+  size = 0;
+}
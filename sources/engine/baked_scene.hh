@@ -0,0 +1,91 @@
+#pragma once
+
+#include "gltf.hh"
+
+//
+// GPU ready scene written offline by the asset_baker tool from a glb file.
+//
+// | header | scene graph arrays | material textures | texture descriptions | geometry | texture pixels |
+//
+// Whole file is memory mapped and used in place. Scene graph structs are stored exactly as they are in memory, with
+// every pointer replaced by an offset from the beginning of the file, "map" only adds the mapping address back.
+// Geometry is the index / vertex data parseGLB builds for every mesh (mesh offsets are relative to the geometry blob)
+// and textures are RGBA8 with a full mip chain, so both go to the gpu straight from the mapping.
+//
+// Files are only valid for the build which wrote them: struct sizes are part of the header and have to match.
+//
+struct BakedTexture
+{
+  uint32_t width;
+  uint32_t height;
+  uint32_t mip_levels;
+  uint32_t padding;
+  // levels one after another starting from the biggest one, rows are tightly packed
+  uint64_t pixels_offset;
+  uint64_t pixels_size;
+};
+
+struct BakedSceneHeader
+{
+  static constexpr uint32_t MAGIC      = 0x454e5656; // "VVNE"
+  static constexpr uint32_t VERSION    = 4;
+  static constexpr uint32_t NO_TEXTURE = ~0u;
+
+  uint32_t magic;
+  uint32_t version;
+  uint32_t layout;
+  uint32_t textures_count;
+  uint64_t file_size;
+
+  SceneGraph scene_graph;
+
+  // index into textures for each Texture of each Material (albedo, metal roughness, emissive, AO, normal)
+  uint64_t material_textures_offset;
+  uint64_t textures_offset;
+  uint64_t geometry_offset;
+  uint64_t geometry_size;
+};
+
+// materials are stored as a flat table of textures
+static_assert(sizeof(Material) == (5 * sizeof(Texture)));
+
+// changes whenever anything stored in place changes size
+uint32_t baked_scene_layout();
+
+// "../assets/rock.glb" -> "../assets/rock.vvne"
+void baked_scene_path(const char* glb_path, char* dst, uint32_t dst_size);
+
+struct BakedScene
+{
+  // false when the file is missing, truncated or was written by an incompatible build
+  bool map(const char* path);
+  void unmap();
+
+  [[nodiscard]] BakedSceneHeader& header() const
+  {
+    return *reinterpret_cast<BakedSceneHeader*>(data);
+  }
+
+  [[nodiscard]] const uint32_t* material_textures() const
+  {
+    return reinterpret_cast<const uint32_t*>(&data[header().material_textures_offset]);
+  }
+
+  [[nodiscard]] const BakedTexture* textures() const
+  {
+    return reinterpret_cast<const BakedTexture*>(&data[header().textures_offset]);
+  }
+
+  [[nodiscard]] const uint8_t* geometry() const
+  {
+    return &data[header().geometry_offset];
+  }
+
+  [[nodiscard]] const uint8_t* pixels(const BakedTexture& texture) const
+  {
+    return &data[texture.pixels_offset];
+  }
+
+  uint8_t* data;
+  uint64_t size;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "hierarchical_allocator.hh"
+#include <SDL2/SDL_stdinc.h>
+#include <bit>
+
+//
+// Set of bits sized once at setup, usually one bit per scene graph node.
+//
+struct Bitset
+{
+  uint64_t* words;
+  uint32_t  words_count;
+
+  void setup(HierarchicalAllocator& allocator, uint32_t bits_count)
+  {
+    words_count = (bits_count + 63) / 64;
+    words       = allocator.allocate_zeroed<uint64_t>(SDL_max(words_count, 1u));
+  }
+
+  void set(uint32_t idx)
+  {
+    words[idx / 64] |= uint64_t(1) << (idx % 64);
+  }
+
+  [[nodiscard]] bool test(uint32_t idx) const
+  {
+    return words[idx / 64] & (uint64_t(1) << (idx % 64));
+  }
+
+  void clear()
+  {
+    SDL_memset(words, 0, sizeof(uint64_t) * words_count);
+  }
+
+  // calls "fn" with the index of every set bit, in ascending order
+  template <typename Fn> void for_each(Fn fn) const
+  {
+    for (uint32_t word_idx = 0; word_idx < words_count; ++word_idx)
+      for (uint64_t word = words[word_idx]; word; word &= (word - 1))
+        fn((64 * word_idx) + static_cast<uint32_t>(std::countr_zero(word)));
+  }
+};
@@ -1,25 +1,61 @@
 #include "block_allocator.hh"
 #include <SDL2/SDL_assert.h>
+#include <bit>
 
 namespace {
 
+constexpr uint64_t ALL_BITS = ~uint64_t(0);
+
 inline bool is_bit_set(uint64_t bitmap, uint64_t bit)
 {
   return bitmap & (uint64_t(1) << bit);
 }
 
+inline void set_bit(uint64_t& bitmap, uint64_t bit)
+{
+  bitmap |= (uint64_t(1) << bit);
+}
+
+inline void clear_bit(uint64_t& bitmap, uint64_t bit)
+{
+  bitmap &= ~(uint64_t(1) << bit);
+}
+
+// bits [count, 64) set, used to mark everything past the capacity as permanently taken
+inline uint64_t tail_bits(uint32_t count)
+{
+  return (0 == (count % 64)) ? 0 : (ALL_BITS << (count % 64));
+}
+
 } // namespace
 
 BlockAllocator::BlockAllocator(uint32_t new_block_size, uint32_t new_block_count)
     : m_Data(reinterpret_cast<uint8_t*>(SDL_malloc(new_block_size * new_block_count)))
-    , m_BlockUsageBitmaps{}
     , m_BlockSize(new_block_size)
     , m_BlockCapacity(new_block_count)
+    , m_UsageWordsCount((new_block_count + 63) / 64)
+    , m_FullWordsCount((m_UsageWordsCount + 63) / 64)
+    , m_FirstNotFullWord(0)
+    , m_FreeHint(new_block_count)
 {
+  m_BlockUsageBitmaps = reinterpret_cast<uint64_t*>(SDL_calloc(m_UsageWordsCount, sizeof(uint64_t)));
+  m_FullWordsBitmaps  = reinterpret_cast<uint64_t*>(SDL_calloc(m_FullWordsCount, sizeof(uint64_t)));
+
+  if (m_UsageWordsCount)
+  {
+    m_BlockUsageBitmaps[m_UsageWordsCount - 1] = tail_bits(m_BlockCapacity);
+    if (ALL_BITS == m_BlockUsageBitmaps[m_UsageWordsCount - 1])
+      set_bit(m_FullWordsBitmaps[(m_UsageWordsCount - 1) / 64], (m_UsageWordsCount - 1) % 64);
+  }
+
+  if (m_FullWordsCount)
+    m_FullWordsBitmaps[m_FullWordsCount - 1] |= tail_bits(m_UsageWordsCount);
 }
 
 BlockAllocator::~BlockAllocator()
 {
+  SDL_free(m_FullWordsBitmaps);
+  SDL_free(m_BlockUsageBitmaps);
   SDL_free(m_Data);
 }
 
@@ -27,21 +63,34 @@ void* BlockAllocator::Allocate(uint64_t size)
 {
   SDL_assert(size <= m_BlockSize);
 
-  auto set_bit = [](uint64_t& bitmap, uint64_t bit) { bitmap |= (uint64_t(1) << bit); };
-  for (uint32_t i = 0; i < m_BlockCapacity; ++i)
+  uint32_t block_idx = m_FreeHint;
+  m_FreeHint         = m_BlockCapacity;
+
+  if ((m_BlockCapacity <= block_idx) or is_bit_set(m_BlockUsageBitmaps[block_idx / 64], block_idx % 64))
   {
-    uint64_t&      bitmap = m_BlockUsageBitmaps[i / 64];
-    const uint64_t offset = i % 64;
+    uint32_t full_word_idx = m_FirstNotFullWord;
+    while ((m_FullWordsCount > full_word_idx) and (ALL_BITS == m_FullWordsBitmaps[full_word_idx]))
+      ++full_word_idx;
 
-    if (!is_bit_set(bitmap, offset))
+    m_FirstNotFullWord = full_word_idx;
+
+    if (m_FullWordsCount == full_word_idx)
     {
-      set_bit(bitmap, offset);
-      return &m_Data[m_BlockSize * i];
+      SDL_assert(false);
+      return nullptr;
     }
+
+    const uint32_t usage_word_idx = 64 * full_word_idx + std::countr_zero(~m_FullWordsBitmaps[full_word_idx]);
+    block_idx                     = 64 * usage_word_idx + std::countr_zero(~m_BlockUsageBitmaps[usage_word_idx]);
   }
 
-  SDL_assert(false);
-  return nullptr;
+  uint64_t& usage_word = m_BlockUsageBitmaps[block_idx / 64];
+  set_bit(usage_word, block_idx % 64);
+
+  if (ALL_BITS == usage_word)
+    set_bit(m_FullWordsBitmaps[block_idx / (64 * 64)], (block_idx / 64) % 64);
+
+  return &m_Data[m_BlockSize * block_idx];
 }
 
 void* BlockAllocator::Reallocate(void* ptr, uint64_t size)
@@ -61,7 +110,7 @@ void BlockAllocator::Free(void* ptr, uint64_t size)
   SDL_assert(is_between(m_Data, reinterpret_cast<uint8_t*>(ptr), &m_Data[m_BlockSize * m_BlockCapacity]));
 
   const uint64_t memory_offset = (reinterpret_cast<uint8_t*>(ptr) - m_Data);
-  const uint64_t block_idx     = memory_offset / m_BlockSize;
+  const uint32_t block_idx     = static_cast<uint32_t>(memory_offset / m_BlockSize);
   uint64_t&      bitmap        = m_BlockUsageBitmaps[block_idx / 64];
   const uint64_t offset        = block_idx % 64;
 
@@ -70,6 +119,19 @@ void BlockAllocator::Free(void* ptr, uint64_t size)
   //
   SDL_assert(is_bit_set(bitmap, offset));
 
-  auto clear_bit = [](uint64_t& bitmap, uint64_t bit) { bitmap &= ~(uint64_t(1) << bit); };
   clear_bit(bitmap, offset);
+  clear_bit(m_FullWordsBitmaps[block_idx / (64 * 64)], (block_idx / 64) % 64);
+
+  m_FirstNotFullWord = SDL_min(m_FirstNotFullWord, block_idx / (64 * 64));
+  m_FreeHint         = block_idx;
+}
+
+uint32_t BlockAllocator::count_used_blocks() const
+{
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < m_UsageWordsCount; ++i)
+    result += std::popcount(m_BlockUsageBitmaps[i]);
+
+  // bits past capacity are always set
+  return result - std::popcount(tail_bits(m_BlockCapacity));
 }
@@ -4,10 +4,16 @@
 
 //
 // Fixed size block allocator.
-// Internal bitmap allows maximum of 1280 blocks, but will be capped depending on the available memory and block size.
-//
 // Allows to ONLY allocate a single block
 //
+// Block usage is tracked with a two level bitmap:
+// - usage bitmaps: one bit per block, set when the block is in use,
+// - full words bitmaps: one bit per usage bitmap word, set when all 64 blocks of that word are in use.
+// Finding a free block is a word scan over the second level followed by two bit scans, so the cost doesn't depend
+// on how full the allocator is. Bits past the capacity are permanently marked as used.
+//
+// Most recently freed block is kept as a hint and handed out first, since it's likely still in cache.
+//
 struct BlockAllocator : public MemoryAllocator
 {
   BlockAllocator(uint32_t block_size, uint32_t block_count);
@@ -17,8 +23,15 @@ struct BlockAllocator : public MemoryAllocator
   void* Reallocate(void* ptr, uint64_t size) override;
   void  Free(void* ptr, uint64_t size) override;
 
-  uint8_t* m_Data                  = nullptr;
-  uint64_t m_BlockUsageBitmaps[20] = {};
-  uint32_t m_BlockSize             = 0;
-  uint32_t m_BlockCapacity         = 0;
+  [[nodiscard]] uint32_t count_used_blocks() const;
+
+  uint8_t*  m_Data              = nullptr;
+  uint64_t* m_BlockUsageBitmaps = nullptr;
+  uint64_t* m_FullWordsBitmaps  = nullptr;
+  uint32_t  m_BlockSize         = 0;
+  uint32_t  m_BlockCapacity     = 0;
+  uint32_t  m_UsageWordsCount   = 0;
+  uint32_t  m_FullWordsCount    = 0;
+  uint32_t  m_FirstNotFullWord  = 0; // no full words bitmap before this index has a free block
+  uint32_t  m_FreeHint          = 0; // block index, valid only when below capacity
 };
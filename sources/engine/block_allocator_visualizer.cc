@@ -75,3 +75,11 @@ void block_allocator_visualize(const BlockAllocator& allocator)
     state = !state;
   }
 }
+
+void allocator_stats_visualize(const AllocatorStats& stats)
+{
+  auto as_kb = [](uint64_t bytes) { return static_cast<uint32_t>(bytes / 1024u); };
+  ImGui::Text("used %uKB (%uKB cached) | peak %uKB of %uKB | %u allocations, %u frees", as_kb(stats.used_bytes),
+              as_kb(stats.cached_bytes), as_kb(stats.peak_used_bytes), as_kb(stats.capacity_bytes),
+              static_cast<uint32_t>(stats.allocations_count), static_cast<uint32_t>(stats.frees_count));
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "allocator_stats.hh"
 #include "block_allocator.hh"
 
 //
@@ -8,3 +9,8 @@
 // Black - free memory
 //
 void block_allocator_visualize(const BlockAllocator& allocator);
+
+//
+// Renders usage numbers of an allocator tier as a single text line
+//
+void allocator_stats_visualize(const AllocatorStats& stats);
@@ -0,0 +1,529 @@
+#include "compressed_animation.hh"
+#include <SDL2/SDL_assert.h>
+#include <algorithm>
+
+namespace {
+
+// every quaternion component other than the largest one is within +-1/sqrt(2)
+constexpr float SMALLEST_THREE_RANGE = 0.70710678f;
+constexpr float ROTATION_STEPS       = 32767.0f;
+constexpr float VEC3_STEPS           = 65535.0f;
+
+uint16_t quantize(float normalized, float steps)
+{
+  return static_cast<uint16_t>((SDL_max(0.0f, SDL_min(1.0f, normalized)) * steps) + 0.5f);
+}
+
+void encode_rotation(const float* src, uint16_t* dst)
+{
+  const Vec4   q          = Vec4(src[0], src[1], src[2], src[3]).normalize();
+  const float* components = &q.x;
+
+  uint32_t largest = 0;
+  for (uint32_t i = 1; i < 4; ++i)
+    if (SDL_fabsf(components[i]) > SDL_fabsf(components[largest]))
+      largest = i;
+
+  // q and -q are the same rotation, dropped component is always the positive one
+  const float sign = (0.0f > components[largest]) ? -1.0f : 1.0f;
+
+  for (uint32_t i = 0, j = 0; i < 4; ++i)
+    if (largest != i)
+      dst[j++] = quantize(0.5f + (0.5f * sign * components[i] / SMALLEST_THREE_RANGE), ROTATION_STEPS);
+
+  dst[0] |= static_cast<uint16_t>((largest & 1u) << 15);
+  dst[1] |= static_cast<uint16_t>((largest >> 1) << 15);
+}
+
+void encode_vec3(const float* src, const Vec3& range_min, const Vec3& range_step, uint16_t* dst)
+{
+  const float* min  = &range_min.x;
+  const float* step = &range_step.x;
+
+  for (uint32_t i = 0; i < 3; ++i)
+    dst[i] = (0.0f < step[i]) ? quantize((src[i] - min[i]) / (step[i] * VEC3_STEPS), VEC3_STEPS) : 0;
+}
+
+// rotations use all four components, translations and scales leave "w" at zero
+Vec4 decode_keyframe(const CompressedSampler& sampler, const uint16_t* packed)
+{
+  if (3 == sampler.dim)
+  {
+    const Vec3& min  = sampler.range_min;
+    const Vec3& step = sampler.range_step;
+    return Vec4(min.x + (step.x * packed[0]), min.y + (step.y * packed[1]), min.z + (step.z * packed[2]), 0.0f);
+  }
+
+  constexpr float scale = 2.0f * SMALLEST_THREE_RANGE / ROTATION_STEPS;
+
+  const float    a       = (scale * static_cast<float>(packed[0] & 0x7fffu)) - SMALLEST_THREE_RANGE;
+  const float    b       = (scale * static_cast<float>(packed[1] & 0x7fffu)) - SMALLEST_THREE_RANGE;
+  const float    c       = (scale * static_cast<float>(packed[2])) - SMALLEST_THREE_RANGE;
+  const float    largest = SDL_sqrtf(SDL_max(0.0f, 1.0f - ((a * a) + (b * b) + (c * c))));
+  const uint32_t idx     = (packed[0] >> 15) | ((packed[1] >> 15) << 1);
+
+  switch (idx)
+  {
+  case 0:
+    return Vec4(largest, a, b, c);
+  case 1:
+    return Vec4(a, largest, b, c);
+  case 2:
+    return Vec4(a, b, largest, c);
+  default:
+    return Vec4(a, b, c, largest);
+  }
+}
+
+// keyframe "idx" of the samplers own (kept) keyframes
+Vec4 decode_kept_keyframe(const CompressedSampler& sampler, uint32_t idx)
+{
+  if (nullptr == sampler.exact_values)
+    return decode_keyframe(sampler, &sampler.values[3 * idx]);
+
+  const float* value = &sampler.exact_values[sampler.dim * idx];
+  return Vec4(value[0], value[1], value[2], (4 == sampler.dim) ? value[3] : 0.0f);
+}
+
+// value keyframe "idx" of the raw sampler will have after compression, "quantized" is nullptr for exact samplers
+Vec4 compressed_value(const CompressedSampler& sampler, const AnimationSampler& raw, const uint16_t* quantized,
+                      uint32_t idx)
+{
+  if (quantized)
+    return decode_keyframe(sampler, &quantized[3 * idx]);
+
+  const float* value = &raw.values[sampler.dim * idx];
+  return (3 == sampler.dim) ? Vec4(value[0], value[1], value[2], 0.0f)
+                            : Vec4(value[0], value[1], value[2], value[3]).normalize();
+}
+
+Vec4 interpolate(const CompressedSampler& sampler, const Vec4& a, const Vec4& b, float t)
+{
+  if (AnimationSampler::Interpolation::Step == sampler.interpolation)
+    return a;
+
+  if (3 == sampler.dim)
+    return a.lerp(b, t);
+
+  // quantized rotations can land on different hemispheres, shortest path is taken
+  const Vec4 to = (0.0f > a.mul_inner(b)) ? b.scale(-1.0f) : b;
+  return a.lerp(to, t).normalize();
+}
+
+// distance for translations and scales, biggest component difference for rotations (as tolerances are defined)
+float value_error(uint32_t dim, const Vec4& decoded, Vec4 expected)
+{
+  if (3 == dim)
+    return Vec3(decoded.x - expected.x, decoded.y - expected.y, decoded.z - expected.z).len();
+
+  if (0.0f > expected.mul_inner(decoded))
+    expected = expected.scale(-1.0f);
+
+  return SDL_max(SDL_max(SDL_fabsf(decoded.x - expected.x), SDL_fabsf(decoded.y - expected.y)),
+                 SDL_max(SDL_fabsf(decoded.z - expected.z), SDL_fabsf(decoded.w - expected.w)));
+}
+
+float keyframe_error(uint32_t dim, const Vec4& decoded, const float* original)
+{
+  const Vec4 expected = (3 == dim) ? Vec4(original[0], original[1], original[2], 0.0f)
+                                   : Vec4(original[0], original[1], original[2], original[3]).normalize();
+  return value_error(dim, decoded, expected);
+}
+
+//
+// Every keyframe between "first" and "last" is reproduced by interpolating the two within "tolerance". Difference
+// of two linear interpolations is linear too, so for translations and scales checking at keyframes bounds the error
+// everywhere. Normalized rotations bend away from that, they are checked half way between keyframes as well.
+//
+bool is_segment_valid(const CompressedSampler& sampler, const AnimationSampler& raw, const uint16_t* quantized,
+                      uint32_t first, uint32_t last, float tolerance)
+{
+  const Vec4  a    = compressed_value(sampler, raw, quantized, first);
+  const Vec4  b    = compressed_value(sampler, raw, quantized, last);
+  const float span = raw.times[last] - raw.times[first];
+
+  for (uint32_t i = first + 1; i < last; ++i)
+  {
+    const float t = (raw.times[i] - raw.times[first]) / span;
+    if (tolerance < keyframe_error(sampler.dim, interpolate(sampler, a, b, t), &raw.values[sampler.dim * i]))
+      return false;
+  }
+
+  if ((4 == sampler.dim) and (AnimationSampler::Interpolation::Linear == sampler.interpolation))
+  {
+    for (uint32_t i = first; i < last; ++i)
+    {
+      const Vec4* values   = reinterpret_cast<const Vec4*>(raw.values);
+      const float t        = (0.5f * (raw.times[i] + raw.times[i + 1]) - raw.times[first]) / span;
+      const Vec4  to       = (0.0f > values[i].mul_inner(values[i + 1])) ? values[i + 1].scale(-1.0f) : values[i + 1];
+      const Vec4  expected = values[i].normalize().lerp(to.normalize(), 0.5f).normalize();
+      if (tolerance < value_error(sampler.dim, interpolate(sampler, a, b, t), expected))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+//
+// Greedy keyframe removal: from every kept keyframe the segment is stretched as far as the tolerance allows. Error is
+// measured between the raw keyframes and the decoded ones, so quantization is part of it. Segment
+// length is doubled until it fails and then bisected, so long static stretches (common in motion capture) cost
+// a handful of checks instead of one for every keyframe. First and last keyframes are kept, unless the whole sampler
+// is constant (unused scale channels, bones which don't move): then the first one is all that's left.
+//
+uint32_t reduce_keyframes(const CompressedSampler& sampler, const AnimationSampler& raw, const uint16_t* quantized,
+                          float tolerance, uint16_t* kept)
+{
+  const uint32_t last_keyframe = static_cast<uint32_t>(raw.keyframes_count) - 1;
+  const Vec4     constant      = compressed_value(sampler, raw, quantized, 0);
+  uint32_t       kept_count    = 0;
+
+  kept[kept_count++] = 0;
+
+  bool is_constant = true;
+  for (uint32_t i = 1; is_constant and (i <= last_keyframe); ++i)
+    is_constant = (tolerance >= keyframe_error(sampler.dim, constant, &raw.values[sampler.dim * i]));
+
+  if (is_constant)
+    return kept_count;
+
+  for (uint32_t first = 0; first < last_keyframe;)
+  {
+    uint32_t valid   = first + 1;
+    uint32_t invalid = last_keyframe + 1;
+
+    for (uint32_t span = 2; valid < last_keyframe; span *= 2)
+    {
+      const uint32_t candidate = SDL_min(first + span, last_keyframe);
+      if (not is_segment_valid(sampler, raw, quantized, first, candidate, tolerance))
+      {
+        invalid = candidate;
+        break;
+      }
+      valid = candidate;
+    }
+
+    while ((valid + 1) < invalid)
+    {
+      const uint32_t candidate = (valid + invalid) / 2;
+      if (is_segment_valid(sampler, raw, quantized, first, candidate, tolerance))
+        valid = candidate;
+      else
+        invalid = candidate;
+    }
+
+    kept[kept_count++] = static_cast<uint16_t>(valid);
+    first              = valid;
+  }
+
+  return kept_count;
+}
+
+bool is_sampler_active(const CompressedSampler& sampler, const float& animation_time)
+{
+  return (sampler.time_frame[0] < animation_time) and (sampler.time_frame[1] > animation_time);
+}
+
+// same as for the raw samplers, only keyframe times are reached through the kept keyframe indices
+uint32_t advance_cursor(const CompressedSampler& sampler, uint32_t cursor, float animation_time)
+{
+  const float*    times     = sampler.times;
+  const uint16_t* keyframes = sampler.keyframes;
+
+  if (times[keyframes[cursor]] >= animation_time)
+  {
+    const uint16_t* upper = std::lower_bound(keyframes, keyframes + sampler.keyframes_count, animation_time,
+                                             [times](uint16_t keyframe, float time) { return times[keyframe] < time; });
+    return static_cast<uint32_t>(upper - keyframes) - 1;
+  }
+
+  while (times[keyframes[cursor + 1]] < animation_time)
+    cursor += 1;
+
+  return cursor;
+}
+
+} // namespace
+
+bool CompressedAnimation::is_supported(const Animation& animation)
+{
+  return std::all_of(animation.samplers.begin(), animation.samplers.end(), [](const AnimationSampler& sampler) {
+    const int dim = sampler.keyframes_count ? (sampler.values_count / sampler.keyframes_count) : 0;
+    return (AnimationSampler::Interpolation::CubicSpline != sampler.interpolation) and ((3 == dim) or (4 == dim)) and
+           (UINT16_MAX >= sampler.keyframes_count);
+  });
+}
+
+void CompressedAnimation::setup(MemoryAllocator& allocator, const Animation& animation,
+                                const CompressionSettings& settings)
+{
+  SDL_assert(is_supported(animation));
+
+  const uint32_t samplers_count = animation.samplers.count;
+  const uint32_t channels_count = animation.channels.count;
+  const uint32_t tracks_count   = animation.tracks_count;
+
+  uint32_t keyframes_total = 0;
+  uint32_t max_keyframes   = 0;
+
+  for (const AnimationSampler& sampler : animation.samplers)
+  {
+    keyframes_total += static_cast<uint32_t>(sampler.keyframes_count);
+    max_keyframes = SDL_max(max_keyframes, static_cast<uint32_t>(sampler.keyframes_count));
+  }
+
+  //
+  // Every sampler is quantized and reduced into scratch buffers first, final sizes are known only afterwards
+  //
+  CompressedSampler*       compressed      = allocate_array<CompressedSampler>(allocator, samplers_count);
+  uint16_t*                quantized       = allocate_array<uint16_t>(allocator, 3 * max_keyframes);
+  uint16_t*                kept            = allocate_array<uint16_t>(allocator, keyframes_total);
+  uint16_t*                kept_values     = allocate_array<uint16_t>(allocator, 3 * keyframes_total);
+  float*                   kept_exact      = allocate_array<float>(allocator, 4 * keyframes_total);
+  float*                   tolerances      = allocate_array<float>(allocator, samplers_count);
+  const AnimationSampler** track_samplers  = allocate_array<const AnimationSampler*>(allocator, tracks_count);
+  uint32_t                 kept_total      = 0;
+  uint32_t                 values_total    = 0;
+  uint32_t                 exact_total     = 0;
+  uint32_t                 track_keyframes = 0;
+
+  for (uint32_t i = 0; i < samplers_count; ++i)
+    tolerances[i] = settings.translation_tolerance;
+
+  for (const AnimationChannel& channel : animation.channels)
+  {
+    if (AnimationChannel::Path::Rotation == channel.target_path)
+      tolerances[channel.sampler_idx] = settings.rotation_tolerance;
+    else if (AnimationChannel::Path::Scale == channel.target_path)
+      tolerances[channel.sampler_idx] = settings.scale_tolerance;
+  }
+
+  for (uint32_t i = 0; i < tracks_count; ++i)
+    track_samplers[i] = nullptr;
+
+  for (uint32_t sampler_idx = 0; sampler_idx < samplers_count; ++sampler_idx)
+  {
+    const AnimationSampler& raw       = animation.samplers[sampler_idx];
+    CompressedSampler&      sampler   = compressed[sampler_idx];
+    const uint32_t          count     = static_cast<uint32_t>(raw.keyframes_count);
+    const float             tolerance = tolerances[sampler_idx];
+
+    sampler               = {};
+    sampler.time_frame[0] = raw.time_frame[0];
+    sampler.time_frame[1] = raw.time_frame[1];
+    sampler.dim           = static_cast<uint32_t>(raw.values_count / raw.keyframes_count);
+    sampler.interpolation = raw.interpolation;
+
+    if (nullptr == track_samplers[raw.track_idx])
+    {
+      track_samplers[raw.track_idx] = &raw;
+      track_keyframes += count;
+    }
+
+    if (3 == sampler.dim)
+    {
+      Vec3 range_max = Vec3(raw.values[0], raw.values[1], raw.values[2]);
+
+      sampler.range_min = range_max;
+      for (uint32_t i = 1; i < count; ++i)
+      {
+        const float* value = &raw.values[3 * i];
+        sampler.range_min  = Vec3(SDL_min(sampler.range_min.x, value[0]), SDL_min(sampler.range_min.y, value[1]),
+                                  SDL_min(sampler.range_min.z, value[2]));
+        range_max          = Vec3(SDL_max(range_max.x, value[0]), SDL_max(range_max.y, value[1]),
+                                  SDL_max(range_max.z, value[2]));
+      }
+
+      sampler.range_step = (range_max - sampler.range_min).scale(1.0f / VEC3_STEPS);
+
+      for (uint32_t i = 0; i < count; ++i)
+        encode_vec3(&raw.values[3 * i], sampler.range_min, sampler.range_step, &quantized[3 * i]);
+    }
+    else
+    {
+      for (uint32_t i = 0; i < count; ++i)
+        encode_rotation(&raw.values[4 * i], &quantized[3 * i]);
+    }
+
+    //
+    // Kept keyframes are off by their quantization error. Samplers too wide for 16 bit steps to stay within tolerance
+    // (root motion over a long clip) keep exact values instead, keyframe removal still applies to them.
+    //
+    bool is_exact = false;
+    for (uint32_t i = 0; (not is_exact) and (i < count); ++i)
+    {
+      const Vec4 decoded = decode_keyframe(sampler, &quantized[3 * i]);
+      is_exact           = (tolerance < keyframe_error(sampler.dim, decoded, &raw.values[sampler.dim * i]));
+    }
+
+    const uint16_t* sampler_quantized = is_exact ? nullptr : quantized;
+    uint16_t*       sampler_kept      = &kept[kept_total];
+    sampler.keyframes_count = reduce_keyframes(sampler, raw, sampler_quantized, tolerance, sampler_kept);
+
+    if (is_exact)
+    {
+      // marks the sampler as exact until the final location is known
+      sampler.exact_values = &kept_exact[exact_total];
+
+      for (uint32_t i = 0; i < sampler.keyframes_count; ++i)
+      {
+        const Vec4 value = compressed_value(sampler, raw, nullptr, sampler_kept[i]);
+        SDL_memcpy(&kept_exact[exact_total + (sampler.dim * i)], &value.x, sampler.dim * sizeof(float));
+      }
+
+      exact_total += sampler.dim * sampler.keyframes_count;
+    }
+    else
+    {
+      for (uint32_t i = 0; i < sampler.keyframes_count; ++i)
+        SDL_memcpy(&kept_values[3 * (values_total + i)], &quantized[3 * sampler_kept[i]], 3 * sizeof(uint16_t));
+
+      values_total += sampler.keyframes_count;
+    }
+
+    kept_total += sampler.keyframes_count;
+  }
+
+  //
+  // | samplers | channels | track times | exact values | kept keyframe indices | quantized values |
+  //
+  const uint64_t samplers_size  = sizeof(CompressedSampler) * samplers_count;
+  const uint64_t channels_size  = sizeof(AnimationChannel) * channels_count;
+  const uint64_t times_size     = sizeof(float) * track_keyframes;
+  const uint64_t exact_size     = sizeof(float) * exact_total;
+  const uint64_t keyframes_size = sizeof(uint16_t) * kept_total;
+  const uint64_t values_size    = 3 * sizeof(uint16_t) * values_total;
+
+  memory_size = samplers_size + channels_size + times_size + exact_size + keyframes_size + values_size;
+  memory      = reinterpret_cast<uint8_t*>(allocator.Allocate(SDL_max(memory_size, uint64_t(1))));
+  duration    = animation.duration;
+
+  samplers = {reinterpret_cast<CompressedSampler*>(memory), samplers_count};
+  channels = {reinterpret_cast<AnimationChannel*>(&memory[samplers_size]), channels_count};
+
+  float*    times          = reinterpret_cast<float*>(&memory[samplers_size + channels_size]);
+  float*    exact_values   = &times[track_keyframes];
+  uint16_t* keyframes      = reinterpret_cast<uint16_t*>(&exact_values[exact_total]);
+  uint16_t* values         = &keyframes[kept_total];
+  float**   track_times    = allocate_array<float*>(allocator, tracks_count);
+  uint32_t  times_usage    = 0;
+  uint32_t  keyframe_usage = 0;
+  uint32_t  values_usage   = 0;
+
+  for (uint32_t track_idx = 0; track_idx < tracks_count; ++track_idx)
+  {
+    const AnimationSampler* raw = track_samplers[track_idx];
+    track_times[track_idx]      = &times[times_usage];
+
+    if (raw)
+    {
+      SDL_memcpy(track_times[track_idx], raw->times, sizeof(float) * raw->keyframes_count);
+      times_usage += static_cast<uint32_t>(raw->keyframes_count);
+    }
+  }
+
+  SDL_memcpy(channels.data, animation.channels.data, channels_size);
+  SDL_memcpy(exact_values, kept_exact, exact_size);
+  SDL_memcpy(keyframes, kept, keyframes_size);
+  SDL_memcpy(values, kept_values, values_size);
+
+  for (uint32_t sampler_idx = 0; sampler_idx < samplers_count; ++sampler_idx)
+  {
+    CompressedSampler& sampler = samplers[sampler_idx];
+
+    sampler           = compressed[sampler_idx];
+    sampler.times     = track_times[animation.samplers[sampler_idx].track_idx];
+    sampler.keyframes = &keyframes[keyframe_usage];
+    keyframe_usage += sampler.keyframes_count;
+
+    if (sampler.exact_values)
+    {
+      sampler.exact_values = &exact_values[sampler.exact_values - kept_exact];
+    }
+    else
+    {
+      sampler.values = &values[3 * values_usage];
+      values_usage += sampler.keyframes_count;
+    }
+  }
+
+  free_array(allocator, track_times, tracks_count);
+  free_array(allocator, track_samplers, tracks_count);
+  free_array(allocator, tolerances, samplers_count);
+  free_array(allocator, kept_exact, 4 * keyframes_total);
+  free_array(allocator, kept_values, 3 * keyframes_total);
+  free_array(allocator, kept, keyframes_total);
+  free_array(allocator, quantized, 3 * max_keyframes);
+  free_array(allocator, compressed, samplers_count);
+}
+
+void CompressedAnimation::teardown(MemoryAllocator& allocator)
+{
+  allocator.Free(memory, SDL_max(memory_size, uint64_t(1)));
+}
+
+uint64_t animation_memory_size(const Animation& animation)
+{
+  uint64_t size = (sizeof(AnimationSampler) * animation.samplers.count) +
+                  (sizeof(AnimationChannel) * animation.channels.count);
+
+  for (const AnimationSampler& sampler : animation.samplers)
+    size += sizeof(float) * static_cast<uint64_t>(sampler.keyframes_count + sampler.values_count);
+
+  return size;
+}
+
+bool should_compress(const Animation& animation, const CompressionSettings& settings)
+{
+  return CompressedAnimation::is_supported(animation) and (settings.min_raw_size <= animation_memory_size(animation));
+}
+
+void sample_compressed_animation(const CompressedAnimation& animation, float animation_time, uint32_t* cursors,
+                                 const Pose& dst)
+{
+  const AnimationChannel* channels       = animation.channels.data;
+  const uint32_t          channels_count = animation.channels.count;
+
+  for (uint32_t first = 0, last = 0; first < channels_count; first = last)
+  {
+    const int sampler_idx = channels[first].sampler_idx;
+
+    last = first + 1;
+    while ((last < channels_count) and (sampler_idx == channels[last].sampler_idx))
+      last += 1;
+
+    const CompressedSampler&     sampler = animation.samplers[sampler_idx];
+    const AnimationChannel::Path path    = channels[first].target_path;
+
+    if (not is_sampler_active(sampler, animation_time))
+      continue;
+
+    Vec4 value = decode_kept_keyframe(sampler, 0);
+
+    if (1 < sampler.keyframes_count)
+    {
+      const uint32_t keyframe_lower = advance_cursor(sampler, cursors[sampler_idx], animation_time);
+      cursors[sampler_idx]          = keyframe_lower;
+
+      const float lower_time = sampler.times[sampler.keyframes[keyframe_lower]];
+      const float upper_time = sampler.times[sampler.keyframes[keyframe_lower + 1]];
+      const Vec4  lower      = decode_kept_keyframe(sampler, keyframe_lower);
+      const Vec4  upper      = decode_kept_keyframe(sampler, keyframe_lower + 1);
+      value = interpolate(sampler, lower, upper, (animation_time - lower_time) / (upper_time - lower_time));
+    }
+
+    if (AnimationChannel::Path::Rotation == path)
+    {
+      for (uint32_t i = first; i < last; ++i)
+        dst.rotations[channels[i].target_node_idx].data = value;
+    }
+    else
+    {
+      Vec3* targets = (AnimationChannel::Path::Translation == path) ? dst.translations : dst.scales;
+
+      for (uint32_t i = first; i < last; ++i)
+        targets[channels[i].target_node_idx] = Vec3(value.x, value.y, value.z);
+    }
+  }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "animation.hh"
+
+//
+// Animation with quantized keyframes, built at load time from a parsed one. Raw samplers keep 4 bytes for every
+// keyframe time and 12 / 16 bytes for every value, which for long motion capture clips is mostly redundant:
+//
+// - rotations are stored as "smallest three": the largest quaternion component is dropped (it is recovered from the
+//   unit length), the other three are quantized to 15 bits each and the index of the dropped one fits into the two
+//   spare bits, 48 bits per keyframe
+// - translations and scales are quantized to 16 bits per component within the value range of their sampler,
+//   samplers whose range is too wide for that to stay within tolerance keep exact float values
+// - keyframes which linear interpolation of their neighbours reproduces within a tolerance are removed, the rest
+//   reference keyframe times of their track (stored once per track) by a 16 bit index
+//
+// Tolerance bounds the whole error at every raw keyframe time, quantization included. Everything lives in a single
+// allocation and is sampled straight from the quantized data, nothing is decoded ahead of time. Only linear and step
+// samplers are supported.
+//
+// Decoding makes sampling slower than from raw samplers. It pays off only for clips big enough that the raw data
+// doesn't stay in cache (long motion capture), short clips are better left raw - see "should_compress".
+//
+struct CompressedSampler
+{
+  float                           time_frame[2];
+  const float*                    times;        // keyframe times of the track the sampler was on
+  const uint16_t*                 keyframes;    // kept keyframes, indices into "times"
+  const uint16_t*                 values;       // three per kept keyframe
+  const float*                    exact_values; // "dim" per kept keyframe instead of "values", nullptr if quantized
+  Vec3                            range_min;    // translations and scales only
+  Vec3                            range_step;
+  uint32_t                        keyframes_count;
+  uint32_t                        dim;
+  AnimationSampler::Interpolation interpolation;
+};
+
+struct CompressionSettings
+{
+  float rotation_tolerance    = 0.0005f; // per quaternion component
+  float translation_tolerance = 0.0005f; // scene units
+  float scale_tolerance       = 0.0005f;
+
+  // clips with less raw data than this stay uncompressed
+  uint64_t min_raw_size = 1024 * 1024;
+};
+
+struct CompressedAnimation
+{
+  // false for animations with cubic spline samplers, those have to stay uncompressed
+  [[nodiscard]] static bool is_supported(const Animation& animation);
+
+  void setup(MemoryAllocator& allocator, const Animation& animation, const CompressionSettings& settings);
+  void teardown(MemoryAllocator& allocator);
+
+  // same order as in the source animation
+  ArrayView<AnimationChannel>  channels;
+  ArrayView<CompressedSampler> samplers;
+
+  float    duration;
+  uint8_t* memory;
+  uint64_t memory_size;
+};
+
+// bytes taken by keyframe times, values and sampler descriptions of a parsed animation
+uint64_t animation_memory_size(const Animation& animation);
+
+// supported and big enough for the saved memory bandwidth to outweigh the slower sampling
+bool should_compress(const Animation& animation, const CompressionSettings& settings);
+
+//
+// Same contract as sample_animation, but keyframe sets differ between samplers after compression, so there is a
+// cursor for every sampler: "cursors" has CompressedAnimation::samplers.count elements.
+//
+void sample_compressed_animation(const CompressedAnimation& animation, float animation_time, uint32_t* cursors,
+                                 const Pose& dst);
@@ -1,7 +1,6 @@
 #include "cubemap.hh"
 #include "../materials.hh"
 #include "aligned_push_consts.hh"
-#include <algorithm>
 
 static constexpr float calculate_mip_divisor(int mip_level)
 {
@@ -13,22 +12,36 @@ static constexpr float calculate_mip_divisor(int mip_level)
   return result;
 }
 
-static void generate_cubemap_views(Mat4x4 views[6])
+// fence waits only for this submission, vkQueueWaitIdle would wait for everything else on the graphics queue too
+static void submit_and_wait(Engine* engine, VkCommandBuffer cmd)
 {
-  const Vec3 centers[] = {
-      Vec3(1.0f, 0.0f, 0.0f),  Vec3(-1.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f),
-      Vec3(0.0f, -1.0f, 0.0f), Vec3(0.0f, 0.0f, 1.0f),  Vec3(0.0f, 0.0f, -1.0f),
-  };
+  VkFence fence = VK_NULL_HANDLE;
+  {
+    VkFenceCreateInfo ci = {.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    vkCreateFence(engine->device, &ci, nullptr, &fence);
+  }
 
-  const Vec3 ups[] = {
-      Vec3(0.0f, -1.0f, 0.0f), Vec3(0.0f, -1.0f, 0.0f), Vec3(0.0f, 0.0f, 1.0f),
-      Vec3(0.0f, 0.0f, -1.0f), Vec3(0.0f, -1.0f, 0.0f), Vec3(0.0f, -1.0f, 0.0f),
+  VkSubmitInfo submit = {
+      .sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .commandBufferCount = 1,
+      .pCommandBuffers    = &cmd,
   };
 
-  std::transform(centers, &centers[6], ups, views,
-                 [](const Vec3& center, const Vec3& up) { return Mat4x4::LookAt(Vec3(0.0f, 0.0f, 0.0f), center, up); });
+  vkQueueSubmit(engine->graphics_queue, 1, &submit, fence);
+  vkWaitForFences(engine->device, 1, &fence, VK_TRUE, UINT64_MAX);
+  vkDestroyFence(engine->device, fence, nullptr);
 }
 
+// baked at compile time
+static constexpr Mat4x4 cubemap_views[] = {
+    Mat4x4::LookAt(Vec3(0.0f), Vec3(1.0f, 0.0f, 0.0f), Vec3(0.0f, -1.0f, 0.0f)),
+    Mat4x4::LookAt(Vec3(0.0f), Vec3(-1.0f, 0.0f, 0.0f), Vec3(0.0f, -1.0f, 0.0f)),
+    Mat4x4::LookAt(Vec3(0.0f), Vec3(0.0f, 1.0f, 0.0f), Vec3(0.0f, 0.0f, 1.0f)),
+    Mat4x4::LookAt(Vec3(0.0f), Vec3(0.0f, -1.0f, 0.0f), Vec3(0.0f, 0.0f, -1.0f)),
+    Mat4x4::LookAt(Vec3(0.0f), Vec3(0.0f, 0.0f, 1.0f), Vec3(0.0f, -1.0f, 0.0f)),
+    Mat4x4::LookAt(Vec3(0.0f), Vec3(0.0f, 0.0f, -1.0f), Vec3(0.0f, -1.0f, 0.0f)),
+};
+
 static VkExtent3D create_flat_extent(int size[2])
 {
   return {
@@ -51,7 +64,7 @@ static void allocate_memory(Engine* engine, Texture& t)
 {
   VkMemoryRequirements reqs = {};
   vkGetImageMemoryRequirements(engine->device, t.image, &reqs);
-  t.memory_offset = engine->memory_blocks.device_images.allocator.allocate_bytes(align(reqs.size, reqs.alignment));
+  t.memory_offset = engine->memory_blocks.device_images.allocator.allocate_bytes(reqs.size, reqs.alignment);
   vkBindImageMemory(engine->device, t.image, engine->memory_blocks.device_images.memory, t.memory_offset);
 }
 
@@ -504,12 +517,9 @@ Texture generate_cubemap(Engine* engine, Materials* materials, const char* equir
     projection.perspective(1.0f, to_rad(90.0f), 0.1f, 100.0f);
     projection.columns[1].y *= -1.0f;
 
-    Mat4x4 views[6];
-    generate_cubemap_views(views);
-
     for (int i = 0; i < 6; ++i)
     {
-      const Mat4x4 projectionview = projection * views[i];
+      const Mat4x4 projectionview = projection * cubemap_views[i];
 
       vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[i]);
       AlignedPushConsts(cmd, pipeline_layout).push(VK_SHADER_STAGE_VERTEX_BIT, projectionview);
@@ -528,14 +538,7 @@ Texture generate_cubemap(Engine* engine, Materials* materials, const char* equir
     vkCmdEndRenderPass(cmd);
     vkEndCommandBuffer(cmd);
 
-    VkSubmitInfo submit = {
-        .sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .commandBufferCount = 1,
-        .pCommandBuffers    = &cmd,
-    };
-
-    vkQueueSubmit(engine->graphics_queue, 1, &submit, VK_NULL_HANDLE);
-    vkQueueWaitIdle(engine->graphics_queue);
+    submit_and_wait(engine, cmd);
   }
 
   // @todo: this is a leaked resource. We should destroy this at this point, but the pool must be correctly configured
@@ -982,12 +985,9 @@ Texture generate_irradiance_cubemap(Engine* engine, Materials* materials, Textur
     projection.perspective(1.0f, to_rad(90.0f), 0.1f, 100.0f);
     projection.columns[1].y *= -1.0f;
 
-    Mat4x4 views[6];
-    generate_cubemap_views(views);
-
     for (int i = 0; i < 6; ++i)
     {
-      const Mat4x4 projectionview = projection * views[i];
+      const Mat4x4 projectionview = projection * cubemap_views[i];
 
       vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[i]);
       vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
@@ -1007,14 +1007,7 @@ Texture generate_irradiance_cubemap(Engine* engine, Materials* materials, Textur
     vkCmdEndRenderPass(cmd);
     vkEndCommandBuffer(cmd);
 
-    VkSubmitInfo submit = {
-        .sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .commandBufferCount = 1,
-        .pCommandBuffers    = &cmd,
-    };
-
-    vkQueueSubmit(engine->graphics_queue, 1, &submit, VK_NULL_HANDLE);
-    vkQueueWaitIdle(engine->graphics_queue);
+    submit_and_wait(engine, cmd);
   }
 
   // todo: this is a leaked resource. We should destroy this at this point, but the pool must be correctly configured
@@ -1478,13 +1471,10 @@ Texture generate_prefiltered_cubemap(Engine* engine, Materials* materials, Textu
       projection.perspective(1.0f, to_rad(90.0f), 0.1f, 100.0f);
       projection.columns[1].y *= -1.0f;
 
-      Mat4x4 views[6];
-      generate_cubemap_views(views);
-
       const float roughness = (float)mip_level / (float)(DESIRED_MIP_LEVELS - 1);
       for (int cube_side = 0; cube_side < CUBE_SIDES; ++cube_side)
       {
-        const Mat4x4 projectionview = projection * views[cube_side];
+        const Mat4x4 projectionview = projection * cubemap_views[cube_side];
 
         vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[CUBE_SIDES * mip_level + cube_side]);
         vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &descriptor_set, 0,
@@ -1509,14 +1499,7 @@ Texture generate_prefiltered_cubemap(Engine* engine, Materials* materials, Textu
     }
     vkEndCommandBuffer(cmd);
 
-    VkSubmitInfo submit = {
-        .sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .commandBufferCount = 1,
-        .pCommandBuffers    = &cmd,
-    };
-
-    vkQueueSubmit(engine->graphics_queue, 1, &submit, VK_NULL_HANDLE);
-    vkQueueWaitIdle(engine->graphics_queue);
+    submit_and_wait(engine, cmd);
   }
 
   // todo: this is a leaked resource. We should destroy this at this point, but the pool must be correctly configured
@@ -1831,14 +1814,7 @@ Texture generate_brdf_lookup(Engine* engine, int size)
     vkCmdEndRenderPass(cmd);
     vkEndCommandBuffer(cmd);
 
-    VkSubmitInfo submit = {
-        .sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .commandBufferCount = 1,
-        .pCommandBuffers    = &cmd,
-    };
-
-    vkQueueSubmit(engine->graphics_queue, 1, &submit, VK_NULL_HANDLE);
-    vkQueueWaitIdle(engine->graphics_queue);
+    submit_and_wait(engine, cmd);
   }
 
   vkDestroyPipeline(engine->device, pipeline, nullptr);
@@ -58,25 +58,52 @@ void allocate_memory_for_image(VkDevice device, Texture& t, GpuMemoryBlock& bloc
 {
   VkMemoryRequirements reqs = {};
   vkGetImageMemoryRequirements(device, t.image, &reqs);
-  t.memory_offset = block.allocator.allocate_bytes(align(reqs.size, reqs.alignment));
+  t.memory_offset = block.allocator.allocate_bytes(reqs.size, reqs.alignment);
   vkBindImageMemory(device, t.image, block.memory, t.memory_offset);
 }
 
 } // namespace
 
-VkDeviceSize GpuMemoryBlock::allocate_aligned(VkDeviceSize size)
+void GpuMemoryBlock::map(VkDevice device, VkMemoryPropertyFlags memory_type_flags, VkDeviceSize atom_size)
 {
-  return allocator.allocate_bytes(align(size, alignment));
+  SDL_assert(memory_type_flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+
+  host_coherent          = memory_type_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  non_coherent_atom_size = atom_size;
+  vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&mapped));
 }
 
-void GpuMemoryBlock::allocate_aligned_ranged(VkDeviceSize dst[], const uint32_t count, const VkDeviceSize size)
+void GpuMemoryBlock::unmap(VkDevice device)
 {
-  for (uint32_t i = 0; i < count; ++i)
+  if (mapped)
   {
-    dst[i] = allocate_aligned(size);
+    vkUnmapMemory(device, memory);
+    mapped = nullptr;
   }
 }
 
+void GpuMemoryBlock::flush(VkDevice device, VkDeviceSize offset, VkDeviceSize size) const
+{
+  if (host_coherent)
+    return;
+
+  //
+  // Flushed range has to start and end on nonCoherentAtomSize boundaries, unless it ends with the allocation.
+  // Widening it is harmless, neighbouring bytes are either written by their owners before submition or unused.
+  //
+  const VkDeviceSize begin = offset - (offset % non_coherent_atom_size);
+  const VkDeviceSize end   = SDL_min(align(offset + size, non_coherent_atom_size), allocator.max_size);
+
+  VkMappedMemoryRange range = {
+      .sType  = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+      .memory = memory,
+      .offset = begin,
+      .size   = (end == allocator.max_size) ? VK_WHOLE_SIZE : (end - begin),
+  };
+
+  vkFlushMappedMemoryRanges(device, 1, &range);
+}
+
 void Engine::startup(bool vulkan_validation_enabled)
 {
   {
@@ -145,7 +172,7 @@ void Engine::startup(bool vulkan_validation_enabled)
   }
 
   vkGetDeviceQueue(device, graphics_family_index, 0, &graphics_queue);
-  job_system.setup(device, graphics_family_index);
+  job_system.setup(device, graphics_family_index, *generic_allocator, WORKER_THREADS_COUNT);
 
   surface_format = SelectSurfaceFormat(physical_device, surface,
                                        SurfaceFormatSelectionStrategy::PreferSRGBnonlinearBGRA8, *generic_allocator);
@@ -322,6 +349,9 @@ void Engine::startup(bool vulkan_validation_enabled)
     vkAllocateMemory(device, &allocate, nullptr, &memory_blocks.host_visible_transfer_source.memory);
     vkBindBufferMemory(device, gpu_host_visible_transfer_source_memory_buffer,
                        memory_blocks.host_visible_transfer_source.memory, 0);
+    memory_blocks.host_visible_transfer_source.map(device,
+                                                   properties.memoryTypes[allocate.memoryTypeIndex].propertyFlags,
+                                                   physical_device_properties.limits.nonCoherentAtomSize);
   }
 
   // HOST VISIBLE
@@ -354,6 +384,12 @@ void Engine::startup(bool vulkan_validation_enabled)
     memory_blocks.host_coherent.allocator.init(reqs.size);
     vkAllocateMemory(device, &allocate, nullptr, &memory_blocks.host_coherent.memory);
     vkBindBufferMemory(device, gpu_host_coherent_memory_buffer, memory_blocks.host_coherent.memory, 0);
+    memory_blocks.host_coherent.map(device, properties.memoryTypes[allocate.memoryTypeIndex].propertyFlags,
+                                    physical_device_properties.limits.nonCoherentAtomSize);
+
+    GpuMemoryBlock& block = memory_blocks.host_coherent;
+    host_coherent_ring.setup(block.allocator.allocate_bytes(HOST_COHERENT_RING_CAPACITY, block.alignment),
+                             HOST_COHERENT_RING_CAPACITY, block.alignment);
   }
 
   // IMAGES
@@ -502,6 +538,15 @@ void Engine::startup(bool vulkan_validation_enabled)
     memory_blocks.host_coherent_ubo.allocator.init(reqs.size);
     vkAllocateMemory(device, &allocate, nullptr, &memory_blocks.host_coherent_ubo.memory);
     vkBindBufferMemory(device, gpu_host_coherent_ubo_memory_buffer, memory_blocks.host_coherent_ubo.memory, 0);
+    memory_blocks.host_coherent_ubo.map(device, properties.memoryTypes[allocate.memoryTypeIndex].propertyFlags,
+                                        physical_device_properties.limits.nonCoherentAtomSize);
+
+    // dynamic offsets have to respect the device limit as well, not only the buffer requirements
+    GpuMemoryBlock&    block     = memory_blocks.host_coherent_ubo;
+    const VkDeviceSize alignment =
+        SDL_max(block.alignment, physical_device_properties.limits.minUniformBufferOffsetAlignment);
+    host_coherent_ubo_ring.setup(block.allocator.allocate_bytes(HOST_COHERENT_UBO_RING_CAPACITY, alignment),
+                                 HOST_COHERENT_UBO_RING_CAPACITY, alignment);
   }
 
   //
@@ -687,9 +732,11 @@ void Engine::teardown()
   vkDestroyImageView(device, depth_image.image_view, nullptr);
   vkDestroyImage(device, depth_image.image, nullptr);
 
-  for (const GpuMemoryBlock& it : StructureAsArrayView<GpuMemoryBlock>(&memory_blocks))
+  for (GpuMemoryBlock& it : StructureAsArrayView<GpuMemoryBlock>(&memory_blocks))
   {
+    it.unmap(device);
     vkFreeMemory(device, it.memory, nullptr);
+    it.allocator.teardown();
   }
 
   vkDestroyBuffer(device, gpu_device_local_memory_buffer, nullptr);
@@ -1141,7 +1188,7 @@ Texture Engine::load_texture(SDL_Surface* surface, bool register_for_destruction
   {
     VkMemoryRequirements reqs = {};
     vkGetImageMemoryRequirements(device, result.image, &reqs);
-    result.memory_offset = memory_blocks.device_images.allocator.allocate_bytes(align(reqs.size, reqs.alignment));
+    result.memory_offset = memory_blocks.device_images.allocator.allocate_bytes(reqs.size, reqs.alignment);
     vkBindImageMemory(device, result.image, memory_blocks.device_images.memory, result.memory_offset);
   }
 
@@ -1299,6 +1346,222 @@ Texture Engine::load_texture(SDL_Surface* surface, bool register_for_destruction
   return result;
 }
 
+VkBuffer Engine::create_staging_buffer(VkDeviceSize size, VkDeviceMemory& memory) const
+{
+  VkBuffer result = VK_NULL_HANDLE;
+
+  {
+    VkBufferCreateInfo ci = {
+        .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size        = size,
+        .usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+
+    vkCreateBuffer(device, &ci, nullptr, &result);
+  }
+
+  {
+    VkPhysicalDeviceMemoryProperties properties = {};
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &properties);
+
+    VkMemoryRequirements reqs = {};
+    vkGetBufferMemoryRequirements(device, result, &reqs);
+
+    VkMemoryPropertyFlags type = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    VkMemoryAllocateInfo allocate = {
+        .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize  = reqs.size,
+        .memoryTypeIndex = find_memory_type_index(&properties, &reqs, type),
+    };
+
+    vkAllocateMemory(device, &allocate, nullptr, &memory);
+    vkBindBufferMemory(device, result, memory, 0);
+  }
+
+  return result;
+}
+
+Texture Engine::create_texture(uint32_t width, uint32_t height, uint32_t mip_levels)
+{
+  Texture result = {};
+
+  {
+    VkImageCreateInfo ci = {
+        .sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType     = VK_IMAGE_TYPE_2D,
+        .format        = VK_FORMAT_R8G8B8A8_UNORM,
+        .extent        = {.width = width, .height = height, .depth = 1},
+        .mipLevels     = mip_levels,
+        .arrayLayers   = 1,
+        .samples       = VK_SAMPLE_COUNT_1_BIT,
+        .tiling        = VK_IMAGE_TILING_OPTIMAL,
+        .usage         = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        .sharingMode   = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+
+    vkCreateImage(device, &ci, nullptr, &result.image);
+  }
+
+  {
+    VkMemoryRequirements reqs = {};
+    vkGetImageMemoryRequirements(device, result.image, &reqs);
+    result.memory_offset = memory_blocks.device_images.allocator.allocate_bytes(reqs.size, reqs.alignment);
+    vkBindImageMemory(device, result.image, memory_blocks.device_images.memory, result.memory_offset);
+  }
+
+  {
+    VkImageViewCreateInfo ci = {
+        .sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image            = result.image,
+        .viewType         = VK_IMAGE_VIEW_TYPE_2D,
+        .format           = VK_FORMAT_R8G8B8A8_UNORM,
+        .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .levelCount = mip_levels, .layerCount = 1},
+    };
+
+    vkCreateImageView(device, &ci, nullptr, &result.image_view);
+  }
+
+  autoclean_images.push(result.image);
+  autoclean_image_views.push(result.image_view);
+
+  return result;
+}
+
+void Engine::record_texture_upload(VkCommandBuffer cmd, VkBuffer src, VkDeviceSize src_offset, const Texture& dst,
+                                   uint32_t width, uint32_t height, uint32_t mip_levels) const
+{
+  const VkImageSubresourceRange all_levels = {
+      .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+      .baseMipLevel   = 0,
+      .levelCount     = mip_levels,
+      .baseArrayLayer = 0,
+      .layerCount     = 1,
+  };
+
+  {
+    VkImageMemoryBarrier barrier = {
+        .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask       = 0,
+        .dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image               = dst.image,
+        .subresourceRange    = all_levels,
+    };
+
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                         nullptr, 1, &barrier);
+  }
+
+  {
+    // levels are tightly packed one after another, one copy region each
+    VkBufferImageCopy regions[16] = {};
+    SDL_assert(SDL_arraysize(regions) >= mip_levels);
+
+    VkDeviceSize offset = src_offset;
+    for (uint32_t level = 0; level < mip_levels; ++level)
+    {
+      const uint32_t level_width  = SDL_max(width >> level, 1u);
+      const uint32_t level_height = SDL_max(height >> level, 1u);
+
+      regions[level] = {
+          .bufferOffset     = offset,
+          .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = level, .layerCount = 1},
+          .imageExtent      = {.width = level_width, .height = level_height, .depth = 1},
+      };
+
+      offset += 4 * level_width * level_height;
+    }
+
+    vkCmdCopyBufferToImage(cmd, src, dst.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mip_levels, regions);
+  }
+
+  {
+    VkImageMemoryBarrier barrier = {
+        .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask       = VK_ACCESS_SHADER_READ_BIT,
+        .oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .newLayout           = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image               = dst.image,
+        .subresourceRange    = all_levels,
+    };
+
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0,
+                         nullptr, 1, &barrier);
+  }
+}
+
+Texture Engine::load_texture_mip_chain(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t mip_levels)
+{
+  const VkDeviceSize pixels_size    = rgba8_mip_chain_size(width, height, mip_levels);
+  VkDeviceMemory     staging_memory = VK_NULL_HANDLE;
+  VkBuffer           staging_buffer = create_staging_buffer(pixels_size, staging_memory);
+
+  {
+    void* mapped_data = nullptr;
+    vkMapMemory(device, staging_memory, 0, pixels_size, 0, &mapped_data);
+    SDL_memcpy(mapped_data, pixels, static_cast<size_t>(pixels_size));
+    vkUnmapMemory(device, staging_memory);
+  }
+
+  Texture         result         = create_texture(width, height, mip_levels);
+  VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+
+  {
+    VkCommandBufferAllocateInfo allocate = {
+        .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool        = graphics_command_pool,
+        .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+
+    vkAllocateCommandBuffers(device, &allocate, &command_buffer);
+  }
+
+  {
+    VkCommandBufferBeginInfo begin = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+
+    vkBeginCommandBuffer(command_buffer, &begin);
+  }
+
+  record_texture_upload(command_buffer, staging_buffer, 0, result, width, height, mip_levels);
+  vkEndCommandBuffer(command_buffer);
+
+  VkFence image_upload_fence = VK_NULL_HANDLE;
+  {
+    VkFenceCreateInfo ci{.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    vkCreateFence(device, &ci, nullptr, &image_upload_fence);
+  }
+
+  {
+    VkSubmitInfo submit = {
+        .sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers    = &command_buffer,
+    };
+    vkQueueSubmit(graphics_queue, 1, &submit, image_upload_fence);
+  }
+
+  vkWaitForFences(device, 1, &image_upload_fence, VK_TRUE, UINT64_MAX);
+  vkDestroyFence(device, image_upload_fence, nullptr);
+  vkFreeCommandBuffers(device, graphics_command_pool, 1, &command_buffer);
+  vkFreeMemory(device, staging_memory, nullptr);
+  vkDestroyBuffer(device, staging_buffer, nullptr);
+
+  return result;
+}
+
 namespace {
 
 struct TrianglesVertex
@@ -1468,13 +1731,13 @@ void Engine::change_resolution(const VkExtent2D new_size)
   {
     VkMemoryRequirements reqs = {};
     vkGetImageMemoryRequirements(device, msaa_color_image.image, &reqs);
-    memory_blocks.device_images.allocator.free_bytes(msaa_color_image.memory_offset, align(reqs.size, reqs.alignment));
+    memory_blocks.device_images.allocator.free_bytes(msaa_color_image.memory_offset, reqs.size);
   }
 
   {
     VkMemoryRequirements reqs = {};
     vkGetImageMemoryRequirements(device, depth_image.image, &reqs);
-    memory_blocks.device_images.allocator.free_bytes(depth_image.memory_offset, align(reqs.size, reqs.alignment));
+    memory_blocks.device_images.allocator.free_bytes(depth_image.memory_offset, reqs.size);
   }
 
   if (VK_SAMPLE_COUNT_1_BIT != MSAA_SAMPLE_COUNT)
@@ -1498,8 +1761,7 @@ void Engine::change_resolution(const VkExtent2D new_size)
 
     VkMemoryRequirements reqs = {};
     vkGetImageMemoryRequirements(device, msaa_color_image.image, &reqs);
-    msaa_color_image.memory_offset =
-        memory_blocks.device_images.allocator.allocate_bytes(align(reqs.size, reqs.alignment));
+    msaa_color_image.memory_offset = memory_blocks.device_images.allocator.allocate_bytes(reqs.size, reqs.alignment);
     vkBindImageMemory(device, msaa_color_image.image, memory_blocks.device_images.memory,
                       msaa_color_image.memory_offset);
   }
@@ -1524,7 +1786,7 @@ void Engine::change_resolution(const VkExtent2D new_size)
 
     VkMemoryRequirements reqs = {};
     vkGetImageMemoryRequirements(device, depth_image.image, &reqs);
-    depth_image.memory_offset = memory_blocks.device_images.allocator.allocate_bytes(align(reqs.size, reqs.alignment));
+    depth_image.memory_offset = memory_blocks.device_images.allocator.allocate_bytes(reqs.size, reqs.alignment);
     vkBindImageMemory(device, depth_image.image, memory_blocks.device_images.memory, depth_image.memory_offset);
   }
 
@@ -2,6 +2,7 @@
 
 #include "allocators.hh"
 #include "engine_constants.hh"
+#include "gpu_frame_ring.hh"
 #include "gpu_memory_allocator.hh"
 #include "hierarchical_allocator.hh"
 #include "job_system.hh"
@@ -28,6 +29,7 @@ struct Pipelines
   Pair shadowmap;
   Pair skybox;
   Pair scene3D;
+  Pair scene3D_instanced;
   Pair pbr_water;
   Pair colored_geometry;
   Pair colored_geometry_triangle_strip;
@@ -73,14 +75,31 @@ struct DescriptorSetLayouts
   VkDescriptorSetLayout frustum_planes;
 };
 
+//
+// Host visible blocks are mapped once at startup and stay mapped until teardown (nullptr "mapped" otherwise).
+// Writing through "host_span" involves no driver calls, so any thread can fill its own range without locking.
+// For memory types without HOST_COHERENT bit the written range has to be made visible to the device with "flush",
+// which is a no-op for coherent ones. Flushing is thread safe as well.
+//
 struct GpuMemoryBlock
 {
   VkDeviceMemory     memory;
   VkDeviceSize       alignment;
   GpuMemoryAllocator allocator;
+  uint8_t*           mapped;
+  bool               host_coherent;
+  VkDeviceSize       non_coherent_atom_size;
 
-  VkDeviceSize allocate_aligned(VkDeviceSize size);
-  void         allocate_aligned_ranged(VkDeviceSize dst[], uint32_t count, VkDeviceSize size);
+  void map(VkDevice device, VkMemoryPropertyFlags memory_type_flags, VkDeviceSize atom_size);
+  void unmap(VkDevice device);
+  void flush(VkDevice device, VkDeviceSize offset, VkDeviceSize size) const;
+
+  template <typename T> ArrayView<T> host_span(VkDeviceSize offset, uint32_t count = 1) const
+  {
+    SDL_assert(mapped);
+    SDL_assert((offset + count * sizeof(T)) <= allocator.max_size);
+    return {reinterpret_cast<T*>(&mapped[offset]), count};
+  }
 };
 
 struct MemoryBlocks
@@ -99,10 +118,21 @@ struct Texture
   VkDeviceSize memory_offset;
 };
 
+// bytes taken by RGBA8 levels packed one after another
+[[nodiscard]] inline uint64_t rgba8_mip_chain_size(uint32_t width, uint32_t height, uint32_t mip_levels)
+{
+  uint64_t result = 0;
+  for (uint32_t level = 0; level < mip_levels; ++level)
+    result += 4ull * SDL_max(width >> level, 1u) * SDL_max(height >> level, 1u);
+  return result;
+}
+
 struct Engine
 {
   // configuration
   VkSampleCountFlagBits MSAA_SAMPLE_COUNT;
+  uint32_t              WORKER_THREADS_COUNT;
+  bool                  USE_BAKED_ASSETS;
 
   // renderdoc support
   bool                              renderdoc_marker_naming_enabled;
@@ -159,6 +189,10 @@ struct Engine
   // Used for universal buffer objects
   VkBuffer gpu_host_coherent_ubo_memory_buffer;
 
+  // Data living for a single frame (dynamic ubos, dynamic vertices). Space is given back when frame's fence signals.
+  GpuFrameRing host_coherent_ubo_ring;
+  GpuFrameRing host_coherent_ring;
+
   DescriptorSetLayouts descriptor_set_layouts;
   RenderPasses         render_passes;
   Pipelines            pipelines;
@@ -173,7 +207,18 @@ struct Engine
   Texture        load_texture_hdr(const char* filename);
   Texture        load_texture(const char* filepath, bool register_for_destruction = true);
   Texture        load_texture(SDL_Surface* surface, bool register_for_destruction = true);
-  void           insert_debug_marker(VkCommandBuffer cmd, const char* name, const Vec4& color) const;
+  // RGBA8 levels packed one after another, biggest first
+  Texture load_texture_mip_chain(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t mip_levels);
+  void    insert_debug_marker(VkCommandBuffer cmd, const char* name, const Vec4& color) const;
+
+  //
+  // Building blocks for batched uploads. Textures are RGBA8, registered for autoclean and
+  // "record_texture_upload" leaves them in shader read only layout.
+  //
+  VkBuffer create_staging_buffer(VkDeviceSize size, VkDeviceMemory& memory) const;
+  Texture  create_texture(uint32_t width, uint32_t height, uint32_t mip_levels);
+  void     record_texture_upload(VkCommandBuffer cmd, VkBuffer src, VkDeviceSize src_offset, const Texture& dst,
+                                 uint32_t width, uint32_t height, uint32_t mip_levels) const;
 
   //
   // Converting lengths in pixels (xy) to normalized texel coordinates (st).
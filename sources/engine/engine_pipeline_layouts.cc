@@ -72,6 +72,9 @@ void scene3D(Engine& engine)
   };
 
   vkCreatePipelineLayout(engine.device, &ci, nullptr, &engine.pipelines.scene3D.layout);
+
+  // same interface, every pair owns its layout
+  vkCreatePipelineLayout(engine.device, &ci, nullptr, &engine.pipelines.scene3D_instanced.layout);
 }
 
 void pbr_water(Engine& engine)
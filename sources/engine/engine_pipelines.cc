@@ -505,6 +505,44 @@ void scene3d(Engine& engine)
   };
 
   vkCreateGraphicsPipelines(engine.device, VK_NULL_HANDLE, 1, &ci, nullptr, &engine.pipelines.scene3D.pipeline);
+
+  //
+  // Instanced variant: model matrix of every instance is read from the second vertex buffer, one column per location
+  //
+  TwoStageShader instanced_shaders(engine, "triangle_push_instanced.vert", "triangle_push.frag");
+
+  VkVertexInputAttributeDescription instanced_attribute_descriptions[SDL_arraysize(attribute_descriptions) + 4] = {};
+  SDL_memcpy(instanced_attribute_descriptions, attribute_descriptions, sizeof(attribute_descriptions));
+
+  for (uint32_t column = 0; column < 4; ++column)
+  {
+    instanced_attribute_descriptions[SDL_arraysize(attribute_descriptions) + column] = {
+        .location = 3 + column,
+        .binding  = 1,
+        .format   = VK_FORMAT_R32G32B32A32_SFLOAT,
+        .offset   = column * static_cast<uint32_t>(sizeof(Vec4)),
+    };
+  }
+
+  VkVertexInputBindingDescription instanced_binding_descriptions[] = {
+      vertex_binding_descriptions[0],
+      {
+          .binding   = 1,
+          .stride    = sizeof(Mat4x4),
+          .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE,
+      },
+  };
+
+  vertex_input_state.vertexBindingDescriptionCount   = SDL_arraysize(instanced_binding_descriptions);
+  vertex_input_state.pVertexBindingDescriptions      = instanced_binding_descriptions;
+  vertex_input_state.vertexAttributeDescriptionCount = SDL_arraysize(instanced_attribute_descriptions);
+  vertex_input_state.pVertexAttributeDescriptions    = instanced_attribute_descriptions;
+
+  ci.pStages = instanced_shaders.shader_stages;
+  ci.layout  = engine.pipelines.scene3D_instanced.layout;
+
+  vkCreateGraphicsPipelines(engine.device, VK_NULL_HANDLE, 1, &ci, nullptr,
+                            &engine.pipelines.scene3D_instanced.pipeline);
 }
 
 void colored_geometry(Engine& engine)
@@ -0,0 +1,103 @@
+#include "frame_arena.hh"
+#include "allocators.hh"
+#include <new>
+
+FrameArena::FrameArena(uint8_t* memory, uint64_t new_capacity)
+    : last_frame_used(0)
+    , high_water(0)
+    , data(memory)
+    , sp(0)
+    , last_allocation(0)
+    , capacity(new_capacity)
+{
+}
+
+void FrameArena::Reset()
+{
+  last_frame_used = sp;
+  high_water      = SDL_max(high_water, sp);
+  sp              = 0;
+  last_allocation = 0;
+}
+
+void* FrameArena::Allocate(uint64_t size)
+{
+  SDL_assert((sp + align<uint64_t>(size)) <= capacity);
+  last_allocation = size;
+  uint8_t* r      = &data[sp];
+  sp += align<uint64_t>(size);
+  return r;
+}
+
+void* FrameArena::Reallocate(void* ptr, uint64_t size)
+{
+  // only the most recent allocation can be resized, it simply grows in place
+  SDL_assert(ptr == &data[sp - align<uint64_t>(last_allocation)]);
+  sp -= align<uint64_t>(last_allocation);
+  return Allocate(size);
+}
+
+void FrameArena::Free(void*, uint64_t)
+{
+  // released all at once in "Reset"
+}
+
+void FrameArenas::setup(MemoryAllocator& allocator, uint32_t new_threads_count, uint32_t new_images_count,
+                        uint64_t capacity)
+{
+  threads_count    = new_threads_count;
+  images_count     = new_images_count;
+  last_reset_image = 0;
+  arena_capacity   = align<uint64_t>(capacity);
+
+  const uint32_t arenas_count = threads_count * images_count;
+
+  //
+  // Backing memory can easily outgrow the 5MB tier of the engine allocator with many threads,
+  // so it comes from the C heap just like the per job scratch stacks.
+  //
+  memory = reinterpret_cast<uint8_t*>(SDL_malloc(arenas_count * arena_capacity));
+  arenas = reinterpret_cast<FrameArena*>(allocator.Allocate(arenas_count * sizeof(FrameArena)));
+
+  for (uint32_t i = 0; i < arenas_count; ++i)
+    new (&arenas[i]) FrameArena(&memory[i * arena_capacity], arena_capacity);
+}
+
+void FrameArenas::teardown(MemoryAllocator& allocator)
+{
+  const uint32_t arenas_count = threads_count * images_count;
+
+  for (uint32_t i = 0; i < arenas_count; ++i)
+    arenas[i].~FrameArena();
+
+  allocator.Free(arenas, arenas_count * sizeof(FrameArena));
+  SDL_free(memory);
+}
+
+void FrameArenas::reset(uint32_t image_index)
+{
+  for (uint32_t thread_id = 0; thread_id < threads_count; ++thread_id)
+    get(thread_id, image_index).Reset();
+
+  last_reset_image = image_index;
+}
+
+FrameArena& FrameArenas::get(uint32_t thread_id, uint32_t image_index)
+{
+  SDL_assert(thread_id < threads_count);
+  SDL_assert(image_index < images_count);
+  return arenas[thread_id * images_count + image_index];
+}
+
+uint64_t FrameArenas::thread_high_water(uint32_t thread_id) const
+{
+  uint64_t result = 0;
+  for (uint32_t image_index = 0; image_index < images_count; ++image_index)
+    result = SDL_max(result, arenas[thread_id * images_count + image_index].high_water);
+  return result;
+}
+
+uint64_t FrameArenas::thread_last_frame_used(uint32_t thread_id) const
+{
+  return arenas[thread_id * images_count + last_reset_image].last_frame_used;
+}
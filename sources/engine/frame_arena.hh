@@ -0,0 +1,65 @@
+#pragma once
+
+#include "memory_allocator.hh"
+
+//
+// Bump allocator owned by a single thread for a single frame in flight.
+// Individual frees do nothing, everything is released at once by "Reset" after the frame's fence signals.
+// Memory is not owned, it's a slice handed out by FrameArenas.
+//
+class FrameArena : public MemoryAllocator
+{
+public:
+  FrameArena(uint8_t* memory, uint64_t new_capacity);
+
+  void* Allocate(uint64_t size) override;
+  void* Reallocate(void* ptr, uint64_t size) override;
+  void  Free(void* ptr, uint64_t size) override;
+  void  Reset();
+
+  [[nodiscard]] uint64_t get_used() const
+  {
+    return sp;
+  }
+
+  [[nodiscard]] uint64_t get_capacity() const
+  {
+    return capacity;
+  }
+
+  // usage of the frame which was just released by "Reset"
+  uint64_t last_frame_used;
+  // biggest usage seen by this arena since setup
+  uint64_t high_water;
+
+private:
+  uint8_t* data;
+  uint64_t sp;
+  uint64_t last_allocation;
+  uint64_t capacity;
+};
+
+//
+// One arena per thread per frame in flight.
+// Results written into "get(thread_id, image_index)" stay valid until "reset(image_index)" is called again,
+// so update jobs can hand data over to render jobs (and render jobs to the gpu upload) without copying it anywhere.
+//
+struct FrameArenas
+{
+  void        setup(MemoryAllocator& allocator, uint32_t threads_count, uint32_t images_count, uint64_t capacity);
+  void        teardown(MemoryAllocator& allocator);
+  void        reset(uint32_t image_index);
+  FrameArena& get(uint32_t thread_id, uint32_t image_index);
+
+  // highest usage of given thread across all images
+  [[nodiscard]] uint64_t thread_high_water(uint32_t thread_id) const;
+  // usage of given thread in the most recently completed frame
+  [[nodiscard]] uint64_t thread_last_frame_used(uint32_t thread_id) const;
+
+  FrameArena* arenas;
+  uint8_t*    memory;
+  uint32_t    threads_count;
+  uint32_t    images_count;
+  uint32_t    last_reset_image;
+  uint64_t    arena_capacity;
+};
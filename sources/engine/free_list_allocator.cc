@@ -1,30 +1,82 @@
 #include "free_list_allocator.hh"
 #include "allocators.hh"
+#include <bit>
 
-using Node = FreeListAllocator::Node;
+using Block = FreeListAllocator::Block;
 
 namespace {
 
-uint8_t* as_address(Node* node)
+struct SizeClass
 {
-  return reinterpret_cast<uint8_t*>(node);
+  uint32_t first_level;
+  uint32_t second_level;
+};
+
+uint32_t most_significant_bit(uint64_t value)
+{
+  return 63u - static_cast<uint32_t>(std::countl_zero(value));
+}
+
+SizeClass size_class(uint64_t block_size)
+{
+  if (FreeListAllocator::SMALL_BLOCK_SIZE > block_size)
+  {
+    return {0, static_cast<uint32_t>(block_size >> FreeListAllocator::ALIGNMENT_LOG2)};
+  }
+
+  const uint32_t msb = most_significant_bit(block_size);
+  return {
+      msb - FreeListAllocator::FIRST_LEVEL_SHIFT + 1,
+      static_cast<uint32_t>(block_size >> (msb - FreeListAllocator::SECOND_LEVEL_LOG2)) ^
+          FreeListAllocator::SECOND_LEVEL_COUNT,
+  };
+}
+
+//
+// Rounds the request up to the next size class boundary, so any block found in the returned class is big enough.
+//
+SizeClass search_size_class(uint64_t block_size)
+{
+  if (FreeListAllocator::SMALL_BLOCK_SIZE <= block_size)
+  {
+    block_size += (uint64_t(1) << (most_significant_bit(block_size) - FreeListAllocator::SECOND_LEVEL_LOG2)) - 1;
+  }
+  return size_class(block_size);
 }
 
-const uint8_t* as_address(const Node* node)
+uint64_t calc_block_size(uint64_t size)
 {
-  return reinterpret_cast<const uint8_t*>(node);
+  return SDL_max(align(size, FreeListAllocator::ALIGNMENT) + FreeListAllocator::HEADER_SIZE,
+                 FreeListAllocator::MIN_BLOCK_SIZE);
+}
+
+Block* as_block(void* ptr)
+{
+  return reinterpret_cast<Block*>(reinterpret_cast<uint8_t*>(ptr) - FreeListAllocator::HEADER_SIZE);
+}
+
+Block* offset_block(Block* block, uint64_t offset)
+{
+  return reinterpret_cast<Block*>(reinterpret_cast<uint8_t*>(block) + offset);
 }
 
 } // namespace
 
 FreeListAllocator::FreeListAllocator(uint64_t new_capacity)
-    : head{}
-    , pool(reinterpret_cast<uint8_t*>(SDL_malloc(new_capacity)))
-    , capacity(new_capacity)
+    : pool(reinterpret_cast<uint8_t*>(SDL_malloc(new_capacity)))
+    , capacity(new_capacity & SIZE_MASK)
+    , first_level_bitmap(0)
+    , second_level_bitmaps{}
+    , free_blocks{}
 {
-  Node* first = reinterpret_cast<Node*>(pool);
-  *first      = Node{nullptr, static_cast<uint32_t>(capacity)};
-  head        = Node{first, static_cast<uint32_t>(capacity)};
+  SDL_assert(0 == (reinterpret_cast<uintptr_t>(pool) % ALIGNMENT));
+  SDL_assert(MIN_BLOCK_SIZE <= capacity);
+  SDL_assert(FIRST_LEVEL_COUNT > size_class(capacity).first_level);
+
+  Block* first          = reinterpret_cast<Block*>(pool);
+  first->prev_physical  = nullptr;
+  first->size_and_flags = capacity | FREE_FLAG;
+  insert_free_block(first);
 }
 
 FreeListAllocator::~FreeListAllocator()
@@ -34,217 +86,230 @@ FreeListAllocator::~FreeListAllocator()
 
 void* FreeListAllocator::Allocate(uint64_t size)
 {
-  Node* A = &head;
-  Node* B = A->next;
+  const uint64_t block_size = calc_block_size(size);
+  Block*         block      = find_free_block(block_size);
 
-  while (nullptr != B)
+  if (nullptr == block)
   {
-    if (B->size == size)
-    {
-      A->next = B->next;
-      return as_address(B);
-    }
-    else if (B->size > size)
+    SDL_assert(false);
+    return nullptr;
+  }
+
+  remove_free_block(block);
+
+  //
+  // BEFORE:
+  //     [Pool] ... [__________free__________] ...
+  //
+  // AFTER:
+  //     [Pool] ... [___free___][____used____] ...
+  //
+  if ((block->size() - block_size) >= MIN_BLOCK_SIZE)
+  {
+    const uint64_t remainder_size = block->size() - block_size;
+    Block*         used           = offset_block(block, remainder_size);
+    used->prev_physical           = block;
+    used->size_and_flags          = block_size;
+
+    if (Block* next = next_physical(used))
+      next->prev_physical = used;
+
+    block->size_and_flags = remainder_size | FREE_FLAG;
+    insert_free_block(block);
+    block = used;
+  }
+  else
+  {
+    block->size_and_flags &= ~FREE_FLAG;
+  }
+
+  return block->payload();
+}
+
+void* FreeListAllocator::Reallocate(void* ptr, uint64_t size)
+{
+  Block*         block      = as_block(ptr);
+  const uint64_t block_size = calc_block_size(size);
+  SDL_assert(not block->is_free());
+
+  if (block_size > block->size())
+  {
+    Block* next = next_physical(block);
+    if (next and next->is_free() and ((block->size() + next->size()) >= block_size))
     {
-      B->size -= size;
-      return as_address(B) + B->size;
+      //
+      // BEFORE:
+      //     [Pool] ... [__used__][___free___] ...
+      //
+      // AFTER:
+      //     [Pool] ... [_____used_____][free] ...
+      //
+      remove_free_block(next);
+      block->size_and_flags += next->size();
+
+      if (Block* after = next_physical(block))
+        after->prev_physical = block;
     }
     else
     {
-      A = B;
-      B = B->next;
+      // out of memory leaves the old block untouched, same as realloc
+      void* moved = Allocate(size);
+      if (nullptr == moved)
+        return nullptr;
+
+      SDL_memcpy(moved, ptr, block->size() - HEADER_SIZE);
+      Free(ptr, block->size() - HEADER_SIZE);
+      return moved;
     }
   }
 
-  SDL_assert(false);
-  return nullptr;
+  split_tail(block, block_size);
+  return ptr;
 }
 
-void* FreeListAllocator::Reallocate(void* ptr, uint64_t size)
+void FreeListAllocator::Free(void* ptr, uint64_t size)
 {
-  // TODO implement!
-  (void)ptr;
+  uint8_t* free_me = reinterpret_cast<uint8_t*>(ptr);
+  SDL_assert(free_me);
+  SDL_assert((pool + HEADER_SIZE) <= free_me);
+  SDL_assert(&free_me[size] <= &pool[capacity]);
+
+  Block* block = as_block(ptr);
+
+  //
+  // attempting to free already freed memory?
+  //
+  SDL_assert(not block->is_free());
+  SDL_assert(calc_block_size(size) <= block->size());
   (void)size;
-  SDL_assert(false);
-  return ptr;
-}
 
-namespace {
+  block->size_and_flags |= FREE_FLAG;
+  block = merge_with_next(block);
 
-bool are_mergable(const Node* left, const Node* right)
-{
-  return (as_address(left) + left->size) == as_address(right);
+  //
+  // BEFORE:
+  //     [Pool] ... [free][free_me] ...
+  //
+  // AFTER:
+  //     [Pool] ... [_____free____] ...
+  //
+  Block* prev = block->prev_physical;
+  if (prev and prev->is_free())
+  {
+    remove_free_block(prev);
+    prev->size_and_flags += block->size();
+    block = prev;
+
+    if (Block* next = next_physical(block))
+      next->prev_physical = block;
+  }
+
+  insert_free_block(block);
 }
 
-} // namespace
+void FreeListAllocator::insert_free_block(Block* block)
+{
+  const SizeClass c    = size_class(block->size());
+  Block*&         head = free_blocks[c.first_level][c.second_level];
 
-void FreeListAllocator::Free(void* ptr, uint64_t size)
+  block->next_free = head;
+  block->prev_free = nullptr;
+  if (head)
+    head->prev_free = block;
+  head = block;
+
+  first_level_bitmap |= (1u << c.first_level);
+  second_level_bitmaps[c.first_level] |= (1u << c.second_level);
+}
+
+void FreeListAllocator::remove_free_block(Block* block)
 {
-  uint8_t* free_me = reinterpret_cast<uint8_t*>(ptr);
-  SDL_assert(free_me);
-  SDL_assert(pool <= free_me);
-  SDL_assert(&free_me[size] <= &pool[capacity]);
+  const SizeClass c = size_class(block->size());
 
-  Node* A = &head;
-  Node* B = A->next;
-  Node* C = reinterpret_cast<Node*>(free_me);
+  if (block->prev_free)
+    block->prev_free->next_free = block->next_free;
+  if (block->next_free)
+    block->next_free->prev_free = block->prev_free;
 
-  if (free_me < as_address(B))
+  Block*& head = free_blocks[c.first_level][c.second_level];
+  if (head == block)
   {
-    // BEFORE:
-    //     [Head] ------------------*
-    //                              |
-    //     [Pool] ... [free_me] ... [Node] ---> ...
-    //
-    // AFTER:
-    //     [Head] ----*
-    //                |
-    //     [Pool] ... [Node] ---> [Node] ---> ...
-    //
-    C->size = size;
-    C->next = B;
-
-    if (are_mergable(C, B))
+    head = block->next_free;
+    if (nullptr == head)
     {
-      // BEFORE:
-      //     [Head] -------------*
-      //                         |
-      //     [Pool] ... [free_me][Node] ---> ...
-      //
-      // AFTER:
-      //     [Head] ----*
-      //                |
-      //     [Pool] ... [_____Node____] ---> ...
-      //
-      C->size += B->size;
-      C->next = B->next;
+      second_level_bitmaps[c.first_level] &= ~(1u << c.second_level);
+      if (0 == second_level_bitmaps[c.first_level])
+        first_level_bitmap &= ~(1u << c.first_level);
     }
-
-    A->next = C;
-    return;
   }
-  else
+}
+
+Block* FreeListAllocator::find_free_block(uint64_t block_size)
+{
+  SizeClass c = search_size_class(block_size);
+  if (FIRST_LEVEL_COUNT <= c.first_level)
+    return nullptr;
+
+  uint32_t second_level_map = second_level_bitmaps[c.first_level] & (~0u << c.second_level);
+  if (0 == second_level_map)
   {
-    while (nullptr != B)
-    {
-      const uint8_t* end_address = as_address(B) + B->size;
-      SDL_assert(end_address <= free_me);
-
-      uint8_t* next_address = as_address(B->next);
-
-      if (nullptr == next_address)
-      {
-        //
-        // [Head] ----*
-        //            |
-        // [Pool] ... [Node] ... [free_me]
-        //                 |
-        //                 *---> null
-        //
-        if (are_mergable(B, C))
-        {
-          //
-          // [Head] ----*
-          //            |
-          // [Pool] ... [_______Node_______] ---> null
-          //
-          B->size += size;
-        }
-        else
-        {
-          //
-          // [Head] ----*
-          //            |
-          // [Pool] ... [Node] ---> [Node] ---> null
-          //
-          C->size = size;
-          C->next = nullptr;
-          B->next = C;
-        }
-        return;
-      }
-      else if (are_mergable(B, C))
-      {
-        //
-        // BEFORE:
-        //     [Head] ----*
-        //                |
-        //     [Pool] ... [Node][free_me] ... ---> ...
-        //                     |              |
-        //                     *--------------*
-        // AFTER:
-        //     [Head] ----*
-        //                |
-        //     [Pool] ... [_____Node____] ---> ...
-        //
-        B->size += size;
-
-        if (are_mergable(B, B->next))
-        {
-          //
-          // BEFORE:
-          //     [Head] ----*
-          //                |
-          //     [Pool] ... [Node][free_me][Node] ---> ...
-          //                     |         |
-          //                     *---------*
-          // AFTER:
-          //     [Head] ----*
-          //                |
-          //     [Pool] ... [________Node_______] ---> ...
-          //
-          B->size += B->next->size;
-          B->next = B->next->next;
-        }
-        return;
-      }
-      else if (next_address > free_me)
-      {
-        if (&free_me[size] == next_address)
-        {
-          // BEFORE:
-          //     [Head] ----*
-          //                |
-          //     [Pool] ... [Node] ... [free_me][Node] ---> ...
-          //                     |              |
-          //                     *--------------*
-          // AFTER:
-          //     [Head] ----*
-          //                |
-          //     [Pool] ... [Node] --> [_____Node____] ---> ...
-          //
-          C->size = B->next->size + size;
-          C->next = B->next->next;
-          B->next = C;
-          return;
-        }
-        else
-        {
-          // BEFORE:
-          //     [Head] ----*
-          //                |
-          //     [Pool] ... [Node] ... [free_me] ... [Node] ---> ...
-          //                     |                   |
-          //                     *-------------------*
-          //
-          // AFTER:
-          //     [Head] ----*
-          //                |
-          //     [Pool] ... [Node] ---> [Node] ----> [Node] ---> ...
-          //
-          C->size = size;
-          C->next = B->next;
-          B->next = C;
-          return;
-        }
-      }
-      else
-      {
-        A = B;
-        B = A->next;
-      }
-    }
+    // nothing in this power of two range, first non empty bigger range has to fit
+    const uint32_t first_level_map =
+        (FIRST_LEVEL_COUNT > (c.first_level + 1)) ? (first_level_bitmap & (~0u << (c.first_level + 1))) : 0;
+
+    if (0 == first_level_map)
+      return nullptr;
+
+    c.first_level    = std::countr_zero(first_level_map);
+    second_level_map = second_level_bitmaps[c.first_level];
   }
 
-  SDL_assert(false);
+  c.second_level = std::countr_zero(second_level_map);
+  return free_blocks[c.first_level][c.second_level];
+}
+
+Block* FreeListAllocator::next_physical(Block* block)
+{
+  uint8_t* next = reinterpret_cast<uint8_t*>(block) + block->size();
+  return (&pool[capacity] == next) ? nullptr : reinterpret_cast<Block*>(next);
+}
+
+//
+// Gives the tail past "block_size" back as a free block, if it's big enough to be one.
+//
+void FreeListAllocator::split_tail(Block* block, uint64_t block_size)
+{
+  if ((block->size() - block_size) < MIN_BLOCK_SIZE)
+    return;
+
+  Block* tail          = offset_block(block, block_size);
+  tail->prev_physical  = block;
+  tail->size_and_flags = (block->size() - block_size) | FREE_FLAG;
+  block->size_and_flags -= tail->size();
+
+  if (Block* next = next_physical(tail))
+    next->prev_physical = tail;
+
+  insert_free_block(merge_with_next(tail));
+}
+
+//
+// BEFORE:
+//     [Pool] ... [free][free] ...
+//
+// AFTER:
+//     [Pool] ... [___free___] ...
+//
+Block* FreeListAllocator::merge_with_next(Block* block)
+{
+  Block* next = next_physical(block);
+  if (next and next->is_free())
+  {
+    remove_free_block(next);
+    block->size_and_flags += next->size();
+
+    if (Block* after = next_physical(block))
+      after->prev_physical = block;
+  }
+  return block;
 }
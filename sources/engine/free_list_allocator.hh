@@ -2,14 +2,56 @@
 
 #include "memory_allocator.hh"
 
+//
+// Two level segregated fit (TLSF) allocator.
+//
+// Free blocks are kept in size classes: first level splits sizes by power of two, second level splits every power of
+// two range into 32 linear steps. Non empty classes are marked in bitmaps, so finding a big enough free block is two
+// bit scans. Every block starts with a header (boundary tag) holding its size, free flag and pointer to the block
+// physically before it, which lets "Free" and "Reallocate" reach both neighbours in constant time.
+//
+// Memory is handed out from the end of the split free block, so the remainder keeps its place in the pool.
+//
 struct FreeListAllocator : public MemoryAllocator
 {
-  struct Node
+  static constexpr uint64_t ALIGNMENT_LOG2     = 4;
+  static constexpr uint64_t ALIGNMENT          = uint64_t(1) << ALIGNMENT_LOG2;
+  static constexpr uint32_t SECOND_LEVEL_LOG2  = 5;
+  static constexpr uint32_t SECOND_LEVEL_COUNT = 1u << SECOND_LEVEL_LOG2;
+  static constexpr uint32_t FIRST_LEVEL_SHIFT  = SECOND_LEVEL_LOG2 + ALIGNMENT_LOG2;
+  static constexpr uint32_t FIRST_LEVEL_COUNT  = 32;
+  static constexpr uint64_t SMALL_BLOCK_SIZE   = uint64_t(1) << FIRST_LEVEL_SHIFT;
+  static constexpr uint64_t FREE_FLAG          = 1;
+  static constexpr uint64_t SIZE_MASK          = ~(ALIGNMENT - 1);
+
+  struct Block
   {
-    Node*    next;
-    unsigned size;
+    Block*   prev_physical;
+    uint64_t size_and_flags; // whole block size including this header
+
+    // valid only while the block is free, otherwise it's already user memory
+    Block* next_free;
+    Block* prev_free;
+
+    [[nodiscard]] uint64_t size() const
+    {
+      return size_and_flags & SIZE_MASK;
+    }
+
+    [[nodiscard]] bool is_free() const
+    {
+      return size_and_flags & FREE_FLAG;
+    }
+
+    [[nodiscard]] uint8_t* payload()
+    {
+      return reinterpret_cast<uint8_t*>(this) + HEADER_SIZE;
+    }
   };
 
+  static constexpr uint64_t HEADER_SIZE    = 2 * sizeof(uint64_t);
+  static constexpr uint64_t MIN_BLOCK_SIZE = sizeof(Block);
+
   explicit FreeListAllocator(uint64_t capacity);
   ~FreeListAllocator() override;
 
@@ -17,7 +59,36 @@ struct FreeListAllocator : public MemoryAllocator
   void* Reallocate(void* ptr, uint64_t size) override;
   void  Free(void* ptr, uint64_t size) override;
 
-  Node     head;
+  // bytes which can be used through a pointer returned by Allocate / Reallocate, at least as much as requested
+  [[nodiscard]] static uint64_t usable_size(const void* ptr)
+  {
+    return reinterpret_cast<const Block*>(reinterpret_cast<const uint8_t*>(ptr) - HEADER_SIZE)->size() - HEADER_SIZE;
+  }
+
+  // walks over every block in address order, "fcn" is called with (const uint8_t* begin, uint64_t size, bool is_free)
+  template <typename Fcn> void for_each_block(Fcn fcn) const
+  {
+    const uint8_t* it  = pool;
+    const uint8_t* end = &pool[capacity];
+    while (end != it)
+    {
+      const Block* block = reinterpret_cast<const Block*>(it);
+      fcn(it, block->size(), block->is_free());
+      it += block->size();
+    }
+  }
+
   uint8_t* pool;
   uint64_t capacity;
+  uint32_t first_level_bitmap;
+  uint32_t second_level_bitmaps[FIRST_LEVEL_COUNT];
+  Block*   free_blocks[FIRST_LEVEL_COUNT][SECOND_LEVEL_COUNT];
+
+private:
+  void   insert_free_block(Block* block);
+  void   remove_free_block(Block* block);
+  Block* find_free_block(uint64_t block_size);
+  Block* next_physical(Block* block);
+  void   split_tail(Block* block, uint64_t block_size);
+  Block* merge_with_next(Block* block);
 };
@@ -1,10 +1,11 @@
 #pragma once
 
+#include "allocator_stats.hh"
 #include "free_list_allocator.hh"
 
 //
-// Renders the allocation visualization bar in current imgui window
+// Renders usage numbers followed by the allocation visualization bar in current imgui window
 // Red   - used memory
 // Black - free memory
 //
-void free_list_visualize(const FreeListAllocator& allocator);
+void free_list_visualize(const FreeListAllocator& allocator, const AllocatorStats& stats);
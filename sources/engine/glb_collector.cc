@@ -0,0 +1,165 @@
+#include "glb_collector.hh"
+#include "stb_image.h"
+
+namespace {
+
+//
+// Each level is a 2x2 box filter of the previous one, odd dimensions reuse the last row / column.
+//
+uint8_t* generate_mip_chain(const uint8_t* image, uint32_t width, uint32_t height, BakedTexture& description)
+{
+  uint32_t mip_levels = 1;
+  while ((1 < (width >> (mip_levels - 1))) or (1 < (height >> (mip_levels - 1))))
+    mip_levels += 1;
+
+  const uint64_t total_size = rgba8_mip_chain_size(width, height, mip_levels);
+  uint8_t*       result     = reinterpret_cast<uint8_t*>(SDL_malloc(total_size));
+  SDL_memcpy(result, image, 4ull * width * height);
+
+  uint8_t* src        = result;
+  uint32_t src_width  = width;
+  uint32_t src_height = height;
+
+  for (uint32_t level = 1; level < mip_levels; ++level)
+  {
+    uint8_t*       dst        = &src[4ull * src_width * src_height];
+    const uint32_t dst_width  = SDL_max(src_width / 2, 1u);
+    const uint32_t dst_height = SDL_max(src_height / 2, 1u);
+
+    for (uint32_t y = 0; y < dst_height; ++y)
+    {
+      const uint32_t y0 = SDL_min(2 * y, src_height - 1);
+      const uint32_t y1 = SDL_min((2 * y) + 1, src_height - 1);
+
+      for (uint32_t x = 0; x < dst_width; ++x)
+      {
+        const uint32_t x0 = SDL_min(2 * x, src_width - 1);
+        const uint32_t x1 = SDL_min((2 * x) + 1, src_width - 1);
+
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+          const uint32_t sum = src[4 * ((y0 * src_width) + x0) + c] + src[4 * ((y0 * src_width) + x1) + c] +
+                               src[4 * ((y1 * src_width) + x0) + c] + src[4 * ((y1 * src_width) + x1) + c];
+          dst[4 * ((y * dst_width) + x) + c] = static_cast<uint8_t>((sum + 2) / 4);
+        }
+      }
+    }
+
+    src        = dst;
+    src_width  = dst_width;
+    src_height = dst_height;
+  }
+
+  description = {
+      .width       = width,
+      .height      = height,
+      .mip_levels  = mip_levels,
+      .pixels_size = total_size,
+  };
+
+  return result;
+}
+
+} // namespace
+
+uint64_t ByteStream::append(const void* src, uint64_t bytes, uint64_t alignment)
+{
+  const uint64_t offset = (size + alignment - 1) & ~(alignment - 1);
+
+  if (capacity < (offset + bytes))
+  {
+    capacity = SDL_max(2 * capacity, offset + bytes);
+    data     = reinterpret_cast<uint8_t*>(SDL_realloc(data, capacity));
+  }
+
+  SDL_memset(&data[size], 0, offset - size);
+  if (src)
+    SDL_memcpy(&data[offset], src, bytes);
+  else
+    SDL_memset(&data[offset], 0, bytes);
+
+  size = offset + bytes;
+  return offset;
+}
+
+void ByteStream::teardown()
+{
+  SDL_free(data);
+}
+
+void GlbCollector::texture(Texture& dst, const uint8_t* image, uint32_t size)
+{
+  uint32_t image_idx = 0;
+  while ((image_idx < images_count) and (images[image_idx].encoded != image))
+    image_idx += 1;
+
+  if (image_idx == images_count)
+  {
+    SDL_assert(MAX_IMAGES > images_count);
+    images[images_count++] = {.encoded = image, .encoded_size = size};
+  }
+
+  SDL_assert(MAX_ASSIGNMENTS > assignments_count);
+  assignments[assignments_count++] = {&dst, image_idx};
+}
+
+void GlbCollector::mesh(Mesh& dst, const uint8_t* data, uint32_t indices_size, uint32_t vertices_size)
+{
+  dst.indices_offset  = geometry.append(data, indices_size);
+  dst.vertices_offset = geometry.append(&data[indices_size], vertices_size);
+}
+
+void GlbCollector::decode_image(uint32_t idx, bool mipmapped)
+{
+  DecodedImage& image       = images[idx];
+  int           x           = 0;
+  int           y           = 0;
+  int           real_format = 0;
+  stbi_uc*      pixels      = stbi_load_from_memory(image.encoded, static_cast<int>(image.encoded_size), &x, &y,
+                                                    &real_format, STBI_rgb_alpha);
+
+  const uint32_t width  = static_cast<uint32_t>(x);
+  const uint32_t height = static_cast<uint32_t>(y);
+
+  image.mipmapped = mipmapped;
+
+  if (mipmapped)
+  {
+    image.pixels = generate_mip_chain(pixels, width, height, image.description);
+    stbi_image_free(pixels);
+  }
+  else
+  {
+    image.pixels      = pixels;
+    image.description = {
+        .width       = width,
+        .height      = height,
+        .mip_levels  = 1,
+        .pixels_size = rgba8_mip_chain_size(width, height, 1),
+    };
+  }
+}
+
+void GlbCollector::fill_material_textures(const ArrayView<Material>& materials, uint32_t* dst) const
+{
+  const Texture* first = reinterpret_cast<const Texture*>(materials.data);
+
+  for (uint32_t i = 0; i < (5 * materials.count); ++i)
+    dst[i] = BakedSceneHeader::NO_TEXTURE;
+
+  for (uint32_t i = 0; i < assignments_count; ++i)
+    dst[assignments[i].texture - first] = assignments[i].image_idx;
+}
+
+void GlbCollector::teardown()
+{
+  for (uint32_t i = 0; i < images_count; ++i)
+  {
+    if (images[i].mipmapped)
+      SDL_free(images[i].pixels);
+    else
+      stbi_image_free(images[i].pixels);
+  }
+
+  geometry.teardown();
+}
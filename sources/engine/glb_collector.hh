@@ -0,0 +1,59 @@
+#pragma once
+
+#include "baked_scene.hh"
+
+// growable byte buffer
+struct ByteStream
+{
+  uint8_t* data;
+  uint64_t size;
+  uint64_t capacity;
+
+  // "src" may be null, space is zeroed then
+  uint64_t append(const void* src, uint64_t bytes, uint64_t alignment = 16);
+  void     teardown();
+};
+
+struct DecodedImage
+{
+  const uint8_t* encoded;
+  uint32_t       encoded_size;
+  BakedTexture   description;
+  uint8_t*       pixels;
+  bool           mipmapped;
+};
+
+//
+// Collects gpu data of a glb while it's parsed instead of uploading it.
+// Materials reference images of the glb binary chunk, the same image is recorded only once and decoded later on
+// (glb has to stay alive until then). Mesh data is appended to a single geometry blob, mesh offsets are relative to it.
+//
+class GlbCollector : public GlbConsumer
+{
+public:
+  static constexpr uint32_t MAX_IMAGES      = 256;
+  static constexpr uint32_t MAX_ASSIGNMENTS = 1024;
+
+  void texture(Texture& dst, const uint8_t* image, uint32_t size) override;
+  void mesh(Mesh& dst, const uint8_t* data, uint32_t indices_size, uint32_t vertices_size) override;
+
+  // RGBA8, mipmapped images get a box filtered mip chain down to 1x1
+  void decode_image(uint32_t idx, bool mipmapped);
+
+  // flat table of image indices (see BakedSceneHeader::material_textures_offset)
+  void fill_material_textures(const ArrayView<Material>& materials, uint32_t* dst) const;
+
+  void teardown();
+
+  struct Assignment
+  {
+    const Texture* texture;
+    uint32_t       image_idx;
+  };
+
+  DecodedImage images[MAX_IMAGES];
+  uint32_t     images_count;
+  Assignment   assignments[MAX_ASSIGNMENTS];
+  uint32_t     assignments_count;
+  ByteStream   geometry;
+};
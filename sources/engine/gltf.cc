@@ -1,247 +1,31 @@
 #include "gltf.hh"
-#include "stb_image.h"
+#include "json.hh"
 #include <SDL2/SDL_assert.h>
-#include <SDL2/SDL_log.h>
-#include <SDL2/SDL_timer.h>
 #include <algorithm>
 
-#ifndef __linux__
-#include <stdlib.h>
-#endif
-
 namespace {
 
-size_t find_substring_idx(const char* big_string, const size_t big_string_length, const char* small_string)
-{
-  size_t result              = 0;
-  size_t small_string_length = SDL_strlen(small_string);
-
-  if (small_string_length > big_string_length)
-    return 0;
-
-  for (size_t i = 0; i < (big_string_length - small_string_length); ++i)
-  {
-    if (0 == SDL_memcmp(&big_string[i], small_string, small_string_length))
-    {
-      result = i;
-      break;
-    }
-  }
-
-  return result;
-}
-
-bool is_open_bracket(char in) { return ('{' == in) or ('[' == in); }
-
-bool is_closing_bracket(char in) { return ('}' == in) or (']' == in); }
-
-struct Seeker
-{
-  const char* data;
-  size_t      length;
-
-  Seeker node(const char* name) const
-  {
-    const size_t name_length = SDL_strlen(name);
-    const char*  iter        = data;
-
-    while ('{' != *iter)
-      ++iter;
-    ++iter;
-
-    int  open_brackets = 1;
-    char character     = *iter;
-
-    while (1 <= open_brackets)
-    {
-      if (is_open_bracket(character))
-      {
-        open_brackets += 1;
-      }
-      else if (is_closing_bracket(character))
-      {
-        open_brackets -= 1;
-      }
-      else if ((1 == open_brackets) and ('"' == character))
-      {
-        if (0 == SDL_memcmp(&iter[1], name, name_length))
-        {
-          return {iter, length - (iter - data)};
-        }
-      }
-
-      ++iter;
-      character = *iter;
-    }
-
-    return *this;
-  }
-
-  bool has(const char* name) const
-  {
-    const char* iter = data;
-    while ('{' != *iter)
-      ++iter;
-    ++iter;
-
-    int open_brackets = 1;
-    while ((1 <= open_brackets) and (iter != &data[length]))
-    {
-      char character = *iter;
-      if (is_open_bracket(character))
-      {
-        open_brackets += 1;
-      }
-      else if (is_closing_bracket(character))
-      {
-        open_brackets -= 1;
-      }
-
-      ++iter;
-    }
-
-    size_t sublen = (iter - data);
-    return (0 != find_substring_idx(data, sublen, name));
-  }
-
-  [[nodiscard]] Seeker idx(const int desired_array_element) const
-  {
-    Seeker result{};
-
-    const char* iter = data;
-    while ('[' != *iter)
-      ++iter;
-    ++iter;
-
-    if (0 != desired_array_element)
-    {
-      int open_brackets = 1;
-      int array_element = 0;
-
-      while (array_element != desired_array_element)
-      {
-        char character = *iter;
-        if (is_open_bracket(character))
-        {
-          open_brackets += 1;
-        }
-        else if (is_closing_bracket(character))
-        {
-          open_brackets -= 1;
-        }
-        else if ((1 == open_brackets) and (',' == character))
-        {
-          array_element += 1;
-        }
-
-        ++iter;
-      }
-    }
-
-    result.data   = iter;
-    result.length = length - (iter - data);
-
-    return result;
-  }
-
-  [[nodiscard]] int idx_integer(const int desired_array_element) const
-  {
-    Seeker element = idx(desired_array_element);
-    long   result  = SDL_strtol(element.data, nullptr, 10);
-    return static_cast<int>(result);
-  }
-
-  [[nodiscard]] float idx_float(const int desired_array_element) const
-  {
-    Seeker element = idx(desired_array_element);
-
-#ifdef __linux__
-    double result = SDL_strtod(element.data, nullptr);
-#else
-    // Apperently SDL_strtod on windows does not read scientific
-    // notation correctly when not compiled with correct compilation
-    // flag.
-    double result = strtod(element.data, nullptr);
-#endif
-
-    return static_cast<float>(result);
-  }
-
-  [[nodiscard]] int elements_count() const
-  {
-    const char* iter = data;
-    while ('[' != *iter)
-      ++iter;
-    ++iter;
-
-    int  result        = 1;
-    int  open_brackets = 1;
-    char character     = *iter;
-
-    while (1 <= open_brackets)
-    {
-      if (is_open_bracket(character))
-      {
-        open_brackets += 1;
-      }
-      else if (is_closing_bracket(character))
-      {
-        open_brackets -= 1;
-      }
-      else if ((1 == open_brackets) and (',' == character))
-      {
-        result += 1;
-      }
-
-      ++iter;
-      character = *iter;
-    }
-
-    return result;
-  }
-
-  int integer(const char* name) const
-  {
-    const size_t idx = find_substring_idx(data, length, name);
-
-    const char* iter = &data[idx];
-    while (':' != *iter)
-      ++iter;
-    ++iter;
-
-    long result = SDL_strtol(iter, nullptr, 10);
-    return static_cast<int>(result);
-  }
-};
-
 struct TextureLoadOp
 {
   Texture&    dst;
   const char* name;
 };
 
-void load_textures(TextureLoadOp ops[], uint32_t n, Engine& engine, const uint8_t* binary_data,
-                   const Seeker& material_json, const Seeker& images_json, const Seeker& buffer_views_json)
+void load_textures(TextureLoadOp ops[], uint32_t n, GlbConsumer& consumer, const uint8_t* binary_data,
+                   const JsonValue& material_json, const JsonValue& images_json, const JsonValue& buffer_views_json)
 {
   TextureLoadOp* begin = ops;
   TextureLoadOp* end   = &ops[n];
 
   for (TextureLoadOp* t = begin; t != end; ++t)
   {
-    int    image_idx       = material_json.node(t->name).integer("index");
-    int    buffer_view_idx = images_json.idx(image_idx).integer("bufferView");
-    Seeker buffer_view     = buffer_views_json.idx(buffer_view_idx);
-    int    offset          = buffer_view.integer("byteOffset");
-    int    length          = buffer_view.integer("byteLength");
-    int    x               = 0;
-    int    y               = 0;
-    int    real_format     = 0;
-
-    SDL_PixelFormat format  = {.format = SDL_PIXELFORMAT_RGBA32, .BitsPerPixel = 32, .BytesPerPixel = (32 + 7) / 8};
-    stbi_uc*        pixels  = stbi_load_from_memory(&binary_data[offset], length, &x, &y, &real_format, STBI_rgb_alpha);
-    SDL_Surface     surface = {.format = &format, .w = x, .h = y, .pitch = 4 * x, .pixels = pixels};
-    t->dst                  = engine.load_texture(&surface);
-    stbi_image_free(pixels);
+    int       image_idx       = material_json.node(t->name).integer("index");
+    int       buffer_view_idx = images_json.idx(image_idx).integer("bufferView");
+    JsonValue buffer_view     = buffer_views_json.idx(buffer_view_idx);
+    int       offset          = buffer_view.integer("byteOffset");
+    int       length          = buffer_view.integer("byteLength");
+
+    consumer.texture(t->dst, &binary_data[offset], static_cast<uint32_t>(length));
   }
 }
 
@@ -266,36 +50,36 @@ const uint8_t* find_glb_binary_data(const uint8_t* blob)
 
 } // namespace
 
-SceneGraph loadGLB(Engine& engine, const char* path)
+SceneGraph parseGLB(const uint8_t* glb_file_content, HierarchicalAllocator& allocator, GlbConsumer& consumer)
 {
-  uint64_t start = SDL_GetPerformanceCounter();
-
-  SDL_RWops* ctx              = SDL_RWFromFile(path, "rb");
-  uint64_t   glb_file_size    = static_cast<uint64_t>(SDL_RWsize(ctx));
-  uint8_t*   glb_file_content = engine.generic_allocator->allocate<uint8_t>(static_cast<uint32_t>(glb_file_size));
+  const uint8_t* binary_data = find_glb_binary_data(glb_file_content);
 
-  SDL_RWread(ctx, glb_file_content, sizeof(char), glb_file_size);
-  SDL_RWclose(ctx);
+  JsonDocument json = {};
+  {
+    const bool parsed = json.parse(find_glb_json_data(glb_file_content), find_glb_json_chunk_length(glb_file_content),
+                                   allocator);
+    SDL_assert(parsed);
+  }
 
-  const uint8_t* binary_data = find_glb_binary_data(glb_file_content);
-  const Seeker   document = Seeker{find_glb_json_data(glb_file_content), find_glb_json_chunk_length(glb_file_content)};
-  const Seeker   buffer_views = document.node("bufferViews");
+  const JsonValue document     = json.root();
+  const JsonValue buffer_views = document.node("bufferViews");
 
   SceneGraph scene_graph = {};
 
-  auto safe_count = [](const Seeker& d, const char* name) { return d.has(name) ? d.node(name).elements_count() : 0; };
+  // missing arrays give 0 elements
+  auto safe_count = [](const JsonValue& d, const char* name) { return d.node(name).elements_count(); };
   scene_graph.materials.count  = safe_count(document, "materials");
-  scene_graph.materials.data   = engine.generic_allocator->allocate_zeroed<Material>(scene_graph.materials.count);
+  scene_graph.materials.data   = allocator.allocate_zeroed<Material>(scene_graph.materials.count);
   scene_graph.meshes.count     = safe_count(document, "meshes");
-  scene_graph.meshes.data      = engine.generic_allocator->allocate_zeroed<Mesh>(scene_graph.meshes.count);
+  scene_graph.meshes.data      = allocator.allocate_zeroed<Mesh>(scene_graph.meshes.count);
   scene_graph.nodes.count      = safe_count(document, "nodes");
-  scene_graph.nodes.data       = engine.generic_allocator->allocate_zeroed<Node>(scene_graph.nodes.count);
+  scene_graph.nodes.data       = allocator.allocate_zeroed<Node>(scene_graph.nodes.count);
   scene_graph.scenes.count     = safe_count(document, "scenes");
-  scene_graph.scenes.data      = engine.generic_allocator->allocate_zeroed<Scene>(scene_graph.scenes.count);
+  scene_graph.scenes.data      = allocator.allocate_zeroed<Scene>(scene_graph.scenes.count);
   scene_graph.animations.count = safe_count(document, "animations");
-  scene_graph.animations.data  = engine.generic_allocator->allocate_zeroed<Animation>(scene_graph.animations.count);
+  scene_graph.animations.data  = allocator.allocate_zeroed<Animation>(scene_graph.animations.count);
   scene_graph.skins.count      = safe_count(document, "skins");
-  scene_graph.skins.data       = engine.generic_allocator->allocate_zeroed<Skin>(scene_graph.skins.count);
+  scene_graph.skins.data       = allocator.allocate_zeroed<Skin>(scene_graph.skins.count);
 
   // ---------------------------------------------------------------------------
   // MATERIALS
@@ -303,12 +87,13 @@ SceneGraph loadGLB(Engine& engine, const char* path)
 
   if (document.has("images"))
   {
-    Seeker images = document.node("images");
+    JsonValue images    = document.node("images");
+    JsonValue materials = document.node("materials");
 
     for (int material_idx = 0; material_idx < scene_graph.materials.count; ++material_idx)
     {
       Material& material      = scene_graph.materials.data[material_idx];
-      Seeker    material_json = document.node("materials").idx(material_idx);
+      JsonValue material_json = materials.idx(material_idx);
 
       TextureLoadOp ops[] = {
           {material.emissive_texture, "emissiveTexture"},
@@ -316,14 +101,14 @@ SceneGraph loadGLB(Engine& engine, const char* path)
           {material.normal_texture, "normalTexture"},
       };
 
-      load_textures(ops, SDL_arraysize(ops), engine, binary_data, material_json, images, buffer_views);
+      load_textures(ops, SDL_arraysize(ops), consumer, binary_data, material_json, images, buffer_views);
 
       TextureLoadOp metallness_ops[] = {
           {material.albedo_texture, "baseColorTexture"},
           {material.metal_roughness_texture, "metallicRoughnessTexture"},
       };
 
-      load_textures(metallness_ops, SDL_arraysize(metallness_ops), engine, binary_data,
+      load_textures(metallness_ops, SDL_arraysize(metallness_ops), consumer, binary_data,
                     material_json.node("pbrMetallicRoughness"), images, buffer_views);
     }
   }
@@ -332,26 +117,27 @@ SceneGraph loadGLB(Engine& engine, const char* path)
   // MESHES
   // ---------------------------------------------------------------------------
 
-  Seeker accessors = document.node("accessors");
+  JsonValue accessors = document.node("accessors");
+  JsonValue meshes    = document.node("meshes");
   for (int mesh_idx = 0; mesh_idx < scene_graph.meshes.count; ++mesh_idx)
   {
-    Mesh&  mesh      = scene_graph.meshes.data[mesh_idx];
-    Seeker mesh_json = document.node("meshes").idx(mesh_idx);
+    Mesh&     mesh      = scene_graph.meshes.data[mesh_idx];
+    JsonValue mesh_json = meshes.idx(mesh_idx);
 
     // For now we'll be using single primitive per mesh. I can't think of any situation when multiple primitives will
     // be used. Maybe some gltf converters / generators do this? @todo implement in the future if nessesary
-    Seeker primitive  = mesh_json.node("primitives").idx(0);
-    mesh.material     = primitive.integer("material");
-    Seeker attributes = primitive.node("attributes");
+    JsonValue primitive  = mesh_json.node("primitives").idx(0);
+    mesh.material        = primitive.integer("material");
+    JsonValue attributes = primitive.node("attributes");
 
-    int    indices_accessor_idx = primitive.integer("indices");
-    Seeker index_accessor       = accessors.idx(indices_accessor_idx);
-    int    index_type           = index_accessor.integer("componentType");
-    int    index_buffer_view    = index_accessor.integer("bufferView");
+    int       indices_accessor_idx = primitive.integer("indices");
+    JsonValue index_accessor       = accessors.idx(indices_accessor_idx);
+    int       index_type           = index_accessor.integer("componentType");
+    int       index_buffer_view    = index_accessor.integer("bufferView");
 
-    Seeker position_accessor    = accessors.idx(attributes.integer("POSITION"));
-    int    position_count       = position_accessor.integer("count");
-    int    position_buffer_view = position_accessor.integer("bufferView");
+    JsonValue position_accessor    = accessors.idx(attributes.integer("POSITION"));
+    int       position_count       = position_accessor.integer("count");
+    int       position_buffer_view = position_accessor.integer("bufferView");
 
     enum IndexType
     {
@@ -386,7 +172,7 @@ SceneGraph loadGLB(Engine& engine, const char* path)
     const int required_index_space  = mesh.indices_count * (is_index_type_uint16 ? sizeof(uint16_t) : sizeof(uint32_t));
     const int required_vertex_space = position_count * (is_skinning_used ? sizeof(SkinnedVertex) : sizeof(Vertex));
     const int total_upload_buffer_size = required_index_space + required_vertex_space;
-    uint8_t*  upload_buffer            = engine.generic_allocator->allocate<uint8_t>(
+    uint8_t*  upload_buffer            = allocator.allocate<uint8_t>(
         static_cast<uint32_t>(total_upload_buffer_size)); // @todo: is this cleaned up?
     const int index_buffer_glb_offset =
         buffer_views.idx(index_buffer_view).integer("byteOffset") + index_accessor.integer("byteOffset");
@@ -418,7 +204,7 @@ SceneGraph loadGLB(Engine& engine, const char* path)
     const int dst_element_size          = is_skinning_used ? sizeof(SkinnedVertex) : sizeof(Vertex);
 
     {
-      Seeker    buffer_view         = buffer_views.idx(position_buffer_view);
+      JsonValue buffer_view         = buffer_views.idx(position_buffer_view);
       const int view_glb_offset     = buffer_view.integer("byteOffset");
       const int accessor_glb_offset = position_accessor.integer("byteOffset");
       const int start_offset        = view_glb_offset + accessor_glb_offset;
@@ -426,7 +212,7 @@ SceneGraph loadGLB(Engine& engine, const char* path)
       int dst_offset_to_position =
           static_cast<int>(is_skinning_used ? offsetof(SkinnedVertex, position) : offsetof(Vertex, position));
 
-      int src_stride = buffer_view.integer("stride");
+      int src_stride = buffer_view.integer("byteStride");
       src_stride     = src_stride ? src_stride : static_cast<int>(sizeof(Vec3));
 
       for (int i = 0; i < position_count; ++i)
@@ -440,8 +226,8 @@ SceneGraph loadGLB(Engine& engine, const char* path)
     }
 
     {
-      Seeker    accessor            = accessors.idx(attributes.integer("NORMAL"));
-      Seeker    buffer_view         = buffer_views.idx(accessor.integer("bufferView"));
+      JsonValue accessor            = accessors.idx(attributes.integer("NORMAL"));
+      JsonValue buffer_view         = buffer_views.idx(accessor.integer("bufferView"));
       const int view_glb_offset     = buffer_view.integer("byteOffset");
       const int accessor_glb_offset = accessor.integer("byteOffset");
       const int start_offset        = view_glb_offset + accessor_glb_offset;
@@ -449,7 +235,7 @@ SceneGraph loadGLB(Engine& engine, const char* path)
       int dst_offset_to_normal =
           static_cast<int>(is_skinning_used ? offsetof(SkinnedVertex, normal) : offsetof(Vertex, normal));
 
-      int src_stride = buffer_view.integer("stride");
+      int src_stride = buffer_view.integer("byteStride");
       src_stride     = src_stride ? src_stride : static_cast<int>(sizeof(Vec3));
 
       for (int i = 0; i < position_count; ++i)
@@ -464,8 +250,8 @@ SceneGraph loadGLB(Engine& engine, const char* path)
 
     if (attributes.has("TEXCOORD_0"))
     {
-      Seeker    accessor            = accessors.idx(attributes.integer("TEXCOORD_0"));
-      Seeker    buffer_view         = buffer_views.idx(accessor.integer("bufferView"));
+      JsonValue accessor            = accessors.idx(attributes.integer("TEXCOORD_0"));
+      JsonValue buffer_view         = buffer_views.idx(accessor.integer("bufferView"));
       const int view_glb_offset     = buffer_view.integer("byteOffset");
       const int accessor_glb_offset = accessor.integer("byteOffset");
       const int start_offset        = view_glb_offset + accessor_glb_offset;
@@ -473,7 +259,7 @@ SceneGraph loadGLB(Engine& engine, const char* path)
       int dst_offset_to_texcoord =
           static_cast<int>(is_skinning_used ? offsetof(SkinnedVertex, texcoord) : offsetof(Vertex, texcoord));
 
-      int src_stride = buffer_view.integer("stride");
+      int src_stride = buffer_view.integer("byteStride");
       src_stride     = src_stride ? src_stride : static_cast<int>(sizeof(Vec2));
 
       for (int i = 0; i < position_count; ++i)
@@ -489,14 +275,14 @@ SceneGraph loadGLB(Engine& engine, const char* path)
     if (is_skinning_used)
     {
       {
-        Seeker         accessor            = accessors.idx(attributes.integer("JOINTS_0"));
-        Seeker         buffer_view         = buffer_views.idx(accessor.integer("bufferView"));
+        JsonValue      accessor            = accessors.idx(attributes.integer("JOINTS_0"));
+        JsonValue      buffer_view         = buffer_views.idx(accessor.integer("bufferView"));
         const int      view_glb_offset     = buffer_view.integer("byteOffset");
         const int      accessor_glb_offset = accessor.integer("byteOffset");
         const int      start_offset        = view_glb_offset + accessor_glb_offset;
         SkinnedVertex* dst_vertices        = reinterpret_cast<SkinnedVertex*>(&upload_buffer[required_index_space]);
 
-        int src_stride = buffer_view.integer("stride");
+        int src_stride = buffer_view.integer("byteStride");
         src_stride     = src_stride ? src_stride : (4 * static_cast<int>(sizeof(uint16_t)));
 
         for (int i = 0; i < position_count; ++i)
@@ -508,14 +294,14 @@ SceneGraph loadGLB(Engine& engine, const char* path)
       }
 
       {
-        Seeker         accessor            = accessors.idx(attributes.integer("WEIGHTS_0"));
-        Seeker         buffer_view         = buffer_views.idx(accessor.integer("bufferView"));
+        JsonValue      accessor            = accessors.idx(attributes.integer("WEIGHTS_0"));
+        JsonValue      buffer_view         = buffer_views.idx(accessor.integer("bufferView"));
         const int      view_glb_offset     = buffer_view.integer("byteOffset");
         const int      accessor_glb_offset = accessor.integer("byteOffset");
         const int      start_offset        = view_glb_offset + accessor_glb_offset;
         SkinnedVertex* dst_vertices        = reinterpret_cast<SkinnedVertex*>(&upload_buffer[required_index_space]);
 
-        int src_stride = buffer_view.integer("stride");
+        int src_stride = buffer_view.integer("byteStride");
         src_stride     = src_stride ? src_stride : static_cast<int>(sizeof(Vec4));
 
         for (int i = 0; i < position_count; ++i)
@@ -527,143 +313,38 @@ SceneGraph loadGLB(Engine& engine, const char* path)
       }
     }
 
-    VkDeviceSize host_buffer_offset = 0;
-
-    {
-      GpuMemoryBlock& block = engine.memory_blocks.host_visible_transfer_source;
-      host_buffer_offset =
-          block.allocator.allocate_bytes(align(static_cast<VkDeviceSize>(total_upload_buffer_size), block.alignment));
-    }
-
-    {
-      uint8_t* mapped_gpu_memory = nullptr;
-      vkMapMemory(engine.device, engine.memory_blocks.host_visible_transfer_source.memory, host_buffer_offset,
-                  total_upload_buffer_size, 0, (void**)&mapped_gpu_memory);
-      SDL_memcpy(mapped_gpu_memory, upload_buffer, static_cast<size_t>(total_upload_buffer_size));
-      vkUnmapMemory(engine.device, engine.memory_blocks.host_visible_transfer_source.memory);
-    }
-
-    {
-      GpuMemoryBlock& block = engine.memory_blocks.device_local;
-      mesh.indices_offset =
-          block.allocator.allocate_bytes(align(static_cast<VkDeviceSize>(required_index_space), block.alignment));
-      mesh.vertices_offset =
-          block.allocator.allocate_bytes(align(static_cast<VkDeviceSize>(required_vertex_space), block.alignment));
-    }
-
-    VkCommandBuffer cmd = VK_NULL_HANDLE;
-
-    {
-      VkCommandBufferAllocateInfo allocate = {
-          .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-          .commandPool        = engine.graphics_command_pool,
-          .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-          .commandBufferCount = 1,
-      };
-
-      vkAllocateCommandBuffers(engine.device, &allocate, &cmd);
-    }
-
-    {
-      VkCommandBufferBeginInfo begin = {
-          .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-          .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-      };
-
-      vkBeginCommandBuffer(cmd, &begin);
-    }
-
-    {
-      VkBufferCopy copies[] = {
-          {
-              .srcOffset = 0,
-              .dstOffset = mesh.indices_offset,
-              .size      = static_cast<VkDeviceSize>(required_index_space),
-          },
-          {
-              .srcOffset = static_cast<VkDeviceSize>(required_index_space),
-              .dstOffset = mesh.vertices_offset,
-              .size      = static_cast<VkDeviceSize>(required_vertex_space),
-          },
-      };
-
-      vkCmdCopyBuffer(cmd, engine.gpu_host_visible_transfer_source_memory_buffer, engine.gpu_device_local_memory_buffer,
-                      SDL_arraysize(copies), copies);
-    }
-
-    {
-      VkBufferMemoryBarrier barriers[] = {
-          {
-              .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-              .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
-              .dstAccessMask       = VK_ACCESS_SHADER_READ_BIT,
-              .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-              .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-              .buffer              = engine.gpu_device_local_memory_buffer,
-              .offset              = mesh.indices_offset,
-              .size                = static_cast<VkDeviceSize>(required_index_space),
-          },
-          {
-              .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
-              .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
-              .dstAccessMask       = VK_ACCESS_SHADER_READ_BIT,
-              .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-              .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-              .buffer              = engine.gpu_device_local_memory_buffer,
-              .offset              = mesh.vertices_offset,
-              .size                = static_cast<VkDeviceSize>(required_vertex_space),
-          },
-      };
-
-      vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 0, nullptr,
-                           SDL_arraysize(barriers), barriers, 0, nullptr);
-    }
-
-    vkEndCommandBuffer(cmd);
-
-    VkFence data_upload_fence = VK_NULL_HANDLE;
-    {
-      VkFenceCreateInfo ci = {.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
-      vkCreateFence(engine.device, &ci, nullptr, &data_upload_fence);
-    }
-
-    {
-      VkSubmitInfo submit = {
-          .sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-          .commandBufferCount = 1,
-          .pCommandBuffers    = &cmd,
-      };
-
-      vkQueueSubmit(engine.graphics_queue, 1, &submit, data_upload_fence);
-    }
-
-    vkWaitForFences(engine.device, 1, &data_upload_fence, VK_TRUE, UINT64_MAX);
-    vkDestroyFence(engine.device, data_upload_fence, nullptr);
-    vkFreeCommandBuffers(engine.device, engine.graphics_command_pool, 1, &cmd);
-
-    engine.memory_blocks.host_visible_transfer_source.allocator.reset();
-    engine.generic_allocator->free(upload_buffer, total_upload_buffer_size);
+    consumer.mesh(mesh, upload_buffer, static_cast<uint32_t>(required_index_space),
+                  static_cast<uint32_t>(required_vertex_space));
+    allocator.free(upload_buffer, total_upload_buffer_size);
   }
 
   // ---------------------------------------------------------------------------
   // NODES
   // ---------------------------------------------------------------------------
 
+  // a node has at most one parent, so children of all nodes together fit into a single nodes sized array
+  JsonValue nodes               = document.node("nodes");
+  int*      children_pool       = allocator.allocate<int>(SDL_max(scene_graph.nodes.count, 1u));
+  uint32_t  children_pool_usage = 0;
+
   for (int node_idx = 0; node_idx < scene_graph.nodes.count; ++node_idx)
   {
-    Node&  node      = scene_graph.nodes.data[node_idx];
-    Seeker node_json = document.node("nodes").idx(node_idx);
+    Node&     node      = scene_graph.nodes.data[node_idx];
+    JsonValue node_json = nodes.idx(node_idx);
 
     if (node_json.has("children"))
     {
+      JsonValue children  = node_json.node("children");
       node.flags.children = true;
-      node.children.count = node_json.node("children").elements_count();
-      node.children.data  = engine.generic_allocator->allocate<int>(static_cast<uint32_t>(node.children.count));
-      node.children.fill_with_zeros();
+      node.children.count = children.elements_count();
+      SDL_assert(scene_graph.nodes.count >= (children_pool_usage + node.children.count));
+
+      node.children.data = &children_pool[children_pool_usage];
+      children_pool_usage += node.children.count;
 
       for (int child_idx = 0; child_idx < node.children.count; ++child_idx)
       {
-        node.children.data[child_idx] = node_json.node("children").idx_integer(child_idx);
+        node.children.data[child_idx] = children.idx_integer(child_idx);
       }
     }
     else
@@ -674,7 +355,7 @@ SceneGraph loadGLB(Engine& engine, const char* path)
     if (node_json.has("matrix"))
     {
       node.flags.matrix = true;
-      Seeker matrix = node_json.node("matrix");
+      JsonValue matrix = node_json.node("matrix");
 
       for (int row = 0; row < 4; ++row)
         for (int column = 0; column < 4; ++column)
@@ -684,7 +365,7 @@ SceneGraph loadGLB(Engine& engine, const char* path)
     if (node_json.has("rotation"))
     {
       node.flags.rotation = true;
-      Seeker rotation = node_json.node("rotation");
+      JsonValue rotation = node_json.node("rotation");
       for (int i = 0; i < 4; ++i)
       {
         node.rotation.data[i] = rotation.idx_float(i);
@@ -694,7 +375,7 @@ SceneGraph loadGLB(Engine& engine, const char* path)
     if (node_json.has("translation"))
     {
       node.flags.translation = true;
-      Seeker translation = node_json.node("translation");
+      JsonValue translation = node_json.node("translation");
 
       node.translation.x = translation.idx_float(0);
       node.translation.y = translation.idx_float(1);
@@ -704,7 +385,7 @@ SceneGraph loadGLB(Engine& engine, const char* path)
     if (node_json.has("scale"))
     {
       node.flags.scale = true;
-      Seeker scale = node_json.node("scale");
+      JsonValue scale = node_json.node("scale");
 
       node.scale.x = scale.idx_float(0);
       node.scale.y = scale.idx_float(1);
@@ -728,14 +409,15 @@ SceneGraph loadGLB(Engine& engine, const char* path)
   // SCENES
   // ---------------------------------------------------------------------------
 
+  JsonValue scenes = document.node("scenes");
   for (int scene_idx = 0; scene_idx < scene_graph.scenes.count; ++scene_idx)
   {
-    Scene& scene      = scene_graph.scenes.data[scene_idx];
-    Seeker scene_json = document.node("scenes").idx(scene_idx);
-    Seeker nodes_json = scene_json.node("nodes");
+    Scene&    scene      = scene_graph.scenes.data[scene_idx];
+    JsonValue scene_json = scenes.idx(scene_idx);
+    JsonValue nodes_json = scene_json.node("nodes");
 
     scene.nodes.count = nodes_json.elements_count();
-    scene.nodes.data  = engine.generic_allocator->allocate<int>(scene.nodes.count);
+    scene.nodes.data  = allocator.allocate<int>(scene.nodes.count);
     scene.nodes.fill_with_zeros();
 
     for (int node_idx = 0; node_idx < scene.nodes.count; ++node_idx)
@@ -747,12 +429,12 @@ SceneGraph loadGLB(Engine& engine, const char* path)
   // ---------------------------------------------------------------------------
   // ANIMATIONS
   // ---------------------------------------------------------------------------
-  Seeker animations_json = document.node("animations");
+  JsonValue animations_json = document.node("animations");
   for (int animation_idx = 0; animation_idx < scene_graph.animations.count; ++animation_idx)
   {
-    Seeker animation_json = animations_json.idx(animation_idx);
-    Seeker channels_json  = animation_json.node("channels");
-    Seeker samplers_json  = animation_json.node("samplers");
+    JsonValue animation_json = animations_json.idx(animation_idx);
+    JsonValue channels_json  = animation_json.node("channels");
+    JsonValue samplers_json  = animation_json.node("samplers");
 
     int channels_count = channels_json.elements_count();
     int samplers_count = samplers_json.elements_count();
@@ -760,36 +442,33 @@ SceneGraph loadGLB(Engine& engine, const char* path)
     Animation& current_animation = scene_graph.animations.data[animation_idx];
 
     current_animation.channels.count = channels_count;
-    current_animation.channels.data =
-        engine.generic_allocator->allocate<AnimationChannel>(static_cast<uint32_t>(channels_count));
+    current_animation.channels.data  = allocator.allocate<AnimationChannel>(static_cast<uint32_t>(channels_count));
     current_animation.channels.fill_with_zeros();
 
     current_animation.samplers.count = samplers_count;
-    current_animation.samplers.data =
-        engine.generic_allocator->allocate<AnimationSampler>(static_cast<uint32_t>(samplers_count));
+    current_animation.samplers.data  = allocator.allocate<AnimationSampler>(static_cast<uint32_t>(samplers_count));
     current_animation.samplers.fill_with_zeros();
 
     for (int channel_idx = 0; channel_idx < channels_count; ++channel_idx)
     {
-      Seeker            channel_json    = channels_json.idx(channel_idx);
-      Seeker            target_json     = channel_json.node("target");
+      JsonValue         channel_json    = channels_json.idx(channel_idx);
+      JsonValue         target_json     = channel_json.node("target");
       AnimationChannel& current_channel = current_animation.channels.data[channel_idx];
 
       current_channel.sampler_idx     = channel_json.integer("sampler");
       current_channel.target_node_idx = target_json.integer("node");
 
-      Seeker      path_json  = target_json.node("path");
-      const char* path_value = &path_json.data[8];
+      JsonValue path_json = target_json.node("path");
 
-      if (0 == SDL_memcmp(path_value, "rotation", 8))
+      if (path_json.equals("rotation"))
       {
         current_channel.target_path = AnimationChannel::Path::Rotation;
       }
-      else if (0 == SDL_memcmp(path_value, "translation", 11))
+      else if (path_json.equals("translation"))
       {
         current_channel.target_path = AnimationChannel::Path::Translation;
       }
-      else if (0 == SDL_memcmp(path_value, "scale", 5))
+      else if (path_json.equals("scale"))
       {
         current_channel.target_path = AnimationChannel::Path::Scale;
       }
@@ -801,26 +480,26 @@ SceneGraph loadGLB(Engine& engine, const char* path)
 
     for (int sampler_idx = 0; sampler_idx < samplers_count; ++sampler_idx)
     {
-      Seeker            sampler_json    = samplers_json.idx(sampler_idx);
+      JsonValue         sampler_json    = samplers_json.idx(sampler_idx);
       AnimationSampler& current_sampler = current_animation.samplers.data[sampler_idx];
 
       int input  = sampler_json.integer("input");
       int output = sampler_json.integer("output");
 
-      Seeker input_accessor  = accessors.idx(input);
-      Seeker output_accessor = accessors.idx(output);
+      JsonValue input_accessor  = accessors.idx(input);
+      JsonValue output_accessor = accessors.idx(output);
 
       int input_elements  = input_accessor.integer("count");
       int output_elements = output_accessor.integer("count");
 
-      const char* interpolation = &sampler_json.node("interpolation").data[17];
-      if (0 == SDL_memcmp("CUBICSPLINE", interpolation, 11))
+      JsonValue interpolation = sampler_json.node("interpolation");
+      if (interpolation.equals("CUBICSPLINE"))
       {
         // In cubic-spline interpolation keyframe each time point maps to 3 vec3 elements
         SDL_assert(input_elements == output_elements / 3);
         current_sampler.interpolation = AnimationSampler::Interpolation::CubicSpline;
       }
-      else if (0 == SDL_memcmp("LINEAR", interpolation, 6))
+      else if (interpolation.equals("LINEAR"))
       {
         // In linear interpolation time maps to values 1:1 in count, so this should be always true
         SDL_assert(input_elements == output_elements);
@@ -839,8 +518,8 @@ SceneGraph loadGLB(Engine& engine, const char* path)
       int input_buffer_view_idx  = input_accessor.integer("bufferView");
       int output_buffer_view_idx = output_accessor.integer("bufferView");
 
-      Seeker input_buffer_view  = buffer_views.idx(input_buffer_view_idx);
-      Seeker output_buffer_view = buffer_views.idx(output_buffer_view_idx);
+      JsonValue input_buffer_view  = buffer_views.idx(input_buffer_view_idx);
+      JsonValue output_buffer_view = buffer_views.idx(output_buffer_view_idx);
 
       enum class Type : unsigned
       {
@@ -849,19 +528,18 @@ SceneGraph loadGLB(Engine& engine, const char* path)
         Vec4   = 4
       };
 
-      Type        output_type         = Type::Scalar;
-      Seeker      output_type_json    = output_accessor.node("type");
-      const char* output_type_str_ptr = &output_type_json.data[8];
+      Type      output_type      = Type::Scalar;
+      JsonValue output_type_json = output_accessor.node("type");
 
-      if (0 == SDL_memcmp(output_type_str_ptr, "VEC3", 4))
+      if (output_type_json.equals("VEC3"))
       {
         output_type = Type::Vec3;
       }
-      else if (0 == SDL_memcmp(output_type_str_ptr, "VEC4", 4))
+      else if (output_type_json.equals("VEC4"))
       {
         output_type = Type::Vec4;
       }
-      else if (0 == SDL_memcmp(output_type_str_ptr, "SCALAR", 6))
+      else if (output_type_json.equals("SCALAR"))
       {
         output_type = Type::Scalar;
       }
@@ -870,16 +548,16 @@ SceneGraph loadGLB(Engine& engine, const char* path)
         SDL_assert(false);
       }
 
-      current_sampler.times = engine.generic_allocator->allocate<float>(static_cast<uint32_t>(input_elements));
-      current_sampler.values =
-          engine.generic_allocator->allocate<float>(static_cast<unsigned>(output_type) * output_elements);
+      current_sampler.values_count = static_cast<int>(output_type) * output_elements;
+      current_sampler.times        = allocator.allocate<float>(static_cast<uint32_t>(input_elements));
+      current_sampler.values       = allocator.allocate<float>(static_cast<uint32_t>(current_sampler.values_count));
 
       {
         const int input_view_glb_offset     = input_buffer_view.integer("byteOffset");
         const int input_accessor_glb_offset = input_accessor.integer("byteOffset");
         const int input_start_offset        = input_view_glb_offset + input_accessor_glb_offset;
 
-        int input_stride = input_buffer_view.integer("stride");
+        int input_stride = input_buffer_view.integer("byteStride");
         input_stride     = input_stride ? input_stride : static_cast<int>(sizeof(float));
 
         for (int i = 0; i < input_elements; ++i)
@@ -898,7 +576,7 @@ SceneGraph loadGLB(Engine& engine, const char* path)
         const int output_accessor_glb_offset = output_accessor.integer("byteOffset");
         const int output_start_offset        = output_view_glb_offset + output_accessor_glb_offset;
 
-        int output_stride = output_buffer_view.integer("stride");
+        int output_stride = output_buffer_view.integer("byteStride");
         output_stride     = output_stride ? output_stride : static_cast<unsigned>(output_type) * sizeof(float);
 
         for (int i = 0; i < output_elements; ++i)
@@ -914,61 +592,136 @@ SceneGraph loadGLB(Engine& engine, const char* path)
       }
     }
 
+    //
+    // Exported animations usually key every bone at the same times. Samplers with identical times are put on one
+    // track, so the keyframe interval is looked up once per track instead of once per sampler.
+    //
+    ArrayView<AnimationSampler>& samplers = current_animation.samplers;
+    current_animation.tracks_count        = 0;
+
+    for (uint32_t sampler_idx = 0; sampler_idx < samplers.count; ++sampler_idx)
+    {
+      AnimationSampler& sampler = samplers[sampler_idx];
+      sampler.track_idx         = static_cast<int>(current_animation.tracks_count);
+
+      for (uint32_t other_idx = 0; other_idx < sampler_idx; ++other_idx)
+      {
+        const AnimationSampler& other = samplers[other_idx];
+        if ((other.keyframes_count == sampler.keyframes_count) and
+            (0 == SDL_memcmp(other.times, sampler.times, sizeof(float) * sampler.keyframes_count)))
+        {
+          sampler.track_idx = other.track_idx;
+          break;
+        }
+      }
+
+      if (static_cast<int>(current_animation.tracks_count) == sampler.track_idx)
+        current_animation.tracks_count += 1;
+    }
+
+    std::stable_sort(current_animation.channels.begin(), current_animation.channels.end(),
+                     [&samplers](const AnimationChannel& a, const AnimationChannel& b) {
+                       const int a_track = samplers[a.sampler_idx].track_idx;
+                       const int b_track = samplers[b.sampler_idx].track_idx;
+                       return (a_track != b_track) ? (a_track < b_track) : (a.sampler_idx < b.sampler_idx);
+                     });
+
+    current_animation.duration = 0.0f;
+    for (const AnimationSampler& sampler : current_animation.samplers)
+      current_animation.duration = SDL_max(current_animation.duration, sampler.time_frame[1]);
+
     auto has_path = [](const ArrayView<AnimationChannel>& c, AnimationChannel::Path path) {
       return c.end() != std::find(c.begin(), c.end(), path);
     };
 
     current_animation.has_rotations    = has_path(current_animation.channels, AnimationChannel::Path::Rotation);
     current_animation.has_translations = has_path(current_animation.channels, AnimationChannel::Path::Translation);
+    current_animation.has_scales       = has_path(current_animation.channels, AnimationChannel::Path::Scale);
   }
 
   // ---------------------------------------------------------------------------
   // SKINS
   // ---------------------------------------------------------------------------
-  Seeker skins_json = document.node("skins");
+  JsonValue skins_json = document.node("skins");
   for (int skin_idx = 0; skin_idx < scene_graph.skins.count; ++skin_idx)
   {
-    Seeker skin_json = skins_json.idx(skin_idx);
-    Skin&  skin      = scene_graph.skins[skin_idx];
+    JsonValue skin_json = skins_json.idx(skin_idx);
+    Skin&     skin      = scene_graph.skins[skin_idx];
 
     skin.skeleton = skin_json.integer("skeleton");
 
-    Seeker joints_json = skin_json.node("joints");
+    JsonValue joints_json = skin_json.node("joints");
 
     skin.joints.count = joints_json.elements_count();
-    skin.joints.data  = engine.generic_allocator->allocate<int>(static_cast<uint32_t>(skin.joints.count));
+    skin.joints.data  = allocator.allocate<int>(static_cast<uint32_t>(skin.joints.count));
 
     for (int i = 0; i < skin.joints.count; ++i)
     {
       skin.joints[i] = joints_json.idx_integer(i);
     }
 
-    int    inverse_bind_matrices_accessor_idx = skin_json.integer("inverseBindMatrices");
-    Seeker accessor                           = accessors.idx(inverse_bind_matrices_accessor_idx);
+    int       inverse_bind_matrices_accessor_idx = skin_json.integer("inverseBindMatrices");
+    JsonValue accessor                           = accessors.idx(inverse_bind_matrices_accessor_idx);
 
     skin.inverse_bind_matrices.count = accessor.integer("count");
-    skin.inverse_bind_matrices.data =
-        engine.generic_allocator->allocate<Mat4x4>(static_cast<uint32_t>(skin.inverse_bind_matrices.count));
+    skin.inverse_bind_matrices.data  = allocator.allocate<Affine3x4>(skin.inverse_bind_matrices.count);
 
-    Seeker buffer_view = buffer_views.idx(accessor.integer("bufferView"));
+    JsonValue buffer_view = buffer_views.idx(accessor.integer("bufferView"));
 
     int glb_start_offset = buffer_view.integer("byteOffset") + accessor.integer("byteOffset");
-    int glb_stride       = buffer_view.integer("stride");
+    int glb_stride       = buffer_view.integer("byteStride");
     glb_stride           = glb_stride ? glb_stride : sizeof(Mat4x4);
 
+    // stored as full mat4 in the file, bottom row of inverse bind matrices is always (0, 0, 0, 1)
     for (int i = 0; i < skin.inverse_bind_matrices.count; ++i)
     {
       const uint8_t* src            = &binary_data[glb_start_offset + (glb_stride * i)];
-      skin.inverse_bind_matrices[i] = Mat4x4(reinterpret_cast<const float*>(src));
+      skin.inverse_bind_matrices[i] = Affine3x4(Mat4x4(reinterpret_cast<const float*>(src)));
     }
   }
 
-  engine.generic_allocator->free(glb_file_content, static_cast<uint32_t>(glb_file_size));
-
-  uint64_t duration_ticks = SDL_GetPerformanceCounter() - start;
-  float    elapsed_ms     = 1000.0f * ((float)duration_ticks / (float)SDL_GetPerformanceFrequency());
-  auto     align_text     = [](float in) -> const char* { return (in > 10.0f) ? ((in > 100.0f) ? " " : "  ") : "   "; };
-  SDL_Log("parsing GLB took:%s%.4f ms (%s)", align_text(elapsed_ms), elapsed_ms, path);
+  json.teardown();
+  build_node_hierarchy(scene_graph, allocator);
 
   return scene_graph;
 }
+
+void build_node_hierarchy(SceneGraph& scene_graph, HierarchicalAllocator& allocator)
+{
+  const uint32_t nodes_count = scene_graph.nodes.count;
+
+  scene_graph.node_parents = {allocator.allocate<int>(nodes_count), nodes_count};
+  scene_graph.node_order   = {allocator.allocate<int>(nodes_count), nodes_count};
+
+  std::fill(scene_graph.node_parents.begin(), scene_graph.node_parents.end(), -1);
+
+  for (uint32_t node_idx = 0; node_idx < nodes_count; ++node_idx)
+  {
+    for (int child_idx : scene_graph.nodes[node_idx].children)
+    {
+      SDL_assert(-1 == scene_graph.node_parents[child_idx]);
+      scene_graph.node_parents[child_idx] = static_cast<int>(node_idx);
+    }
+  }
+
+  //
+  // Breadth first: roots go first, then the children of every node already placed. Order array is the queue.
+  //
+  uint32_t order_count = 0;
+
+  for (uint32_t node_idx = 0; node_idx < nodes_count; ++node_idx)
+    if (-1 == scene_graph.node_parents[node_idx])
+      scene_graph.node_order[order_count++] = static_cast<int>(node_idx);
+
+  for (uint32_t i = 0; i < order_count; ++i)
+  {
+    for (int child_idx : scene_graph.nodes[scene_graph.node_order[i]].children)
+    {
+      SDL_assert(nodes_count > order_count);
+      scene_graph.node_order[order_count++] = child_idx;
+    }
+  }
+
+  // nodes in a cycle are never reached from a root
+  SDL_assert(nodes_count == order_count);
+}
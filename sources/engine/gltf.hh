@@ -83,25 +83,31 @@ struct AnimationSampler
   // todo: very naive (but fastest to implement) approach. This should be in form of buffer, buffer views and accessors
   float         time_frame[2];
   int           keyframes_count;
+  int           values_count;
   float*        times;
   float*        values;
   Interpolation interpolation;
+  int           track_idx; // samplers with identical keyframe times share a track
 };
 
 struct Animation
 {
+  // sorted by track and sampler, channels sharing a sampler are next to each other
   ArrayView<AnimationChannel> channels;
   ArrayView<AnimationSampler> samplers;
 
-  bool has_rotations;
-  bool has_translations;
+  float    duration; // end of the longest sampler
+  uint32_t tracks_count;
+  bool     has_rotations;
+  bool     has_translations;
+  bool     has_scales;
 };
 
 struct Skin
 {
-  ArrayView<Mat4x4> inverse_bind_matrices;
-  ArrayView<int>    joints;
-  int               skeleton;
+  ArrayView<Affine3x4> inverse_bind_matrices;
+  ArrayView<int>       joints;
+  int                  skeleton;
 };
 
 struct SceneGraph
@@ -112,6 +118,32 @@ struct SceneGraph
   ArrayView<Scene>     scenes;
   ArrayView<Animation> animations;
   ArrayView<Skin>      skins;
+
+  // every node exactly once, parents always before their children
+  ArrayView<int> node_order;
+  // -1 for nodes without a parent
+  ArrayView<int> node_parents;
+};
+
+//
+// Receives everything which has to end up on the gpu while a glb is parsed. Runtime loader uploads it right away,
+// asset baker writes it into a baked scene file instead.
+//
+class GlbConsumer
+{
+public:
+  virtual ~GlbConsumer() = default;
+
+  // png / jpeg image embedded in the glb binary chunk
+  virtual void texture(Texture& dst, const uint8_t* image, uint32_t size) = 0;
+
+  // "indices_size" bytes of indices (mesh.indices_type) followed by "vertices_size" bytes of interleaved vertices,
+  // consumer is responsible for filling mesh.indices_offset and mesh.vertices_offset
+  virtual void mesh(Mesh& dst, const uint8_t* data, uint32_t indices_size, uint32_t vertices_size) = 0;
 };
 
-SceneGraph loadGLB(Engine& engine, const char* path);
+// scene graph arrays are allocated from "allocator", "glb" has to stay alive only for the duration of the call
+SceneGraph parseGLB(const uint8_t* glb, HierarchicalAllocator& allocator, GlbConsumer& consumer);
+
+// fills "node_order" and "node_parents" from node children, parseGLB calls it on its own
+void build_node_hierarchy(SceneGraph& scene_graph, HierarchicalAllocator& allocator);
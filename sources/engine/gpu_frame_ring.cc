@@ -0,0 +1,69 @@
+#include "gpu_frame_ring.hh"
+#include "allocators.hh"
+#include <SDL2/SDL_assert.h>
+#include <SDL2/SDL_stdinc.h>
+
+void GpuFrameRing::setup(VkDeviceSize new_base_offset, VkDeviceSize new_capacity, VkDeviceSize new_alignment)
+{
+  SDL_assert(0 == (new_alignment & (new_alignment - 1)));
+  SDL_assert(0 == (new_base_offset % new_alignment));
+
+  base_offset            = new_base_offset;
+  capacity               = new_capacity & ~(new_alignment - 1);
+  alignment              = new_alignment;
+  head                   = 0;
+  tail                   = 0;
+  frame_begin            = 0;
+  high_water             = 0;
+  lock                   = 0;
+  first_frame_in_flight  = 0;
+  frames_in_flight_count = 0;
+}
+
+VkDeviceSize GpuFrameRing::allocate(VkDeviceSize size)
+{
+  SDL_assert(size <= capacity);
+
+  SDL_AtomicLock(&lock);
+
+  //
+  // capacity is a multiple of alignment, so aligning the virtual position aligns the physical one as well
+  //
+  uint64_t begin = align(head, alignment);
+  if (((begin % capacity) + size) > capacity)
+  {
+    // skipping the remainder up to the end of the range
+    begin += capacity - (begin % capacity);
+  }
+
+  if ((begin + size - tail) > capacity)
+  {
+    SDL_AtomicUnlock(&lock);
+
+    // frames in flight use up the whole ring, capacity is too small for the workload
+    SDL_assert(false);
+    return INVALID_OFFSET;
+  }
+
+  head = begin + size;
+  SDL_AtomicUnlock(&lock);
+
+  return base_offset + (begin % capacity);
+}
+
+void GpuFrameRing::end_frame(VkFence fence)
+{
+  //
+  // No slot left to track the fence: the frame stays open and its slices are released together with the next frame.
+  // Frames complete in submition order, so the later fence is a safe (if late) stand in.
+  //
+  if (MAX_FRAMES_IN_FLIGHT == frames_in_flight_count)
+    return;
+
+  const uint32_t idx    = (first_frame_in_flight + frames_in_flight_count) % MAX_FRAMES_IN_FLIGHT;
+  frames_in_flight[idx] = {fence, head};
+  frames_in_flight_count += 1;
+
+  high_water  = SDL_max(high_water, head - frame_begin);
+  frame_begin = head;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <SDL2/SDL_atomic.h>
+#include <vulkan/vulkan.h>
+
+//
+// Linear ring over a range of host visible gpu memory for data which lives a single frame (uniforms, dynamic vertices).
+//
+// |-------------------------------------------------------|
+// | free | frame N-1 (gpu reads) | frame N (cpu writes) | free |
+// |-------------------------------------------------------|
+//        ^ tail                                   ^ head
+//
+// Jobs grab aligned slices with "allocate" and use the returned offset directly (dynamic uniform offset, vertex buffer
+// offset). Submitting a frame closes it with the fence signaled by its submition, "reclaim" moves the tail past every
+// frame whose fence has already signaled. Frames complete in submition order, so the oldest one is always checked first.
+//
+// Head and tail only grow, physical position is taken modulo capacity. Slice never wraps around the end of the range,
+// if it doesn't fit the remainder is skipped.
+//
+struct GpuFrameRing
+{
+  static constexpr uint32_t     MAX_FRAMES_IN_FLIGHT = 8;
+  static constexpr VkDeviceSize INVALID_OFFSET       = ~VkDeviceSize(0);
+
+  struct Frame
+  {
+    VkFence  fence;
+    uint64_t end;
+  };
+
+  // "capacity" bytes starting at "base_offset" of the memory block are owned by the ring
+  void setup(VkDeviceSize base_offset, VkDeviceSize capacity, VkDeviceSize alignment);
+
+  // thread safe, result is an offset into the whole memory block (not relative to the ring)
+  // INVALID_OFFSET when frames in flight leave no room, callers have to skip whatever would use the slice
+  VkDeviceSize allocate(VkDeviceSize size);
+
+  // everything allocated since previous call stays in use until "fence" signals
+  // (or a later one, when MAX_FRAMES_IN_FLIGHT are already waited on)
+  void end_frame(VkFence fence);
+
+  // "is_signaled" is called with fences of frames in flight, oldest first: bool is_signaled(VkFence)
+  template <typename IsSignaled> void reclaim(IsSignaled is_signaled)
+  {
+    while ((0 < frames_in_flight_count) and is_signaled(frames_in_flight[first_frame_in_flight].fence))
+    {
+      tail                  = frames_in_flight[first_frame_in_flight].end;
+      first_frame_in_flight = (first_frame_in_flight + 1) % MAX_FRAMES_IN_FLIGHT;
+      frames_in_flight_count -= 1;
+    }
+  }
+
+  [[nodiscard]] VkDeviceSize get_used() const
+  {
+    return head - tail;
+  }
+
+  VkDeviceSize base_offset;
+  VkDeviceSize capacity;
+  VkDeviceSize alignment;
+  uint64_t     head;
+  uint64_t     tail;
+  uint64_t     frame_begin;
+  VkDeviceSize high_water; // biggest single frame seen so far
+  SDL_SpinLock lock;
+  Frame        frames_in_flight[MAX_FRAMES_IN_FLIGHT];
+  uint32_t     first_frame_in_flight;
+  uint32_t     frames_in_flight_count;
+};
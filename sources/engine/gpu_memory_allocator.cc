@@ -1,106 +1,380 @@
 #include "gpu_memory_allocator.hh"
+#include "allocators.hh"
 #include <SDL2/SDL_assert.h>
 #include <SDL2/SDL_stdinc.h>
 
-#include <algorithm>
+using Node = GpuMemoryAllocator::Node;
+
+namespace {
+
+constexpr uint32_t INVALID_NODE           = GpuMemoryAllocator::INVALID_NODE;
+constexpr uint32_t INITIAL_NODES_CAPACITY = 64;
+
+using Children = uint32_t (Node::*)[2];
+
+bool offset_less(const Node& lhs, const Node& rhs)
+{
+  return lhs.offset < rhs.offset;
+}
+
+bool size_less(const Node& lhs, const Node& rhs)
+{
+  return (lhs.size < rhs.size) or ((lhs.size == rhs.size) and (lhs.offset < rhs.offset));
+}
+
+//
+// Split / merge treap over nodes stored in a pool. "children" selects which of the two trees is walked,
+// "less" gives its ordering. Keys are unique in both trees (offsets never repeat).
+// Pool is held by reference, acquiring a node may reallocate it.
+//
+template <Children children, bool (*less)(const Node&, const Node&)> struct Treap
+{
+  Node*& nodes;
+
+  // "left" gets everything ordered before "key", "right" the rest
+  void split(uint32_t root, const Node& key, uint32_t& left, uint32_t& right)
+  {
+    if (INVALID_NODE == root)
+    {
+      left  = INVALID_NODE;
+      right = INVALID_NODE;
+    }
+    else if (less(nodes[root], key))
+    {
+      split((nodes[root].*children)[1], key, (nodes[root].*children)[1], right);
+      left = root;
+    }
+    else
+    {
+      split((nodes[root].*children)[0], key, left, (nodes[root].*children)[0]);
+      right = root;
+    }
+  }
+
+  // every node in "left" has to be ordered before every node in "right"
+  uint32_t merge(uint32_t left, uint32_t right)
+  {
+    if (INVALID_NODE == left)
+      return right;
+
+    if (INVALID_NODE == right)
+      return left;
+
+    if (nodes[left].priority > nodes[right].priority)
+    {
+      (nodes[left].*children)[1] = merge((nodes[left].*children)[1], right);
+      return left;
+    }
+
+    (nodes[right].*children)[0] = merge(left, (nodes[right].*children)[0]);
+    return right;
+  }
+
+  // descends while the heap order holds, then the subtree below gets split around the new node
+  void insert(uint32_t& root, uint32_t node)
+  {
+    uint32_t* link = &root;
+    while ((INVALID_NODE != *link) and (nodes[*link].priority > nodes[node].priority))
+      link = &(nodes[*link].*children)[less(nodes[*link], nodes[node]) ? 1 : 0];
+
+    split(*link, nodes[node], (nodes[node].*children)[0], (nodes[node].*children)[1]);
+    *link = node;
+  }
+
+  void erase(uint32_t& root, uint32_t node)
+  {
+    uint32_t* link = &root;
+    while (node != *link)
+    {
+      SDL_assert(INVALID_NODE != *link);
+      link = &(nodes[*link].*children)[less(nodes[*link], nodes[node]) ? 1 : 0];
+    }
+    *link = merge((nodes[node].*children)[0], (nodes[node].*children)[1]);
+  }
+};
+
+using OffsetTreap = Treap<&Node::by_offset, offset_less>;
+using SizeTreap   = Treap<&Node::by_size, size_less>;
+
+// can the range hold "size" bytes starting at an offset aligned to "alignment"
+bool fits(const Node& node, VkDeviceSize size, VkDeviceSize alignment)
+{
+  const VkDeviceSize padding = align(node.offset, alignment) - node.offset;
+  return node.size >= (padding + size);
+}
+
+uint32_t lower_bound_by_size(const Node* nodes, uint32_t root, VkDeviceSize size)
+{
+  uint32_t result = INVALID_NODE;
+  while (INVALID_NODE != root)
+  {
+    if (nodes[root].size >= size)
+    {
+      result = root;
+      root   = nodes[root].by_size[0];
+    }
+    else
+    {
+      root = nodes[root].by_size[1];
+    }
+  }
+  return result;
+}
+
+// next range in (size, offset) order
+uint32_t successor_by_size(const Node* nodes, uint32_t root, const Node& key)
+{
+  uint32_t result = INVALID_NODE;
+  while (INVALID_NODE != root)
+  {
+    if (size_less(key, nodes[root]))
+    {
+      result = root;
+      root   = nodes[root].by_size[0];
+    }
+    else
+    {
+      root = nodes[root].by_size[1];
+    }
+  }
+  return result;
+}
+
+uint32_t xorshift(uint32_t x)
+{
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return x;
+}
+
+} // namespace
 
 void GpuMemoryAllocator::init(const VkDeviceSize init_max_size)
 {
   max_size = init_max_size;
+  if (nullptr == nodes)
+  {
+    nodes_capacity = INITIAL_NODES_CAPACITY;
+    nodes          = reinterpret_cast<Node*>(SDL_malloc(nodes_capacity * sizeof(Node)));
+  }
   reset();
 }
 
+void GpuMemoryAllocator::teardown()
+{
+  SDL_free(nodes);
+  nodes          = nullptr;
+  nodes_capacity = 0;
+}
+
 void GpuMemoryAllocator::reset()
 {
-  nodes_count = 1;
-  nodes[0]    = {0, max_size};
+  for (uint32_t i = 0; i < nodes_capacity; ++i)
+    nodes[i].by_offset[0] = i + 1;
+  nodes[nodes_capacity - 1].by_offset[0] = INVALID_NODE;
+
+  unused_nodes      = 0;
+  offset_root       = INVALID_NODE;
+  size_root         = INVALID_NODE;
+  free_ranges_count = 0;
+  priority_seed     = 0x9e3779b9u;
+  free_size         = 0;
+
+  free_bytes(0, max_size);
 }
 
-VkDeviceSize GpuMemoryAllocator::allocate_bytes(const VkDeviceSize size)
+VkDeviceSize GpuMemoryAllocator::allocate_bytes(const VkDeviceSize size, const VkDeviceSize alignment)
 {
-  Node* end = nodes + nodes_count;
-  auto  it  = std::find_if(nodes, end, [size](const Node& n) { return n.size >= size; });
+  SDL_assert(0 < size);
+  SDL_assert(0 != alignment and 0 == (alignment & (alignment - 1)));
+
+  //
+  // Best fit by size is checked first. When alignment padding makes it too small the following ranges are tried in
+  // size order: one of them may already start at an aligned offset. Ranges of at least "size + alignment - 1" bytes
+  // fit regardless of their offset, so from that size on the search is over, the next range is the answer.
+  //
+  const VkDeviceSize worst_case_size = size + alignment - 1;
+
+  uint32_t node = lower_bound_by_size(nodes, size_root, size);
+  while ((INVALID_NODE != node) and not fits(nodes[node], size, alignment))
+  {
+    node = successor_by_size(nodes, size_root, nodes[node]);
+    if ((INVALID_NODE != node) and (worst_case_size <= nodes[node].size))
+      break;
+  }
 
-  SDL_assert(it != end);
+  if (INVALID_NODE == node)
+  {
+    // out of device memory
+    SDL_assert(false);
+    return INVALID_OFFSET;
+  }
+
+  OffsetTreap by_offset = {nodes};
+  SizeTreap   by_size   = {nodes};
+
+  by_size.erase(size_root, node);
 
-  const VkDeviceSize result = it->offset;
-  if (size == it->size)
+  const VkDeviceSize result       = align(nodes[node].offset, alignment);
+  const VkDeviceSize padding      = result - nodes[node].offset;
+  const VkDeviceSize tail_size    = nodes[node].size - padding - size;
+  const VkDeviceSize range_offset = nodes[node].offset;
+
+  free_size -= size;
+
+  //
+  // BEFORE:
+  //     ... [____________free____________] ...
+  //
+  // AFTER:
+  //     ... [padding][allocation][__tail__] ...
+  //
+  // Padding keeps the original node (its place in offset order doesn't change), the tail gets a new one.
+  //
+  if (0 < padding)
   {
-    std::rotate(it, it + 1, end);
+    nodes[node].size = padding;
+    by_size.insert(size_root, node);
   }
   else
   {
-    it->offset += size;
-    it->size -= size;
+    by_offset.erase(offset_root, node);
+    release_node(node);
+  }
+
+  if (0 < tail_size)
+  {
+    const uint32_t tail = acquire_node(range_offset + padding + size, tail_size);
+    by_offset.insert(offset_root, tail);
+    by_size.insert(size_root, tail);
   }
+
   return result;
 }
 
-void GpuMemoryAllocator::free_bytes(VkDeviceSize offset, VkDeviceSize size)
+void GpuMemoryAllocator::allocate_bytes_ranged(VkDeviceSize dst[], const uint32_t count, const VkDeviceSize size,
+                                               const VkDeviceSize alignment)
 {
-  // basically a sorted container insertion problem
-  const Node insertion = {offset, size};
-
-  // TODO catch double frees
-
-  if (0 == nodes_count) // whole memory used, inserting first element to list
+  for (uint32_t i = 0; i < count; ++i)
   {
-    nodes_count = 1;
-    nodes[0]    = insertion;
+    dst[i] = allocate_bytes(size, alignment);
   }
-  else if (offset < nodes[0].offset) // insertion before the first element on list
+}
+
+void GpuMemoryAllocator::free_bytes(const VkDeviceSize offset, const VkDeviceSize size)
+{
+  SDL_assert(0 < size);
+  SDL_assert((offset + size) <= max_size);
+
+  // closest free ranges on both sides of the freed one
+  uint32_t prev = INVALID_NODE;
+  uint32_t next = INVALID_NODE;
+  for (uint32_t it = offset_root; INVALID_NODE != it;)
   {
-    if ((offset + size) == nodes[0].offset)
+    if (nodes[it].offset <= offset)
     {
-      nodes[0].offset = offset;
-      nodes[0].size += size;
+      prev = it;
+      it   = nodes[it].by_offset[1];
     }
     else
     {
-      SDL_memmove(&nodes[1], &nodes[0], sizeof(Node) * nodes_count);
-      nodes[0] = insertion;
-      nodes_count++;
+      next = it;
+      it   = nodes[it].by_offset[0];
     }
   }
-  // else if (1 == nodes_count) // insertion as the second list element
-  //{
-  //  nodes_count = 2;
-  //  nodes[1]    = insertion;
-  //}
+
+  const bool overlaps_prev = (INVALID_NODE != prev) and ((nodes[prev].offset + nodes[prev].size) > offset);
+  const bool overlaps_next = (INVALID_NODE != next) and ((offset + size) > nodes[next].offset);
+
+  //
+  // attempting to free memory which is already (even partially) free?
+  //
+  if (overlaps_prev or overlaps_next)
+  {
+    SDL_assert(false);
+    return;
+  }
+
+  const bool merge_prev = (INVALID_NODE != prev) and ((nodes[prev].offset + nodes[prev].size) == offset);
+  const bool merge_next = (INVALID_NODE != next) and ((offset + size) == nodes[next].offset);
+
+  OffsetTreap by_offset = {nodes};
+  SizeTreap   by_size   = {nodes};
+
+  free_size += size;
+
+  //
+  // Coalescing never reorders ranges by offset: nothing free lies between "prev" and "next", so a surviving node can
+  // take over the merged range and stay where it is in the offset tree. Only the size tree needs re-insertion.
+  //
+  if (merge_prev and merge_next)
+  {
+    by_size.erase(size_root, prev);
+    by_size.erase(size_root, next);
+    by_offset.erase(offset_root, next);
+    nodes[prev].size += size + nodes[next].size;
+    release_node(next);
+    by_size.insert(size_root, prev);
+  }
+  else if (merge_prev)
+  {
+    by_size.erase(size_root, prev);
+    nodes[prev].size += size;
+    by_size.insert(size_root, prev);
+  }
+  else if (merge_next)
+  {
+    by_size.erase(size_root, next);
+    nodes[next].offset = offset;
+    nodes[next].size += size;
+    by_size.insert(size_root, next);
+  }
   else
   {
-    for (uint32_t i = 0; i < (nodes_count - 1); ++i)
-    {
-      Node& before = nodes[i + 0];
-      Node& after  = nodes[i + 1];
-
-      if (offset + size > after.offset)
-        continue;
-
-      // just continue if the offset range is not fitting
-      if (after.offset < offset)
-        continue;
-
-      if ((before.offset + before.size) == offset) // left merge
-      {
-        before.size += size;
-        return;
-      }
-      else if (after.offset == (offset + size)) // right merge
-      {
-        after.offset = offset;
-        after.size += size;
-        return;
-      }
-      else // insertion between elements
-      {
-        SDL_memmove(&nodes[i + 2], &nodes[i + 1], sizeof(Node) * (nodes_count - (i + 1)));
-        nodes[i + 1] = insertion;
-        return;
-      }
-    }
+    const uint32_t node = acquire_node(offset, size);
+    by_offset.insert(offset_root, node);
+    by_size.insert(size_root, node);
+  }
+}
+
+VkDeviceSize GpuMemoryAllocator::largest_free_range() const
+{
+  VkDeviceSize result = 0;
+  for (uint32_t it = size_root; INVALID_NODE != it; it = nodes[it].by_size[1])
+    result = nodes[it].size;
+  return result;
+}
 
-    // if we got to the end of list, insertion happens as the new last element on list
-    nodes[nodes_count++] = insertion;
+uint32_t GpuMemoryAllocator::acquire_node(const VkDeviceSize offset, const VkDeviceSize size)
+{
+  if (INVALID_NODE == unused_nodes)
+  {
+    const uint32_t old_capacity = nodes_capacity;
+    nodes_capacity *= 2;
+    nodes = reinterpret_cast<Node*>(SDL_realloc(nodes, nodes_capacity * sizeof(Node)));
+
+    for (uint32_t i = old_capacity; i < nodes_capacity; ++i)
+      nodes[i].by_offset[0] = i + 1;
+    nodes[nodes_capacity - 1].by_offset[0] = INVALID_NODE;
+    unused_nodes                           = old_capacity;
   }
+
+  const uint32_t node = unused_nodes;
+  unused_nodes        = nodes[node].by_offset[0];
+  priority_seed       = xorshift(priority_seed);
+
+  nodes[node].offset   = offset;
+  nodes[node].size     = size;
+  nodes[node].priority = priority_seed;
+  free_ranges_count += 1;
+
+  return node;
+}
+
+void GpuMemoryAllocator::release_node(const uint32_t node)
+{
+  nodes[node].by_offset[0] = unused_nodes;
+  unused_nodes             = node;
+  free_ranges_count -= 1;
 }
@@ -10,32 +10,76 @@
 // 0   1   2   3   4   5   6   7   8   9  10  11  12
 //
 // GpuMemoryAllocator
-// Nodes:
-// [0] offset: 4  size: 2
-// [1] offset: 10 size: 2
+// Free ranges:
+// offset: 4  size: 2
+// offset: 10 size: 2
 //
 // Since it'd be hard to implement real free list allocator with remote device, this is the next closest thing.
 //
-
+// Every free range is a node living in two treaps at the same time:
+// - ordered by (size, offset), used to find the best fitting range,
+// - ordered by offset, used to find the neighbours of a freed range (coalescing, double free and overlap detection).
+// Both allocation and free are O(log n) in the number of free ranges. Nodes are referenced by index, so the node pool
+// can grow without invalidating the trees.
+//
 struct GpuMemoryAllocator
 {
-  enum
-  {
-    MAX_FREE_BLOCKS_TRACKED = 128
-  };
+  static constexpr uint32_t     INVALID_NODE   = UINT32_MAX;
+  static constexpr VkDeviceSize INVALID_OFFSET = ~VkDeviceSize(0);
 
   struct Node
   {
     VkDeviceSize offset;
     VkDeviceSize size;
+    uint32_t     priority;
+    uint32_t     by_offset[2]; // left / right child, "by_offset[0]" links the unused nodes
+    uint32_t     by_size[2];
   };
 
-  Node         nodes[MAX_FREE_BLOCKS_TRACKED];
-  uint32_t     nodes_count;
+  Node*        nodes;
+  uint32_t     nodes_capacity;
+  uint32_t     unused_nodes;
+  uint32_t     offset_root;
+  uint32_t     size_root;
+  uint32_t     free_ranges_count;
+  uint32_t     priority_seed;
   VkDeviceSize max_size;
+  VkDeviceSize free_size;
+
+  void init(VkDeviceSize max_size);
+  void teardown();
+  void reset();
 
-  void         init(VkDeviceSize max_size);
-  void         reset();
-  VkDeviceSize allocate_bytes(VkDeviceSize size);
+  // returned offset is a multiple of "alignment", which has to be a power of two
+  VkDeviceSize allocate_bytes(VkDeviceSize size, VkDeviceSize alignment = 1);
+  void         allocate_bytes_ranged(VkDeviceSize dst[], uint32_t count, VkDeviceSize size, VkDeviceSize alignment);
   void         free_bytes(VkDeviceSize offset, VkDeviceSize size);
+
+  [[nodiscard]] VkDeviceSize largest_free_range() const;
+
+  // walks over free ranges in offset order, "fcn" is called with (VkDeviceSize offset, VkDeviceSize size)
+  template <typename Fcn> void for_each_free_range(Fcn fcn) const
+  {
+    // treap depth stays logarithmic with very high probability, 128 levels is far beyond anything reachable
+    uint32_t stack[128];
+    uint32_t stack_size = 0;
+    uint32_t it         = offset_root;
+
+    while ((INVALID_NODE != it) or (0 != stack_size))
+    {
+      while (INVALID_NODE != it)
+      {
+        stack[stack_size++] = it;
+        it                  = nodes[it].by_offset[0];
+      }
+
+      it = stack[--stack_size];
+      fcn(nodes[it].offset, nodes[it].size);
+      it = nodes[it].by_offset[1];
+    }
+  }
+
+private:
+  uint32_t acquire_node(VkDeviceSize offset, VkDeviceSize size);
+  void     release_node(uint32_t node);
 };
@@ -28,17 +28,18 @@ void gpu_memory_visualize(const GpuMemoryAllocator& allocator)
                        ImGuiColorEditFlags_NoTooltip, ImVec2(length, 20));
   };
 
-  if(allocator.nodes[0].offset > 0)
-  {
-      draw_button(BlockType::UsedSpace, allocator.nodes[0].offset);
-  }
+  VkDeviceSize used_begin = 0;
+  allocator.for_each_free_range([&draw_button, &used_begin](VkDeviceSize offset, VkDeviceSize size) {
+    if (offset > used_begin)
+    {
+      draw_button(BlockType::UsedSpace, offset - used_begin);
+    }
+    draw_button(BlockType::FreeSpace, size);
+    used_begin = offset + size;
+  });
 
-  for(uint32_t i=0; i<allocator.nodes_count; ++i)
+  if (allocator.max_size > used_begin)
   {
-      draw_button(BlockType::FreeSpace, allocator.nodes[i].size);
-      if(i < (allocator.nodes_count - 1))
-      {
-          draw_button(BlockType::UsedSpace, allocator.nodes[i+1].offset - (allocator.nodes[i].offset + allocator.nodes[i].size));
-      }
+    draw_button(BlockType::UsedSpace, allocator.max_size - used_begin);
   }
 }
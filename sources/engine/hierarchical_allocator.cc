@@ -1,11 +1,273 @@
 #include "hierarchical_allocator.hh"
 #include "allocators.hh"
 #include "literals.hh"
+#include <utility>
+
+namespace {
+
+//
+// Threads get a small slot number on their first allocation, it selects the thread cache in every BlockTier.
+// Slot goes back to the pool when the thread exits. Whatever was cached under it stays valid and is simply
+// inherited by the next thread which takes the slot.
+//
+
+SDL_SpinLock slots_lock;
+bool         slots_taken[BlockTier::MAX_THREADS];
+
+struct ThreadSlot
+{
+  ThreadSlot()
+      : idx(-1)
+  {
+    SDL_AtomicLock(&slots_lock);
+    for (uint32_t i = 0; i < BlockTier::MAX_THREADS; ++i)
+    {
+      if (not slots_taken[i])
+      {
+        slots_taken[i] = true;
+        idx            = static_cast<int>(i);
+        break;
+      }
+    }
+    SDL_AtomicUnlock(&slots_lock);
+  }
+
+  ~ThreadSlot()
+  {
+    if (0 > idx)
+      return;
+
+    SDL_AtomicLock(&slots_lock);
+    slots_taken[idx] = false;
+    SDL_AtomicUnlock(&slots_lock);
+  }
+
+  int idx;
+};
+
+int get_thread_slot()
+{
+  thread_local ThreadSlot slot;
+  return slot.idx;
+}
+
+uint64_t magazines_bytes(BlockTier::Magazine* const magazines[], uint32_t count, uint32_t block_size)
+{
+  uint64_t result = 0;
+  for (uint32_t i = 0; i < count; ++i)
+    result += magazines[i]->count * block_size;
+  return result;
+}
+
+} // namespace
+
+BlockTier::BlockTier(uint32_t block_size, uint32_t block_count)
+    : backing(block_size, block_count)
+    , backing_lock(0)
+    , backing_used_blocks(0)
+    , backing_peak_used_blocks(0)
+    , uncached_allocations_count(0)
+    , uncached_frees_count(0)
+    , caches(reinterpret_cast<ThreadCache*>(SDL_calloc(MAX_THREADS, sizeof(ThreadCache))))
+    , magazines(reinterpret_cast<Magazine*>(SDL_calloc(MAGAZINES_COUNT, sizeof(Magazine))))
+    , depot_lock(0)
+    , depot_full{}
+    , depot_empty{}
+    , depot_full_count(0)
+    , depot_empty_count(0)
+{
+  for (uint32_t i = 0; i < MAX_THREADS; ++i)
+  {
+    caches[i].loaded   = &magazines[2 * i];
+    caches[i].previous = &magazines[2 * i + 1];
+  }
+
+  for (uint32_t i = 2 * MAX_THREADS; i < MAGAZINES_COUNT; ++i)
+    depot_empty[depot_empty_count++] = &magazines[i];
+}
+
+BlockTier::~BlockTier()
+{
+  SDL_free(magazines);
+  SDL_free(caches);
+}
+
+void* BlockTier::acquire(int thread_slot)
+{
+  if (0 > thread_slot)
+  {
+    void* result = nullptr;
+
+    SDL_AtomicLock(&backing_lock);
+    if (backing.m_BlockCapacity > backing_used_blocks)
+    {
+      result = backing.Allocate(backing.m_BlockSize);
+      backing_used_blocks += 1;
+      backing_peak_used_blocks = SDL_max(backing_peak_used_blocks, backing_used_blocks);
+      uncached_allocations_count += 1;
+    }
+    SDL_AtomicUnlock(&backing_lock);
+    return result;
+  }
+
+  ThreadCache& cache = caches[thread_slot];
+
+  if (0 == cache.loaded->count)
+  {
+    if (cache.previous->count)
+    {
+      std::swap(cache.loaded, cache.previous);
+    }
+    else
+    {
+      Magazine* full = nullptr;
+
+      SDL_AtomicLock(&depot_lock);
+      if (depot_full_count)
+      {
+        full                             = depot_full[--depot_full_count];
+        depot_empty[depot_empty_count++] = cache.previous;
+      }
+      SDL_AtomicUnlock(&depot_lock);
+
+      if (full)
+      {
+        cache.previous = cache.loaded;
+        cache.loaded   = full;
+      }
+      else if (not refill_from_backing(cache.loaded, MAGAZINE_CAPACITY / 2))
+      {
+        return nullptr;
+      }
+    }
+  }
+
+  cache.allocations_count += 1;
+  return cache.loaded->blocks[--cache.loaded->count];
+}
+
+void BlockTier::release(int thread_slot, void* ptr)
+{
+  if (0 > thread_slot)
+  {
+    SDL_AtomicLock(&backing_lock);
+    backing.Free(ptr, backing.m_BlockSize);
+    backing_used_blocks -= 1;
+    uncached_frees_count += 1;
+    SDL_AtomicUnlock(&backing_lock);
+    return;
+  }
+
+  ThreadCache& cache = caches[thread_slot];
+  cache.frees_count += 1;
+
+  if (MAGAZINE_CAPACITY == cache.loaded->count)
+  {
+    if (MAGAZINE_CAPACITY != cache.previous->count)
+    {
+      std::swap(cache.loaded, cache.previous);
+    }
+    else
+    {
+      Magazine* empty = nullptr;
+
+      SDL_AtomicLock(&depot_lock);
+      if (depot_empty_count)
+      {
+        empty                          = depot_empty[--depot_empty_count];
+        depot_full[depot_full_count++] = cache.previous;
+      }
+      SDL_AtomicUnlock(&depot_lock);
+
+      if (empty)
+      {
+        cache.previous = cache.loaded;
+        cache.loaded   = empty;
+      }
+      else
+      {
+        drain_to_backing(cache.loaded, MAGAZINE_CAPACITY / 2);
+      }
+    }
+  }
+
+  cache.loaded->blocks[cache.loaded->count++] = ptr;
+}
+
+void BlockTier::flush(int thread_slot)
+{
+  if (0 > thread_slot)
+    return;
+
+  ThreadCache& cache = caches[thread_slot];
+  drain_to_backing(cache.loaded, cache.loaded->count);
+  drain_to_backing(cache.previous, cache.previous->count);
+}
+
+bool BlockTier::contains(const void* ptr) const
+{
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(ptr);
+  return (backing.m_Data <= p) and (&backing.m_Data[backing.m_BlockSize * backing.m_BlockCapacity] > p);
+}
+
+AllocatorStats BlockTier::get_stats() const
+{
+  const uint32_t block_size = backing.m_BlockSize;
+
+  AllocatorStats stats = {
+      .capacity_bytes    = static_cast<uint64_t>(block_size) * backing.m_BlockCapacity,
+      .used_bytes        = static_cast<uint64_t>(block_size) * backing_used_blocks,
+      .cached_bytes      = magazines_bytes(depot_full, depot_full_count, block_size),
+      .peak_used_bytes   = static_cast<uint64_t>(block_size) * backing_peak_used_blocks,
+      .allocations_count = uncached_allocations_count,
+      .frees_count       = uncached_frees_count,
+  };
+
+  for (uint32_t i = 0; i < MAX_THREADS; ++i)
+  {
+    const ThreadCache& cache = caches[i];
+    stats.cached_bytes += (cache.loaded->count + cache.previous->count) * block_size;
+    stats.allocations_count += cache.allocations_count;
+    stats.frees_count += cache.frees_count;
+  }
+
+  return stats;
+}
+
+bool BlockTier::refill_from_backing(Magazine* magazine, uint32_t count)
+{
+  SDL_AtomicLock(&backing_lock);
+
+  // blocks parked in other thread caches can't be reached from here, take only what's left
+  count = SDL_min(count, backing.m_BlockCapacity - backing_used_blocks);
+
+  for (uint32_t i = 0; i < count; ++i)
+    magazine->blocks[magazine->count++] = backing.Allocate(backing.m_BlockSize);
+  backing_used_blocks += count;
+  backing_peak_used_blocks = SDL_max(backing_peak_used_blocks, backing_used_blocks);
+  SDL_AtomicUnlock(&backing_lock);
+
+  return 0 < count;
+}
+
+void BlockTier::drain_to_backing(Magazine* magazine, uint32_t count)
+{
+  SDL_AtomicLock(&backing_lock);
+  for (uint32_t i = 0; i < count; ++i)
+    backing.Free(magazine->blocks[--magazine->count], backing.m_BlockSize);
+  backing_used_blocks -= count;
+  SDL_AtomicUnlock(&backing_lock);
+}
 
 HierarchicalAllocator::HierarchicalAllocator()
     : block_allocator_1kb(1_KB, 512)
     , block_allocator_10kb(10_KB, 512)
     , free_list_5MB(5_MB)
+    , free_list_lock(0)
+    , free_list_used_bytes(0)
+    , free_list_peak_used_bytes(0)
+    , free_list_allocations_count(0)
+    , free_list_frees_count(0)
 {
 }
 
@@ -14,15 +276,24 @@ void* HierarchicalAllocator::Allocate(uint64_t size)
   size = align(size);
   if (1_KB >= size)
   {
-    return block_allocator_1kb.Allocate(size);
+    return block_allocator_1kb.acquire(get_thread_slot());
   }
   else if (10_KB >= size)
   {
-    return block_allocator_10kb.Allocate(size);
+    return block_allocator_10kb.acquire(get_thread_slot());
   }
   else
   {
-    return free_list_5MB.Allocate(size);
+    SDL_AtomicLock(&free_list_lock);
+    void* result = free_list_5MB.Allocate(size);
+    if (result)
+    {
+      free_list_used_bytes += FreeListAllocator::usable_size(result);
+      free_list_peak_used_bytes = SDL_max(free_list_peak_used_bytes, free_list_used_bytes);
+      free_list_allocations_count += 1;
+    }
+    SDL_AtomicUnlock(&free_list_lock);
+    return result;
   }
 }
 
@@ -31,23 +302,82 @@ void HierarchicalAllocator::Free(void* ptr, uint64_t size)
   size = align(size);
   if (1_KB >= size)
   {
-    block_allocator_1kb.Free(ptr, size);
+    block_allocator_1kb.release(get_thread_slot(), ptr);
   }
   else if (10_KB >= size)
   {
-    block_allocator_10kb.Free(ptr, size);
+    block_allocator_10kb.release(get_thread_slot(), ptr);
   }
   else
   {
+    SDL_AtomicLock(&free_list_lock);
+    free_list_used_bytes -= FreeListAllocator::usable_size(ptr);
     free_list_5MB.Free(ptr, size);
+    free_list_frees_count += 1;
+    SDL_AtomicUnlock(&free_list_lock);
   }
 }
 
+//
+// Tier of the old allocation is found by its address, so the previous size doesn't have to be known.
+// Memory stays where it is as long as the new size maps to the same tier, since "Free" picks the tier by size.
+//
 void* HierarchicalAllocator::Reallocate(void* ptr, uint64_t size)
 {
-  // @TODO: implement
-  (void)ptr;
-  (void)size;
-  SDL_assert(false);
-  return nullptr;
+  size = align(size);
+
+  BlockTier* old_tier = block_allocator_1kb.contains(ptr)    ? &block_allocator_1kb
+                        : block_allocator_10kb.contains(ptr) ? &block_allocator_10kb
+                                                             : nullptr;
+  BlockTier* new_tier = (1_KB >= size) ? &block_allocator_1kb : (10_KB >= size) ? &block_allocator_10kb : nullptr;
+
+  if (old_tier == new_tier)
+  {
+    if (old_tier)
+      return ptr;
+
+    SDL_AtomicLock(&free_list_lock);
+    const uint64_t old_size = FreeListAllocator::usable_size(ptr);
+    void*          result   = free_list_5MB.Reallocate(ptr, size);
+    if (nullptr == result)
+    {
+      // old block is still there and still counted
+      SDL_AtomicUnlock(&free_list_lock);
+      return nullptr;
+    }
+
+    free_list_used_bytes -= old_size;
+    free_list_used_bytes += FreeListAllocator::usable_size(result);
+    free_list_peak_used_bytes = SDL_max(free_list_peak_used_bytes, free_list_used_bytes);
+    SDL_AtomicUnlock(&free_list_lock);
+    return result;
+  }
+
+  const uint64_t old_size = old_tier ? old_tier->backing.m_BlockSize : FreeListAllocator::usable_size(ptr);
+  void*          result   = Allocate(size);
+  if (nullptr == result)
+    return nullptr;
+
+  SDL_memcpy(result, ptr, SDL_min(old_size, size));
+  Free(ptr, old_size);
+  return result;
+}
+
+void HierarchicalAllocator::flush_thread_cache()
+{
+  const int thread_slot = get_thread_slot();
+  block_allocator_1kb.flush(thread_slot);
+  block_allocator_10kb.flush(thread_slot);
+}
+
+AllocatorStats HierarchicalAllocator::get_free_list_stats() const
+{
+  return {
+      .capacity_bytes    = free_list_5MB.capacity,
+      .used_bytes        = free_list_used_bytes,
+      .cached_bytes      = 0,
+      .peak_used_bytes   = free_list_peak_used_bytes,
+      .allocations_count = free_list_allocations_count,
+      .frees_count       = free_list_frees_count,
+  };
 }
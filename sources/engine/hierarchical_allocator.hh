@@ -1,9 +1,79 @@
 #pragma once
 
+#include "allocator_stats.hh"
 #include "block_allocator.hh"
 #include "free_list_allocator.hh"
 #include "memory_allocator.hh"
+#include <SDL2/SDL_atomic.h>
 
+//
+// Magazine layer in front of a BlockAllocator (Bonwick & Adams, "Magazines and Vmem").
+//
+// Every thread owns two magazines of free blocks, allocation and free only touch them in the common case.
+// When both are exhausted (or both are full) a whole magazine is traded with the depot under a spinlock,
+// and only when the depot has nothing to offer the backing allocator is locked and used in batches.
+//
+struct BlockTier
+{
+  static constexpr uint32_t MAGAZINE_CAPACITY = 32;
+  static constexpr uint32_t MAX_THREADS       = 64;
+  static constexpr uint32_t DEPOT_MAGAZINES   = 64;
+
+  struct Magazine
+  {
+    uint32_t count;
+    void*    blocks[MAGAZINE_CAPACITY];
+  };
+
+  struct ThreadCache
+  {
+    Magazine* loaded;
+    Magazine* previous;
+    uint64_t  allocations_count;
+    uint64_t  frees_count;
+    uint8_t   padding[64 - 2 * sizeof(Magazine*) - 2 * sizeof(uint64_t)];
+  };
+
+  BlockTier(uint32_t block_size, uint32_t block_count);
+  ~BlockTier();
+
+  // thread slot is -1 for threads which didn't get a cache, they go straight to the backing allocator
+  // nullptr once neither the thread cache, the depot nor the backing allocator have a block left
+  void* acquire(int thread_slot);
+  void  release(int thread_slot, void* ptr);
+  void  flush(int thread_slot);
+
+  [[nodiscard]] bool contains(const void* ptr) const;
+  [[nodiscard]] AllocatorStats get_stats() const;
+
+  static constexpr uint32_t MAGAZINES_COUNT = 2 * MAX_THREADS + DEPOT_MAGAZINES;
+
+  BlockAllocator backing;
+  SDL_SpinLock   backing_lock;
+  uint32_t       backing_used_blocks;
+  uint32_t       backing_peak_used_blocks;
+  uint64_t       uncached_allocations_count;
+  uint64_t       uncached_frees_count;
+
+  ThreadCache* caches;
+  Magazine*    magazines;
+
+  SDL_SpinLock depot_lock;
+  Magazine*    depot_full[MAGAZINES_COUNT];
+  Magazine*    depot_empty[MAGAZINES_COUNT];
+  uint32_t     depot_full_count;
+  uint32_t     depot_empty_count;
+
+private:
+  // false when the backing allocator is exhausted
+  bool refill_from_backing(Magazine* magazine, uint32_t count);
+  void drain_to_backing(Magazine* magazine, uint32_t count);
+};
+
+//
+// Allocator shared by every thread.
+// 1KB and 10KB block tiers go through per thread magazine caches, bigger allocations hit the TLSF tier under a lock.
+//
 struct HierarchicalAllocator : public MemoryAllocator
 {
   HierarchicalAllocator();
@@ -31,7 +101,17 @@ struct HierarchicalAllocator : public MemoryAllocator
   void  Free(void* ptr, uint64_t size) override;
   void* Reallocate(void* ptr, uint64_t size) override;
 
-  BlockAllocator    block_allocator_1kb;
-  BlockAllocator    block_allocator_10kb;
+  // gives blocks cached by the calling thread back to the depot, call it before a thread goes idle for long
+  void flush_thread_cache();
+
+  [[nodiscard]] AllocatorStats get_free_list_stats() const;
+
+  BlockTier         block_allocator_1kb;
+  BlockTier         block_allocator_10kb;
   FreeListAllocator free_list_5MB;
+  SDL_SpinLock      free_list_lock;
+  uint64_t          free_list_used_bytes;
+  uint64_t          free_list_peak_used_bytes;
+  uint64_t          free_list_allocations_count;
+  uint64_t          free_list_frees_count;
 };
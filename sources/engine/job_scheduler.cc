@@ -0,0 +1,589 @@
+#include "job_scheduler.hh"
+#include "literals.hh"
+#include "stack_allocator.hh"
+#include <SDL2/SDL_timer.h>
+#include <new>
+
+namespace {
+
+SDL_Thread* spawn_worker_thread(JobScheduler* scheduler)
+{
+  return SDL_CreateThread(
+      [](void* arg) {
+        reinterpret_cast<JobScheduler*>(arg)->worker_loop();
+        return 0;
+      },
+      "worker", scheduler);
+}
+
+uint32_t next_power_of_two(uint32_t in)
+{
+  uint32_t result = 1;
+  while (result < in)
+    result <<= 1;
+  return result;
+}
+
+} // namespace
+
+void JobScheduler::setup(MemoryAllocator& new_allocator, uint32_t new_worker_threads_count,
+                         uint32_t initial_jobs_capacity, uint32_t initial_dependencies_capacity)
+{
+  allocator            = &new_allocator;
+  worker_threads_count = new_worker_threads_count;
+  threads_count        = new_worker_threads_count + 1;
+
+  jobs_capacity         = SDL_max(initial_jobs_capacity, 1u);
+  jobs                  = allocate_array<Job>(*allocator, jobs_capacity);
+  coroutine_jobs        = allocate_array<CoroutineJobFunction>(*allocator, jobs_capacity);
+  jobs_blocking_count   = allocate_array<SDL_atomic_t>(*allocator, jobs_capacity);
+  jobs_first_dependency = allocate_array<uint32_t>(*allocator, jobs_capacity);
+
+  dependencies_capacity = SDL_max(initial_dependencies_capacity, 1u);
+  dependencies          = allocate_array<JobDependency>(*allocator, dependencies_capacity);
+
+  clear_jobs();
+
+  //
+  // Every single job may end up in one deque, so each of them has to be able to hold the whole frame.
+  // Job deques are resized in "start" whenever the frame outgrows them.
+  //
+  queues       = allocate_array<WorkStealingDeque<JobHandle>>(*allocator, threads_count);
+  range_queues = allocate_array<WorkStealingDeque<RangeTask>>(*allocator, threads_count);
+
+  for (uint32_t i = 0; i < threads_count; ++i)
+  {
+    queues[i].init(*allocator, next_power_of_two(jobs_capacity));
+    range_queues[i].init(*allocator, RANGE_QUEUE_CAPACITY);
+  }
+
+  main_thread_allocator = new (allocator->Allocate(sizeof(Stack))) Stack(256_KB);
+  coroutine_frames.setup(*allocator, COROUTINE_FRAME_SIZE, COROUTINE_FRAMES);
+
+  worker_threads             = allocate_array<SDL_Thread*>(*allocator, worker_threads_count);
+  new_jobs_available_signals = allocate_array<SDL_sem*>(*allocator, worker_threads_count);
+
+  for (uint32_t i = 0; i < worker_threads_count; ++i)
+    new_jobs_available_signals[i] = SDL_CreateSemaphore(0);
+
+  all_threads_idle_signal = SDL_CreateSemaphore(0);
+  thread_end_requested    = false;
+
+  SDL_AtomicSet(&threads_finished_work, 0);
+
+  for (uint32_t i = 0; i < worker_threads_count; ++i)
+    worker_threads[i] = spawn_worker_thread(this);
+
+  if (worker_threads_count)
+    SDL_SemWait(all_threads_idle_signal);
+
+  SDL_AtomicSet(&threads_finished_work, 0);
+}
+
+void JobScheduler::teardown()
+{
+  thread_end_requested = true;
+
+  for (uint32_t i = 0; i < worker_threads_count; ++i)
+    SDL_SemPost(new_jobs_available_signals[i]);
+
+  for (uint32_t i = 0; i < worker_threads_count; ++i)
+    SDL_WaitThread(worker_threads[i], nullptr);
+
+  for (uint32_t i = 0; i < worker_threads_count; ++i)
+    SDL_DestroySemaphore(new_jobs_available_signals[i]);
+
+  SDL_DestroySemaphore(all_threads_idle_signal);
+
+  free_array(*allocator, new_jobs_available_signals, worker_threads_count);
+  free_array(*allocator, worker_threads, worker_threads_count);
+
+  SDL_assert(0 == SDL_AtomicGet(&coroutine_frames.used_count));
+  coroutine_frames.teardown(*allocator);
+
+  main_thread_allocator->~Stack();
+  allocator->Free(main_thread_allocator, sizeof(Stack));
+
+  for (uint32_t i = 0; i < threads_count; ++i)
+  {
+    range_queues[i].teardown(*allocator);
+    queues[i].teardown(*allocator);
+  }
+
+  free_array(*allocator, range_queues, threads_count);
+  free_array(*allocator, queues, threads_count);
+
+  free_array(*allocator, dependencies, dependencies_capacity);
+  free_array(*allocator, jobs_first_dependency, jobs_capacity);
+  free_array(*allocator, jobs_blocking_count, jobs_capacity);
+  free_array(*allocator, coroutine_jobs, jobs_capacity);
+  free_array(*allocator, jobs, jobs_capacity);
+}
+
+void JobScheduler::worker_loop()
+{
+  const int thread_id          = SDL_AtomicIncRef(&threads_finished_work) + 1;
+  SDL_sem*  new_jobs_available = new_jobs_available_signals[thread_id - 1];
+
+  if (static_cast<int>(worker_threads_count) == thread_id)
+  {
+    SDL_SemPost(all_threads_idle_signal);
+  }
+
+  Stack allocator(256_KB);
+
+  while (true)
+  {
+    SDL_SemWait(new_jobs_available);
+
+    if (thread_end_requested)
+      break;
+
+    process_jobs(thread_id, allocator);
+
+    if (static_cast<int>(worker_threads_count) == (SDL_AtomicIncRef(&threads_finished_work) + 1))
+      SDL_SemPost(all_threads_idle_signal);
+  }
+}
+
+void JobScheduler::clear_jobs()
+{
+  jobs_count         = 0;
+  dependencies_count = 0;
+}
+
+JobHandle JobScheduler::add_job(Job job)
+{
+  if (jobs_capacity == jobs_count)
+    grow_jobs();
+
+  //
+  // Workers are asleep while the frame is being built, plain stores are enough.
+  //
+  const JobHandle handle            = jobs_count++;
+  jobs[handle]                      = job;
+  coroutine_jobs[handle]            = nullptr;
+  jobs_blocking_count[handle].value = 0;
+  jobs_first_dependency[handle]     = NO_DEPENDENCY;
+
+  return handle;
+}
+
+JobHandle JobScheduler::add_job(Job job, std::initializer_list<JobHandle> predecessors)
+{
+  const JobHandle handle = add_job(job);
+  for (JobHandle predecessor : predecessors)
+    add_dependency(handle, predecessor);
+  return handle;
+}
+
+JobHandle JobScheduler::add_job(CoroutineJobFunction job)
+{
+  const JobHandle handle = add_job(static_cast<Job>(nullptr));
+  coroutine_jobs[handle] = job;
+  return handle;
+}
+
+JobHandle JobScheduler::add_job(CoroutineJobFunction job, std::initializer_list<JobHandle> predecessors)
+{
+  const JobHandle handle = add_job(job);
+  for (JobHandle predecessor : predecessors)
+    add_dependency(handle, predecessor);
+  return handle;
+}
+
+void JobScheduler::add_dependency(JobHandle job, JobHandle predecessor)
+{
+  SDL_assert(jobs_count > job);
+  SDL_assert(job > predecessor);
+
+  if (dependencies_capacity == dependencies_count)
+    grow_dependencies();
+
+  const uint32_t dependency_idx = dependencies_count++;
+  dependencies[dependency_idx]  = {
+      .successor = job,
+      .next      = jobs_first_dependency[predecessor],
+  };
+  jobs_first_dependency[predecessor] = dependency_idx;
+
+  SDL_AtomicIncRef(&jobs_blocking_count[job]);
+}
+
+void JobScheduler::fill_jobs(JobGenerator g)
+{
+  clear_jobs();
+
+  //
+  // Generators write straight into the job array, so it has to be big enough up front.
+  //
+  const uint32_t count = g(jobs) - jobs;
+  SDL_assert(jobs_capacity >= count);
+
+  for (uint32_t i = 0; i < count; ++i)
+    add_job(jobs[i]);
+}
+
+void JobScheduler::grow_jobs()
+{
+  const uint32_t new_capacity = 2 * jobs_capacity;
+
+  jobs                  = grow_array(*allocator, jobs, new_capacity);
+  coroutine_jobs        = grow_array(*allocator, coroutine_jobs, new_capacity);
+  jobs_blocking_count   = grow_array(*allocator, jobs_blocking_count, new_capacity);
+  jobs_first_dependency = grow_array(*allocator, jobs_first_dependency, new_capacity);
+  jobs_capacity         = new_capacity;
+}
+
+void JobScheduler::grow_dependencies()
+{
+  const uint32_t new_capacity = 2 * dependencies_capacity;
+
+  dependencies          = grow_array(*allocator, dependencies, new_capacity);
+  dependencies_capacity = new_capacity;
+}
+
+void JobScheduler::start()
+{
+  //
+  // All workers are asleep at this point, so the main thread is free to act as owner of every deque.
+  // Jobs without predecessors are dealt round robin and pushed in reverse, so each owner pops them in added order.
+  //
+  for (uint32_t i = 0; i < threads_count; ++i)
+  {
+    if (queues[i].get_capacity() < jobs_capacity)
+    {
+      queues[i].teardown(*allocator);
+      queues[i].init(*allocator, next_power_of_two(jobs_capacity));
+    }
+
+    queues[i].reset();
+    range_queues[i].reset();
+  }
+
+  SDL_AtomicSet(&jobs_finished, 0);
+
+  for (JobHandle job = jobs_count; 0 < job; --job)
+    if (0 == SDL_AtomicGet(&jobs_blocking_count[job - 1]))
+      queues[(job - 1) % threads_count].push(job - 1);
+
+  for (uint32_t i = 0; i < worker_threads_count; ++i)
+    SDL_SemPost(new_jobs_available_signals[i]);
+}
+
+void JobScheduler::wait_for_finish()
+{
+  process_jobs(0, *main_thread_allocator);
+
+  if (worker_threads_count)
+    SDL_SemWait(all_threads_idle_signal);
+
+  SDL_AtomicSet(&threads_finished_work, 0);
+}
+
+bool JobScheduler::acquire_job(int thread_id, JobHandle& job)
+{
+  if (queues[thread_id].pop(job))
+    return true;
+
+  for (uint32_t i = 1; i < threads_count; ++i)
+    if (queues[(thread_id + i) % threads_count].steal(job))
+      return true;
+
+  return false;
+}
+
+bool JobScheduler::acquire_range(int thread_id, RangeTask& task)
+{
+  if (range_queues[thread_id].pop(task))
+    return true;
+
+  for (uint32_t i = 1; i < threads_count; ++i)
+    if (range_queues[(thread_id + i) % threads_count].steal(task))
+      return true;
+
+  return false;
+}
+
+void JobScheduler::finish_job(int thread_id, JobHandle job)
+{
+  for (uint32_t i = jobs_first_dependency[job]; NO_DEPENDENCY != i; i = dependencies[i].next)
+  {
+    const JobHandle successor = dependencies[i].successor;
+    if (SDL_AtomicDecRef(&jobs_blocking_count[successor]))
+      queues[thread_id].push(successor);
+  }
+}
+
+void JobScheduler::run_range(ThreadJobData tjd, RangeTask task)
+{
+  ParallelFor& pf = *task.parallel_for;
+
+  //
+  // Lazy binary splitting: upper halves are left for thieves, the lower one is split further until it fits the grain.
+  // Thief which takes an upper half splits it the same way on its own deque.
+  //
+  while (pf.grain < (task.end - task.begin))
+  {
+    const uint32_t mid = task.begin + ((task.end - task.begin) / 2);
+    range_queues[tjd.thread_id].push({
+        .parallel_for = &pf,
+        .begin        = mid,
+        .end          = task.end,
+    });
+    task.end = mid;
+  }
+
+  //
+  // Blocking "parallel_for" may release its bookkeeping as soon as the last chunk reports in,
+  // so nothing is read from it past that point unless there is a coroutine waiting on it.
+  //
+  const std::coroutine_handle<> continuation = pf.continuation;
+  const int                     chunk_size   = static_cast<int>(task.end - task.begin);
+
+  pf.fn(tjd, pf.arg, task.begin, task.end);
+
+  if ((chunk_size == SDL_AtomicAdd(&pf.remaining, -chunk_size)) and continuation)
+  {
+    pf.resumed_thread_id = tjd.thread_id;
+    pf.resumed_allocator = &tjd.allocator;
+    continuation.resume();
+  }
+}
+
+void JobScheduler::parallel_for(ThreadJobData tjd, uint32_t begin, uint32_t end, uint32_t grain, RangeFunction fn,
+                                void* arg)
+{
+  if (begin >= end)
+    return;
+
+  ParallelFor* pf  = reinterpret_cast<ParallelFor*>(tjd.allocator.Allocate(sizeof(ParallelFor)));
+  pf->fn           = fn;
+  pf->arg          = arg;
+  pf->grain        = SDL_max(grain, 1u);
+  pf->continuation = nullptr;
+  SDL_AtomicSet(&pf->remaining, static_cast<int>(end - begin));
+
+  run_range(tjd, {
+                     .parallel_for = pf,
+                     .begin        = begin,
+                     .end          = end,
+                 });
+
+  //
+  // Help with whatever ranges are out there (not necessarily our own) until the last chunk of ours is done.
+  //
+  RangeTask task = {};
+  while (0 != SDL_AtomicGet(&pf->remaining))
+  {
+    if (acquire_range(tjd.thread_id, task))
+      run_range(tjd, task);
+    else
+      SDL_Delay(0);
+  }
+}
+
+ParallelForAwaiter JobScheduler::async_parallel_for(ThreadJobData tjd, uint32_t begin, uint32_t end, uint32_t grain,
+                                                    RangeFunction fn, void* arg)
+{
+  ParallelForAwaiter awaiter = {
+      .scheduler = this,
+      .parallel_for =
+          {
+              .fn                = fn,
+              .arg               = arg,
+              .grain             = SDL_max(grain, 1u),
+              .remaining         = {static_cast<int>(end - begin)},
+              .continuation      = nullptr,
+              .resumed_thread_id = tjd.thread_id,
+              .resumed_allocator = &tjd.allocator,
+          },
+      .begin     = begin,
+      .end       = end,
+      .user_data = tjd.user_data,
+      .promise   = nullptr,
+  };
+
+  return awaiter;
+}
+
+void JobScheduler::run_coroutine_job(ThreadJobData tjd, JobHandle job)
+{
+  CoroutineJob                coroutine = coroutine_jobs[job](tjd);
+  CoroutineJob::promise_type& promise   = coroutine.handle.promise();
+
+  promise.scheduler = this;
+  promise.job       = job;
+  promise.thread_id = tjd.thread_id;
+
+  coroutine.handle.resume();
+}
+
+void JobScheduler::process_jobs(int thread_id, Stack& allocator)
+{
+  JobHandle job              = 0;
+  RangeTask task             = {};
+  int       finished_locally = 0;
+
+  while (true)
+  {
+    ThreadJobData tjd = {
+        .thread_id = thread_id,
+        .allocator = allocator,
+        .user_data = user_data,
+        .scheduler = this,
+    };
+
+    if (acquire_range(thread_id, task))
+    {
+      run_range(tjd, task);
+      allocator.Reset();
+      continue;
+    }
+
+    if (acquire_job(thread_id, job))
+    {
+      if (coroutine_jobs[job])
+      {
+        //
+        // Coroutine reports back on its own once its body returns, possibly from another thread.
+        //
+        run_coroutine_job(tjd, job);
+        allocator.Reset();
+        continue;
+      }
+
+      jobs[job](tjd);
+      allocator.Reset();
+      finish_job(thread_id, job);
+      finished_locally += 1;
+      continue;
+    }
+
+    //
+    // Shared counter is only touched when this thread runs out of work, not after every single job.
+    // Until every job reports in, some successor may still become runnable.
+    //
+    if (finished_locally)
+    {
+      SDL_AtomicAdd(&jobs_finished, finished_locally);
+      finished_locally = 0;
+    }
+
+    if (static_cast<int>(jobs_count) == SDL_AtomicGet(&jobs_finished))
+      break;
+
+    SDL_Delay(0);
+  }
+}
+
+void CoroutineFramePool::setup(MemoryAllocator& allocator, uint32_t max_frame_size, uint32_t max_frames_count)
+{
+  slot_size   = align(HEADER_SIZE + max_frame_size, HEADER_SIZE);
+  slots_count = max_frames_count;
+  memory      = reinterpret_cast<uint8_t*>(allocator.Allocate(slot_size * slots_count + HEADER_SIZE));
+  slots       = reinterpret_cast<uint8_t*>(align(reinterpret_cast<uintptr_t>(memory), uintptr_t(HEADER_SIZE)));
+  free_slots  = nullptr;
+  lock        = 0;
+  SDL_AtomicSet(&used_count, 0);
+
+  for (uint32_t i = slots_count; 0 < i; --i)
+  {
+    Slot* slot = reinterpret_cast<Slot*>(&slots[(i - 1) * slot_size]);
+    slot->pool = this;
+    slot->next = free_slots;
+    free_slots = slot;
+  }
+}
+
+void CoroutineFramePool::teardown(MemoryAllocator& allocator)
+{
+  allocator.Free(memory, slot_size * slots_count + HEADER_SIZE);
+}
+
+void* CoroutineFramePool::allocate(uint64_t size)
+{
+  SDL_assert((HEADER_SIZE + size) <= slot_size);
+
+  SDL_AtomicLock(&lock);
+  Slot* slot = free_slots;
+  if (slot)
+    free_slots = slot->next;
+  SDL_AtomicUnlock(&lock);
+
+  SDL_assert(slot);
+  SDL_AtomicIncRef(&used_count);
+  return reinterpret_cast<uint8_t*>(slot) + HEADER_SIZE;
+}
+
+void CoroutineFramePool::release(void* frame)
+{
+  Slot*               slot = reinterpret_cast<Slot*>(reinterpret_cast<uint8_t*>(frame) - HEADER_SIZE);
+  CoroutineFramePool* pool = slot->pool;
+
+  SDL_AtomicLock(&pool->lock);
+  slot->next       = pool->free_slots;
+  pool->free_slots = slot;
+  SDL_AtomicUnlock(&pool->lock);
+
+  SDL_AtomicAdd(&pool->used_count, -1);
+}
+
+void* CoroutineJob::promise_type::operator new(size_t size, ThreadJobData tjd)
+{
+  return tjd.scheduler->coroutine_frames.allocate(size);
+}
+
+void CoroutineJob::promise_type::operator delete(void* frame)
+{
+  CoroutineFramePool::release(frame);
+}
+
+void CoroutineJob::promise_type::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+{
+  //
+  // Frame goes back to the pool before successors are released, so they can reuse it right away.
+  //
+  JobScheduler*   scheduler = handle.promise().scheduler;
+  const JobHandle job       = handle.promise().job;
+  const int       thread_id = handle.promise().thread_id;
+
+  handle.destroy();
+
+  scheduler->finish_job(thread_id, job);
+  SDL_AtomicIncRef(&scheduler->jobs_finished);
+}
+
+bool ParallelForAwaiter::await_ready() const
+{
+  return begin >= end;
+}
+
+void ParallelForAwaiter::await_suspend(std::coroutine_handle<CoroutineJob::promise_type> handle)
+{
+  //
+  // Once the range is pushed any thread may finish it and resume the coroutine, even before this function returns.
+  // Nothing in the awaiter is touched after the push.
+  //
+  promise                   = &handle.promise();
+  parallel_for.continuation = handle;
+
+  scheduler->range_queues[promise->thread_id].push({
+      .parallel_for = &parallel_for,
+      .begin        = begin,
+      .end          = end,
+  });
+}
+
+ThreadJobData ParallelForAwaiter::await_resume()
+{
+  if (promise)
+    promise->thread_id = parallel_for.resumed_thread_id;
+
+  return {
+      .thread_id = parallel_for.resumed_thread_id,
+      .allocator = *parallel_for.resumed_allocator,
+      .user_data = user_data,
+      .scheduler = scheduler,
+  };
+}
@@ -0,0 +1,267 @@
+#pragma once
+
+#include "engine_constants.hh"
+#include "memory_allocator.hh"
+#include "work_stealing_deque.hh"
+#include <SDL2/SDL_mutex.h>
+#include <SDL2/SDL_thread.h>
+#include <coroutine>
+#include <initializer_list>
+
+class Stack;
+struct JobScheduler;
+
+struct ThreadJobData
+{
+  int              thread_id;
+  MemoryAllocator& allocator;
+  void*            user_data;
+  JobScheduler*    scheduler;
+};
+
+using Job          = void (*)(ThreadJobData);
+using JobGenerator = Job*(Job*);
+using JobHandle    = uint32_t;
+
+struct JobDependency
+{
+  JobHandle successor;
+  uint32_t  next;
+};
+
+using RangeFunction = void (*)(ThreadJobData tjd, void* arg, uint32_t begin, uint32_t end);
+
+struct ParallelFor
+{
+  RangeFunction fn;
+  void*         arg;
+  uint32_t      grain;
+  SDL_atomic_t  remaining;
+
+  // set only for "async_parallel_for", resumed by the thread which finishes the last chunk
+  std::coroutine_handle<> continuation;
+  int                     resumed_thread_id;
+  MemoryAllocator*        resumed_allocator;
+};
+
+struct RangeTask
+{
+  ParallelFor* parallel_for;
+  uint32_t     begin;
+  uint32_t     end;
+};
+
+//
+// Fixed size slots for coroutine frames, carved out of a single allocation made during setup.
+// Frames are created and destroyed on any thread, so the free list is guarded by a spinlock.
+// Each slot starts with a header pointing back to the pool, since coroutine "operator delete" gets no context.
+//
+struct CoroutineFramePool
+{
+  struct Slot
+  {
+    CoroutineFramePool* pool;
+    Slot*               next;
+  };
+
+  static constexpr uint32_t HEADER_SIZE = 16;
+  static_assert(sizeof(Slot) <= HEADER_SIZE);
+
+  uint8_t*     memory;
+  uint8_t*     slots;
+  Slot*        free_slots;
+  uint32_t     slot_size;
+  uint32_t     slots_count;
+  SDL_SpinLock lock;
+  SDL_atomic_t used_count;
+
+  void        setup(MemoryAllocator& allocator, uint32_t max_frame_size, uint32_t max_frames_count);
+  void        teardown(MemoryAllocator& allocator);
+  void*       allocate(uint64_t size);
+  static void release(void* frame);
+};
+
+//
+// Frame job which is able to suspend itself while waiting on child work, without blocking the thread it runs on.
+// Started by the scheduler like any other job and considered finished once the coroutine body returns.
+// Successors are released by whichever thread completes the coroutine.
+//
+// Rules for coroutine bodies:
+// - "co_await" may resume on a different thread. Use ThreadJobData returned by it from then on.
+// - Allocations from ThreadJobData::allocator and scoped profiler events must not span a "co_await".
+//
+struct CoroutineJob
+{
+  struct promise_type
+  {
+    JobScheduler* scheduler;
+    JobHandle     job;
+    int           thread_id;
+
+    struct FinalAwaiter
+    {
+      bool await_ready() noexcept
+      {
+        return false;
+      }
+
+      void await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+      void await_resume() noexcept {}
+    };
+
+    static void* operator new(size_t size, ThreadJobData tjd);
+    static void  operator delete(void* frame);
+
+    CoroutineJob get_return_object()
+    {
+      return {std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+
+    std::suspend_always initial_suspend() noexcept
+    {
+      return {};
+    }
+
+    FinalAwaiter final_suspend() noexcept
+    {
+      return {};
+    }
+
+    void return_void() {}
+
+    void unhandled_exception()
+    {
+      SDL_assert(false);
+    }
+  };
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+using CoroutineJobFunction = CoroutineJob (*)(ThreadJobData);
+
+struct ParallelForAwaiter
+{
+  JobScheduler*               scheduler;
+  ParallelFor                 parallel_for;
+  uint32_t                    begin;
+  uint32_t                    end;
+  void*                       user_data;
+  CoroutineJob::promise_type* promise;
+
+  bool          await_ready() const;
+  void          await_suspend(std::coroutine_handle<CoroutineJob::promise_type> handle);
+  ThreadJobData await_resume();
+};
+
+//
+// Work stealing job scheduler.
+// Every thread owns a deque of jobs and steals from the others once its own deque runs dry.
+// Thread "0" is the main thread which takes part in job processing while waiting for the frame to finish.
+// Worker threads use ids from 1 to worker_threads_count. Worker count is decided at runtime and may be zero,
+// in which case the main thread processes the whole frame on its own.
+//
+// Jobs of a single frame form a dependency graph. Job becomes runnable once all of its predecessors are finished
+// and is then pushed onto the deque of the thread which finished the last predecessor.
+// Predecessors have to be added before their successors, which keeps the graph acyclic.
+//
+// Data parallel work inside of a job goes through "parallel_for". Ranges live in separate deques, so a thread helping
+// with a range never picks up a whole frame job in the middle of its own.
+//
+// Coroutine jobs (see CoroutineJob) fan out child work with "co_await async_parallel_for(...)" and give their thread
+// back to the scheduler until the last child chunk is done.
+//
+// Per thread data, jobs and dependencies come from the allocator passed to "setup". Job and dependency arrays
+// start at the requested capacity and grow while the frame is being built, so there is no per frame job limit.
+//
+
+struct JobScheduler
+{
+  static constexpr uint32_t NO_DEPENDENCY        = ~0u;
+  static constexpr uint32_t RANGE_QUEUE_CAPACITY = 256;
+  static constexpr uint32_t COROUTINE_FRAME_SIZE = 1024;
+  static constexpr uint32_t COROUTINE_FRAMES     = 64;
+
+  bool             thread_end_requested;
+  MemoryAllocator* allocator;
+  uint32_t         worker_threads_count;
+  uint32_t         threads_count;
+
+  Job*                  jobs;
+  CoroutineJobFunction* coroutine_jobs;
+  SDL_atomic_t*         jobs_blocking_count;
+  uint32_t*     jobs_first_dependency;
+  uint32_t      jobs_count;
+  uint32_t      jobs_capacity;
+  SDL_atomic_t  jobs_finished;
+
+  JobDependency* dependencies;
+  uint32_t       dependencies_count;
+  uint32_t       dependencies_capacity;
+
+  // indexed with thread id
+  WorkStealingDeque<JobHandle>* queues;
+  WorkStealingDeque<RangeTask>* range_queues;
+
+  // indexed with thread id - 1
+  SDL_Thread** worker_threads;
+  SDL_sem**    new_jobs_available_signals;
+
+  SDL_sem*     all_threads_idle_signal;
+  SDL_atomic_t threads_finished_work;
+  Stack*       main_thread_allocator;
+  void*        user_data;
+
+  CoroutineFramePool coroutine_frames;
+
+  void setup(MemoryAllocator& new_allocator, uint32_t new_worker_threads_count, uint32_t initial_jobs_capacity,
+             uint32_t initial_dependencies_capacity);
+  void teardown();
+  void worker_loop();
+
+  //
+  // Building the frame. Has to be done from the main thread between "wait_for_finish" and "start".
+  //
+  void      clear_jobs();
+  JobHandle add_job(Job job);
+  JobHandle add_job(Job job, std::initializer_list<JobHandle> predecessors);
+  JobHandle add_job(CoroutineJobFunction job);
+  JobHandle add_job(CoroutineJobFunction job, std::initializer_list<JobHandle> predecessors);
+  void      add_dependency(JobHandle job, JobHandle predecessor);
+  void      fill_jobs(JobGenerator g);
+  void      grow_jobs();
+  void      grow_dependencies();
+
+  void start();
+  void wait_for_finish();
+
+  //
+  // Splits [begin, end) into chunks of at most "grain" elements which are processed by every thread free to help.
+  // Has to be called from inside of a job. Calling thread works on the range too and returns once all of it is done.
+  // Bookkeeping is allocated from the calling job's allocator.
+  //
+  void parallel_for(ThreadJobData tjd, uint32_t begin, uint32_t end, uint32_t grain, RangeFunction fn, void* arg);
+
+  template <typename F> void parallel_for(ThreadJobData tjd, uint32_t begin, uint32_t end, uint32_t grain, const F& fn)
+  {
+    auto call = [](ThreadJobData chunk_tjd, void* arg, uint32_t chunk_begin, uint32_t chunk_end) {
+      (*reinterpret_cast<const F*>(arg))(chunk_tjd, chunk_begin, chunk_end);
+    };
+    parallel_for(tjd, begin, end, grain, call, const_cast<F*>(&fn));
+  }
+
+  //
+  // Non blocking variant of the above for coroutine jobs. Whole range is handed over to the scheduler and
+  // the coroutine is resumed by the thread which finishes the last chunk. Bookkeeping lives in the returned awaiter,
+  // so it has to be awaited right away: "ThreadJobData resumed = co_await scheduler.async_parallel_for(...)".
+  //
+  [[nodiscard]] ParallelForAwaiter async_parallel_for(ThreadJobData tjd, uint32_t begin, uint32_t end, uint32_t grain,
+                                                      RangeFunction fn, void* arg);
+
+  bool acquire_job(int thread_id, JobHandle& job);
+  bool acquire_range(int thread_id, RangeTask& task);
+  void finish_job(int thread_id, JobHandle job);
+  void run_range(ThreadJobData tjd, RangeTask task);
+  void run_coroutine_job(ThreadJobData tjd, JobHandle job);
+  void process_jobs(int thread_id, Stack& allocator);
+};
@@ -1,6 +1,4 @@
 #include "job_system.hh"
-#include "literals.hh"
-#include "stack_allocator.hh"
 #include <algorithm>
 
 namespace {
@@ -22,10 +20,11 @@ public:
     return pool;
   }
 
-  void allocate_command_buffers(VkCommandPool pool, VkCommandBuffer dst[]) const
+  void allocate_command_buffers(VkCommandPool pool, VkCommandBuffer dst[], uint32_t count) const
   {
     VkCommandBufferAllocateInfo info = cb_allocate_info;
     info.commandPool                 = pool;
+    info.commandBufferCount          = count;
     vkAllocateCommandBuffers(device, &info, dst);
   }
 
@@ -45,7 +44,7 @@ private:
     i.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     i.commandPool                 = VK_NULL_HANDLE;
     i.level                       = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
-    i.commandBufferCount          = sizeof(WorkerCommands::commands) / sizeof(VkCommandBuffer);
+    i.commandBufferCount          = 0;
     return i;
   }
 
@@ -55,132 +54,94 @@ private:
   VkCommandBufferAllocateInfo cb_allocate_info;
 };
 
-SDL_Thread* spawn_worker_thread(JobSystem* system)
-{
-  return SDL_CreateThread(
-      [](void* arg) {
-        reinterpret_cast<JobSystem*>(arg)->worker_loop();
-        return 0;
-      },
-      "worker", system);
-}
-
 } // namespace
 
-void JobSystem::setup(VkDevice device, uint32_t graphics_queue_family_index)
+void JobSystem::setup(VkDevice new_device, uint32_t graphics_queue_family_index, MemoryAllocator& allocator,
+                      uint32_t worker_threads_count)
 {
-  VulkanInitialization vk(device, graphics_queue_family_index);
+  JobScheduler::setup(allocator, worker_threads_count, INITIAL_JOBS_PER_FRAME, INITIAL_JOB_DEPENDENCIES_PER_FRAME);
 
-  for (WorkerThread& worker : workers)
-    worker.pool = vk.create_pool();
-
-  for (WorkerThread& worker : workers)
-    for (WorkerCommands& commands : worker.commands)
-      vk.allocate_command_buffers(worker.pool, commands.commands);
+  device = new_device;
+  VulkanInitialization vk(device, graphics_queue_family_index);
 
-  all_threads_idle_signal  = SDL_CreateSemaphore(0);
-  new_jobs_available_cond  = SDL_CreateCond();
-  new_jobs_available_mutex = SDL_CreateMutex();
-  thread_end_requested     = false;
+  command_pools = reinterpret_cast<ThreadCommandPool*>(allocator.Allocate(threads_count * sizeof(ThreadCommandPool)));
 
-  SDL_AtomicSet(&threads_finished_work, 1);
+  for (uint32_t thread_id = 0; thread_id < threads_count; ++thread_id)
+  {
+    ThreadCommandPool& command_pool = command_pools[thread_id];
+    command_pool.pool               = vk.create_pool();
 
-  for (WorkerThread& worker : workers)
-    worker.thread_handle = spawn_worker_thread(this);
+    for (WorkerCommands& commands : command_pool.commands)
+    {
+      commands.commands        = reinterpret_cast<VkCommandBuffer*>(
+          allocator.Allocate(WORKER_INITIAL_COMMANDS_PER_FRAME * sizeof(VkCommandBuffer)));
+      commands.submitted_count = 0;
+      commands.capacity        = WORKER_INITIAL_COMMANDS_PER_FRAME;
+      vk.allocate_command_buffers(command_pool.pool, commands.commands, WORKER_INITIAL_COMMANDS_PER_FRAME);
+    }
+  }
 
-  SDL_SemWait(all_threads_idle_signal);
-  SDL_AtomicSet(&threads_finished_work, 1);
+  frame_arenas.setup(allocator, threads_count, SWAPCHAIN_IMAGES_COUNT, FRAME_ARENA_CAPACITY);
 }
 
 void JobSystem::teardown(VkDevice device)
 {
-  thread_end_requested = true;
-  jobs_count           = 0;
-  SDL_AtomicSet(&jobs_taken, 0);
+  JobScheduler::teardown();
 
-  SDL_CondBroadcast(new_jobs_available_cond);
-
-  for (WorkerThread& worker : workers)
+  for (uint32_t thread_id = 0; thread_id < threads_count; ++thread_id)
   {
-    SDL_WaitThread(worker.thread_handle, nullptr);
-  }
+    ThreadCommandPool& command_pool = command_pools[thread_id];
+    vkDestroyCommandPool(device, command_pool.pool, nullptr);
 
-  SDL_DestroySemaphore(all_threads_idle_signal);
-  SDL_DestroyCond(new_jobs_available_cond);
-  SDL_DestroyMutex(new_jobs_available_mutex);
+    for (WorkerCommands& commands : command_pool.commands)
+      allocator->Free(commands.commands, commands.capacity * sizeof(VkCommandBuffer));
+  }
 
-  for (WorkerThread& worker : workers)
-    vkDestroyCommandPool(device, worker.pool, nullptr);
+  allocator->Free(command_pools, threads_count * sizeof(ThreadCommandPool));
+  frame_arenas.teardown(*allocator);
 }
 
-void JobSystem::reset_command_buffers(uint32_t image_index)
+//
+// Has to be called only after the fence of given image signaled, since both command buffers and frame arena memory
+// of that image may still be in use by the previous frame rendered into it.
+//
+void JobSystem::begin_frame(uint32_t image_index)
 {
-  for (WorkerThread& worker : workers)
+  for (uint32_t thread_id = 0; thread_id < threads_count; ++thread_id)
   {
-    WorkerCommands& worker_commands = worker.commands[image_index];
+    WorkerCommands& worker_commands = command_pools[thread_id].commands[image_index];
     std::for_each(worker_commands.commands, &worker_commands.commands[worker_commands.submitted_count],
                   [](VkCommandBuffer& cmd) { vkResetCommandBuffer(cmd, 0); });
     worker_commands.submitted_count = 0;
   }
-}
-
-VkCommandBuffer JobSystem::acquire(uint32_t worker_index, uint32_t image_index)
-{
-  WorkerThread&   worker   = workers[worker_index - 1];
-  WorkerCommands& commands = worker.commands[image_index];
 
-  return commands.commands[commands.submitted_count++];
+  frame_arenas.reset(image_index);
 }
 
-void JobSystem::worker_loop()
+VkCommandBuffer JobSystem::acquire(uint32_t thread_id, uint32_t image_index)
 {
-  const int threadId = SDL_AtomicIncRef(&threads_finished_work);
-
-  if (SDL_arraysize(workers) == threadId)
-  {
-    SDL_SemPost(all_threads_idle_signal);
-  }
+  ThreadCommandPool& command_pool = command_pools[thread_id];
+  WorkerCommands&    commands     = command_pool.commands[image_index];
 
-  Stack allocator(256_KB);
-
-  SDL_LockMutex(new_jobs_available_mutex);
-  while (not thread_end_requested)
+  //
+  // Runs inside of jobs. Pool belongs to the calling thread only, so allocating more buffers from it is safe.
+  //
+  if (commands.capacity == commands.submitted_count)
   {
-    SDL_CondWait(new_jobs_available_cond, new_jobs_available_mutex);
-    SDL_UnlockMutex(new_jobs_available_mutex);
-
-    uint32_t job_idx = SDL_AtomicIncRef(&jobs_taken);
-
-    while (job_idx < jobs_count)
-    {
-      ThreadJobData tjd = {
-          .thread_id = threadId,
-          .allocator = allocator,
-          .user_data = user_data,
-      };
-
-      jobs[job_idx](tjd);
-      allocator.Reset();
-      job_idx = SDL_AtomicIncRef(&jobs_taken);
-    }
-
-    SDL_LockMutex(new_jobs_available_mutex);
-    if (SDL_arraysize(workers) == SDL_AtomicIncRef(&threads_finished_work))
-      SDL_SemPost(all_threads_idle_signal);
+    const int new_capacity = 2 * commands.capacity;
+    commands.commands      = reinterpret_cast<VkCommandBuffer*>(
+        allocator->Reallocate(commands.commands, new_capacity * sizeof(VkCommandBuffer)));
+
+    VkCommandBufferAllocateInfo info = {
+        .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool        = command_pool.pool,
+        .level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+        .commandBufferCount = static_cast<uint32_t>(new_capacity - commands.capacity),
+    };
+    vkAllocateCommandBuffers(device, &info, &commands.commands[commands.capacity]);
+
+    commands.capacity = new_capacity;
   }
-  SDL_UnlockMutex(new_jobs_available_mutex);
-}
-
-void JobSystem::start()
-{
-  SDL_LockMutex(new_jobs_available_mutex);
-  SDL_CondBroadcast(new_jobs_available_cond);
-  SDL_UnlockMutex(new_jobs_available_mutex);
-}
 
-void JobSystem::wait_for_finish()
-{
-  SDL_SemWait(all_threads_idle_signal);
-  SDL_AtomicSet(&threads_finished_work, 1);
-  SDL_AtomicSet(&jobs_taken, 0);
+  return commands.commands[commands.submitted_count++];
 }
@@ -0,0 +1,416 @@
+#include "json.hh"
+#include <SDL2/SDL_assert.h>
+
+#ifndef __linux__
+#include <stdlib.h>
+#endif
+
+namespace {
+
+bool is_whitespace(char c)
+{
+  return (' ' == c) or ('\n' == c) or ('\r' == c) or ('\t' == c);
+}
+
+bool is_digit(char c)
+{
+  return ('0' <= c) and ('9' >= c);
+}
+
+bool is_container(JsonToken::Type type)
+{
+  return (JsonToken::Type::Object == type) or (JsonToken::Type::Array == type);
+}
+
+struct Tokenizer
+{
+  JsonDocument& document;
+  const char*   text;
+  uint32_t      length;
+  uint32_t      cursor;
+
+  void skip_whitespace()
+  {
+    while ((cursor < length) and is_whitespace(text[cursor]))
+      cursor += 1;
+  }
+
+  uint32_t push(JsonToken::Type type, uint32_t offset, uint32_t token_length, uint32_t parent)
+  {
+    if (document.tokens_count == document.tokens_capacity)
+    {
+      const uint32_t new_capacity = 2 * document.tokens_capacity;
+      document.tokens             = reinterpret_cast<JsonToken*>(
+          document.allocator->Reallocate(document.tokens, sizeof(JsonToken) * new_capacity));
+      document.tokens_capacity = new_capacity;
+    }
+
+    const uint32_t idx     = document.tokens_count++;
+    document.tokens[idx]   = {
+        .offset      = offset,
+        .length      = token_length,
+        .parent      = parent,
+        .first_child = 0,
+        .type        = type,
+    };
+    return idx;
+  }
+
+  // cursor on the opening quote, ends up right after the closing one
+  bool string(uint32_t parent)
+  {
+    const uint32_t begin = cursor + 1;
+    for (cursor = begin; cursor < length; ++cursor)
+    {
+      const char c = text[cursor];
+      if ('"' == c)
+      {
+        push(JsonToken::Type::String, begin, cursor - begin, parent);
+        cursor += 1;
+        return true;
+      }
+      else if ('\\' == c)
+      {
+        cursor += 1;
+      }
+      else if (0x20 > static_cast<unsigned char>(c))
+      {
+        return false;
+      }
+    }
+    return false;
+  }
+
+  bool digits()
+  {
+    const uint32_t begin = cursor;
+    while ((cursor < length) and is_digit(text[cursor]))
+      cursor += 1;
+    return begin != cursor;
+  }
+
+  bool number(uint32_t parent)
+  {
+    const uint32_t begin = cursor;
+
+    if ('-' == text[cursor])
+      cursor += 1;
+
+    if (not digits())
+      return false;
+
+    if ((cursor < length) and ('.' == text[cursor]))
+    {
+      cursor += 1;
+      if (not digits())
+        return false;
+    }
+
+    if ((cursor < length) and (('e' == text[cursor]) or ('E' == text[cursor])))
+    {
+      cursor += 1;
+      if ((cursor < length) and (('+' == text[cursor]) or ('-' == text[cursor])))
+        cursor += 1;
+      if (not digits())
+        return false;
+    }
+
+    push(JsonToken::Type::Number, begin, cursor - begin, parent);
+    return true;
+  }
+
+  bool literal(const char* word, uint32_t word_length, JsonToken::Type type, uint32_t parent)
+  {
+    if (((length - cursor) < word_length) or (0 != SDL_memcmp(&text[cursor], word, word_length)))
+      return false;
+
+    push(type, cursor, word_length, parent);
+    cursor += word_length;
+    return true;
+  }
+
+  // object member key followed by a colon, returns the key token or INVALID
+  uint32_t key(uint32_t object)
+  {
+    skip_whitespace();
+    if ((cursor == length) or ('"' != text[cursor]) or (not string(object)))
+      return JsonValue::INVALID;
+
+    const uint32_t result = document.tokens_count - 1;
+
+    skip_whitespace();
+    if ((cursor == length) or (':' != text[cursor]))
+      return JsonValue::INVALID;
+
+    cursor += 1;
+    return result;
+  }
+
+  bool run()
+  {
+    uint32_t stack[JsonDocument::MAX_DEPTH];
+    uint32_t depth        = 0;
+    uint32_t value_parent = JsonValue::INVALID;
+
+    for (;;)
+    {
+      //
+      // value
+      //
+      skip_whitespace();
+      if (cursor == length)
+        return false;
+
+      const char c = text[cursor];
+
+      if (('{' == c) or ('[' == c))
+      {
+        if (JsonDocument::MAX_DEPTH == depth)
+          return false;
+
+        const bool     is_object = ('{' == c);
+        const uint32_t container =
+            push(is_object ? JsonToken::Type::Object : JsonToken::Type::Array, cursor, 0, value_parent);
+
+        cursor += 1;
+        skip_whitespace();
+
+        if ((cursor < length) and ((is_object ? '}' : ']') == text[cursor]))
+        {
+          cursor += 1;
+        }
+        else
+        {
+          stack[depth++] = container;
+          value_parent   = is_object ? key(container) : container;
+          if (JsonValue::INVALID == value_parent)
+            return false;
+          continue;
+        }
+      }
+      else if ('"' == c)
+      {
+        if (not string(value_parent))
+          return false;
+      }
+      else if (('-' == c) or is_digit(c))
+      {
+        if (not number(value_parent))
+          return false;
+      }
+      else if ('t' == c)
+      {
+        if (not literal("true", 4, JsonToken::Type::True, value_parent))
+          return false;
+      }
+      else if ('f' == c)
+      {
+        if (not literal("false", 5, JsonToken::Type::False, value_parent))
+          return false;
+      }
+      else if ('n' == c)
+      {
+        if (not literal("null", 4, JsonToken::Type::Null, value_parent))
+          return false;
+      }
+      else
+      {
+        return false;
+      }
+
+      //
+      // value is complete, count it in the enclosing container and look for the next one
+      //
+      for (;;)
+      {
+        skip_whitespace();
+
+        if (0 == depth)
+          return cursor == length;
+
+        if (cursor == length)
+          return false;
+
+        const uint32_t container = stack[depth - 1];
+        const bool     is_object = (JsonToken::Type::Object == document.tokens[container].type);
+        const char     next      = text[cursor];
+
+        document.tokens[container].length += 1;
+        cursor += 1;
+
+        if (',' == next)
+        {
+          value_parent = is_object ? key(container) : container;
+          if (JsonValue::INVALID == value_parent)
+            return false;
+          break;
+        }
+        else if ((is_object ? '}' : ']') == next)
+        {
+          depth -= 1;
+        }
+        else
+        {
+          return false;
+        }
+      }
+    }
+  }
+};
+
+} // namespace
+
+bool JsonDocument::parse(const char* new_text, uint32_t length, MemoryAllocator& new_allocator)
+{
+  text            = new_text;
+  text_length     = length;
+  allocator       = &new_allocator;
+  tokens_count    = 0;
+  tokens_capacity = (length / 8) + 16;
+  tokens          = reinterpret_cast<JsonToken*>(allocator->Allocate(sizeof(JsonToken) * tokens_capacity));
+  children        = nullptr;
+  children_count  = 0;
+
+  Tokenizer tokenizer = {*this, new_text, length, 0};
+  if (not tokenizer.run())
+  {
+    tokens_count = 0;
+    return false;
+  }
+
+  //
+  // Every container reserves a range of the children array (prefix sum of element counts). Walking the tape backwards
+  // fills each range from its end, which leaves children in document order.
+  //
+  for (uint32_t i = 0; i < tokens_count; ++i)
+  {
+    JsonToken& token = tokens[i];
+    if (is_container(token.type))
+    {
+      children_count += token.length;
+      token.first_child = children_count;
+    }
+  }
+
+  children = reinterpret_cast<uint32_t*>(allocator->Allocate(sizeof(uint32_t) * SDL_max(children_count, 1u)));
+
+  for (uint32_t i = tokens_count; 0 < i; --i)
+  {
+    const uint32_t parent = tokens[i - 1].parent;
+    if ((JsonValue::INVALID != parent) and is_container(tokens[parent].type))
+      children[--tokens[parent].first_child] = i - 1;
+  }
+
+  return true;
+}
+
+void JsonDocument::teardown()
+{
+  allocator->Free(tokens, sizeof(JsonToken) * tokens_capacity);
+  if (children)
+    allocator->Free(children, sizeof(uint32_t) * SDL_max(children_count, 1u));
+}
+
+bool JsonValue::is(JsonToken::Type type) const
+{
+  return valid() and (type == document->tokens[token].type);
+}
+
+JsonValue JsonValue::node(const char* name) const
+{
+  if (not is(JsonToken::Type::Object))
+    return {};
+
+  const uint32_t   name_length = static_cast<uint32_t>(SDL_strlen(name));
+  const JsonToken& object      = document->tokens[token];
+
+  for (uint32_t i = 0; i < object.length; ++i)
+  {
+    const uint32_t   key_idx = document->children[object.first_child + i];
+    const JsonToken& key     = document->tokens[key_idx];
+
+    if ((name_length == key.length) and (0 == SDL_memcmp(&document->text[key.offset], name, name_length)))
+      return {document, key_idx + 1};
+  }
+
+  return {};
+}
+
+bool JsonValue::has(const char* name) const
+{
+  return node(name).valid();
+}
+
+JsonValue JsonValue::idx(int element) const
+{
+  if (not is(JsonToken::Type::Array))
+    return {};
+
+  const JsonToken& array = document->tokens[token];
+  if ((0 > element) or (array.length <= static_cast<uint32_t>(element)))
+    return {};
+
+  return {document, document->children[array.first_child + element]};
+}
+
+int JsonValue::elements_count() const
+{
+  return is(JsonToken::Type::Array) ? static_cast<int>(document->tokens[token].length) : 0;
+}
+
+int JsonValue::as_integer() const
+{
+  if (not is(JsonToken::Type::Number))
+    return 0;
+
+  const JsonToken& number = document->tokens[token];
+  const char*      iter   = &document->text[number.offset];
+  const char*      end    = &iter[number.length];
+  const bool       minus  = ('-' == *iter);
+
+  if (minus)
+    ++iter;
+
+  // glTF indices, counts and offsets are plain integers, fractions are truncated
+  int result = 0;
+  for (; (iter != end) and is_digit(*iter); ++iter)
+    result = (10 * result) + (*iter - '0');
+
+  return minus ? -result : result;
+}
+
+float JsonValue::as_float() const
+{
+  if (not is(JsonToken::Type::Number))
+    return 0.0f;
+
+  // text is not null terminated, numbers are short so they're copied out for strtod
+  const JsonToken& number = document->tokens[token];
+  char             buffer[64];
+  const uint32_t   length = SDL_min(number.length, static_cast<uint32_t>(sizeof(buffer) - 1));
+
+  SDL_memcpy(buffer, &document->text[number.offset], length);
+  buffer[length] = '\0';
+
+#ifdef __linux__
+  double result = SDL_strtod(buffer, nullptr);
+#else
+  // Apperently SDL_strtod on windows does not read scientific
+  // notation correctly when not compiled with correct compilation
+  // flag.
+  double result = strtod(buffer, nullptr);
+#endif
+
+  return static_cast<float>(result);
+}
+
+bool JsonValue::equals(const char* string) const
+{
+  if (not is(JsonToken::Type::String))
+    return false;
+
+  const JsonToken& value  = document->tokens[token];
+  const uint32_t   length = static_cast<uint32_t>(SDL_strlen(string));
+
+  return (length == value.length) and (0 == SDL_memcmp(&document->text[value.offset], string, length));
+}
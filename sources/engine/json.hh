@@ -0,0 +1,117 @@
+#pragma once
+
+#include "memory_allocator.hh"
+#include <SDL2/SDL_stdinc.h>
+
+//
+// Single pass JSON tokenizer used by the glTF loader.
+//
+// Whole text is scanned once into a flat tape of tokens (pre-order), every token only stores offsets into the original
+// text, nothing is copied or converted up front. Children of every object / array are listed in one shared index array,
+// so member and element lookups don't have to walk the text again:
+//
+//   {"a":[1,2],"b":true}
+//
+//   tape:     0 Object(2)  1 "a"  2 Array(2)  3 1  4 2  5 "b"  6 true
+//   children: [1 5] [3 4]
+//
+// Object children are its keys, value of a key is always the very next token on the tape.
+// Text has to outlive the document. It doesn't need to be null terminated, trailing whitespace (GLB pads JSON chunks
+// with spaces) is accepted.
+//
+struct JsonToken
+{
+  enum class Type : uint8_t
+  {
+    Object,
+    Array,
+    String,
+    Number,
+    True,
+    False,
+    Null,
+  };
+
+  // first character of the value, for strings the one right after the opening quote
+  uint32_t offset;
+  // characters for strings (without quotes, escapes not resolved) and numbers, members / elements for containers
+  uint32_t length;
+  // container owning an element or key, key owning a member value
+  uint32_t parent;
+  // position in JsonDocument::children, containers only
+  uint32_t first_child;
+  Type     type;
+};
+
+struct JsonDocument;
+
+//
+// Lightweight handle to a token. Queries on missing values give back an invalid handle, chained queries on invalid
+// handles stay invalid and numbers read from them are 0 (glTF defaults for byteOffset, byteStride etc.).
+//
+struct JsonValue
+{
+  static constexpr uint32_t INVALID = ~0u;
+
+  const JsonDocument* document = nullptr;
+  uint32_t            token    = INVALID;
+
+  [[nodiscard]] bool valid() const
+  {
+    return INVALID != token;
+  }
+
+  [[nodiscard]] bool is(JsonToken::Type type) const;
+
+  // object member lookup, compares only keys of this object
+  [[nodiscard]] JsonValue node(const char* name) const;
+  [[nodiscard]] bool      has(const char* name) const;
+
+  // array element lookup
+  [[nodiscard]] JsonValue idx(int element) const;
+  [[nodiscard]] int       elements_count() const;
+
+  [[nodiscard]] int   as_integer() const;
+  [[nodiscard]] float as_float() const;
+
+  // true only for string values with exactly this content
+  [[nodiscard]] bool equals(const char* string) const;
+
+  [[nodiscard]] int integer(const char* name) const
+  {
+    return node(name).as_integer();
+  }
+
+  [[nodiscard]] int idx_integer(int element) const
+  {
+    return idx(element).as_integer();
+  }
+
+  [[nodiscard]] float idx_float(int element) const
+  {
+    return idx(element).as_float();
+  }
+};
+
+struct JsonDocument
+{
+  static constexpr uint32_t MAX_DEPTH = 64;
+
+  // false on malformed input, document is empty afterwards but still has to be torn down
+  bool parse(const char* text, uint32_t length, MemoryAllocator& allocator);
+  void teardown();
+
+  [[nodiscard]] JsonValue root() const
+  {
+    return {this, tokens_count ? 0u : JsonValue::INVALID};
+  }
+
+  const char*      text;
+  uint32_t         text_length;
+  JsonToken*       tokens;
+  uint32_t         tokens_count;
+  uint32_t         tokens_capacity;
+  uint32_t*        children;
+  uint32_t         children_count;
+  MemoryAllocator* allocator;
+};
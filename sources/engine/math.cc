@@ -1,220 +1,141 @@
 #include "math.hh"
+#include "simd.hh"
 #include <algorithm>
 
-Vec2 Vec2::operator-(const Vec2& rhs) const
-{
-  return Vec2(x - rhs.x, y - rhs.y);
-}
-
-Vec2 Vec2::operator+(const Vec2& rhs) const
-{
-  return Vec2(x + rhs.x, y + rhs.y);
-}
-
-void Vec2::operator+=(const Vec2& rhs)
-{
-  x += rhs.x;
-  y += rhs.y;
-}
-
-void Vec2::operator-=(const Vec2& rhs)
-{
-  x -= rhs.x;
-  y -= rhs.y;
-}
+static_assert(sizeof(Vec4) == (4 * sizeof(float)), "simd loads read Vec4 as a whole");
+static_assert(sizeof(Quaternion) == sizeof(Vec4), "simd loads read Quaternion as a whole");
+static_assert(sizeof(Mat4x4) == (4 * sizeof(Vec4)), "simd loads read Mat4x4 column by column");
+static_assert(sizeof(Affine3x4) == (3 * sizeof(Vec4)), "Affine3x4 is uploaded as row_major mat4x3");
 
-float Vec2::len() const
-{
-  return SDL_sqrtf(x * x + y * y);
-}
+#if VVNE_SIMD
+namespace {
 
-Vec2 Vec2::scale(float s) const
+//
+// Rotation part of Mat4x4(Quaternion), w lanes of all three columns are zero. Only pays off in compose_trs, where the
+// scale folds in before the store.
+// Same terms as the scalar version, grouped by quaternion component. With q = (x, y, z, w):
+//
+// c0 = x * (x, y, z) + w * ( w,  z, -y) + y * (-y,  x, -w) + z * (-z,  w,  x)
+// c1 = y * (x, y, z) + w * (-z,  w,  x) - x * (-y,  x, -w) - z * ( w,  z, -y)
+// c2 = z * (x, y, z) - w * (-y,  x, -w) - x * (-z,  w,  x) + y * ( w,  z, -y)
+//
+void quaternion_to_columns(simd::Float4 v, simd::Float4 columns[3])
 {
-  return Vec2(x * s, y * s);
-}
+  const simd::Float4 x  = simd::broadcast<0>(v);
+  const simd::Float4 y  = simd::broadcast<1>(v);
+  const simd::Float4 z  = simd::broadcast<2>(v);
+  const simd::Float4 w  = simd::broadcast<3>(v);
+  const simd::Float4 q3 = simd::mul(v, simd::set(1, 1, 1, 0));
+  const simd::Float4 p  = simd::mul(simd::swizzle<3, 2, 1, 3>(v), simd::set(1, 1, -1, 0));
+  const simd::Float4 s  = simd::mul(simd::swizzle<1, 0, 3, 3>(v), simd::set(-1, 1, -1, 0));
+  const simd::Float4 t  = simd::mul(simd::swizzle<2, 3, 0, 3>(v), simd::set(-1, 1, 1, 0));
 
-Vec2 Vec2::scale(const Vec2& s) const
-{
-  return Vec2(x * s.x, y * s.y);
+  columns[0] = simd::madd(z, t, simd::madd(y, s, simd::madd(w, p, simd::mul(x, q3))));
+  columns[1] = simd::sub(simd::madd(w, t, simd::mul(y, q3)), simd::madd(x, s, simd::mul(z, p)));
+  columns[2] = simd::sub(simd::madd(y, p, simd::mul(z, q3)), simd::madd(w, s, simd::mul(x, t)));
 }
 
-Vec2 Vec2::normalize() const
+// C[c] = A[0] * B[c].x + A[1] * B[c].y + A[2] * B[c].z + A[3] * B[c].w
+simd::Float4 mul_column(const simd::Float4 a[4], simd::Float4 b)
 {
-  return scale(1.0f / len());
+  simd::Float4 r = simd::mul(a[0], simd::broadcast<0>(b));
+  r              = simd::madd(a[1], simd::broadcast<1>(b), r);
+  r              = simd::madd(a[2], simd::broadcast<2>(b), r);
+  return simd::madd(a[3], simd::broadcast<3>(b), r);
 }
 
-Vec2 Vec2::invert() const
+void load_columns(const Mat4x4& m, simd::Float4 dst[4])
 {
-  return Vec2(1.0f / x, 1.0f / y);
+  for (uint32_t i = 0; i < 4; ++i)
+    dst[i] = simd::load(&m.columns[i].x);
 }
 
-Vec3::Vec3(float val)
-    : x(val)
-    , y(val)
-    , z(val)
+// everything is loaded before the first store, so "out" may alias either input
+void mul_columns(const simd::Float4 a[4], const Mat4x4& rhs, Mat4x4& out)
 {
-}
+  simd::Float4 b[4];
+  load_columns(rhs, b);
 
-Vec3::Vec3(const Vec2& vec, float val)
-    : x(vec.x)
-    , y(vec.y)
-    , z(val)
-{
-}
+  for (uint32_t c = 0; c < 4; ++c)
+    b[c] = mul_column(a, b[c]);
 
-Vec3::Vec3(float x, float y, float z)
-    : x(x)
-    , y(y)
-    , z(z)
-{
+  for (uint32_t c = 0; c < 4; ++c)
+    simd::store(&out.columns[c].x, b[c]);
 }
 
-Vec3 Vec3::operator-(const Vec3& rhs) const
-{
-  return Vec3(x - rhs.x, y - rhs.y, z - rhs.z);
-}
+} // namespace
+#endif
 
-Vec3 Vec3::operator+(const Vec3& rhs) const
+Vec2 Vec2::operator-(const Vec2& rhs) const
 {
-  return Vec3(x + rhs.x, y + rhs.y, z + rhs.z);
+  return Vec2(x - rhs.x, y - rhs.y);
 }
 
-Vec3 Vec3::scale(float s) const
+Vec2 Vec2::operator+(const Vec2& rhs) const
 {
-  return Vec3(x * s, y * s, z * s);
+  return Vec2(x + rhs.x, y + rhs.y);
 }
 
-void Vec3::operator+=(const Vec3& rhs)
+void Vec2::operator+=(const Vec2& rhs)
 {
   x += rhs.x;
   y += rhs.y;
-  z += rhs.z;
 }
 
-void Vec3::operator-=(const Vec3& rhs)
+void Vec2::operator-=(const Vec2& rhs)
 {
   x -= rhs.x;
   y -= rhs.y;
-  z -= rhs.z;
 }
 
-float Vec3::len() const
+float Vec2::len() const
 {
-  return SDL_sqrtf(x * x + y * y + z * z);
+  return SDL_sqrtf(x * x + y * y);
 }
 
-Vec3 Vec3::invert_signs() const
+Vec2 Vec2::scale(float s) const
 {
-  return Vec3(-x, -y, -z);
+  return Vec2(x * s, y * s);
 }
 
-void Vec3::clamp(float min, float max)
+Vec2 Vec2::scale(const Vec2& s) const
 {
-  x = ::clamp(x, min, max);
-  y = ::clamp(y, min, max);
-  z = ::clamp(z, min, max);
+  return Vec2(x * s.x, y * s.y);
 }
 
-Vec3 Vec3::normalize() const
+Vec2 Vec2::normalize() const
 {
   return scale(1.0f / len());
 }
 
-Vec2 Vec3::xz() const
-{
-  return Vec2(x, z);
-}
-
-Vec3 Vec3::mul_cross(const Vec3& rhs) const
-{
-  return Vec3(y * rhs.z - z * rhs.y, z * rhs.x - x * rhs.z, x * rhs.y - y * rhs.x);
-}
-
-float Vec3::mul_inner(const Vec3& rhs) const
-{
-  return (x * rhs.x) + (y * rhs.y) + (z * rhs.z);
-}
-
-Vec3 Vec3::lerp(const Vec3& dst, float t) const
-{
-  Vec3 r;
-
-  r.x = x + t * (dst.x - x);
-  r.y = y + t * (dst.y - y);
-  r.z = z + t * (dst.z - z);
-
-  return r;
-}
-
-Vec4::Vec4(float x, float y, float z, float w)
-    : x(x)
-    , y(y)
-    , z(z)
-    , w(w)
-{
-}
-
-Vec4::Vec4(const Vec3& v, float w)
-    : x(v.x)
-    , y(v.y)
-    , z(v.z)
-    , w(w)
-{
-}
-
-float Vec4::mul_inner(const Vec4& rhs) const
-{
-  return (x * rhs.x) + (y * rhs.y) + (z * rhs.z) + (w * rhs.w);
-}
-
-Vec4 Vec4::lerp(const Vec4& dst, float t) const
-{
-  Vec4 r;
-
-  r.x = x + t * (dst.x - x);
-  r.y = y + t * (dst.y - y);
-  r.z = z + t * (dst.z - z);
-  r.w = w + t * (dst.w - w);
-
-  return r;
-}
-
-float Vec4::len() const
-{
-  return SDL_sqrtf(x * x + y * y + z * z + w * w);
-}
-
-Vec4 Vec4::normalize() const
+Vec2 Vec2::invert() const
 {
-  return scale(1.0f / len());
+  return Vec2(1.0f / x, 1.0f / y);
 }
 
-Quaternion::Quaternion(const float angle, const Vec3& axis)
+Quaternion backend_math::mul(const Quaternion& lhs, const Quaternion& rhs)
 {
-  rotate(angle, axis);
-}
+#if VVNE_SIMD
+  //
+  // r.xyz = a.xyz x b.xyz + a.xyz * b.w + b.xyz * a.w
+  // r.w   = a.w * b.w - a.xyz . b.xyz
+  //
+  // Expanded per lane it's b scaled by a.w plus three sign flipped swizzles of b scaled by a.x, a.y and a.z.
+  //
+  const simd::Float4 a = simd::load(lhs.data.data());
+  const simd::Float4 b = simd::load(rhs.data.data());
 
-void Quaternion::rotate(const float angle, const Vec3& axis)
-{
-  const float half_angle = 0.5f * angle;
-  data.as_vec3()         = axis.scale(SDL_sinf(half_angle));
-  data.w                 = SDL_cosf(half_angle);
-}
+  simd::Float4 c = simd::mul(simd::broadcast<3>(a), b);
+  c = simd::madd(simd::broadcast<0>(a), simd::mul(simd::swizzle<3, 2, 1, 0>(b), simd::set(1, -1, 1, -1)), c);
+  c = simd::madd(simd::broadcast<1>(a), simd::mul(simd::swizzle<2, 3, 0, 1>(b), simd::set(1, 1, -1, -1)), c);
+  c = simd::madd(simd::broadcast<2>(a), simd::mul(simd::swizzle<1, 0, 3, 2>(b), simd::set(-1, 1, 1, -1)), c);
 
-Quaternion Quaternion::operator*(const Quaternion& rhs) const
-{
   Quaternion r;
-
-  const Vec3& a = data.as_vec3();
-  const Vec3& b = rhs.data.as_vec3();
-  Vec3&       c = r.data.as_vec3();
-
-  c = a.mul_cross(b);
-  c += a.scale(rhs.data.w);
-  c += b.scale(data.w);
-  r.data.w = data.w * rhs.data.w - a.mul_inner(b);
-
+  simd::store(&r.data.x, c);
   return r;
+#else
+  return scalar_math::mul(lhs, rhs);
+#endif
 }
 
 Mat4x4::Mat4x4(const float* data)
@@ -222,8 +143,14 @@ Mat4x4::Mat4x4(const float* data)
   SDL_memcpy(&columns[0].x, data, 16 * sizeof(float));
 }
 
-Mat4x4::Mat4x4(const Quaternion& q)
+//
+// Scalar arithmetic on purpose, the shuffles of quaternion_to_columns cost more than they save for a single matrix.
+// What matters is storing whole columns: the result lands in a temporary which callers copy with 16 byte loads, and
+// those stall on the partial stores a compiler emits for the plain scalar version.
+//
+Mat4x4 backend_math::from_quaternion(const Quaternion& q)
 {
+#if VVNE_SIMD
   const float a  = q.data.w;
   const float b  = q.data.x;
   const float c  = q.data.y;
@@ -233,108 +160,42 @@ Mat4x4::Mat4x4(const Quaternion& q)
   const float c2 = c * c;
   const float d2 = d * d;
 
-  columns[0]   = Vec4(a2 + b2 - c2 - d2, 2.0f * (b * c + a * d), 2.0f * (b * d - a * c), 0.0f);
-  columns[1]   = Vec4(2.0f * (b * c - a * d), a2 - b2 + c2 - d2, 2.0f * (c * d + a * b), 0.0f);
-  columns[2]   = Vec4(2.0f * (b * d + a * c), 2.0f * (c * d - a * b), a2 - b2 - c2 + d2, 0.0f);
-  columns[3].w = 1.0f;
-}
-
-void Mat4x4::translate(const Vec3 v)
-{
-  identity();
-  columns[3].x = v.x;
-  columns[3].y = v.y;
-  columns[3].z = v.z;
-}
-
-void Mat4x4::set_diagonal(const Vec3& v)
-{
-  columns[0].x = v.x;
-  columns[1].y = v.y;
-  columns[2].z = v.z;
-  columns[3].w = 1.0f;
-}
-
-void Mat4x4::identity()
-{
-  std::fill(columns, &columns[4], Vec4());
-  for (uint32_t i = 0; i < 4; ++i)
-    columns[i][i] = 1.0f;
-}
-
-void Mat4x4::scale(const Vec3 s)
-{
-  set_diagonal(s);
-}
-
-void Mat4x4::transpose()
-{
-  //
-  // a1 b1 c1 d1     a1 a2 a3 a4
-  // a2 b2 c2 d2     b1 b2 b3 b4
-  // a3 b3 c3 d3 --> c1 c2 c3 c4
-  // a4 b4 c4 d4     d1 d2 d3 d4
-  //
-  // We only need to iterate elements on one side of diagonal (exluding diag line).
-  //
-  // x 0 1 3
-  // x x 2 4
-  // x x x 5
-  // x x x x
-  //
-  // (1, 0) -> (0, 1)
-  // (2, 0) -> (0, 2)
-  // (2, 1) -> (1, 2)
-  // (3, 0) -> (0, 3)
-  // (3, 1) -> (1, 3)
-  // (3, 2) -> (2, 3)
-  //
-  for (uint32_t c = 1; c < 4; ++c)
-    for (uint32_t idx = 0; idx < c; ++idx)
-      columns[idx][c] = columns[c][idx];
+  Mat4x4 r;
+  simd::store(&r.columns[0].x, simd::set(a2 + b2 - c2 - d2, 2.0f * (b * c + a * d), 2.0f * (b * d - a * c), 0.0f));
+  simd::store(&r.columns[1].x, simd::set(2.0f * (b * c - a * d), a2 - b2 + c2 - d2, 2.0f * (c * d + a * b), 0.0f));
+  simd::store(&r.columns[2].x, simd::set(2.0f * (b * d + a * c), 2.0f * (c * d - a * b), a2 - b2 - c2 + d2, 0.0f));
+  simd::store(&r.columns[3].x, simd::set(0.0f, 0.0f, 0.0f, 1.0f));
+  return r;
+#else
+  return scalar_math::from_quaternion(q);
+#endif
 }
 
-Mat4x4 Mat4x4::operator*(const Mat4x4& rhs) const
+Mat4x4 backend_math::mul(const Mat4x4& lhs, const Mat4x4& rhs)
 {
-  Mat4x4 result;
-
-  //
-  //   A               B              C
-  //   a1 b1 c1 d1     e1 f1 g1 h1    i1 j1 k1 l1
-  //   a2 b2 c2 d2     e2 f2 g2 h2    i2 j2 k2 l2
-  //   a3 b3 c3 d3 mul e3 f3 g3 h3 -> i3 j3 k3 l3
-  //   a4 b4 c4 d4     e4 f4 g4 h4    i4 j4 k4 l4
-  //
-  //   i1 = (a1 * e1) + (b1 * e2) + (c1 * e3) + (d1 * e4)
-  //   i2 = (a2 * e1) + (b2 * e2) + (c2 * e3) + (d2 * e4)
-  //   ...
-  //
-  //   For each column (c) in C
-  //       For each row (r) in C
-  //           Use full length (k) of row in A and column in B to calculate C[c][r]
-  //
-
-  for (uint32_t c = 0; c < 4; ++c)
-    for (uint32_t r = 0; r < 4; ++r)
-      for (uint32_t k = 0; k < 4; ++k)
-        result.columns[c][r] += columns[k][r] * rhs.columns[c][k];
-
+#if VVNE_SIMD
+  // C[c] = A[0] * B[c].x + A[1] * B[c].y + A[2] * B[c].z + A[3] * B[c].w
+  Mat4x4       result;
+  simd::Float4 a[4];
+  load_columns(lhs, a);
+  mul_columns(a, rhs, result);
   return result;
+#else
+  return scalar_math::mul(lhs, rhs);
+#endif
 }
 
-Vec4 Mat4x4::operator*(const Vec4& rhs) const
+Vec4 backend_math::mul(const Mat4x4& lhs, const Vec4& rhs)
 {
-  Vec4 result;
-
-  //
-  // Simplified version of algorithm above. Only difference is B and C matrices are 1-column versions
-  //
-
-  for (uint32_t r = 0; r < 4; ++r)
-    for (uint32_t k = 0; k < 4; ++k)
-      result[r] += columns[k][r] * rhs[k];
-
+#if VVNE_SIMD
+  Vec4         result;
+  simd::Float4 a[4];
+  load_columns(lhs, a);
+  simd::store(&result.x, mul_column(a, simd::load(rhs.data())));
   return result;
+#else
+  return scalar_math::mul(lhs, rhs);
+#endif
 }
 
 void Mat4x4::perspective(const uint32_t width, const uint32_t height, float fov_rads, float n, float f)
@@ -358,52 +219,113 @@ void Mat4x4::perspective(float aspect_ratio, float fov_rads, float n, float f)
   columns[3].z = -((2.f * f * n) / (f - n));
 }
 
-Mat4x4 Mat4x4::LookAt(const Vec3& eye, const Vec3& center, const Vec3& up)
+void Mat4x4::ortho(float l, float r, float b, float t, float n, float f)
 {
-  Mat4x4 r;
+  std::fill(columns, &columns[4], Vec4());
 
-  const Vec3 f = (center - eye).normalize();
-  const Vec3 s = f.mul_cross(up).normalize(); // up should be already normalized
-  const Vec3 t = s.mul_cross(f);
+  columns[0].x = 2.0f / (r - l);
+  columns[1].y = 2.0f / (t - b);
+  columns[2].z = -2.0f / (f - n);
+  columns[3].x = -(r + l) / (r - l);
+  columns[3].y = -(t + b) / (t - b);
+  columns[3].z = -(f + n) / (f - n);
+  columns[3].w = 1.0f;
+}
 
-  r.columns[0] = Vec4(s.x, t.x, -f.x, 0.0f);
-  r.columns[1] = Vec4(s.y, t.y, -f.y, 0.0f);
-  r.columns[2] = Vec4(s.z, t.z, -f.z, 0.0f);
-  r.translate_in_place(eye.invert_signs());
-  r.columns[3].w = 1.0f;
+#if VVNE_SIMD
+namespace {
 
-  return r;
-}
+//
+// 2x2 blocks packed as (m00, m01, m10, m11) in a single register
+//
 
-Vec4 Mat4x4::row(uint32_t i) const
+// A * B
+simd::Float4 mat2_mul(simd::Float4 a, simd::Float4 b)
 {
-  return {columns[0][i], columns[1][i], columns[2][i], columns[3][i]};
+  return simd::madd(a, simd::swizzle<0, 3, 0, 3>(b),
+                    simd::mul(simd::swizzle<1, 0, 3, 2>(a), simd::swizzle<2, 1, 2, 1>(b)));
 }
 
-void Mat4x4::translate_in_place(const Vec3& v)
+// adj(A) * B
+simd::Float4 mat2_adj_mul(simd::Float4 a, simd::Float4 b)
 {
-  const Vec4 t(v, 0.0f);
-  for (uint32_t i = 0; i < 4; ++i)
-    columns[3][i] = row(i).mul_inner(t);
+  return simd::sub(simd::mul(simd::swizzle<3, 3, 0, 0>(a), b),
+                   simd::mul(simd::swizzle<1, 1, 2, 2>(a), simd::swizzle<2, 3, 0, 1>(b)));
 }
 
-void Mat4x4::ortho(float l, float r, float b, float t, float n, float f)
+// A * adj(B)
+simd::Float4 mat2_mul_adj(simd::Float4 a, simd::Float4 b)
 {
-  std::fill(columns, &columns[4], Vec4());
-
-  columns[0].x = 2.0f / (r - l);
-  columns[1].y = 2.0f / (t - b);
-  columns[2].z = -2.0f / (f - n);
-  columns[3].x = -(r + l) / (r - l);
-  columns[3].y = -(t + b) / (t - b);
-  columns[3].z = -(f + n) / (f - n);
-  columns[3].w = 1.0f;
+  return simd::sub(simd::mul(a, simd::swizzle<3, 0, 3, 0>(b)),
+                   simd::mul(simd::swizzle<1, 0, 3, 2>(a), simd::swizzle<2, 1, 2, 1>(b)));
 }
 
+} // namespace
+#endif
+
 Mat4x4 Mat4x4::invert() const
 {
   Mat4x4 r;
 
+#if VVNE_SIMD
+  //
+  // Block wise inversion. Storage is treated as rows, which inverts the transposition, and transpose of inverse is
+  // inverse of transpose, so the result lands in columns as expected.
+  //
+  //     | A B |            1    | X Y |     X = adj(|D|A - B adj(D)C)     Y = adj(|B|C - D adj(adj(A)B))
+  // M = | C D |  inv(M) = --- * | Z W |     Z = adj(|C|B - A adj(adj(D)C)) W = adj(|A|D - C adj(A)B)
+  //                       |M|
+  //
+  // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+  //
+  const simd::Float4 c0 = simd::load(&columns[0].x);
+  const simd::Float4 c1 = simd::load(&columns[1].x);
+  const simd::Float4 c2 = simd::load(&columns[2].x);
+  const simd::Float4 c3 = simd::load(&columns[3].x);
+
+  const simd::Float4 a = simd::shuffle<0, 1, 0, 1>(c0, c1);
+  const simd::Float4 b = simd::shuffle<2, 3, 2, 3>(c0, c1);
+  const simd::Float4 c = simd::shuffle<0, 1, 0, 1>(c2, c3);
+  const simd::Float4 d = simd::shuffle<2, 3, 2, 3>(c2, c3);
+
+  // (|A|, |B|, |C|, |D|)
+  const simd::Float4 det_sub =
+      simd::sub(simd::mul(simd::shuffle<0, 2, 0, 2>(c0, c2), simd::shuffle<1, 3, 1, 3>(c1, c3)),
+                simd::mul(simd::shuffle<1, 3, 1, 3>(c0, c2), simd::shuffle<0, 2, 0, 2>(c1, c3)));
+
+  const simd::Float4 det_a = simd::broadcast<0>(det_sub);
+  const simd::Float4 det_b = simd::broadcast<1>(det_sub);
+  const simd::Float4 det_c = simd::broadcast<2>(det_sub);
+  const simd::Float4 det_d = simd::broadcast<3>(det_sub);
+
+  const simd::Float4 d_c = mat2_adj_mul(d, c);
+  const simd::Float4 a_b = mat2_adj_mul(a, b);
+
+  simd::Float4 x = simd::sub(simd::mul(det_d, a), mat2_mul(b, d_c));
+  simd::Float4 w = simd::sub(simd::mul(det_a, d), mat2_mul(c, a_b));
+  simd::Float4 y = simd::sub(simd::mul(det_b, c), mat2_mul_adj(d, a_b));
+  simd::Float4 z = simd::sub(simd::mul(det_c, b), mat2_mul_adj(a, d_c));
+
+  simd::Float4 tr = simd::mul(a_b, simd::swizzle<0, 2, 1, 3>(d_c));
+  tr              = simd::add(tr, simd::swizzle<1, 0, 3, 2>(tr));
+  tr              = simd::add(tr, simd::swizzle<2, 3, 0, 1>(tr));
+
+  const simd::Float4 det_m = simd::sub(simd::madd(det_a, det_d, simd::mul(det_b, det_c)), tr);
+
+  // adjugate of a 2x2 block flips signs of the off diagonal elements
+  const simd::Float4 r_det_m = simd::div(simd::set(1, -1, -1, 1), det_m);
+
+  x = simd::mul(x, r_det_m);
+  y = simd::mul(y, r_det_m);
+  z = simd::mul(z, r_det_m);
+  w = simd::mul(w, r_det_m);
+
+  // adjugate shuffle merged with the store shuffle
+  simd::store(&r.columns[0].x, simd::shuffle<3, 1, 3, 1>(x, y));
+  simd::store(&r.columns[1].x, simd::shuffle<2, 0, 2, 0>(x, y));
+  simd::store(&r.columns[2].x, simd::shuffle<3, 1, 3, 1>(z, w));
+  simd::store(&r.columns[3].x, simd::shuffle<2, 0, 2, 0>(z, w));
+#else
   float s[6];
   float c[6];
 
@@ -444,76 +366,44 @@ Mat4x4 Mat4x4::invert() const
   for (Vec4& v : r.columns)
     for (uint32_t i = 0; i < 4; ++i)
       v[i] *= idet;
+#endif
 
   return r;
 }
 
-Mat4x4 Mat4x4::RotationX(float radians)
-{
-  const float s = SDL_sinf(radians);
-  const float c = SDL_cosf(radians);
-
-  Mat4x4 r;
-  r.columns[0].x = 1.0f;
-  r.columns[1].y = c;
-  r.columns[1].z = s;
-  r.columns[2].y = -s;
-  r.columns[2].z = c;
-  r.columns[3].w = 1.0f;
-
-  return r;
-}
-
-Mat4x4 Mat4x4::RotationY(float radians)
-{
-  const float s = SDL_sinf(radians);
-  const float c = SDL_cosf(radians);
-
-  Mat4x4 r;
-  r.columns[0].x = c;
-  r.columns[0].z = s;
-  r.columns[1].y = 1.0f;
-  r.columns[2].x = -s;
-  r.columns[2].z = c;
-  r.columns[3].w = 1.0f;
-
-  return r;
-}
-
-Mat4x4 Mat4x4::RotationZ(float radians)
-{
-  const float s = SDL_sinf(radians);
-  const float c = SDL_cosf(radians);
-
-  Mat4x4 r;
-  r.columns[0].x = c;
-  r.columns[0].y = s;
-  r.columns[1].x = -s;
-  r.columns[1].y = c;
-  r.columns[2].z = 1.0f;
-  r.columns[3].w = 1.0f;
-
-  return r;
-}
-
-Mat4x4 Mat4x4::Translation(const Vec3& t)
-{
-  Mat4x4 r;
-  r.identity();
-  r.translate(t);
-  return r;
-}
-
-Mat4x4 Mat4x4::Scale(const Vec3& s)
-{
-  Mat4x4 r;
-  r.identity();
-  r.scale(s);
-  return r;
-}
-
 void Mat4x4::generate_frustum_planes(Vec4 planes[6]) const
 {
+#if VVNE_SIMD
+  //
+  // Planes are sums and differences of matrix rows. Columns transposed in registers give the rows directly.
+  //
+  const simd::Float4 c0 = simd::load(&columns[0].x);
+  const simd::Float4 c1 = simd::load(&columns[1].x);
+  const simd::Float4 c2 = simd::load(&columns[2].x);
+  const simd::Float4 c3 = simd::load(&columns[3].x);
+
+  const simd::Float4 t0 = simd::shuffle<0, 1, 0, 1>(c0, c1);
+  const simd::Float4 t1 = simd::shuffle<2, 3, 2, 3>(c0, c1);
+  const simd::Float4 t2 = simd::shuffle<0, 1, 0, 1>(c2, c3);
+  const simd::Float4 t3 = simd::shuffle<2, 3, 2, 3>(c2, c3);
+
+  const simd::Float4 r0 = simd::shuffle<0, 2, 0, 2>(t0, t2);
+  const simd::Float4 r1 = simd::shuffle<1, 3, 1, 3>(t0, t2);
+  const simd::Float4 r2 = simd::shuffle<0, 2, 0, 2>(t1, t3);
+  const simd::Float4 r3 = simd::shuffle<1, 3, 1, 3>(t1, t3);
+
+  // left, right, top, bottom, back, front
+  const simd::Float4 unnormalized[] = {
+      simd::add(r3, r0), simd::sub(r3, r0), simd::sub(r3, r1),
+      simd::add(r3, r1), simd::add(r3, r2), simd::sub(r3, r2),
+  };
+
+  for (uint32_t i = 0; i < 6; ++i)
+  {
+    const simd::Float4 p = unnormalized[i];
+    simd::store(&planes[i].x, simd::div(p, simd::sqrt(simd::dot3(p, p))));
+  }
+#else
   enum
   {
     LEFT   = 0,
@@ -554,4 +444,332 @@ void Mat4x4::generate_frustum_planes(Vec4 planes[6]) const
     const float length = planes[i].as_vec3().len();
     planes[i]          = planes[i].scale(1.0f / length);
   }
+#endif
+}
+
+void compose_trs(const Vec3* t, const Quaternion* r, const Vec3* s, Mat4x4* out, uint32_t n)
+{
+  //
+  // T * R * S for affine transforms is the rotation matrix with columns scaled by s and translation in last column,
+  // no matrix products needed.
+  //
+  for (uint32_t i = 0; i < n; ++i)
+  {
+#if VVNE_SIMD
+    simd::Float4 rotation[3];
+    quaternion_to_columns(simd::load(r[i].data.data()), rotation);
+
+    simd::store(&out[i].columns[0].x, simd::mul(rotation[0], simd::splat(s[i].x)));
+    simd::store(&out[i].columns[1].x, simd::mul(rotation[1], simd::splat(s[i].y)));
+    simd::store(&out[i].columns[2].x, simd::mul(rotation[2], simd::splat(s[i].z)));
+#else
+    const Mat4x4 rotation(r[i]);
+    out[i].columns[0] = rotation.columns[0].scale(s[i].x);
+    out[i].columns[1] = rotation.columns[1].scale(s[i].y);
+    out[i].columns[2] = rotation.columns[2].scale(s[i].z);
+#endif
+    out[i].columns[3] = Vec4(t[i], 1.0f);
+  }
+}
+
+void mul_many(const Mat4x4* lhs, const Mat4x4* rhs, Mat4x4* out, uint32_t n)
+{
+  for (uint32_t i = 0; i < n; ++i)
+  {
+#if VVNE_SIMD
+    simd::Float4 a[4];
+    load_columns(lhs[i], a);
+    mul_columns(a, rhs[i], out[i]);
+#else
+    out[i] = lhs[i] * rhs[i];
+#endif
+  }
+}
+
+void mul_many(const Mat4x4& lhs, const Mat4x4* rhs, Mat4x4* out, uint32_t n)
+{
+#if VVNE_SIMD
+  // left hand side stays in registers for the whole batch
+  simd::Float4 a[4];
+  load_columns(lhs, a);
+
+  for (uint32_t i = 0; i < n; ++i)
+    mul_columns(a, rhs[i], out[i]);
+#else
+  for (uint32_t i = 0; i < n; ++i)
+    out[i] = lhs * rhs[i];
+#endif
+}
+
+void mul_many(const Mat4x4* lhs, const Mat4x4& rhs, Mat4x4* out, uint32_t n)
+{
+#if VVNE_SIMD
+  // right hand side columns stay in registers for the whole batch
+  simd::Float4 b[4];
+  load_columns(rhs, b);
+
+  for (uint32_t i = 0; i < n; ++i)
+  {
+    simd::Float4 a[4];
+    load_columns(lhs[i], a);
+
+    for (uint32_t c = 0; c < 4; ++c)
+      simd::store(&out[i].columns[c].x, mul_column(a, b[c]));
+  }
+#else
+  for (uint32_t i = 0; i < n; ++i)
+    out[i] = lhs[i] * rhs;
+#endif
+}
+
+#if VVNE_SIMD
+namespace {
+
+// first three rows of the 4x4 matrix with columns a, b, c, d
+void transpose_to_rows(simd::Float4 a, simd::Float4 b, simd::Float4 c, simd::Float4 d, simd::Float4 rows[3])
+{
+  const simd::Float4 ab_xy = simd::shuffle<0, 1, 0, 1>(a, b);
+  const simd::Float4 cd_xy = simd::shuffle<0, 1, 0, 1>(c, d);
+  const simd::Float4 ab_zw = simd::shuffle<2, 3, 2, 3>(a, b);
+  const simd::Float4 cd_zw = simd::shuffle<2, 3, 2, 3>(c, d);
+
+  rows[0] = simd::shuffle<0, 2, 0, 2>(ab_xy, cd_xy);
+  rows[1] = simd::shuffle<1, 3, 1, 3>(ab_xy, cd_xy);
+  rows[2] = simd::shuffle<0, 2, 0, 2>(ab_zw, cd_zw);
+}
+
+void load_rows(const Affine3x4& m, simd::Float4 dst[3])
+{
+  for (uint32_t i = 0; i < 3; ++i)
+    dst[i] = simd::load(&m.rows[i].x);
+}
+
+//
+// C[r] = A[r].x * B[0] + A[r].y * B[1] + A[r].z * B[2] + A[r].w * (0, 0, 0, 1)
+// Everything is loaded before the first store, so "out" may alias either input.
+//
+void mul_rows(const simd::Float4 a[3], const Affine3x4& rhs, Affine3x4& out)
+{
+  simd::Float4 b[3];
+  load_rows(rhs, b);
+
+  const simd::Float4 w_only = simd::set(0.0f, 0.0f, 0.0f, 1.0f);
+
+  simd::Float4 c[3];
+  for (uint32_t r = 0; r < 3; ++r)
+  {
+    simd::Float4 row = simd::mul(a[r], w_only);
+    row              = simd::madd(simd::broadcast<0>(a[r]), b[0], row);
+    row              = simd::madd(simd::broadcast<1>(a[r]), b[1], row);
+    c[r]             = simd::madd(simd::broadcast<2>(a[r]), b[2], row);
+  }
+
+  for (uint32_t r = 0; r < 3; ++r)
+    simd::store(&out.rows[r].x, c[r]);
+}
+
+// a x b in xyz, w lane ends up as a.w * b.w - a.w * b.w = 0
+simd::Float4 cross(simd::Float4 a, simd::Float4 b)
+{
+  return simd::sub(simd::mul(simd::swizzle<1, 2, 0, 3>(a), simd::swizzle<2, 0, 1, 3>(b)),
+                   simd::mul(simd::swizzle<2, 0, 1, 3>(a), simd::swizzle<1, 2, 0, 3>(b)));
+}
+
+//
+// "inverted" holds rows of the inverted 3x3 part with zero w lanes, translation becomes -inverted * t
+//
+Affine3x4 with_inverted_translation(const simd::Float4 m[3], const simd::Float4 inverted[3])
+{
+  const simd::Float4 t      = simd::shuffle<0, 2, 3, 3>(simd::shuffle<3, 3, 3, 3>(m[0], m[1]), m[2]);
+  const simd::Float4 w_only = simd::set(0.0f, 0.0f, 0.0f, -1.0f);
+
+  Affine3x4 r;
+  for (uint32_t i = 0; i < 3; ++i)
+    simd::store(&r.rows[i].x, simd::madd(simd::dot3(inverted[i], t), w_only, inverted[i]));
+  return r;
+}
+
+} // namespace
+#else
+namespace {
+
+// r0, r1, r2 are rows of the inverted 3x3 part, translation becomes -inverted * t
+Affine3x4 with_inverted_translation(const Affine3x4& m, const Vec3& r0, const Vec3& r1, const Vec3& r2)
+{
+  const Vec3 t(m.rows[0].w, m.rows[1].w, m.rows[2].w);
+
+  Affine3x4 r;
+  r.rows[0] = Vec4(r0, -r0.mul_inner(t));
+  r.rows[1] = Vec4(r1, -r1.mul_inner(t));
+  r.rows[2] = Vec4(r2, -r2.mul_inner(t));
+  return r;
+}
+
+} // namespace
+#endif
+
+Affine3x4::Affine3x4(const Mat4x4& m)
+{
+#if VVNE_SIMD
+  simd::Float4 c[4];
+  load_columns(m, c);
+
+  simd::Float4 r[3];
+  transpose_to_rows(c[0], c[1], c[2], c[3], r);
+
+  for (uint32_t i = 0; i < 3; ++i)
+    simd::store(&rows[i].x, r[i]);
+#else
+  for (uint32_t r = 0; r < 3; ++r)
+    rows[r] = m.row(r);
+#endif
+}
+
+Affine3x4 Affine3x4::operator*(const Affine3x4& rhs) const
+{
+  Affine3x4 r;
+
+#if VVNE_SIMD
+  simd::Float4 a[3];
+  load_rows(*this, a);
+  mul_rows(a, rhs, r);
+#else
+  for (uint32_t i = 0; i < 3; ++i)
+  {
+    const Vec4& a = rows[i];
+    r.rows[i]     = Vec4(0.0f, 0.0f, 0.0f, a.w);
+    r.rows[i] += rhs.rows[0].scale(a.x);
+    r.rows[i] += rhs.rows[1].scale(a.y);
+    r.rows[i] += rhs.rows[2].scale(a.z);
+  }
+#endif
+
+  return r;
+}
+
+Vec3 Affine3x4::transform_point(const Vec3& p) const
+{
+  const Vec4 v(p, 1.0f);
+  return Vec3(rows[0].mul_inner(v), rows[1].mul_inner(v), rows[2].mul_inner(v));
+}
+
+Affine3x4 Affine3x4::invert() const
+{
+  //
+  // Inverse of the 3x3 part is adj(A) / det(A). With rows r0, r1, r2 columns of the adjugate are the cross products
+  // r1 x r2, r2 x r0 and r0 x r1. Determinant is r0 . (r1 x r2).
+  //
+#if VVNE_SIMD
+  simd::Float4 m[3];
+  load_rows(*this, m);
+
+  const simd::Float4 c0      = cross(m[1], m[2]);
+  const simd::Float4 c1      = cross(m[2], m[0]);
+  const simd::Float4 c2      = cross(m[0], m[1]);
+  const simd::Float4 inv_det = simd::div(simd::splat(1.0f), simd::dot3(m[0], c0));
+  const simd::Float4 zero    = simd::splat(0.0f);
+
+  simd::Float4 inverted[3];
+  transpose_to_rows(simd::mul(c0, inv_det), simd::mul(c1, inv_det), simd::mul(c2, inv_det), zero, inverted);
+
+  return with_inverted_translation(m, inverted);
+#else
+  const Vec3 r0(rows[0].x, rows[0].y, rows[0].z);
+  const Vec3 r1(rows[1].x, rows[1].y, rows[1].z);
+  const Vec3 r2(rows[2].x, rows[2].y, rows[2].z);
+
+  const float inv_det = 1.0f / r0.mul_inner(r1.mul_cross(r2));
+  const Vec3  c0      = r1.mul_cross(r2).scale(inv_det);
+  const Vec3  c1      = r2.mul_cross(r0).scale(inv_det);
+  const Vec3  c2      = r0.mul_cross(r1).scale(inv_det);
+
+  return with_inverted_translation(*this, Vec3(c0.x, c1.x, c2.x), Vec3(c0.y, c1.y, c2.y), Vec3(c0.z, c1.z, c2.z));
+#endif
+}
+
+Affine3x4 Affine3x4::invert_rigid() const
+{
+#if VVNE_SIMD
+  simd::Float4 m[3];
+  load_rows(*this, m);
+
+  // translation lanes land in the fourth row of the transpose, which is dropped
+  simd::Float4 inverted[3];
+  transpose_to_rows(m[0], m[1], m[2], simd::splat(0.0f), inverted);
+
+  return with_inverted_translation(m, inverted);
+#else
+  return with_inverted_translation(*this, Vec3(rows[0].x, rows[1].x, rows[2].x), Vec3(rows[0].y, rows[1].y, rows[2].y),
+                                   Vec3(rows[0].z, rows[1].z, rows[2].z));
+#endif
+}
+
+Mat4x4 Affine3x4::to_mat4x4() const
+{
+  Mat4x4 r;
+  for (uint32_t c = 0; c < 4; ++c)
+    r.columns[c] = Vec4(rows[0][c], rows[1][c], rows[2][c], (3 == c) ? 1.0f : 0.0f);
+  return r;
+}
+
+void Affine3x4::identity()
+{
+  rows[0] = Vec4(1.0f, 0.0f, 0.0f, 0.0f);
+  rows[1] = Vec4(0.0f, 1.0f, 0.0f, 0.0f);
+  rows[2] = Vec4(0.0f, 0.0f, 1.0f, 0.0f);
+}
+
+void mul_many(const Affine3x4* lhs, const Affine3x4* rhs, Affine3x4* out, uint32_t n)
+{
+  for (uint32_t i = 0; i < n; ++i)
+  {
+#if VVNE_SIMD
+    simd::Float4 a[3];
+    load_rows(lhs[i], a);
+    mul_rows(a, rhs[i], out[i]);
+#else
+    out[i] = lhs[i] * rhs[i];
+#endif
+  }
+}
+
+void mul_many(const Affine3x4& lhs, const Affine3x4* rhs, Affine3x4* out, uint32_t n)
+{
+#if VVNE_SIMD
+  simd::Float4 a[3];
+  load_rows(lhs, a);
+
+  for (uint32_t i = 0; i < n; ++i)
+    mul_rows(a, rhs[i], out[i]);
+#else
+  for (uint32_t i = 0; i < n; ++i)
+    out[i] = lhs * rhs[i];
+#endif
+}
+
+void nlerp_many(const Quaternion* a, const Quaternion* b, const float* t, Quaternion* out, uint32_t n)
+{
+  for (uint32_t i = 0; i < n; ++i)
+  {
+#if VVNE_SIMD
+    const simd::Float4 from = simd::load(a[i].data.data());
+    const simd::Float4 to   = simd::load(b[i].data.data());
+
+    // shortest path, sign is picked without a branch
+    const float        sign = (0.0f > simd::first(simd::dot4(from, to))) ? -1.0f : 1.0f;
+    const simd::Float4 r    = simd::madd(simd::splat(t[i]), simd::sub(simd::mul(to, simd::splat(sign)), from), from);
+
+    simd::store(&out[i].data.x, simd::div(r, simd::sqrt(simd::dot4(r, r))));
+#else
+    const Vec4& from = a[i].data;
+    const Vec4  to   = (0.0f > from.mul_inner(b[i].data)) ? b[i].data.scale(-1.0f) : b[i].data;
+    out[i].data      = from.lerp(to, t[i]).normalize();
+#endif
+  }
+}
+
+void lerp_many(const Vec3* a, const Vec3* b, const float* t, Vec3* out, uint32_t n)
+{
+  for (uint32_t i = 0; i < n; ++i)
+    out[i] = a[i].lerp(b[i], t[i]);
 }
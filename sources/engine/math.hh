@@ -1,6 +1,7 @@
 #pragma once
 
 #include <SDL2/SDL_stdinc.h>
+#include <type_traits>
 #include <vulkan/vulkan.h>
 
 #ifndef M_PI
@@ -26,6 +27,80 @@ template <typename T> constexpr T clamp(T val, T min, T max)
   return (val < min) ? min : (val > max) ? max : val;
 }
 
+//
+// Usable in constant expressions. During constant evaluation series approximations computed in double are used (error
+// stays below float precision), at runtime calls go straight to SDL so results don't change from the libm versions.
+//
+namespace constexpr_math {
+
+constexpr double PI = 3.14159265358979323846;
+
+// sin on [-pi/2, pi/2], taylor series up to x^15 - truncation error below 1e-12
+constexpr double sin_reduced(double x)
+{
+  const double x2 = x * x;
+  double       r  = 1.0 / 1307674368000.0;
+  r               = 1.0 / 6227020800.0 - x2 * r;
+  r               = 1.0 / 39916800.0 - x2 * r;
+  r               = 1.0 / 362880.0 - x2 * r;
+  r               = 1.0 / 5040.0 - x2 * r;
+  r               = 1.0 / 120.0 - x2 * r;
+  r               = 1.0 / 6.0 - x2 * r;
+  return x * (1.0 - x2 * r);
+}
+
+constexpr double sin(double x)
+{
+  // [-pi, pi] first, then sin(pi - x) = sin(x) folds it to [-pi/2, pi/2]
+  x -= 2.0 * PI * static_cast<double>(static_cast<int64_t>(x / (2.0 * PI)));
+  if (x > PI)
+    x -= 2.0 * PI;
+  else if (x < -PI)
+    x += 2.0 * PI;
+
+  if (x > (0.5 * PI))
+    x = PI - x;
+  else if (x < (-0.5 * PI))
+    x = -PI - x;
+
+  return sin_reduced(x);
+}
+
+constexpr double sqrt(double x)
+{
+  if (x <= 0.0)
+    return 0.0;
+
+  // newton iterations from above converge monotonically, stop once they don't improve
+  double r = (x > 1.0) ? x : 1.0;
+  for (double next = 0.5 * (r + x / r); next < r; next = 0.5 * (r + x / r))
+    r = next;
+  return r;
+}
+
+} // namespace constexpr_math
+
+constexpr float constexpr_sinf(float x)
+{
+  if (std::is_constant_evaluated())
+    return static_cast<float>(constexpr_math::sin(x));
+  return SDL_sinf(x);
+}
+
+constexpr float constexpr_cosf(float x)
+{
+  if (std::is_constant_evaluated())
+    return static_cast<float>(constexpr_math::sin(static_cast<double>(x) + (0.5 * constexpr_math::PI)));
+  return SDL_cosf(x);
+}
+
+constexpr float constexpr_sqrtf(float x)
+{
+  if (std::is_constant_evaluated())
+    return static_cast<float>(constexpr_math::sqrt(x));
+  return SDL_sqrtf(x);
+}
+
 struct Vec2
 {
   Vec2() = default;
@@ -53,28 +128,88 @@ struct Vec2
 struct Vec3
 {
   Vec3() = default;
-  explicit Vec3(float val);
-  Vec3(const Vec2& vec, float val);
-  Vec3(float x, float y, float z);
-
-  [[nodiscard]] Vec3         operator-(const Vec3& rhs) const;
-  [[nodiscard]] Vec3         operator+(const Vec3& rhs) const;
-  [[nodiscard]] Vec3         scale(float s) const;
-  [[nodiscard]] float        len() const;
-  [[nodiscard]] Vec3         invert_signs() const;
-  [[nodiscard]] Vec3         normalize() const;
-  [[nodiscard]] Vec2         xz() const;
-  [[nodiscard]] Vec3         lerp(const Vec3& dst, float t) const;
-  [[nodiscard]] Vec3         mul_cross(const Vec3& rhs) const;
-  [[nodiscard]] float        mul_inner(const Vec3& rhs) const;
+  constexpr explicit Vec3(float val)
+      : x(val)
+      , y(val)
+      , z(val)
+  {
+  }
+  constexpr Vec3(const Vec2& vec, float val)
+      : x(vec.x)
+      , y(vec.y)
+      , z(val)
+  {
+  }
+  constexpr Vec3(float x, float y, float z)
+      : x(x)
+      , y(y)
+      , z(z)
+  {
+  }
+
+  [[nodiscard]] constexpr Vec3 operator-(const Vec3& rhs) const
+  {
+    return Vec3(x - rhs.x, y - rhs.y, z - rhs.z);
+  }
+  [[nodiscard]] constexpr Vec3 operator+(const Vec3& rhs) const
+  {
+    return Vec3(x + rhs.x, y + rhs.y, z + rhs.z);
+  }
+  [[nodiscard]] constexpr Vec3 scale(float s) const
+  {
+    return Vec3(x * s, y * s, z * s);
+  }
+  [[nodiscard]] constexpr float len() const
+  {
+    return constexpr_sqrtf(x * x + y * y + z * z);
+  }
+  [[nodiscard]] constexpr Vec3 invert_signs() const
+  {
+    return Vec3(-x, -y, -z);
+  }
+  [[nodiscard]] constexpr Vec3 normalize() const
+  {
+    return scale(1.0f / len());
+  }
+  [[nodiscard]] constexpr Vec2 xz() const
+  {
+    return Vec2(x, z);
+  }
+  [[nodiscard]] constexpr Vec3 lerp(const Vec3& dst, float t) const
+  {
+    return Vec3(x + t * (dst.x - x), y + t * (dst.y - y), z + t * (dst.z - z));
+  }
+  [[nodiscard]] constexpr Vec3 mul_cross(const Vec3& rhs) const
+  {
+    return Vec3(y * rhs.z - z * rhs.y, z * rhs.x - x * rhs.z, x * rhs.y - y * rhs.x);
+  }
+  [[nodiscard]] constexpr float mul_inner(const Vec3& rhs) const
+  {
+    return (x * rhs.x) + (y * rhs.y) + (z * rhs.z);
+  }
   [[nodiscard]] const float* data() const
   {
     return &x;
   }
 
-  void operator+=(const Vec3& rhs);
-  void operator-=(const Vec3& rhs);
-  void clamp(float min, float max);
+  constexpr void operator+=(const Vec3& rhs)
+  {
+    x += rhs.x;
+    y += rhs.y;
+    z += rhs.z;
+  }
+  constexpr void operator-=(const Vec3& rhs)
+  {
+    x -= rhs.x;
+    y -= rhs.y;
+    z -= rhs.z;
+  }
+  constexpr void clamp(float min, float max)
+  {
+    x = ::clamp(x, min, max);
+    y = ::clamp(y, min, max);
+    z = ::clamp(z, min, max);
+  }
 
   float x = 0.0f;
   float y = 0.0f;
@@ -84,10 +219,22 @@ struct Vec3
 struct Vec4
 {
   Vec4() = default;
-  Vec4(float x, float y, float z, float w);
-  explicit Vec4(const Vec3& v, float w = 0.0f);
+  constexpr Vec4(float x, float y, float z, float w)
+      : x(x)
+      , y(y)
+      , z(z)
+      , w(w)
+  {
+  }
+  constexpr explicit Vec4(const Vec3& v, float w = 0.0f)
+      : x(v.x)
+      , y(v.y)
+      , z(v.z)
+      , w(w)
+  {
+  }
 
-  [[nodiscard]] inline Vec4 scale(float s) const
+  [[nodiscard]] constexpr Vec4 scale(float s) const
   {
     return Vec4(x * s, y * s, z * s, w * s);
   }
@@ -99,24 +246,41 @@ struct Vec4
   {
     return *reinterpret_cast<const Vec3*>(this);
   }
-  [[nodiscard]] inline float& operator[](uint32_t i)
+  // constant evaluation doesn't allow pointer arithmetic across members
+  [[nodiscard]] constexpr float& operator[](uint32_t i)
   {
+    if (std::is_constant_evaluated())
+      return (0 == i) ? x : (1 == i) ? y : (2 == i) ? z : w;
     return *(&x + i);
   }
-  [[nodiscard]] inline const float& operator[](uint32_t i) const
+  [[nodiscard]] constexpr const float& operator[](uint32_t i) const
   {
+    if (std::is_constant_evaluated())
+      return (0 == i) ? x : (1 == i) ? y : (2 == i) ? z : w;
     return *(&x + i);
   }
-  [[nodiscard]] float               mul_inner(const Vec4& rhs) const;
-  [[nodiscard]] Vec4                lerp(const Vec4& dst, float t) const;
-  [[nodiscard]] float               len() const;
-  [[nodiscard]] Vec4                normalize() const;
+  [[nodiscard]] constexpr float mul_inner(const Vec4& rhs) const
+  {
+    return (x * rhs.x) + (y * rhs.y) + (z * rhs.z) + (w * rhs.w);
+  }
+  [[nodiscard]] constexpr Vec4 lerp(const Vec4& dst, float t) const
+  {
+    return Vec4(x + t * (dst.x - x), y + t * (dst.y - y), z + t * (dst.z - z), w + t * (dst.w - w));
+  }
+  [[nodiscard]] constexpr float len() const
+  {
+    return constexpr_sqrtf(x * x + y * y + z * z + w * w);
+  }
+  [[nodiscard]] constexpr Vec4 normalize() const
+  {
+    return scale(1.0f / len());
+  }
   [[nodiscard]] inline const float* data() const
   {
     return &x;
   }
 
-  inline Vec4& operator+=(const Vec4& rhs)
+  constexpr Vec4& operator+=(const Vec4& rhs)
   {
     x += rhs.x;
     y += rhs.y;
@@ -134,10 +298,18 @@ struct Vec4
 struct Quaternion
 {
   Quaternion() = default;
-  Quaternion(float angle, const Vec3& axis);
+  constexpr Quaternion(float angle, const Vec3& axis)
+  {
+    rotate(angle, axis);
+  }
 
-  [[nodiscard]] Quaternion operator*(const Quaternion& rhs) const;
-  void                     rotate(float angle, const Vec3& axis);
+  [[nodiscard]] constexpr Quaternion operator*(const Quaternion& rhs) const;
+
+  constexpr void rotate(float angle, const Vec3& axis)
+  {
+    const float half_angle = 0.5f * angle;
+    data                   = Vec4(axis.scale(constexpr_sinf(half_angle)), constexpr_cosf(half_angle));
+  }
 
   Vec4 data;
 };
@@ -146,16 +318,19 @@ struct Mat4x4
 {
   Mat4x4() = default;
   explicit Mat4x4(const float* data);
-  explicit Mat4x4(const Quaternion& quat);
+  constexpr explicit Mat4x4(const Quaternion& quat);
 
-  [[nodiscard]] Mat4x4              operator*(const Mat4x4& rhs) const;
-  [[nodiscard]] Vec4                operator*(const Vec4& rhs) const;
-  [[nodiscard]] inline const float& at(uint32_t r, uint32_t c) const
+  [[nodiscard]] constexpr Mat4x4       operator*(const Mat4x4& rhs) const;
+  [[nodiscard]] constexpr Vec4         operator*(const Vec4& rhs) const;
+  [[nodiscard]] constexpr const float& at(uint32_t r, uint32_t c) const
   {
     return columns[c][r];
   }
-  [[nodiscard]] Mat4x4              invert() const;
-  [[nodiscard]] Vec4                row(uint32_t i) const;
+  [[nodiscard]] Mat4x4 invert() const;
+  [[nodiscard]] constexpr Vec4 row(uint32_t i) const
+  {
+    return {columns[0][i], columns[1][i], columns[2][i], columns[3][i]};
+  }
   [[nodiscard]] inline const float* data() const
   {
     return &columns[0].x;
@@ -171,21 +346,51 @@ struct Mat4x4
   void perspective(float aspect_ratio, float fov_rads, float near_cp, float far_cp);
 
   void ortho(float l, float r, float b, float t, float n, float f);
-  void set_diagonal(const Vec3& values);
   void generate_frustum_planes(Vec4 planes[6]) const;
 
-  void identity();
-  void transpose();
-  void translate(Vec3 v);
-  void translate_in_place(const Vec3& v);
-  void scale(Vec3 s);
-
-  [[nodiscard]] static Mat4x4 RotationX(float r);
-  [[nodiscard]] static Mat4x4 RotationY(float r);
-  [[nodiscard]] static Mat4x4 RotationZ(float r);
-  [[nodiscard]] static Mat4x4 LookAt(const Vec3& eye, const Vec3& center, const Vec3& up);
-  [[nodiscard]] static Mat4x4 Translation(const Vec3& t);
-  [[nodiscard]] static Mat4x4 Scale(const Vec3& s);
+  constexpr void set_diagonal(const Vec3& v)
+  {
+    columns[0].x = v.x;
+    columns[1].y = v.y;
+    columns[2].z = v.z;
+    columns[3].w = 1.0f;
+  }
+
+  constexpr void identity()
+  {
+    for (uint32_t c = 0; c < 4; ++c)
+      for (uint32_t r = 0; r < 4; ++r)
+        columns[c][r] = (c == r) ? 1.0f : 0.0f;
+  }
+
+  constexpr void transpose();
+
+  constexpr void translate(const Vec3& v)
+  {
+    identity();
+    columns[3].x = v.x;
+    columns[3].y = v.y;
+    columns[3].z = v.z;
+  }
+
+  constexpr void translate_in_place(const Vec3& v)
+  {
+    const Vec4 t(v, 0.0f);
+    for (uint32_t i = 0; i < 4; ++i)
+      columns[3][i] = row(i).mul_inner(t);
+  }
+
+  constexpr void scale(const Vec3& s)
+  {
+    set_diagonal(s);
+  }
+
+  [[nodiscard]] static constexpr Mat4x4 RotationX(float r);
+  [[nodiscard]] static constexpr Mat4x4 RotationY(float r);
+  [[nodiscard]] static constexpr Mat4x4 RotationZ(float r);
+  [[nodiscard]] static constexpr Mat4x4 LookAt(const Vec3& eye, const Vec3& center, const Vec3& up);
+  [[nodiscard]] static constexpr Mat4x4 Translation(const Vec3& t);
+  [[nodiscard]] static constexpr Mat4x4 Scale(const Vec3& s);
 
   //
   // SPIR-V specification 2.18.1. Memory Layout
@@ -205,3 +410,271 @@ struct Mat4x4
   //
   Vec4 columns[4] = {};
 };
+
+//
+// Operators below have a simd backend. Constant evaluation uses the scalar formulas from "scalar_math", runtime calls
+// go to "backend_math" in math.cc, which falls back to the same scalar formulas in VVNE_SCALAR_MATH builds.
+//
+namespace scalar_math {
+
+constexpr Quaternion mul(const Quaternion& lhs, const Quaternion& rhs)
+{
+  const Vec3 a(lhs.data.x, lhs.data.y, lhs.data.z);
+  const Vec3 b(rhs.data.x, rhs.data.y, rhs.data.z);
+
+  Quaternion r;
+  r.data = Vec4(a.mul_cross(b) + a.scale(rhs.data.w) + b.scale(lhs.data.w), lhs.data.w * rhs.data.w - a.mul_inner(b));
+  return r;
+}
+
+constexpr Mat4x4 from_quaternion(const Quaternion& q)
+{
+  const float a  = q.data.w;
+  const float b  = q.data.x;
+  const float c  = q.data.y;
+  const float d  = q.data.z;
+  const float a2 = a * a;
+  const float b2 = b * b;
+  const float c2 = c * c;
+  const float d2 = d * d;
+
+  Mat4x4 r;
+  r.columns[0]   = Vec4(a2 + b2 - c2 - d2, 2.0f * (b * c + a * d), 2.0f * (b * d - a * c), 0.0f);
+  r.columns[1]   = Vec4(2.0f * (b * c - a * d), a2 - b2 + c2 - d2, 2.0f * (c * d + a * b), 0.0f);
+  r.columns[2]   = Vec4(2.0f * (b * d + a * c), 2.0f * (c * d - a * b), a2 - b2 - c2 + d2, 0.0f);
+  r.columns[3].w = 1.0f;
+  return r;
+}
+
+//
+//   A               B              C
+//   a1 b1 c1 d1     e1 f1 g1 h1    i1 j1 k1 l1
+//   a2 b2 c2 d2     e2 f2 g2 h2    i2 j2 k2 l2
+//   a3 b3 c3 d3 mul e3 f3 g3 h3 -> i3 j3 k3 l3
+//   a4 b4 c4 d4     e4 f4 g4 h4    i4 j4 k4 l4
+//
+//   i1 = (a1 * e1) + (b1 * e2) + (c1 * e3) + (d1 * e4)
+//   i2 = (a2 * e1) + (b2 * e2) + (c2 * e3) + (d2 * e4)
+//   ...
+//
+//   For each column (c) in C
+//       For each row (r) in C
+//           Use full length (k) of row in A and column in B to calculate C[c][r]
+//
+constexpr Mat4x4 mul(const Mat4x4& lhs, const Mat4x4& rhs)
+{
+  Mat4x4 result;
+  for (uint32_t c = 0; c < 4; ++c)
+    for (uint32_t r = 0; r < 4; ++r)
+      for (uint32_t k = 0; k < 4; ++k)
+        result.columns[c][r] += lhs.columns[k][r] * rhs.columns[c][k];
+  return result;
+}
+
+// simplified version of algorithm above, B and C matrices are 1-column versions
+constexpr Vec4 mul(const Mat4x4& lhs, const Vec4& rhs)
+{
+  Vec4 result;
+  for (uint32_t r = 0; r < 4; ++r)
+    for (uint32_t k = 0; k < 4; ++k)
+      result[r] += lhs.columns[k][r] * rhs[k];
+  return result;
+}
+
+} // namespace scalar_math
+
+namespace backend_math {
+
+Quaternion mul(const Quaternion& lhs, const Quaternion& rhs);
+Mat4x4     from_quaternion(const Quaternion& q);
+Mat4x4     mul(const Mat4x4& lhs, const Mat4x4& rhs);
+Vec4       mul(const Mat4x4& lhs, const Vec4& rhs);
+
+} // namespace backend_math
+
+constexpr Quaternion Quaternion::operator*(const Quaternion& rhs) const
+{
+  if (std::is_constant_evaluated())
+    return scalar_math::mul(*this, rhs);
+  return backend_math::mul(*this, rhs);
+}
+
+constexpr Mat4x4::Mat4x4(const Quaternion& q)
+    : Mat4x4(std::is_constant_evaluated() ? scalar_math::from_quaternion(q) : backend_math::from_quaternion(q))
+{
+}
+
+constexpr Mat4x4 Mat4x4::operator*(const Mat4x4& rhs) const
+{
+  if (std::is_constant_evaluated())
+    return scalar_math::mul(*this, rhs);
+  return backend_math::mul(*this, rhs);
+}
+
+constexpr Vec4 Mat4x4::operator*(const Vec4& rhs) const
+{
+  if (std::is_constant_evaluated())
+    return scalar_math::mul(*this, rhs);
+  return backend_math::mul(*this, rhs);
+}
+
+constexpr void Mat4x4::transpose()
+{
+  //
+  // a1 b1 c1 d1     a1 a2 a3 a4
+  // a2 b2 c2 d2     b1 b2 b3 b4
+  // a3 b3 c3 d3 --> c1 c2 c3 c4
+  // a4 b4 c4 d4     d1 d2 d3 d4
+  //
+  // We only need to iterate elements on one side of diagonal (exluding diag line).
+  //
+  // x 0 1 3
+  // x x 2 4
+  // x x x 5
+  // x x x x
+  //
+  // (1, 0) -> (0, 1)
+  // (2, 0) -> (0, 2)
+  // (2, 1) -> (1, 2)
+  // (3, 0) -> (0, 3)
+  // (3, 1) -> (1, 3)
+  // (3, 2) -> (2, 3)
+  //
+  for (uint32_t c = 1; c < 4; ++c)
+    for (uint32_t idx = 0; idx < c; ++idx)
+      columns[idx][c] = columns[c][idx];
+}
+
+constexpr Mat4x4 Mat4x4::RotationX(float radians)
+{
+  const float s = constexpr_sinf(radians);
+  const float c = constexpr_cosf(radians);
+
+  Mat4x4 r;
+  r.columns[0].x = 1.0f;
+  r.columns[1].y = c;
+  r.columns[1].z = s;
+  r.columns[2].y = -s;
+  r.columns[2].z = c;
+  r.columns[3].w = 1.0f;
+
+  return r;
+}
+
+constexpr Mat4x4 Mat4x4::RotationY(float radians)
+{
+  const float s = constexpr_sinf(radians);
+  const float c = constexpr_cosf(radians);
+
+  Mat4x4 r;
+  r.columns[0].x = c;
+  r.columns[0].z = s;
+  r.columns[1].y = 1.0f;
+  r.columns[2].x = -s;
+  r.columns[2].z = c;
+  r.columns[3].w = 1.0f;
+
+  return r;
+}
+
+constexpr Mat4x4 Mat4x4::RotationZ(float radians)
+{
+  const float s = constexpr_sinf(radians);
+  const float c = constexpr_cosf(radians);
+
+  Mat4x4 r;
+  r.columns[0].x = c;
+  r.columns[0].y = s;
+  r.columns[1].x = -s;
+  r.columns[1].y = c;
+  r.columns[2].z = 1.0f;
+  r.columns[3].w = 1.0f;
+
+  return r;
+}
+
+constexpr Mat4x4 Mat4x4::LookAt(const Vec3& eye, const Vec3& center, const Vec3& up)
+{
+  Mat4x4 r;
+
+  const Vec3 f = (center - eye).normalize();
+  const Vec3 s = f.mul_cross(up).normalize(); // up should be already normalized
+  const Vec3 t = s.mul_cross(f);
+
+  r.columns[0] = Vec4(s.x, t.x, -f.x, 0.0f);
+  r.columns[1] = Vec4(s.y, t.y, -f.y, 0.0f);
+  r.columns[2] = Vec4(s.z, t.z, -f.z, 0.0f);
+  r.translate_in_place(eye.invert_signs());
+  r.columns[3].w = 1.0f;
+
+  return r;
+}
+
+constexpr Mat4x4 Mat4x4::Translation(const Vec3& t)
+{
+  Mat4x4 r;
+  r.translate(t);
+  return r;
+}
+
+constexpr Mat4x4 Mat4x4::Scale(const Vec3& s)
+{
+  Mat4x4 r;
+  r.identity();
+  r.scale(s);
+  return r;
+}
+
+//
+// Affine transform with implicit (0, 0, 0, 1) bottom row. Stored as three rows, each one [r.x r.y r.z t]:
+//
+// rows[0] = [0].x [1].x [2].x [3].x
+// rows[1] = [0].y [1].y [2].y [3].y
+// rows[2] = [0].z [1].z [2].z [3].z
+//
+// 48 bytes instead of 64. Memory matches "layout(row_major) mat4x3" in std140 / std430 blocks, so arrays of it can be
+// uploaded without conversion.
+//
+struct Affine3x4
+{
+  Affine3x4() = default;
+  explicit Affine3x4(const Mat4x4& m); // bottom row of "m" is dropped, it has to be (0, 0, 0, 1)
+
+  [[nodiscard]] Affine3x4 operator*(const Affine3x4& rhs) const;
+  [[nodiscard]] Vec3      transform_point(const Vec3& p) const;
+  [[nodiscard]] Affine3x4 invert() const;       // any invertible affine transform, scale and shear included
+  [[nodiscard]] Affine3x4 invert_rigid() const; // rotation and translation only, rotation part gets transposed
+  [[nodiscard]] Mat4x4    to_mat4x4() const;
+
+  void identity();
+
+  Vec4 rows[3] = {};
+};
+
+//
+// Batched kernels over plain arrays (structure of arrays). Each element of "out" may alias matching input elements.
+//
+
+// out[i] = Translation(t[i]) * Mat4x4(r[i]) * Scale(s[i]), assembled directly without matrix products
+void compose_trs(const Vec3* t, const Quaternion* r, const Vec3* s, Mat4x4* out, uint32_t n);
+
+// out[i] = lhs[i] * rhs[i]
+void mul_many(const Mat4x4* lhs, const Mat4x4* rhs, Mat4x4* out, uint32_t n);
+
+// out[i] = lhs * rhs[i]
+void mul_many(const Mat4x4& lhs, const Mat4x4* rhs, Mat4x4* out, uint32_t n);
+
+// out[i] = lhs[i] * rhs
+void mul_many(const Mat4x4* lhs, const Mat4x4& rhs, Mat4x4* out, uint32_t n);
+
+// out[i] = lhs[i] * rhs[i]
+void mul_many(const Affine3x4* lhs, const Affine3x4* rhs, Affine3x4* out, uint32_t n);
+
+// out[i] = lhs * rhs[i]
+void mul_many(const Affine3x4& lhs, const Affine3x4* rhs, Affine3x4* out, uint32_t n);
+
+// out[i] = normalize(a[i] + t[i] * (b[i] - a[i])), b[i] is negated first when it's on the other hemisphere than a[i]
+void nlerp_many(const Quaternion* a, const Quaternion* b, const float* t, Quaternion* out, uint32_t n);
+
+// out[i] = a[i] + t[i] * (b[i] - a[i])
+void lerp_many(const Vec3* a, const Vec3* b, const float* t, Vec3* out, uint32_t n);
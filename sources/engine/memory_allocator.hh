@@ -9,4 +9,23 @@ public:
   virtual void* Allocate(uint64_t size)              = 0;
   virtual void* Reallocate(void* ptr, uint64_t size) = 0;
   virtual void  Free(void* ptr, uint64_t size)       = 0;
-};
\ No newline at end of file
+};
+
+//
+// Typed arrays of trivial elements. Empty arrays still get a minimal allocation, so the result can always be handed
+// back to "free_array" / "grow_array" with the same count.
+//
+template <typename T> T* allocate_array(MemoryAllocator& allocator, uint32_t count)
+{
+  return reinterpret_cast<T*>(allocator.Allocate(sizeof(T) * SDL_max(count, 1u)));
+}
+
+template <typename T> void free_array(MemoryAllocator& allocator, T* ptr, uint32_t count)
+{
+  allocator.Free(ptr, sizeof(T) * SDL_max(count, 1u));
+}
+
+template <typename T> T* grow_array(MemoryAllocator& allocator, T* ptr, uint32_t new_count)
+{
+  return reinterpret_cast<T*>(allocator.Reallocate(ptr, sizeof(T) * SDL_max(new_count, 1u)));
+}
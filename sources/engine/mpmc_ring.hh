@@ -0,0 +1,124 @@
+#pragma once
+
+#include "allocators.hh"
+#include "memory_allocator.hh"
+#include <SDL2/SDL_atomic.h>
+
+//
+// Bounded multi producer / multi consumer ring buffer (Dmitry Vyukov's sequence per cell scheme).
+// Every cell carries a sequence number telling whether it is ready to be written or read at the given position,
+// so producers and consumers only ever contend on their own position counter.
+// Full and empty states are reported back to the caller instead of overwriting data.
+//
+// Positions are placed on separate cache lines from each other and from the cell array.
+//
+
+template <typename T> struct MPMCRing
+{
+public:
+  void init(MemoryAllocator& allocator, uint32_t new_capacity)
+  {
+    SDL_assert(0 == (new_capacity & (new_capacity - 1)));
+    cells    = reinterpret_cast<Cell*>(allocator.Allocate(new_capacity * sizeof(Cell)));
+    capacity = new_capacity;
+    reset();
+  }
+
+  void teardown(MemoryAllocator& allocator)
+  {
+    allocator.Free(cells, capacity * sizeof(Cell));
+    cells    = nullptr;
+    capacity = 0;
+  }
+
+  // can't race with any other call
+  void reset()
+  {
+    for (uint32_t i = 0; i < capacity; ++i)
+      SDL_AtomicSet(&cells[i].sequence, static_cast<int>(i));
+
+    SDL_AtomicSet(&enqueue_position, 0);
+    SDL_AtomicSet(&dequeue_position, 0);
+  }
+
+  [[nodiscard]] bool try_push(const T& in)
+  {
+    uint32_t position = SDL_AtomicGet(&enqueue_position);
+
+    while (true)
+    {
+      Cell&     cell = cells[position & (capacity - 1)];
+      const int diff = distance(position, SDL_AtomicGet(&cell.sequence));
+
+      if (0 == diff)
+      {
+        if (SDL_AtomicCAS(&enqueue_position, static_cast<int>(position), static_cast<int>(position + 1)))
+        {
+          cell.data = in;
+          SDL_AtomicSet(&cell.sequence, static_cast<int>(position + 1));
+          return true;
+        }
+      }
+      else if (0 > diff)
+      {
+        // cell from the previous lap was not consumed yet
+        return false;
+      }
+
+      position = SDL_AtomicGet(&enqueue_position);
+    }
+  }
+
+  [[nodiscard]] bool try_pop(T& out)
+  {
+    uint32_t position = SDL_AtomicGet(&dequeue_position);
+
+    while (true)
+    {
+      Cell&     cell = cells[position & (capacity - 1)];
+      const int diff = distance(position + 1, SDL_AtomicGet(&cell.sequence));
+
+      if (0 == diff)
+      {
+        if (SDL_AtomicCAS(&dequeue_position, static_cast<int>(position), static_cast<int>(position + 1)))
+        {
+          out = cell.data;
+          SDL_AtomicSet(&cell.sequence, static_cast<int>(position + capacity));
+          return true;
+        }
+      }
+      else if (0 > diff)
+      {
+        // nothing was published at this position yet
+        return false;
+      }
+
+      position = SDL_AtomicGet(&dequeue_position);
+    }
+  }
+
+  [[nodiscard]] uint32_t get_capacity() const
+  {
+    return capacity;
+  }
+
+private:
+  // positions wrap around, so they are compared on unsigned arithmetic
+  static int distance(uint32_t from, uint32_t to)
+  {
+    return static_cast<int>(to - from);
+  }
+
+  struct Cell
+  {
+    SDL_atomic_t sequence;
+    T            data;
+  };
+
+  SDL_atomic_t enqueue_position;
+  uint8_t      enqueue_padding[64 - sizeof(SDL_atomic_t)];
+  SDL_atomic_t dequeue_position;
+  uint8_t      dequeue_padding[64 - sizeof(SDL_atomic_t)];
+  Cell*        cells;
+  uint32_t     capacity;
+};
@@ -0,0 +1,217 @@
+#pragma once
+
+#include "allocators.hh"
+#include "memory_allocator.hh"
+#include <SDL2/SDL_atomic.h>
+
+//
+// Fixed size segments shared between any number of SegmentedStacks.
+// Memory is taken once during setup, segments are handed out and returned from any thread under a spinlock.
+// Running out of segments is an error, not a silent overwrite: "allocate" gives nullptr.
+//
+struct SegmentPool
+{
+  struct FreeSegment
+  {
+    FreeSegment* next;
+  };
+
+  uint8_t*     segments;
+  FreeSegment* free_segments;
+  uint32_t     segment_size;
+  uint32_t     segments_count;
+  SDL_SpinLock lock;
+
+  void setup(MemoryAllocator& allocator, uint32_t new_segment_size, uint32_t new_segments_count)
+  {
+    segment_size   = align(SDL_max(new_segment_size, static_cast<uint32_t>(sizeof(FreeSegment))));
+    segments_count = new_segments_count;
+    segments       = reinterpret_cast<uint8_t*>(allocator.Allocate(segment_size * segments_count));
+    free_segments  = nullptr;
+    lock           = 0;
+
+    for (uint32_t i = segments_count; 0 < i; --i)
+      release(&segments[(i - 1) * segment_size]);
+  }
+
+  void teardown(MemoryAllocator& allocator)
+  {
+    allocator.Free(segments, segment_size * segments_count);
+  }
+
+  void* allocate()
+  {
+    SDL_AtomicLock(&lock);
+    FreeSegment* segment = free_segments;
+    if (segment)
+      free_segments = segment->next;
+    SDL_AtomicUnlock(&lock);
+
+    return segment;
+  }
+
+  void release(void* ptr)
+  {
+    FreeSegment* segment = reinterpret_cast<FreeSegment*>(ptr);
+
+    SDL_AtomicLock(&lock);
+    segment->next = free_segments;
+    free_segments = segment;
+    SDL_AtomicUnlock(&lock);
+  }
+};
+
+//
+// Append only stack which can be pushed onto from any number of threads.
+// Elements live in fixed size segments, so growing never moves already pushed data.
+// The thread which first lands in a missing segment installs it, losers of that race give their segment back.
+//
+// Reading (iteration, indexing, "copy_to") and "reset" are only valid once every push has completed,
+// for example after JobScheduler::wait_for_finish.
+//
+// Push fails (and leaves the stack untouched) once all MAX_SEGMENTS are full or the pool has no segment left.
+// Index is claimed only after its segment is in place, so a failed push never leaves a hole behind.
+//
+// Push counter lives on its own cache line, away from the segment table which is read by every push.
+//
+
+template <typename T, uint32_t SEGMENT_CAPACITY = 32, uint32_t MAX_SEGMENTS = 32> struct SegmentedStack
+{
+public:
+  struct Segment
+  {
+    T elements[SEGMENT_CAPACITY];
+  };
+
+  struct Iterator
+  {
+    SegmentedStack* stack;
+    uint32_t        idx;
+
+    T& operator*() const
+    {
+      return (*stack)[idx];
+    }
+
+    Iterator& operator++()
+    {
+      ++idx;
+      return *this;
+    }
+
+    bool operator!=(const Iterator& rhs) const
+    {
+      return idx != rhs.idx;
+    }
+  };
+
+  void setup(SegmentPool& new_pool)
+  {
+    SDL_assert(sizeof(Segment) <= new_pool.segment_size);
+    pool = &new_pool;
+    SDL_AtomicSet(&count, 0);
+
+    for (void*& segment : segments)
+      segment = nullptr;
+
+    // first segment is always there, so a typical frame never goes to the pool
+    segments[0] = pool->allocate();
+  }
+
+  void teardown()
+  {
+    for (void*& segment : segments)
+    {
+      if (segment)
+        pool->release(segment);
+      segment = nullptr;
+    }
+  }
+
+  [[nodiscard]] bool push(const T& in)
+  {
+    for (int idx = SDL_AtomicGet(&count);; idx = SDL_AtomicGet(&count))
+    {
+      if ((SEGMENT_CAPACITY * MAX_SEGMENTS) <= static_cast<uint32_t>(idx))
+        return false;
+
+      Segment* segment = acquire_segment(static_cast<uint32_t>(idx) / SEGMENT_CAPACITY);
+      if (nullptr == segment)
+        return false;
+
+      if (SDL_AtomicCAS(&count, idx, idx + 1))
+      {
+        segment->elements[static_cast<uint32_t>(idx) % SEGMENT_CAPACITY] = in;
+        return true;
+      }
+    }
+  }
+
+  void reset()
+  {
+    for (uint32_t i = 1; i < MAX_SEGMENTS; ++i)
+    {
+      if (segments[i])
+        pool->release(segments[i]);
+      segments[i] = nullptr;
+    }
+
+    SDL_AtomicSet(&count, 0);
+  }
+
+  [[nodiscard]] uint32_t size()
+  {
+    return static_cast<uint32_t>(SDL_AtomicGet(&count));
+  }
+
+  T& operator[](uint32_t idx)
+  {
+    return reinterpret_cast<Segment*>(segments[idx / SEGMENT_CAPACITY])->elements[idx % SEGMENT_CAPACITY];
+  }
+
+  Iterator begin()
+  {
+    return {this, 0};
+  }
+
+  Iterator end()
+  {
+    return {this, size()};
+  }
+
+  // copies everything into contiguous memory, "dst" has to hold at least "size()" elements
+  T* copy_to(T* dst)
+  {
+    const uint32_t total = size();
+    for (uint32_t first = 0; first < total; first += SEGMENT_CAPACITY)
+    {
+      const uint32_t n = SDL_min(SEGMENT_CAPACITY, total - first);
+      SDL_memcpy(dst, reinterpret_cast<Segment*>(segments[first / SEGMENT_CAPACITY])->elements, n * sizeof(T));
+      dst += n;
+    }
+    return dst;
+  }
+
+private:
+  Segment* acquire_segment(uint32_t segment_idx)
+  {
+    void* segment = SDL_AtomicGetPtr(&segments[segment_idx]);
+    if (segment)
+      return reinterpret_cast<Segment*>(segment);
+
+    void* fresh = pool->allocate();
+    if (nullptr == fresh)
+      return nullptr;
+
+    if (SDL_AtomicCASPtr(&segments[segment_idx], nullptr, fresh))
+      return reinterpret_cast<Segment*>(fresh);
+
+    pool->release(fresh);
+    return reinterpret_cast<Segment*>(SDL_AtomicGetPtr(&segments[segment_idx]));
+  }
+
+  SDL_atomic_t count;
+  uint8_t      count_padding[64 - sizeof(SDL_atomic_t)];
+  void*        segments[MAX_SEGMENTS];
+  SegmentPool* pool;
+};
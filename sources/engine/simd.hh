@@ -0,0 +1,203 @@
+#pragma once
+
+//
+// Thin 4 wide float layer used by engine math. Backend is picked at compile time: SSE2 on x86-64, NEON on arm.
+// Defining VVNE_SCALAR_MATH (or building for anything else) leaves VVNE_SIMD at 0 and math.cc uses plain float code.
+//
+// Loads and stores are unaligned on purpose. Vec4 / Mat4x4 are part of vertex formats and push constant blocks, and
+// engine allocators hand out 8 byte aligned memory. On 16 byte aligned addresses unaligned loads cost the same.
+//
+// shuffle<x, y, z, w>(a, b) follows _mm_shuffle_ps semantics: {a[x], a[y], b[z], b[w]}.
+//
+
+#if !defined(VVNE_SCALAR_MATH) and (defined(__SSE2__) or defined(_M_X64))
+#define VVNE_SIMD 1
+#define VVNE_SIMD_SSE 1
+#include <emmintrin.h>
+#elif !defined(VVNE_SCALAR_MATH) and defined(__ARM_NEON)
+#define VVNE_SIMD 1
+#define VVNE_SIMD_NEON 1
+#include <arm_neon.h>
+#else
+#define VVNE_SIMD 0
+#endif
+
+#if VVNE_SIMD
+
+namespace simd {
+
+#if VVNE_SIMD_SSE
+
+using Float4 = __m128;
+
+inline Float4 load(const float* src)
+{
+  return _mm_loadu_ps(src);
+}
+
+inline void store(float* dst, Float4 v)
+{
+  _mm_storeu_ps(dst, v);
+}
+
+inline Float4 splat(float v)
+{
+  return _mm_set1_ps(v);
+}
+
+inline Float4 set(float x, float y, float z, float w)
+{
+  return _mm_setr_ps(x, y, z, w);
+}
+
+inline Float4 add(Float4 a, Float4 b)
+{
+  return _mm_add_ps(a, b);
+}
+
+inline Float4 sub(Float4 a, Float4 b)
+{
+  return _mm_sub_ps(a, b);
+}
+
+inline Float4 mul(Float4 a, Float4 b)
+{
+  return _mm_mul_ps(a, b);
+}
+
+inline Float4 div(Float4 a, Float4 b)
+{
+  return _mm_div_ps(a, b);
+}
+
+inline Float4 sqrt(Float4 a)
+{
+  return _mm_sqrt_ps(a);
+}
+
+// a * b + c
+inline Float4 madd(Float4 a, Float4 b, Float4 c)
+{
+  return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+
+template <int x, int y, int z, int w> Float4 shuffle(Float4 a, Float4 b)
+{
+  return _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x));
+}
+
+template <int x, int y, int z, int w> Float4 swizzle(Float4 a)
+{
+  return _mm_castsi128_ps(_mm_shuffle_epi32(_mm_castps_si128(a), _MM_SHUFFLE(w, z, y, x)));
+}
+
+inline float first(Float4 a)
+{
+  return _mm_cvtss_f32(a);
+}
+
+#elif VVNE_SIMD_NEON
+
+using Float4 = float32x4_t;
+
+inline Float4 load(const float* src)
+{
+  return vld1q_f32(src);
+}
+
+inline void store(float* dst, Float4 v)
+{
+  vst1q_f32(dst, v);
+}
+
+inline Float4 splat(float v)
+{
+  return vdupq_n_f32(v);
+}
+
+inline Float4 set(float x, float y, float z, float w)
+{
+  const float values[] = {x, y, z, w};
+  return vld1q_f32(values);
+}
+
+inline Float4 add(Float4 a, Float4 b)
+{
+  return vaddq_f32(a, b);
+}
+
+inline Float4 sub(Float4 a, Float4 b)
+{
+  return vsubq_f32(a, b);
+}
+
+inline Float4 mul(Float4 a, Float4 b)
+{
+  return vmulq_f32(a, b);
+}
+
+inline Float4 div(Float4 a, Float4 b)
+{
+  // two newton-raphson steps on the reciprocal estimate get within a couple ulp of a real division
+  Float4 r = vrecpeq_f32(b);
+  r        = vmulq_f32(vrecpsq_f32(b, r), r);
+  r        = vmulq_f32(vrecpsq_f32(b, r), r);
+  return vmulq_f32(a, r);
+}
+
+inline Float4 sqrt(Float4 a)
+{
+#if defined(__aarch64__)
+  return vsqrtq_f32(a);
+#else
+  const float lanes[] = {__builtin_sqrtf(vgetq_lane_f32(a, 0)), __builtin_sqrtf(vgetq_lane_f32(a, 1)),
+                         __builtin_sqrtf(vgetq_lane_f32(a, 2)), __builtin_sqrtf(vgetq_lane_f32(a, 3))};
+  return vld1q_f32(lanes);
+#endif
+}
+
+inline Float4 madd(Float4 a, Float4 b, Float4 c)
+{
+  return vmlaq_f32(c, a, b);
+}
+
+template <int x, int y, int z, int w> Float4 shuffle(Float4 a, Float4 b)
+{
+  const float lanes[] = {vgetq_lane_f32(a, x), vgetq_lane_f32(a, y), vgetq_lane_f32(b, z), vgetq_lane_f32(b, w)};
+  return vld1q_f32(lanes);
+}
+
+template <int x, int y, int z, int w> Float4 swizzle(Float4 a)
+{
+  return shuffle<x, y, z, w>(a, a);
+}
+
+inline float first(Float4 a)
+{
+  return vgetq_lane_f32(a, 0);
+}
+
+#endif
+
+template <int i> Float4 broadcast(Float4 a)
+{
+  return swizzle<i, i, i, i>(a);
+}
+
+// x * x + y * y + z * z in every lane, w is ignored
+inline Float4 dot3(Float4 a, Float4 b)
+{
+  const Float4 m = mul(a, b);
+  return add(add(broadcast<0>(m), broadcast<1>(m)), broadcast<2>(m));
+}
+
+inline Float4 dot4(Float4 a, Float4 b)
+{
+  const Float4 m = mul(a, b);
+  const Float4 s = add(m, swizzle<1, 0, 3, 2>(m));
+  return add(s, swizzle<2, 3, 0, 1>(s));
+}
+
+} // namespace simd
+
+#endif
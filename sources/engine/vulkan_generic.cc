@@ -387,7 +387,7 @@ VkSampler CreateSampler(VkDevice device, VkSamplerAddressMode address_mode, VkBo
       .compareEnable           = VK_FALSE,
       .compareOp               = VK_COMPARE_OP_NEVER,
       .minLod                  = 0.0f,
-      .maxLod                  = 1.0f,
+      .maxLod                  = VK_LOD_CLAMP_NONE,
       .borderColor             = border_color,
       .unnormalizedCoordinates = VK_FALSE,
   };
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "allocators.hh"
+#include "memory_allocator.hh"
+#include <SDL2/SDL_atomic.h>
+
+//
+// Chase-Lev work stealing deque with fixed capacity.
+// Owner thread pushes and pops from the bottom (LIFO), any other thread may steal from the top (FIFO).
+// Capacity has to be a power of two. Indices are only ever reset by "reset" which must not race with other calls.
+//
+// top and bottom are placed on separate cache lines, since top is hammered by thieves and bottom by the owner.
+//
+
+template <typename T> struct WorkStealingDeque
+{
+public:
+  void init(MemoryAllocator& allocator, uint32_t new_capacity)
+  {
+    SDL_assert(0 == (new_capacity & (new_capacity - 1)));
+    data     = reinterpret_cast<T*>(allocator.Allocate(new_capacity * sizeof(T)));
+    capacity = new_capacity;
+    reset();
+  }
+
+  void teardown(MemoryAllocator& allocator)
+  {
+    allocator.Free(data, capacity * sizeof(T));
+    data     = nullptr;
+    capacity = 0;
+  }
+
+  [[nodiscard]] uint32_t get_capacity() const
+  {
+    return capacity;
+  }
+
+  void reset()
+  {
+    SDL_AtomicSet(&top, 0);
+    SDL_AtomicSet(&bottom, 0);
+  }
+
+  void push(const T& in)
+  {
+    const int b = SDL_AtomicGet(&bottom);
+    const int t = SDL_AtomicGet(&top);
+    SDL_assert(static_cast<uint32_t>(b - t) < capacity);
+
+    data[b & (capacity - 1)] = in;
+    SDL_AtomicSet(&bottom, b + 1);
+  }
+
+  bool pop(T& out)
+  {
+    const int b = SDL_AtomicGet(&bottom) - 1;
+    SDL_AtomicSet(&bottom, b);
+    const int t = SDL_AtomicGet(&top);
+
+    if (t > b)
+    {
+      SDL_AtomicSet(&bottom, b + 1);
+      return false;
+    }
+
+    out = data[b & (capacity - 1)];
+
+    if (t != b)
+    {
+      return true;
+    }
+
+    //
+    // Last element in the deque. Owner races with thieves for it.
+    //
+    const bool won = SDL_AtomicCAS(&top, t, t + 1);
+    SDL_AtomicSet(&bottom, b + 1);
+    return won;
+  }
+
+  bool steal(T& out)
+  {
+    int t = SDL_AtomicGet(&top);
+    int b = SDL_AtomicGet(&bottom);
+
+    while (t < b)
+    {
+      out = data[t & (capacity - 1)];
+      if (SDL_AtomicCAS(&top, t, t + 1))
+      {
+        return true;
+      }
+
+      t = SDL_AtomicGet(&top);
+      b = SDL_AtomicGet(&bottom);
+    }
+
+    return false;
+  }
+
+  [[nodiscard]] bool empty()
+  {
+    return SDL_AtomicGet(&top) >= SDL_AtomicGet(&bottom);
+  }
+
+private:
+  SDL_atomic_t top;
+  uint8_t      top_padding[64 - sizeof(SDL_atomic_t)];
+  SDL_atomic_t bottom;
+  uint8_t      bottom_padding[64 - sizeof(SDL_atomic_t)];
+  T*           data;
+  uint32_t     capacity;
+};
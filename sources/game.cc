@@ -1,7 +1,6 @@
 #include "game.hh"
 #include "engine/cascade_shadow_mapping.hh"
 #include "engine/cubemap.hh"
-#include "engine/memory_map.hh"
 #include "engine/merge_sort.hh"
 #include <SDL2/SDL_events.h>
 #include <SDL2/SDL_scancode.h>
@@ -18,6 +17,13 @@ void Game::startup(Engine& engine)
 
   SDL_SetRelativeMouseMode(SDL_FALSE);
 
+  //
+  // Main thread spreads its own markers over lanes 0-2, so there are never less lanes than that.
+  //
+  const uint32_t profiler_lanes = SDL_max(engine.job_system.threads_count, 3u);
+  update_profiler.setup(*engine.generic_allocator, profiler_lanes);
+  render_profiler.setup(*engine.generic_allocator, profiler_lanes);
+
   update_profiler.paused = false;
   render_profiler.paused = false;
 
@@ -26,6 +32,14 @@ void Game::startup(Engine& engine)
 
   story.setup(*engine.generic_allocator);
 
+  command_list_segments.setup(*engine.generic_allocator,
+                              SDL_max(sizeof(ShadowmapCommandBufferList::Segment),
+                                      sizeof(PrioritizedCommandBufferList::Segment)),
+                              32);
+  shadow_mapping_pass_commands.setup(command_list_segments);
+  scene_rendering_commands.setup(command_list_segments);
+  gui_commands.setup(command_list_segments);
+
   DEBUG_VEC2.x = 0.1f;
   DEBUG_VEC2.y = -1.0f;
 
@@ -56,6 +70,12 @@ void Game::startup(Engine& engine)
 void Game::teardown(Engine& engine)
 {
   level.teardown(*engine.generic_allocator);
+  gui_commands.teardown();
+  scene_rendering_commands.teardown();
+  shadow_mapping_pass_commands.teardown();
+  command_list_segments.teardown(*engine.generic_allocator);
+  render_profiler.teardown(*engine.generic_allocator);
+  update_profiler.teardown(*engine.generic_allocator);
   debug_gui.teardown();
   materials.teardown(engine);
   vkDeviceWaitIdle(engine.device);
@@ -151,28 +171,35 @@ void Game::update(Engine& engine, float time_delta_since_last_frame_ms)
 
   materials.pbr_light_sources_cache.count = 0;
 
-  engine.job_system.fill_jobs(ExampleLevel::copy_update_jobs);
+  //
+  // Render jobs record into command buffers of acquired image, so the image has to be known before the frame starts.
+  // Update and render jobs run as a single graph, render job only waits for the updates it actually reads.
+  //
+  vkAcquireNextImageKHR(engine.device, engine.swapchain, UINT64_MAX, engine.image_available, VK_NULL_HANDLE,
+                        &image_index);
+  vkWaitForFences(engine.device, 1, &engine.submition_fences[image_index], VK_TRUE, UINT64_MAX);
+
+  // has to happen before the fence gets reset, otherwise the frame just waited for would look unfinished
+  {
+    auto is_signaled = [&engine](VkFence fence) { return VK_SUCCESS == vkGetFenceStatus(engine.device, fence); };
+    engine.host_coherent_ubo_ring.reclaim(is_signaled);
+    engine.host_coherent_ring.reclaim(is_signaled);
+  }
+
+  vkResetFences(engine.device, 1, &engine.submition_fences[image_index]);
+  engine.job_system.begin_frame(image_index);
+
+  engine.job_system.clear_jobs();
+  ExampleLevel::add_render_jobs(engine.job_system, ExampleLevel::add_update_jobs(engine.job_system));
   engine.job_system.start();
-  ImGui::Render();
   engine.job_system.wait_for_finish();
 }
 
 void Game::render(Engine& engine)
 {
-  vkAcquireNextImageKHR(engine.device, engine.swapchain, UINT64_MAX, engine.image_available, VK_NULL_HANDLE,
-                        &image_index);
-  vkWaitForFences(engine.device, 1, &engine.submition_fences[image_index], VK_TRUE, UINT64_MAX);
-  vkResetFences(engine.device, 1, &engine.submition_fences[image_index]);
-  engine.job_system.reset_command_buffers(image_index);
-
   {
     ScopedPerfEvent perf_event(render_profiler, __PRETTY_FUNCTION__, 0);
 
-    engine.job_system.fill_jobs(ExampleLevel::copy_render_jobs);
-    engine.job_system.start();
-    // @todo: do something useful here as well?
-    engine.job_system.wait_for_finish();
-
     {
       ScopedPerfEvent recording_perf(render_profiler, "record_primary_command_buffer", 1);
       record_primary_command_buffer(engine);
@@ -198,6 +225,8 @@ void Game::render(Engine& engine)
     };
 
     vkQueueSubmit(engine.graphics_queue, 1, &submit, engine.submition_fences[image_index]);
+    engine.host_coherent_ubo_ring.end_frame(engine.submition_fences[image_index]);
+    engine.host_coherent_ring.end_frame(engine.submition_fences[image_index]);
   }
 
   VkPresentInfoKHR present = {
@@ -220,20 +249,24 @@ void execute_commands(Engine& engine, VkCommandBuffer cmd, PrioritizedCommandBuf
 
   if (0 != list_size)
   {
+    // list is segmented, sorting happens on a contiguous copy
+    PrioritizedCommandBuffer* sorted = engine.generic_allocator->allocate<PrioritizedCommandBuffer>(list_size);
+    list.copy_to(sorted);
+
     {
       PrioritizedCommandBuffer* tmp = engine.generic_allocator->allocate<PrioritizedCommandBuffer>(list_size);
-      merge_sort(list.begin(), list.begin() + list_size, tmp);
+      merge_sort(sorted, sorted + list_size, tmp);
       engine.generic_allocator->free(tmp, list_size);
     }
 
     auto             extract_command_buffer = [](const PrioritizedCommandBuffer& it) { return it.data; };
     VkCommandBuffer* command_buffers        = engine.generic_allocator->allocate<VkCommandBuffer>(list_size);
-    VkCommandBuffer* end =
-        std::transform(list.begin(), list.begin() + list_size, command_buffers, extract_command_buffer);
+    VkCommandBuffer* end = std::transform(sorted, sorted + list_size, command_buffers, extract_command_buffer);
 
     vkCmdExecuteCommands(cmd, std::distance(command_buffers, end), command_buffers);
 
     engine.generic_allocator->free(command_buffers, list_size);
+    engine.generic_allocator->free(sorted, list_size);
   }
 }
 
@@ -1,8 +1,8 @@
 #pragma once
 
 #include "debug_gui.hh"
-#include "engine/atomic_stack.hh"
 #include "engine/priority_pair.hh"
+#include "engine/segmented_stack.hh"
 #include "levels/example_level.hh"
 #include "materials.hh"
 #include "player.hh"
@@ -17,7 +17,8 @@ struct ShadowmapCommandBuffer
 };
 
 using PrioritizedCommandBuffer     = PriorityPair<VkCommandBuffer>;
-using PrioritizedCommandBufferList = AtomicStack<PrioritizedCommandBuffer, 64>;
+using PrioritizedCommandBufferList = SegmentedStack<PrioritizedCommandBuffer>;
+using ShadowmapCommandBufferList   = SegmentedStack<ShadowmapCommandBuffer>;
 
 struct Game;
 
@@ -35,14 +36,15 @@ struct Game
   Profiler           render_profiler;
   story::StoryEditor story;
 
-  VkCommandBuffer                         primary_command_buffers[SWAPCHAIN_IMAGES_COUNT];
-  uint32_t                                image_index;
-  AtomicStack<ShadowmapCommandBuffer, 64> shadow_mapping_pass_commands;
-  VkCommandBuffer                         skybox_command;
-  PrioritizedCommandBufferList            scene_rendering_commands;
-  PrioritizedCommandBufferList            gui_commands;
-  float                                   current_time_sec;
-  JobContext                              job_context;
+  VkCommandBuffer              primary_command_buffers[SWAPCHAIN_IMAGES_COUNT];
+  uint32_t                     image_index;
+  SegmentPool                  command_list_segments;
+  ShadowmapCommandBufferList   shadow_mapping_pass_commands;
+  VkCommandBuffer              skybox_command;
+  PrioritizedCommandBufferList scene_rendering_commands;
+  PrioritizedCommandBufferList gui_commands;
+  float                        current_time_sec;
+  JobContext                   job_context;
 
   bool DEBUG_FLAG_1;
   bool DEBUG_FLAG_2;
@@ -1,17 +1,14 @@
 #include "game_render_entity.hh"
 #include "engine/aligned_push_consts.hh"
 #include "game.hh"
+#include "instance_pool.hh"
 #include "player.hh"
 
 namespace {
 
-uint64_t filter_nodes_with_mesh(const ArrayView<Node>& nodes)
+bool is_rendered(const SimpleEntity& entity, const SceneGraph& scene_graph, uint32_t node_idx)
 {
-  uint64_t result = 0;
-  for (uint32_t i = 0; i < static_cast<uint32_t>(nodes.count); ++i)
-    if (nodes[i].flags.mesh)
-      result |= (uint64_t(1) << i);
-  return result;
+  return scene_graph.nodes[node_idx].flags.mesh and entity.node_renderabilities.test(node_idx);
 }
 
 struct SkinningUbo
@@ -34,9 +31,6 @@ RenderEntityParams::RenderEntityParams(const Player& p)
 void render_pbr_entity_shadow(const SimpleEntity& entity, const SceneGraph& scene_graph, const Engine& engine,
                               const Game& game, VkCommandBuffer cmd, const int cascade_idx)
 {
-  const uint64_t nodes_with_mesh_bitmap = filter_nodes_with_mesh(scene_graph.nodes);
-  const uint64_t bitmap                 = entity.node_renderabilities & nodes_with_mesh_bitmap;
-
   struct Push
   {
     Mat4x4   model;
@@ -47,7 +41,7 @@ void render_pbr_entity_shadow(const SimpleEntity& entity, const SceneGraph& scen
 
   for (uint32_t node_idx = 0; node_idx < static_cast<uint32_t>(scene_graph.nodes.count); ++node_idx)
   {
-    if (bitmap & (uint64_t(1) << node_idx))
+    if (is_rendered(entity, scene_graph, node_idx))
     {
       const int   mesh_idx = scene_graph.nodes.data[node_idx].mesh;
       const Mesh& mesh     = scene_graph.meshes.data[mesh_idx];
@@ -64,9 +58,6 @@ void render_pbr_entity_shadow(const SimpleEntity& entity, const SceneGraph& scen
 void render_pbr_entity(const SimpleEntity& entity, const SceneGraph& scene_graph, const Engine& engine,
                        const RenderEntityParams& p)
 {
-  const uint64_t nodes_with_mesh_bitmap = filter_nodes_with_mesh(scene_graph.nodes);
-  const uint64_t bitmap                 = entity.node_renderabilities & nodes_with_mesh_bitmap;
-
   SkinningUbo ubo;
 
   ubo.projection      = p.projection;
@@ -75,7 +66,7 @@ void render_pbr_entity(const SimpleEntity& entity, const SceneGraph& scene_graph
 
   for (uint32_t node_idx = 0; node_idx < static_cast<uint32_t>(scene_graph.nodes.count); ++node_idx)
   {
-    if (bitmap & (uint64_t(1) << node_idx))
+    if (is_rendered(entity, scene_graph, node_idx))
     {
       const int   mesh_idx = scene_graph.nodes.data[node_idx].mesh;
       const Mesh& mesh     = scene_graph.meshes.data[mesh_idx];
@@ -89,15 +80,40 @@ void render_pbr_entity(const SimpleEntity& entity, const SceneGraph& scene_graph
   }
 }
 
+void render_pbr_instances(const InstancePool& pool, const SceneGraph& scene_graph, const Engine& engine,
+                          const RenderEntityParams& p, VkDeviceSize instances_offset)
+{
+  if (0 == pool.count)
+    return;
+
+  SkinningUbo ubo;
+
+  ubo.projection      = p.projection;
+  ubo.view            = p.view;
+  ubo.camera_position = p.camera_position;
+  ubo.model.identity();
+
+  AlignedPushConsts(p.cmd, p.pipeline_layout).push(VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, ubo);
+
+  for (uint32_t rendered_idx = 0; rendered_idx < pool.rendered_nodes_count; ++rendered_idx)
+  {
+    const int    mesh_idx  = scene_graph.nodes.data[pool.rendered_nodes[rendered_idx]].mesh;
+    const Mesh&  mesh      = scene_graph.meshes.data[mesh_idx];
+    VkBuffer     buffers[] = {engine.gpu_device_local_memory_buffer, engine.gpu_host_coherent_memory_buffer};
+    VkDeviceSize offsets[] = {mesh.vertices_offset, instances_offset + (rendered_idx * pool.count * sizeof(Mat4x4))};
+
+    vkCmdBindIndexBuffer(p.cmd, engine.gpu_device_local_memory_buffer, mesh.indices_offset, mesh.indices_type);
+    vkCmdBindVertexBuffers(p.cmd, 0, array_size(buffers), buffers, offsets);
+    vkCmdDrawIndexed(p.cmd, mesh.indices_count, pool.count, 0, 0, 0);
+  }
+}
+
 void render_wireframe_entity(const SimpleEntity& entity, const SceneGraph& scene_graph, const Engine& engine,
                              const RenderEntityParams& p)
 {
-  const uint64_t nodes_with_mesh_bitmap = filter_nodes_with_mesh(scene_graph.nodes);
-  const uint64_t bitmap                 = entity.node_renderabilities & nodes_with_mesh_bitmap;
-
   for (uint32_t node_idx = 0; node_idx < static_cast<uint32_t>(scene_graph.nodes.count); ++node_idx)
   {
-    if (bitmap & (uint64_t(1) << node_idx))
+    if (is_rendered(entity, scene_graph, node_idx))
     {
       const int    mesh_idx = scene_graph.nodes.data[node_idx].mesh;
       const Mesh&  mesh     = scene_graph.meshes.data[mesh_idx];
@@ -116,12 +132,11 @@ void render_wireframe_entity(const SimpleEntity& entity, const SceneGraph& scene
 void render_entity(const SimpleEntity& entity, const SceneGraph& scene_graph, const Engine& engine,
                    const RenderEntityParams& p)
 {
-  const uint64_t bitmap          = entity.node_renderabilities & filter_nodes_with_mesh(scene_graph.nodes);
-  const Mat4x4   projection_view = p.projection * p.view;
+  const Mat4x4 projection_view = p.projection * p.view;
 
   for (uint32_t node_idx = 0; node_idx < static_cast<uint32_t>(scene_graph.nodes.count); ++node_idx)
   {
-    if (bitmap & (uint64_t(1) << node_idx))
+    if (is_rendered(entity, scene_graph, node_idx))
     {
       const int   mesh_idx = scene_graph.nodes.data[node_idx].mesh;
       const Mesh& mesh     = scene_graph.meshes.data[mesh_idx];
@@ -140,12 +155,11 @@ void render_entity(const SimpleEntity& entity, const SceneGraph& scene_graph, co
 void render_entity_skinned(const SimpleEntity& entity, const SceneGraph& scene_graph, const Engine& engine,
                            const RenderEntityParams& p)
 {
-  const uint64_t bitmap          = entity.node_renderabilities & filter_nodes_with_mesh(scene_graph.nodes);
-  const Mat4x4   projection_view = p.projection * p.view;
+  const Mat4x4 projection_view = p.projection * p.view;
 
   for (uint32_t node_idx = 0; node_idx < static_cast<uint32_t>(scene_graph.nodes.count); ++node_idx)
   {
-    if (bitmap & (uint64_t(1) << node_idx))
+    if (is_rendered(entity, scene_graph, node_idx))
     {
       const int   mesh_idx = scene_graph.nodes.data[node_idx].mesh;
       const Mesh& mesh     = scene_graph.meshes.data[mesh_idx];
@@ -7,6 +7,7 @@ struct Game;
 struct Engine;
 struct Player;
 struct SimpleEntity;
+struct InstancePool;
 struct SceneGraph;
 
 struct RenderEntityParams
@@ -36,3 +37,7 @@ void render_entity(const SimpleEntity& entity, const SceneGraph& scene_graph, co
 
 void render_entity_skinned(const SimpleEntity& entity, const SceneGraph& scene_graph, const Engine& engine,
                            const RenderEntityParams& p);
+
+// every instance of the pool in a single draw per mesh, instance data is already in the host coherent buffer
+void render_pbr_instances(const InstancePool& pool, const SceneGraph& scene_graph, const Engine& engine,
+                          const RenderEntityParams& p, VkDeviceSize instances_offset);
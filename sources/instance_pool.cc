@@ -0,0 +1,112 @@
+#include "instance_pool.hh"
+#include "engine/animation.hh"
+#include <SDL2/SDL_assert.h>
+
+void InstancePool::setup(MemoryAllocator& allocator, const SceneGraph& model, uint32_t new_capacity)
+{
+  const uint32_t nodes_count = model.nodes.count;
+
+  //
+  // Rest pose of the whole hierarchy, relative to the model root. Same rules as SimpleEntity: only scene nodes and
+  // everything below them are rendered, parents are always visited first.
+  //
+  Vec3*       translations = allocate_array<Vec3>(allocator, nodes_count);
+  Quaternion* rotations    = allocate_array<Quaternion>(allocator, nodes_count);
+  Vec3*       node_scales  = allocate_array<Vec3>(allocator, nodes_count);
+  Mat4x4*     node_rest    = allocate_array<Mat4x4>(allocator, nodes_count);
+  bool*       reachable    = allocate_array<bool>(allocator, nodes_count);
+
+  rest_pose(model, {rotations, translations, node_scales});
+  for (uint32_t i = 0; i < nodes_count; ++i)
+    reachable[i] = false;
+
+  compose_trs(translations, rotations, node_scales, node_rest, nodes_count);
+
+  for (int scene_node_idx : model.scenes[0].nodes)
+    reachable[scene_node_idx] = true;
+
+  rendered_nodes_count = 0;
+  for (int node_idx : model.node_order)
+  {
+    const int parent_idx = model.node_parents[node_idx];
+    if (0 <= parent_idx)
+    {
+      node_rest[node_idx] = node_rest[parent_idx] * node_rest[node_idx];
+      reachable[node_idx] = reachable[parent_idx];
+    }
+
+    if (reachable[node_idx] and model.nodes[node_idx].flags.mesh)
+      rendered_nodes_count += 1;
+  }
+
+  rendered_nodes  = allocate_array<uint32_t>(allocator, rendered_nodes_count);
+  rest_transforms = allocate_array<Mat4x4>(allocator, rendered_nodes_count);
+
+  // ascending node order, draws come out in the same order SimpleEntity renders them
+  for (uint32_t i = 0, rendered_idx = 0; i < nodes_count; ++i)
+  {
+    if (reachable[i] and model.nodes[i].flags.mesh)
+    {
+      rendered_nodes[rendered_idx]  = i;
+      rest_transforms[rendered_idx] = node_rest[i];
+      rendered_idx += 1;
+    }
+  }
+
+  free_array(allocator, reachable, nodes_count);
+  free_array(allocator, node_rest, nodes_count);
+  free_array(allocator, node_scales, nodes_count);
+  free_array(allocator, rotations, nodes_count);
+  free_array(allocator, translations, nodes_count);
+
+  //
+  // Per instance arrays
+  //
+  capacity         = new_capacity;
+  count            = 0;
+  positions        = allocate_array<Vec3>(allocator, capacity);
+  orientations     = allocate_array<Quaternion>(allocator, capacity);
+  scales           = allocate_array<Vec3>(allocator, capacity);
+  world_transforms = allocate_array<Mat4x4>(allocator, capacity);
+  transforms       = allocate_array<Mat4x4>(allocator, rendered_nodes_count * capacity);
+}
+
+void InstancePool::teardown(MemoryAllocator& allocator)
+{
+  free_array(allocator, transforms, rendered_nodes_count * capacity);
+  free_array(allocator, world_transforms, capacity);
+  free_array(allocator, scales, capacity);
+  free_array(allocator, orientations, capacity);
+  free_array(allocator, positions, capacity);
+  free_array(allocator, rest_transforms, rendered_nodes_count);
+  free_array(allocator, rendered_nodes, rendered_nodes_count);
+}
+
+uint32_t InstancePool::spawn(const Vec3& position, const Quaternion& orientation, const Vec3& scale)
+{
+  SDL_assert(capacity != count);
+
+  const uint32_t idx = count++;
+  positions[idx]     = position;
+  orientations[idx]  = orientation;
+  scales[idx]        = scale;
+  return idx;
+}
+
+void InstancePool::release(uint32_t idx)
+{
+  SDL_assert(idx < count);
+
+  const uint32_t last = --count;
+  positions[idx]      = positions[last];
+  orientations[idx]   = orientations[last];
+  scales[idx]         = scales[last];
+}
+
+void InstancePool::update()
+{
+  compose_trs(positions, orientations, scales, world_transforms, count);
+
+  for (uint32_t rendered_idx = 0; rendered_idx < rendered_nodes_count; ++rendered_idx)
+    mul_many(world_transforms, rest_transforms[rendered_idx], &transforms[rendered_idx * count], count);
+}
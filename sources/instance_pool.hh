@@ -0,0 +1,54 @@
+#pragma once
+
+#include "engine/gltf.hh"
+#include "engine/memory_allocator.hh"
+
+//
+// Many copies of a single static model (crowds, formations) sharing its SceneGraph.
+//
+// Per instance state is just the placement, kept as structure of arrays so the whole pool is updated with batched
+// kernels: one compose_trs over every instance, then one mul_many per rendered node against its transform relative
+// to the model root, which is resolved once at setup. Results are grouped by node - every rendered node owns one
+// contiguous range of "count" model matrices, ready to be copied into an instance buffer and drawn with a single
+// instanced draw per mesh.
+//
+// Node transforms never change after setup, so animated and skinned models stay with SimpleEntity.
+//
+struct InstancePool
+{
+  void setup(MemoryAllocator& allocator, const SceneGraph& model, uint32_t capacity);
+  void teardown(MemoryAllocator& allocator);
+
+  // instance index stays valid until the next "release", released slot is taken over by the last instance
+  uint32_t spawn(const Vec3& position, const Quaternion& orientation, const Vec3& scale);
+  void     release(uint32_t idx);
+
+  // recalculates "transforms" of every instance
+  void update();
+
+  [[nodiscard]] const Mat4x4* rendered_node_transforms(uint32_t rendered_node_idx) const
+  {
+    return &transforms[rendered_node_idx * count];
+  }
+
+  [[nodiscard]] uint32_t transforms_count() const
+  {
+    return rendered_nodes_count * count;
+  }
+
+  // per instance
+  Vec3*       positions;
+  Quaternion* orientations;
+  Vec3*       scales;
+  Mat4x4*     world_transforms;
+  uint32_t    count;
+  uint32_t    capacity;
+
+  // shared by all instances, mesh nodes reachable from the first scene
+  uint32_t* rendered_nodes;
+  Mat4x4*   rest_transforms;
+  uint32_t  rendered_nodes_count;
+
+  // rendered_nodes_count ranges of "count" elements, instances of the first rendered node come first
+  Mat4x4* transforms;
+};
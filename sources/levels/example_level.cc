@@ -90,6 +90,7 @@ void ExampleLevel::setup(HierarchicalAllocator& allocator, const Materials& mate
   helmet_entity.init(allocator, materials.helmet);
   robot_entity.init(allocator, materials.robot);
   monster_entity.init(allocator, materials.monster);
+  monster_entity.compressed_animations = materials.monster_animations;
 
   for (SimpleEntity& entity : box_entities)
   {
@@ -100,6 +101,11 @@ void ExampleLevel::setup(HierarchicalAllocator& allocator, const Materials& mate
   matrioshka_entity.init(allocator, materials.animatedBox);
   rigged_simple_entity.init(allocator, materials.riggedSimple);
 
+  // placement is recalculated every frame by the update job
+  squadron.setup(allocator, materials.robot, 8);
+  for (uint32_t i = 0; i < squadron.capacity; ++i)
+    squadron.spawn(Vec3(), Quaternion(0.0f, Vec3(0.0f, 1.0f, 0.0f)), Vec3(0.5f));
+
   for (SimpleEntity& entity : axis_arrow_entities)
   {
     entity.init(allocator, materials.lil_arrow);
@@ -114,14 +120,18 @@ void ExampleLevel::setup(HierarchicalAllocator& allocator, const Materials& mate
 
   static_lines_renderer.setup(allocator, 50);
   render_constant_lines(static_lines_renderer);
-  static_lines_renderer.cache_lines(allocator);
+  static_lines_renderer.cache_lines(allocator, allocator);
 
   lines_renderer.setup(allocator, 256);
+  height_ruler_texts.reset();
+  tilt_ruler_texts.reset();
 }
 
 void ExampleLevel::teardown(HierarchicalAllocator& allocator)
 {
+  squadron.teardown(allocator);
   lines_renderer.teardown(allocator);
+  static_lines_renderer.release_cache(allocator);
   static_lines_renderer.teardown(allocator);
 }
 
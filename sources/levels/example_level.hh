@@ -1,5 +1,8 @@
 #pragma once
 
+#include "engine/job_scheduler.hh"
+#include "gui_text_generator.hh"
+#include "instance_pool.hh"
 #include "lines_renderer.hh"
 #include "simple_entity.hh"
 #include <SDL2/SDL_events.h>
@@ -24,13 +27,33 @@ private:
 class ExampleLevel
 {
 public:
+  //
+  // Update jobs which render jobs may have to wait for
+  //
+  struct UpdateJobs
+  {
+    JobHandle monster;
+    JobHandle helmet;
+    JobHandle robot;
+    JobHandle squadron;
+    JobHandle rigged_simple;
+    JobHandle moving_lights;
+    JobHandle matrioshka;
+    JobHandle orientation_axis;
+    JobHandle gui_lines;
+    JobHandle gui_text;
+    JobHandle csm_matrices;
+    JobHandle story;
+    JobHandle imgui;
+  };
+
   void setup(HierarchicalAllocator& allocator, const Materials& materials);
   void teardown(HierarchicalAllocator& allocator);
   void process_event(const SDL_Event& event);
   void update(float time_delta_since_last_frame_ms);
 
-  static Job* copy_update_jobs(Job* dst);
-  static Job* copy_render_jobs(Job* dst);
+  static UpdateJobs add_update_jobs(JobScheduler& scheduler);
+  static void       add_render_jobs(JobScheduler& scheduler, const UpdateJobs& update_jobs);
 
   [[nodiscard]] float get_height(float x, float y) const;
 
@@ -44,7 +67,12 @@ public:
   SimpleEntity    rigged_simple_entity;
   SimpleEntity    axis_arrow_entities[3];
   SimpleEntity    inspected_story_point;
+  InstancePool    squadron;
 
   LinesRenderer static_lines_renderer;
   LinesRenderer lines_renderer;
+
+  // regenerated every frame into the frame arena
+  ArrayView<GuiText> height_ruler_texts;
+  ArrayView<GuiText> tilt_ruler_texts;
 };
@@ -1,18 +1,32 @@
 #include "engine/aligned_push_consts.hh"
-#include "engine/memory_map.hh"
 #include "game.hh"
 #include "sdf_font_generator.hh"
 #include "game_render_entity.hh"
+#include <SDL2/SDL_assert.h>
 #include <SDL2/SDL_log.h>
 
 namespace {
 
+// lists only run out when their segments do, a command dropped here would never be executed
+template <typename T, uint32_t SEGMENT_CAPACITY, uint32_t MAX_SEGMENTS>
+void submit(SegmentedStack<T, SEGMENT_CAPACITY, MAX_SEGMENTS>& list, const T& command)
+{
+  const bool pushed = list.push(command);
+  SDL_assert(pushed);
+}
+
 VkCommandBuffer acquire_command_buffer(ThreadJobData& tjd)
 {
   JobContext* ctx = reinterpret_cast<JobContext*>(tjd.user_data);
   return ctx->engine->job_system.acquire(tjd.thread_id, ctx->game->image_index);
 }
 
+// frame rings refuse slices they have no room for, draws reading such a slice are skipped for the frame
+bool has_frame_data(VkDeviceSize frame_ring_offset)
+{
+  return GpuFrameRing::INVALID_OFFSET != frame_ring_offset;
+}
+
 [[maybe_unused]] void render_skybox(VkCommandBuffer command, VkBuffer buffer, const Player& player,
                                     const Pipelines::Pair& pipe, const Materials& materials)
 {
@@ -65,15 +79,15 @@ void skybox_job(ThreadJobData tjd)
   vkEndCommandBuffer(command);
 }
 
-void robot_depth_job(ThreadJobData tjd)
+void robot_depth_cascades(ThreadJobData tjd, void*, uint32_t begin, uint32_t end)
 {
   JobContext*     ctx = reinterpret_cast<JobContext*>(tjd.user_data);
   ScopedPerfEvent perf_event(ctx->game->render_profiler, __FUNCTION__, tjd.thread_id);
 
-  for (int cascade_idx = 0; cascade_idx < SHADOWMAP_CASCADE_COUNT; ++cascade_idx)
+  for (int cascade_idx = static_cast<int>(begin); cascade_idx < static_cast<int>(end); ++cascade_idx)
   {
     VkCommandBuffer command = acquire_command_buffer(tjd);
-    ctx->game->shadow_mapping_pass_commands.push({command, cascade_idx});
+    submit(ctx->game->shadow_mapping_pass_commands, {command, cascade_idx});
     ctx->engine->render_passes.shadowmap.begin(command, static_cast<uint32_t>(cascade_idx));
     vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.shadowmap.pipeline);
     vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.shadowmap.layout, 0, 1,
@@ -85,13 +99,24 @@ void robot_depth_job(ThreadJobData tjd)
   }
 }
 
+//
+// Every cascade is recorded into its own command buffer, so they are handed out to whichever threads are free.
+//
+CoroutineJob robot_depth_job(ThreadJobData tjd)
+{
+  co_await tjd.scheduler->async_parallel_for(tjd, 0, SHADOWMAP_CASCADE_COUNT, 1, robot_depth_cascades, nullptr);
+}
+
 void robot_job(ThreadJobData tjd)
 {
   JobContext*     ctx = reinterpret_cast<JobContext*>(tjd.user_data);
   ScopedPerfEvent perf_event(ctx->game->render_profiler, __FUNCTION__, tjd.thread_id);
 
+  if (not has_frame_data(ctx->game->materials.pbr_dynamic_lights_ubo_offset))
+    return;
+
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->scene_rendering_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->scene_rendering_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.color_and_depth.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.scene3D.pipeline);
 
@@ -105,8 +130,7 @@ void robot_job(ThreadJobData tjd)
         mats.cascade_view_proj_matrices_render_dset[ctx->game->image_index],
     };
 
-    uint32_t dynamic_offsets[] = {
-        static_cast<uint32_t>(ctx->game->materials.pbr_dynamic_lights_ubo_offsets[ctx->game->image_index])};
+    uint32_t dynamic_offsets[] = {static_cast<uint32_t>(ctx->game->materials.pbr_dynamic_lights_ubo_offset)};
 
     vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.scene3D.layout, 0,
                             array_size(dsets), dsets, array_size(dynamic_offsets), dynamic_offsets);
@@ -133,15 +157,55 @@ void robot_job(ThreadJobData tjd)
   vkEndCommandBuffer(command);
 }
 
-void helmet_depth_job(ThreadJobData tjd)
+void squadron_job(ThreadJobData tjd)
 {
   JobContext*     ctx = reinterpret_cast<JobContext*>(tjd.user_data);
   ScopedPerfEvent perf_event(ctx->game->render_profiler, __FUNCTION__, tjd.thread_id);
 
-  for (int cascade_idx = 0; cascade_idx < SHADOWMAP_CASCADE_COUNT; ++cascade_idx)
+  if (not has_frame_data(ctx->game->materials.pbr_dynamic_lights_ubo_offset) or
+      not has_frame_data(ctx->game->materials.squadron_instances_offset))
+    return;
+
+  VkCommandBuffer command = acquire_command_buffer(tjd);
+  submit(ctx->game->scene_rendering_commands, PrioritizedCommandBuffer(command));
+  ctx->engine->render_passes.color_and_depth.begin(command, ctx->game->image_index);
+  vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.scene3D_instanced.pipeline);
+
+  {
+    const Materials& mats    = ctx->game->materials;
+    VkDescriptorSet  dsets[] = {
+        mats.robot_pbr_material_dset,
+        mats.pbr_ibl_environment_dset,
+        mats.debug_shadow_map_dset,
+        mats.pbr_dynamic_lights_dset,
+        mats.cascade_view_proj_matrices_render_dset[ctx->game->image_index],
+    };
+
+    uint32_t dynamic_offsets[] = {static_cast<uint32_t>(ctx->game->materials.pbr_dynamic_lights_ubo_offset)};
+
+    vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.scene3D_instanced.layout,
+                            0, array_size(dsets), dsets, array_size(dynamic_offsets), dynamic_offsets);
+  }
+
+  RenderEntityParams params(ctx->game->player);
+  params.cmd             = command;
+  params.pipeline_layout = ctx->engine->pipelines.scene3D_instanced.layout;
+
+  render_pbr_instances(ctx->game->level.squadron, ctx->game->materials.robot, *ctx->engine, params,
+                       ctx->game->materials.squadron_instances_offset);
+
+  vkEndCommandBuffer(command);
+}
+
+void helmet_depth_cascades(ThreadJobData tjd, void*, uint32_t begin, uint32_t end)
+{
+  JobContext*     ctx = reinterpret_cast<JobContext*>(tjd.user_data);
+  ScopedPerfEvent perf_event(ctx->game->render_profiler, __FUNCTION__, tjd.thread_id);
+
+  for (int cascade_idx = static_cast<int>(begin); cascade_idx < static_cast<int>(end); ++cascade_idx)
   {
     VkCommandBuffer command = acquire_command_buffer(tjd);
-    ctx->game->shadow_mapping_pass_commands.push({command, cascade_idx});
+    submit(ctx->game->shadow_mapping_pass_commands, {command, cascade_idx});
     ctx->engine->render_passes.shadowmap.begin(command, static_cast<uint32_t>(cascade_idx));
     vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.shadowmap.pipeline);
     vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.shadowmap.layout, 0, 1,
@@ -153,13 +217,21 @@ void helmet_depth_job(ThreadJobData tjd)
   }
 }
 
+CoroutineJob helmet_depth_job(ThreadJobData tjd)
+{
+  co_await tjd.scheduler->async_parallel_for(tjd, 0, SHADOWMAP_CASCADE_COUNT, 1, helmet_depth_cascades, nullptr);
+}
+
 void helmet_job(ThreadJobData tjd)
 {
   JobContext*     ctx = reinterpret_cast<JobContext*>(tjd.user_data);
   ScopedPerfEvent perf_event(ctx->game->render_profiler, __FUNCTION__, tjd.thread_id);
 
+  if (not has_frame_data(ctx->game->materials.pbr_dynamic_lights_ubo_offset))
+    return;
+
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->scene_rendering_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->scene_rendering_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.color_and_depth.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.scene3D.pipeline);
 
@@ -172,8 +244,7 @@ void helmet_job(ThreadJobData tjd)
         ctx->game->materials.cascade_view_proj_matrices_render_dset[ctx->game->image_index],
     };
 
-    uint32_t dynamic_offsets[] = {
-        static_cast<uint32_t>(ctx->game->materials.pbr_dynamic_lights_ubo_offsets[ctx->game->image_index])};
+    uint32_t dynamic_offsets[] = {static_cast<uint32_t>(ctx->game->materials.pbr_dynamic_lights_ubo_offset)};
 
     vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.scene3D.layout, 0,
                             array_size(dsets), dsets, array_size(dynamic_offsets), dynamic_offsets);
@@ -195,7 +266,7 @@ void point_light_boxes(ThreadJobData tjd)
   ScopedPerfEvent perf_event(ctx->game->render_profiler, __FUNCTION__, tjd.thread_id);
 
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->scene_rendering_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->scene_rendering_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.color_and_depth.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.colored_geometry.pipeline);
 
@@ -226,8 +297,11 @@ void matrioshka_box(ThreadJobData tjd)
   JobContext*     ctx = reinterpret_cast<JobContext*>(tjd.user_data);
   ScopedPerfEvent perf_event(ctx->game->render_profiler, __FUNCTION__, tjd.thread_id);
 
+  if (not has_frame_data(ctx->game->materials.pbr_dynamic_lights_ubo_offset))
+    return;
+
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->scene_rendering_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->scene_rendering_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.color_and_depth.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.colored_geometry.pipeline);
 
@@ -247,7 +321,7 @@ void matrioshka_box(ThreadJobData tjd)
   ScopedPerfEvent perf_event(ctx->game->render_profiler, __FUNCTION__, tjd.thread_id);
 
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->scene_rendering_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->scene_rendering_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.color_and_depth.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.scene3D.pipeline);
 
@@ -260,8 +334,7 @@ void matrioshka_box(ThreadJobData tjd)
         ctx->game->materials.cascade_view_proj_matrices_render_dset[ctx->game->image_index],
     };
 
-    uint32_t dynamic_offsets[] = {
-        static_cast<uint32_t>(ctx->game->materials.pbr_dynamic_lights_ubo_offsets[ctx->game->image_index])};
+    uint32_t dynamic_offsets[] = {static_cast<uint32_t>(ctx->game->materials.pbr_dynamic_lights_ubo_offset)};
 
     vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.scene3D.layout, 0,
                             array_size(dsets), dsets, array_size(dynamic_offsets), dynamic_offsets);
@@ -309,7 +382,7 @@ void matrioshka_box(ThreadJobData tjd)
   for (int cascade_idx = 0; cascade_idx < Engine::SHADOWMAP_CASCADE_COUNT; ++cascade_idx)
   {
     VkCommandBuffer command = acquire_command_buffer(tjd);
-    ctx->game->shadow_mapping_pass_commands.push({command, cascade_idx});
+    submit(ctx->game->shadow_mapping_pass_commands, {command, cascade_idx});
 
     VkCommandBufferInheritanceInfo inheritance = {
         .sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
@@ -367,13 +440,15 @@ void simple_rigged(ThreadJobData tjd)
   JobContext*     ctx = reinterpret_cast<JobContext*>(tjd.user_data);
   ScopedPerfEvent perf_event(ctx->game->render_profiler, __FUNCTION__, tjd.thread_id);
 
+  if (not has_frame_data(ctx->game->materials.rig_skinning_matrices_ubo_offset))
+    return;
+
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->scene_rendering_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->scene_rendering_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.color_and_depth.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.colored_geometry_skinned.pipeline);
 
-  uint32_t dynamic_offsets[] = {
-      static_cast<uint32_t>(ctx->game->materials.rig_skinning_matrices_ubo_offsets[ctx->game->image_index])};
+  uint32_t dynamic_offsets[] = {static_cast<uint32_t>(ctx->game->materials.rig_skinning_matrices_ubo_offset)};
 
   vkCmdBindDescriptorSets(
       command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.colored_geometry_skinned.layout, 0, 1,
@@ -394,13 +469,15 @@ void monster_rigged(ThreadJobData tjd)
   JobContext*     ctx = reinterpret_cast<JobContext*>(tjd.user_data);
   ScopedPerfEvent perf_event(ctx->game->render_profiler, __FUNCTION__, tjd.thread_id);
 
+  if (not has_frame_data(ctx->game->materials.monster_skinning_matrices_ubo_offset))
+    return;
+
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->scene_rendering_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->scene_rendering_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.color_and_depth.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.colored_geometry_skinned.pipeline);
 
-  uint32_t dynamic_offsets[] = {
-      static_cast<uint32_t>(ctx->game->materials.monster_skinning_matrices_ubo_offsets[ctx->game->image_index])};
+  uint32_t dynamic_offsets[] = {static_cast<uint32_t>(ctx->game->materials.monster_skinning_matrices_ubo_offset)};
 
   vkCmdBindDescriptorSets(
       command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.colored_geometry_skinned.layout, 0, 1,
@@ -425,7 +502,7 @@ void radar(ThreadJobData tjd)
     return;
 
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->gui_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->gui_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.gui.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.green_gui.pipeline);
   vkCmdBindVertexBuffers(command, 0, 1, &ctx->engine->gpu_device_local_memory_buffer,
@@ -458,12 +535,15 @@ void robot_gui_lines(ThreadJobData tjd)
   if (ctx->game->player.freecam_mode)
     return;
 
+  if (not has_frame_data(ctx->game->materials.green_gui_rulers_buffer_offset))
+    return;
+
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->gui_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->gui_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.gui.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.green_gui_lines.pipeline);
   vkCmdBindVertexBuffers(command, 0, 1, &ctx->engine->gpu_host_coherent_memory_buffer,
-                         &ctx->game->materials.green_gui_rulers_buffer_offsets[ctx->game->image_index]);
+                         &ctx->game->materials.green_gui_rulers_buffer_offset);
 
   {
     VkRect2D scissor = {};
@@ -500,7 +580,7 @@ void robot_gui_speed_meter_text(ThreadJobData tjd)
     return;
 
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->gui_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->gui_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.gui.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.green_gui_sdf_font.pipeline);
   vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.green_gui_sdf_font.layout, 0,
@@ -593,7 +673,7 @@ void robot_gui_speed_meter_triangle(ThreadJobData tjd)
     return;
 
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->gui_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->gui_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.gui.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.green_gui_triangle.pipeline);
 
@@ -619,7 +699,7 @@ void height_ruler_text(ThreadJobData tjd)
     return;
 
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->gui_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->gui_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.gui.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.green_gui_sdf_font.pipeline);
   vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.green_gui_sdf_font.layout, 0,
@@ -631,20 +711,11 @@ void height_ruler_text(ThreadJobData tjd)
   const float time = ctx->game->current_time_sec;
 
   //--------------------------------------------------------------------------
-  // height rulers values
+  // height rulers values, generated by the update into this frame's arena
   //--------------------------------------------------------------------------
 
-  const GuiTextGenerator gen = {
-      .player_y_location_meters = -(2.0f - ctx->game->player.position.y),
-      .camera_x_pitch_radians   = ctx->game->player.get_camera().angle,
-      .camera_y_pitch_radians   = ctx->game->player.get_camera().angle,
-      .screen_extent2D          = ctx->engine->extent2D,
-  };
-
-  ArrayView<GuiText> scheduled_text_data = gen.height_ruler(tjd.allocator);
-
   char buffer[256];
-  for (GuiText& text : scheduled_text_data)
+  for (GuiText& text : ctx->game->level.height_ruler_texts)
   {
     Mat4x4 gui_projection;
     gui_projection.ortho(0, ctx->engine->extent2D.width, 0, ctx->engine->extent2D.height, 0.0f, 1.0f);
@@ -699,7 +770,7 @@ void tilt_ruler_text(ThreadJobData tjd)
     return;
 
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->gui_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->gui_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.gui.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.green_gui_sdf_font.pipeline);
   vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.green_gui_sdf_font.layout, 0,
@@ -723,20 +794,11 @@ void tilt_ruler_text(ThreadJobData tjd)
   fpc.time = ctx->game->current_time_sec;
 
   //--------------------------------------------------------------------------
-  // tilt rulers values
+  // tilt rulers values, generated by the update into this frame's arena
   //--------------------------------------------------------------------------
 
-  const GuiTextGenerator gen = {
-      .player_y_location_meters = -(2.0f - ctx->game->player.position.y),
-      .camera_x_pitch_radians   = ctx->game->player.get_camera().updown_angle,
-      .camera_y_pitch_radians   = ctx->game->player.get_camera().updown_angle,
-      .screen_extent2D          = ctx->engine->extent2D,
-  };
-
-  ArrayView<GuiText> scheduled_text_data = gen.tilt_ruler(tjd.allocator);
-
   char buffer[256];
-  for (GuiText& text : scheduled_text_data)
+  for (GuiText& text : ctx->game->level.tilt_ruler_texts)
   {
     Mat4x4 gui_projection;
     gui_projection.ortho(0, ctx->engine->extent2D.width, 0, ctx->engine->extent2D.height, 0.0f, 1.0f);
@@ -794,7 +856,7 @@ void story_dialog_text(ThreadJobData tjd)
     return;
 
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->gui_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->gui_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.gui.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.green_gui_sdf_font.pipeline);
   vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.green_gui_sdf_font.layout, 0,
@@ -867,7 +929,7 @@ void compass_text(ThreadJobData tjd)
     return;
 
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->gui_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->gui_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.gui.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.green_gui_sdf_font.pipeline);
   vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.green_gui_sdf_font.layout, 0,
@@ -1041,7 +1103,7 @@ void radar_dots(ThreadJobData tjd)
     return;
 
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->gui_commands.push(PrioritizedCommandBuffer(command, 1));
+  submit(ctx->game->gui_commands, PrioritizedCommandBuffer(command, 1));
   ctx->engine->render_passes.gui.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.green_gui_radar_dots.pipeline);
 
@@ -1092,7 +1154,7 @@ void weapon_selectors_left(ThreadJobData tjd)
     return;
 
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->gui_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->gui_commands, PrioritizedCommandBuffer(command));
 
   {
     VkCommandBufferInheritanceInfo inheritance = {
@@ -1231,7 +1293,7 @@ void weapon_selectors_right(ThreadJobData tjd)
     return;
 
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->gui_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->gui_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.gui.begin(command, ctx->game->image_index);
 
   Mat4x4 gui_projection;
@@ -1482,7 +1544,7 @@ void imgui(ThreadJobData tjd)
     return;
 
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->gui_commands.push(PrioritizedCommandBuffer(command, 5));
+  submit(ctx->game->gui_commands, PrioritizedCommandBuffer(command, 5));
   ctx->engine->render_passes.gui.begin(command, ctx->game->image_index);
   ctx->engine->insert_debug_marker(command, "imgui", {1.0f, 0.0f, 0.0f, 1.0f});
 
@@ -1564,8 +1626,11 @@ void water(ThreadJobData tjd)
   JobContext*     ctx = reinterpret_cast<JobContext*>(tjd.user_data);
   ScopedPerfEvent perf_event(ctx->game->render_profiler, __FUNCTION__, tjd.thread_id);
 
+  if (not has_frame_data(ctx->game->materials.pbr_dynamic_lights_ubo_offset))
+    return;
+
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->scene_rendering_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->scene_rendering_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.color_and_depth.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.pbr_water.pipeline);
   vkCmdBindVertexBuffers(command, 0, 1, &ctx->engine->gpu_device_local_memory_buffer,
@@ -1603,8 +1668,7 @@ void water(ThreadJobData tjd)
                                ctx->game->materials.pbr_dynamic_lights_dset,
                                ctx->game->materials.pbr_water_material_dset};
 
-    uint32_t dynamic_offsets[] = {
-        static_cast<uint32_t>(ctx->game->materials.pbr_dynamic_lights_ubo_offsets[ctx->game->image_index])};
+    uint32_t dynamic_offsets[] = {static_cast<uint32_t>(ctx->game->materials.pbr_dynamic_lights_ubo_offset)};
 
     vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.pbr_water.layout, 0,
                             array_size(dsets), dsets, array_size(dynamic_offsets), dynamic_offsets);
@@ -1620,7 +1684,7 @@ void water(ThreadJobData tjd)
   ScopedPerfEvent perf_event(ctx->game->render_profiler, __FUNCTION__, tjd.thread_id);
 
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->gui_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->gui_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.gui.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.debug_billboard.pipeline);
 
@@ -1675,7 +1739,7 @@ void water(ThreadJobData tjd)
   ScopedPerfEvent perf_event(ctx->game->render_profiler, __FUNCTION__, tjd.thread_id);
 
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->scene_rendering_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->scene_rendering_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.color_and_depth.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.colored_geometry.pipeline);
 
@@ -1703,8 +1767,11 @@ void tesselated_ground(ThreadJobData tjd)
   JobContext*     ctx = reinterpret_cast<JobContext*>(tjd.user_data);
   ScopedPerfEvent perf_event(ctx->game->render_profiler, __FUNCTION__, tjd.thread_id);
 
+  if (not has_frame_data(ctx->game->materials.pbr_dynamic_lights_ubo_offset))
+    return;
+
   VkCommandBuffer command = acquire_command_buffer(tjd);
-  ctx->game->scene_rendering_commands.push(PrioritizedCommandBuffer(command));
+  submit(ctx->game->scene_rendering_commands, PrioritizedCommandBuffer(command));
   ctx->engine->render_passes.color_and_depth.begin(command, ctx->game->image_index);
   vkCmdBindPipeline(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.tesselated_ground.pipeline);
   vkCmdBindVertexBuffers(command, 0, 1, &ctx->engine->gpu_host_coherent_memory_buffer,
@@ -1730,8 +1797,7 @@ void tesselated_ground(ThreadJobData tjd)
       mats.cascade_view_proj_matrices_render_dset[ctx->game->image_index],
   };
 
-  uint32_t dynamic_offsets[] = {
-      static_cast<uint32_t>(ctx->game->materials.pbr_dynamic_lights_ubo_offsets[ctx->game->image_index])};
+  uint32_t dynamic_offsets[] = {static_cast<uint32_t>(ctx->game->materials.pbr_dynamic_lights_ubo_offset)};
 
   vkCmdBindDescriptorSets(command, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->engine->pipelines.tesselated_ground.layout, 0,
                           array_size(dsets), dsets, array_size(dynamic_offsets), dynamic_offsets);
@@ -1747,124 +1813,182 @@ void update_memory_host_coherent_ubo(ThreadJobData tjd)
   JobContext*     ctx = reinterpret_cast<JobContext*>(tjd.user_data);
   ScopedPerfEvent perf_event(ctx->game->render_profiler, __FUNCTION__, tjd.thread_id);
 
-  Engine& e = *ctx->engine;
-  Game&   g = *ctx->game;
+  Engine&         e     = *ctx->engine;
+  Game&           g     = *ctx->game;
+  GpuMemoryBlock& block = e.memory_blocks.host_coherent_ubo;
 
   //
   // Cascade shadow map projection matrices
   //
   {
-    MemoryMap csm(e.device, e.memory_blocks.host_coherent_ubo.memory,
-                  g.materials.cascade_view_proj_mat_ubo_offsets[g.image_index],
-                  SHADOWMAP_CASCADE_COUNT * (sizeof(Mat4x4) + sizeof(float)));
+    const VkDeviceSize       offset = g.materials.cascade_view_proj_mat_ubo_offsets[g.image_index];
+    CascadeShadowMappingUbo& csm    = block.host_span<CascadeShadowMappingUbo>(offset)[0];
 
+    std::copy(g.materials.cascade_view_proj_mat, &g.materials.cascade_view_proj_mat[SHADOWMAP_CASCADE_COUNT],
+              csm.cascade_view_proj_mat);
     std::copy(g.materials.cascade_split_depths, &g.materials.cascade_split_depths[SHADOWMAP_CASCADE_COUNT],
-              reinterpret_cast<float*>(std::copy(g.materials.cascade_view_proj_mat,
-                                                 &g.materials.cascade_view_proj_mat[SHADOWMAP_CASCADE_COUNT],
-                                                 reinterpret_cast<Mat4x4*>(*csm))));
+              csm.cascade_splits);
+    block.flush(e.device, offset, sizeof(CascadeShadowMappingUbo));
   }
 
   //
   // light sources
   //
   {
-    MemoryMap light_sources(e.device, e.memory_blocks.host_coherent_ubo.memory,
-                            g.materials.pbr_dynamic_lights_ubo_offsets[g.image_index], sizeof(LightSourcesSoA));
-    *reinterpret_cast<LightSourcesSoA*>(*light_sources) = g.materials.pbr_light_sources_cache;
+    const VkDeviceSize offset = e.host_coherent_ubo_ring.allocate(sizeof(LightSourcesSoA));
+    if (has_frame_data(offset))
+    {
+      block.host_span<LightSourcesSoA>(offset)[0] = g.materials.pbr_light_sources_cache;
+      block.flush(e.device, offset, sizeof(LightSourcesSoA));
+    }
+    g.materials.pbr_dynamic_lights_ubo_offset = offset;
   }
 
+  //
+  // Skinning matrices. Descriptor range always covers MAX_SKINNING_MATRICES, so the whole range is reserved.
+  //
+  const VkDeviceSize skinning_matrices_ubo_size = Materials::MAX_SKINNING_MATRICES * sizeof(Affine3x4);
+
   //
   // rigged simple skinning matrices
   //
   {
-    const uint32_t count = g.materials.riggedSimple.skins[0].joints.count;
-    const uint32_t size  = count * sizeof(Mat4x4);
-    const Mat4x4*  begin = g.level.rigged_simple_entity.joint_matrices;
-    const Mat4x4*  end   = &begin[count];
-
-    MemoryMap joint_matrices(e.device, e.memory_blocks.host_coherent_ubo.memory,
-                             g.materials.rig_skinning_matrices_ubo_offsets[g.image_index], size);
-    std::copy(begin, end, reinterpret_cast<Mat4x4*>(*joint_matrices));
+    const uint32_t   count = g.materials.riggedSimple.skins[0].joints.count;
+    const uint32_t   size  = count * sizeof(Affine3x4);
+    const Affine3x4* begin = g.level.rigged_simple_entity.joint_matrices;
+    const Affine3x4* end   = &begin[count];
+
+    const VkDeviceSize offset = e.host_coherent_ubo_ring.allocate(skinning_matrices_ubo_size);
+    if (has_frame_data(offset))
+    {
+      std::copy(begin, end, block.host_span<Affine3x4>(offset, count).begin());
+      block.flush(e.device, offset, size);
+    }
+    g.materials.rig_skinning_matrices_ubo_offset = offset;
   }
 
   //
   // monster skinning matrices
   //
   {
-    const uint32_t count = g.materials.monster.skins[0].joints.count;
-    const uint32_t size  = count * sizeof(Mat4x4);
-    const Mat4x4*  begin = g.level.monster_entity.joint_matrices;
-    const Mat4x4*  end   = &begin[count];
-
-    MemoryMap joint_matrices(e.device, e.memory_blocks.host_coherent_ubo.memory,
-                             g.materials.monster_skinning_matrices_ubo_offsets[g.image_index], size);
-    std::copy(begin, end, reinterpret_cast<Mat4x4*>(*joint_matrices));
+    const uint32_t   count = g.materials.monster.skins[0].joints.count;
+    const uint32_t   size  = count * sizeof(Affine3x4);
+    const Affine3x4* begin = g.level.monster_entity.joint_matrices;
+    const Affine3x4* end   = &begin[count];
+
+    const VkDeviceSize offset = e.host_coherent_ubo_ring.allocate(skinning_matrices_ubo_size);
+    if (has_frame_data(offset))
+    {
+      std::copy(begin, end, block.host_span<Affine3x4>(offset, count).begin());
+      block.flush(e.device, offset, size);
+    }
+    g.materials.monster_skinning_matrices_ubo_offset = offset;
   }
 
   //
   // frustum planes
   //
   {
-    MemoryMap frustums(e.device, e.memory_blocks.host_coherent_ubo.memory,
-                       g.materials.frustum_planes_ubo_offsets[g.image_index], 6 * sizeof(Vec4));
-    (g.player.camera_projection * g.player.camera_view).generate_frustum_planes(reinterpret_cast<Vec4*>(*frustums));
+    const VkDeviceSize offset = g.materials.frustum_planes_ubo_offsets[g.image_index];
+    ArrayView<Vec4>    planes = block.host_span<Vec4>(offset, 6);
+
+    (g.player.camera_projection * g.player.camera_view).generate_frustum_planes(planes.begin());
+    block.flush(e.device, offset, 6 * sizeof(Vec4));
   }
 }
 
-void update_memory_host_coherent(ThreadJobData tjd)
+void update_gui_lines_vertices(ThreadJobData tjd)
 {
   JobContext*     ctx = reinterpret_cast<JobContext*>(tjd.user_data);
   ScopedPerfEvent perf_event(ctx->game->render_profiler, __FUNCTION__, tjd.thread_id);
 
-  {
-    MemoryMap map(ctx->engine->device, ctx->engine->memory_blocks.host_coherent.memory,
-                  ctx->game->materials.green_gui_rulers_buffer_offsets[ctx->game->image_index],
-                  MAX_ROBOT_GUI_LINES * sizeof(Vec2));
+  const LinesRenderer& a    = ctx->game->level.static_lines_renderer;
+  const LinesRenderer& b    = ctx->game->level.lines_renderer;
+  const VkDeviceSize   size = (a.position_cache_size + b.position_cache_size) * sizeof(Vec2);
 
-    Vec2* cursor = reinterpret_cast<Vec2*>(*map);
-    {
-      const LinesRenderer& r = ctx->game->level.static_lines_renderer;
-      cursor                 = std::copy(r.position_cache, r.position_cache + r.position_cache_size, cursor);
-    }
-    {
-      const LinesRenderer& r = ctx->game->level.lines_renderer;
-      std::copy(r.position_cache, r.position_cache + r.position_cache_size, cursor);
-    }
-  }
+  Engine&            e      = *ctx->engine;
+  GpuMemoryBlock&    block  = e.memory_blocks.host_coherent;
+  const VkDeviceSize offset = e.host_coherent_ring.allocate(size);
+
+  ctx->game->materials.green_gui_rulers_buffer_offset = offset;
+  if (not has_frame_data(offset))
+    return;
+
+  Vec2* cursor = block.host_span<Vec2>(offset, a.position_cache_size + b.position_cache_size).begin();
+  cursor       = std::copy(a.position_cache, a.position_cache + a.position_cache_size, cursor);
+  std::copy(b.position_cache, b.position_cache + b.position_cache_size, cursor);
+
+  block.flush(e.device, offset, size);
+}
+
+void update_squadron_instances(ThreadJobData tjd)
+{
+  JobContext*     ctx = reinterpret_cast<JobContext*>(tjd.user_data);
+  ScopedPerfEvent perf_event(ctx->game->render_profiler, __FUNCTION__, tjd.thread_id);
+
+  const InstancePool& squadron = ctx->game->level.squadron;
+  const uint32_t      count    = squadron.transforms_count();
+  const VkDeviceSize  size     = count * sizeof(Mat4x4);
 
+  Engine&            e      = *ctx->engine;
+  GpuMemoryBlock&    block  = e.memory_blocks.host_coherent;
+  const VkDeviceSize offset = e.host_coherent_ring.allocate(size);
+
+  ctx->game->materials.squadron_instances_offset = offset;
+  if (not has_frame_data(offset))
+    return;
+
+  std::copy(squadron.transforms, &squadron.transforms[count], block.host_span<Mat4x4>(offset, count).begin());
+  block.flush(e.device, offset, size);
+}
+
+void update_memory_host_coherent(ThreadJobData tjd)
+{
+  JobContext*     ctx = reinterpret_cast<JobContext*>(tjd.user_data);
+  ScopedPerfEvent perf_event(ctx->game->render_profiler, __FUNCTION__, tjd.thread_id);
   DebugGui::render(*ctx->engine, *ctx->game);
 }
 
 } // namespace
 
-Job* ExampleLevel::copy_render_jobs(Job* dst)
+void ExampleLevel::add_render_jobs(JobScheduler& scheduler, const UpdateJobs& update_jobs)
 {
-  const Job jobs[] = {
-      update_memory_host_coherent_ubo,
-      update_memory_host_coherent,
-      radar,
-      robot_gui_lines,
-      height_ruler_text,
-      tilt_ruler_text,
-      story_dialog_text,
-      robot_gui_speed_meter_text,
-      robot_gui_speed_meter_triangle,
-      compass_text,
-      radar_dots,
-      weapon_selectors_left,
-      weapon_selectors_right,
-      skybox_job,
-      tesselated_ground,
-      robot_job,
-      helmet_job,
-      point_light_boxes,
-      matrioshka_box,
-      water,
-      simple_rigged,
-      monster_rigged,
-      robot_depth_job,
-      helmet_depth_job,
-      imgui,
-  };
-  return std::copy(jobs, jobs + array_size(jobs), dst);
+  const UpdateJobs& u = update_jobs;
+  JobScheduler&     s = scheduler;
+
+  //
+  // Dynamic ubo / vertex offsets are known only after their writer grabbed a slice of the frame ring,
+  // jobs binding them have to wait for it.
+  //
+  const JobHandle ubo =
+      s.add_job(update_memory_host_coherent_ubo, {u.moving_lights, u.csm_matrices, u.rigged_simple, u.monster});
+
+  const JobHandle gui_lines_vertices = s.add_job(update_gui_lines_vertices, {u.gui_lines});
+  const JobHandle squadron_instances = s.add_job(update_squadron_instances, {u.squadron});
+
+  s.add_job(update_memory_host_coherent, {u.imgui});
+  s.add_job(radar);
+  s.add_job(robot_gui_lines, {u.gui_lines, gui_lines_vertices});
+  s.add_job(height_ruler_text, {u.gui_text});
+  s.add_job(tilt_ruler_text, {u.gui_text});
+  s.add_job(story_dialog_text, {u.story});
+  s.add_job(robot_gui_speed_meter_text);
+  s.add_job(robot_gui_speed_meter_triangle);
+  s.add_job(compass_text);
+  s.add_job(radar_dots);
+  s.add_job(weapon_selectors_left);
+  s.add_job(weapon_selectors_right);
+  s.add_job(skybox_job);
+  s.add_job(tesselated_ground, {ubo});
+  s.add_job(robot_job, {u.robot, ubo});
+  s.add_job(squadron_job, {squadron_instances, ubo});
+  s.add_job(helmet_job, {u.helmet, ubo});
+  s.add_job(point_light_boxes, {u.moving_lights, u.story});
+  s.add_job(matrioshka_box, {u.matrioshka, ubo});
+  s.add_job(water, {ubo});
+  s.add_job(simple_rigged, {u.rigged_simple, ubo});
+  s.add_job(monster_rigged, {u.monster, ubo});
+  s.add_job(robot_depth_job, {u.robot});
+  s.add_job(helmet_depth_job, {u.helmet});
+  s.add_job(imgui, {u.imgui});
 }
@@ -5,10 +5,15 @@
 
 namespace {
 
+//
+// Transforms which don't depend on game state are folded at compile time.
+//
+
 void update_helmet(SimpleEntity& entity, const SceneGraph& scene_graph)
 {
-  const Mat4x4 world_transform = Mat4x4::Translation(Vec3(0.0f, 6.0f, 0.0f)) *
-                                 Mat4x4(Quaternion(to_rad(180.0), Vec3(1.0f, 0.0f, 0.0f))) * Mat4x4::Scale(Vec3(1.6f));
+  constexpr Mat4x4 world_transform = Mat4x4::Translation(Vec3(0.0f, 6.0f, 0.0f)) *
+                                     Mat4x4(Quaternion(to_rad(180.0), Vec3(1.0f, 0.0f, 0.0f))) *
+                                     Mat4x4::Scale(Vec3(1.6f));
   entity.recalculate_node_transforms(scene_graph, world_transform);
 }
 
@@ -33,15 +38,39 @@ Quaternion calculate_player_orientation(const Player& player)
 
 void update_robot(SimpleEntity& entity, const SceneGraph& scene_graph, const Player& player)
 {
+  constexpr Mat4x4 scale = Mat4x4::Scale(Vec3(0.5f));
+
   const Mat4x4 world_transform =
-      Mat4x4::Translation(player.position) * Mat4x4(calculate_player_orientation(player)) * Mat4x4::Scale(Vec3(0.5f));
+      Mat4x4::Translation(player.position) * Mat4x4(calculate_player_orientation(player)) * scale;
   entity.recalculate_node_transforms(scene_graph, world_transform);
 }
 
+//
+// Copies of the robot model chasing each other on a circle above the level, all of them updated in one go.
+//
+void update_squadron(InstancePool& squadron, float current_time_sec)
+{
+  const Vec3  center = Vec3(0.0f, -6.0f, 0.0f);
+  const float radius = 15.0f;
+  const float spread = to_rad(360.0f) / static_cast<float>(SDL_max(squadron.count, 1u));
+
+  for (uint32_t i = 0; i < squadron.count; ++i)
+  {
+    const float angle = (0.2f * current_time_sec) + (spread * static_cast<float>(i));
+
+    squadron.positions[i]    = center + Vec3(radius * SDL_cosf(angle), 0.0f, radius * SDL_sinf(angle));
+    squadron.orientations[i] = Quaternion(to_rad(180.0f), Vec3(1.0f, 0.0f, 0.0f)) *
+                               Quaternion(angle, Vec3(0.0f, 1.0f, 0.0f));
+  }
+
+  squadron.update();
+}
+
 void update_monster(SimpleEntity& entity, const SceneGraph& scene_graph, float current_time_sec)
 {
-  const Mat4x4 world_transform = Mat4x4::Translation(Vec3(-2.0f, 6.5f, -2.5f)) *
-                                 Mat4x4(Quaternion(to_rad(90.0), Vec3(1.0f, 0.0f, 0.0f))) * Mat4x4::Scale(Vec3(0.001f));
+  constexpr Mat4x4 world_transform = Mat4x4::Translation(Vec3(-2.0f, 6.5f, -2.5f)) *
+                                     Mat4x4(Quaternion(to_rad(90.0), Vec3(1.0f, 0.0f, 0.0f))) *
+                                     Mat4x4::Scale(Vec3(0.001f));
 
   entity.animate(scene_graph, current_time_sec);
   entity.recalculate_node_transforms(scene_graph, world_transform);
@@ -49,8 +78,9 @@ void update_monster(SimpleEntity& entity, const SceneGraph& scene_graph, float c
 
 void update_rigged_simple(SimpleEntity& entity, const SceneGraph& scene_graph, float current_time_sec)
 {
-  const Mat4x4 world_transform = Mat4x4::Translation(Vec3(-5.0f, 6.0f, 0.0f)) *
-                                 Mat4x4(Quaternion(to_rad(90.0), Vec3(1.0f, 0.0f, 0.0f))) * Mat4x4::Scale(Vec3(0.5f));
+  constexpr Mat4x4 world_transform = Mat4x4::Translation(Vec3(-5.0f, 6.0f, 0.0f)) *
+                                     Mat4x4(Quaternion(to_rad(90.0), Vec3(1.0f, 0.0f, 0.0f))) *
+                                     Mat4x4::Scale(Vec3(0.5f));
 
   entity.animate(scene_graph, current_time_sec);
   entity.recalculate_node_transforms(scene_graph, world_transform);
@@ -63,8 +93,9 @@ void update_moving_light(SimpleEntity& entity, const SceneGraph& scene_graph, co
                                  Quaternion(to_rad(280.0f * current_time_sec), Vec3(0.0f, 1.0f, 0.0f)) *
                                  Quaternion(to_rad(60.0f * current_time_sec), Vec3(1.0f, 0.0f, 0.0f));
 
-  const Mat4x4 world_transform =
-      Mat4x4::Translation(light_source.position.as_vec3()) * Mat4x4(orientation) * Mat4x4::Scale(Vec3(0.05f));
+  constexpr Mat4x4 scale = Mat4x4::Scale(Vec3(0.05f));
+
+  const Mat4x4 world_transform = Mat4x4::Translation(light_source.position.as_vec3()) * Mat4x4(orientation) * scale;
 
   entity.recalculate_node_transforms(scene_graph, world_transform);
   entity.color = light_source.color;
@@ -84,46 +115,48 @@ void update_matrioshka(SimpleEntity& entity, const SceneGraph& scene_graph, floa
 
 void update_orientation_axis_up(SimpleEntity& entity, const SceneGraph& scene_graph, const Player& player)
 {
-  float       rotation           = -to_rad(90.0f);
-  const Vec3  axis               = Vec3(0.0f, 1.0f, 0.0f);
-  const float translation_offset = 2.0f;
-  const Vec3  trans_offset       = Vec3(translation_offset, 0.0f, 0.0f);
+  constexpr float  rotation           = -to_rad(90.0f);
+  constexpr Vec3   axis               = Vec3(0.0f, 1.0f, 0.0f);
+  constexpr float  translation_offset = 2.0f;
+  constexpr Vec3   trans_offset       = Vec3(translation_offset, 0.0f, 0.0f);
+  constexpr Mat4x4 rotation_scale     = Mat4x4(Quaternion(rotation, axis)) * Mat4x4::Scale(Vec3(1.0f, 1.0f, 0.5f));
 
-  const Mat4x4 world_transform = Mat4x4::Translation(player.position + trans_offset) *
-                                 Mat4x4(Quaternion(rotation, axis)) * Mat4x4::Scale(Vec3(1.0f, 1.0f, 0.5f));
+  const Mat4x4 world_transform = Mat4x4::Translation(player.position + trans_offset) * rotation_scale;
   entity.recalculate_node_transforms(scene_graph, world_transform);
 }
 
 void update_orientation_axis_left(SimpleEntity& entity, const SceneGraph& scene_graph, const Player& player)
 {
-  const float rotation           = -to_rad(90.0f);
-  const Vec3  axis               = Vec3(1.0f, 0.0f, 0.0f);
-  const float translation_offset = 2.0f;
-  const Vec3  trans_offset       = Vec3(0.0f, -translation_offset, 0.0f);
+  constexpr float  rotation           = -to_rad(90.0f);
+  constexpr Vec3   axis               = Vec3(1.0f, 0.0f, 0.0f);
+  constexpr float  translation_offset = 2.0f;
+  constexpr Vec3   trans_offset       = Vec3(0.0f, -translation_offset, 0.0f);
+  constexpr Mat4x4 rotation_scale     = Mat4x4(Quaternion(rotation, axis)) * Mat4x4::Scale(Vec3(1.0f, 1.0f, 0.5f));
 
-  const Mat4x4 world_transform = Mat4x4::Translation(player.position + trans_offset) *
-                                 Mat4x4(Quaternion(rotation, axis)) * Mat4x4::Scale(Vec3(1.0f, 1.0f, 0.5f));
+  const Mat4x4 world_transform = Mat4x4::Translation(player.position + trans_offset) * rotation_scale;
   entity.recalculate_node_transforms(scene_graph, world_transform);
 }
 
 void update_orientation_axis_right(SimpleEntity& entity, const SceneGraph& scene_graph, const Player& player)
 {
-  const float rotation           = to_rad(180.0f);
-  const Vec3  axis               = Vec3(1.0f, 0.0f, 0.0f);
-  const float translation_offset = 2.0f;
-  const Vec3  trans_offset       = Vec3(0.0f, 0.0f, translation_offset);
+  constexpr float  rotation           = to_rad(180.0f);
+  constexpr Vec3   axis               = Vec3(1.0f, 0.0f, 0.0f);
+  constexpr float  translation_offset = 2.0f;
+  constexpr Vec3   trans_offset       = Vec3(0.0f, 0.0f, translation_offset);
+  constexpr Mat4x4 rotation_scale     = Mat4x4(Quaternion(rotation, axis)) * Mat4x4::Scale(Vec3(1.0f, 1.0f, 0.5f));
 
-  const Mat4x4 world_transform = Mat4x4::Translation(player.position + trans_offset) *
-                                 Mat4x4(Quaternion(rotation, axis)) * Mat4x4::Scale(Vec3(1.0f, 1.0f, 0.5f));
+  const Mat4x4 world_transform = Mat4x4::Translation(player.position + trans_offset) * rotation_scale;
   entity.recalculate_node_transforms(scene_graph, world_transform);
 }
 
 struct UpdateJob
 {
   UpdateJob(JobContext& ctx, uint32_t thread_id, const char* name)
-      : game(*ctx.game)
+      : engine(*ctx.engine)
+      , game(*ctx.game)
       , level(game.level)
       , perf_event(game.update_profiler, name, thread_id)
+      , thread_id(thread_id)
   {
   }
 
@@ -132,9 +165,17 @@ struct UpdateJob
   {
   }
 
+  // results placed here can be read by render jobs of the same frame without copying
+  [[nodiscard]] FrameArena& frame_allocator() const
+  {
+    return engine.job_system.frame_allocator(thread_id, game.image_index);
+  }
+
+  Engine&         engine;
   Game&           game;
   ExampleLevel&   level;
   ScopedPerfEvent perf_event;
+  uint32_t        thread_id;
 };
 
 void helmet_job(ThreadJobData tjd)
@@ -149,6 +190,12 @@ void robot_job(ThreadJobData tjd)
   update_robot(ctx.level.robot_entity, ctx.game.materials.robot, ctx.game.player);
 }
 
+void squadron_job(ThreadJobData tjd)
+{
+  UpdateJob ctx(tjd, __FUNCTION__);
+  update_squadron(ctx.level.squadron, ctx.game.current_time_sec);
+}
+
 void monster_job(ThreadJobData tjd)
 {
   UpdateJob ctx(tjd, __FUNCTION__);
@@ -252,7 +299,29 @@ void gui_lines_generation_job(ThreadJobData tjd)
   update.debug                    = ctx.game.DEBUG_VEC2;
   update(ctx.game.level.lines_renderer);
 
-  ctx.game.level.lines_renderer.cache_lines(tjd.allocator);
+  ctx.game.level.lines_renderer.cache_lines(tjd.allocator, ctx.frame_allocator());
+}
+
+void gui_text_generation_job(ThreadJobData tjd)
+{
+  UpdateJob ctx(tjd, __FUNCTION__);
+
+  const GuiTextGenerator height_gen = {
+      .player_y_location_meters = -(2.0f - ctx.game.player.position.y),
+      .camera_x_pitch_radians   = ctx.game.player.get_camera().angle,
+      .camera_y_pitch_radians   = ctx.game.player.get_camera().angle,
+      .screen_extent2D          = ctx.engine.extent2D,
+  };
+
+  const GuiTextGenerator tilt_gen = {
+      .player_y_location_meters = -(2.0f - ctx.game.player.position.y),
+      .camera_x_pitch_radians   = ctx.game.player.get_camera().updown_angle,
+      .camera_y_pitch_radians   = ctx.game.player.get_camera().updown_angle,
+      .screen_extent2D          = ctx.engine.extent2D,
+  };
+
+  ctx.level.height_ruler_texts = height_gen.height_ruler(ctx.frame_allocator());
+  ctx.level.tilt_ruler_texts   = tilt_gen.tilt_ruler(ctx.frame_allocator());
 }
 
 void recalculate_csm_matrices(ThreadJobData tjd)
@@ -269,21 +338,29 @@ void story_job(ThreadJobData tjd)
   ctx.game.story.tick(ctx.game.player, tjd.allocator);
 }
 
+void imgui_draw_data_job(ThreadJobData tjd)
+{
+  UpdateJob ctx(tjd, __FUNCTION__);
+  ImGui::Render();
+}
+
 } // namespace
 
-Job* ExampleLevel::copy_update_jobs(Job* dst)
+ExampleLevel::UpdateJobs ExampleLevel::add_update_jobs(JobScheduler& scheduler)
 {
-  const Job jobs[] = {
-      monster_job,
-      helmet_job,
-      robot_job,
-      rigged_simple_job,
-      moving_lights_job,
-      matrioshka_job,
-      orientation_axis_job,
-      gui_lines_generation_job,
-      recalculate_csm_matrices,
-      story_job,
+  return {
+      .monster          = scheduler.add_job(monster_job),
+      .helmet           = scheduler.add_job(helmet_job),
+      .robot            = scheduler.add_job(robot_job),
+      .squadron         = scheduler.add_job(squadron_job),
+      .rigged_simple    = scheduler.add_job(rigged_simple_job),
+      .moving_lights    = scheduler.add_job(moving_lights_job),
+      .matrioshka       = scheduler.add_job(matrioshka_job),
+      .orientation_axis = scheduler.add_job(orientation_axis_job),
+      .gui_lines        = scheduler.add_job(gui_lines_generation_job),
+      .gui_text         = scheduler.add_job(gui_text_generation_job),
+      .csm_matrices     = scheduler.add_job(recalculate_csm_matrices),
+      .story            = scheduler.add_job(story_job),
+      .imgui            = scheduler.add_job(imgui_draw_data_job),
   };
-  return std::copy(jobs, &jobs[SDL_arraysize(jobs)], dst);
 }
@@ -54,7 +54,7 @@ void LinesRenderer::setup(MemoryAllocator& allocator, uint32_t capacity)
 {
   lines_capacity      = capacity;
   lines               = reinterpret_cast<Line*>(allocator.Allocate(sizeof(Line) * lines_capacity));
-  position_cache      = reinterpret_cast<Vec2*>(allocator.Allocate(sizeof(Vec2) * (2 * lines_capacity)));
+  position_cache      = nullptr;
   lines_size          = 0;
   position_cache_size = 0;
 }
@@ -62,14 +62,14 @@ void LinesRenderer::setup(MemoryAllocator& allocator, uint32_t capacity)
 void LinesRenderer::teardown(MemoryAllocator& allocator)
 {
   allocator.Free(lines, sizeof(Line) * lines_capacity);
-  allocator.Free(position_cache, sizeof(Vec2) * (2 * lines_capacity));
 }
 
-void LinesRenderer::cache_lines(MemoryAllocator& allocator)
+void LinesRenderer::cache_lines(MemoryAllocator& scratch, MemoryAllocator& cache_allocator)
 {
-  Line* tmp = reinterpret_cast<Line*>(allocator.Allocate(sizeof(Line) * lines_size));
+  Line* tmp = reinterpret_cast<Line*>(scratch.Allocate(sizeof(Line) * lines_size));
 
   merge_sort(lines, lines + lines_size, tmp);
+  position_cache = reinterpret_cast<Vec2*>(cache_allocator.Allocate(sizeof(Vec2) * (2 * lines_size)));
 
   auto acc_fcn = [](Vec2* a, const Line& line) {
     *a++ = line.origin;
@@ -80,7 +80,14 @@ void LinesRenderer::cache_lines(MemoryAllocator& allocator)
   position_cache_size =
       std::distance(position_cache, std::accumulate(lines, lines + lines_size, position_cache, acc_fcn));
 
-  allocator.Free(tmp, sizeof(Line) * lines_size);
+  scratch.Free(tmp, sizeof(Line) * lines_size);
+}
+
+void LinesRenderer::release_cache(MemoryAllocator& cache_allocator)
+{
+  cache_allocator.Free(position_cache, sizeof(Vec2) * position_cache_size);
+  position_cache      = nullptr;
+  position_cache_size = 0;
 }
 
 void LinesRenderer::render(VkCommandBuffer cmd, VkPipelineLayout layout, uint32_t base_offset) const
@@ -120,5 +127,6 @@ void LinesRenderer::render(VkCommandBuffer cmd, VkPipelineLayout layout, uint32_
 void LinesRenderer::reset()
 {
   lines_size          = 0;
+  position_cache      = nullptr;
   position_cache_size = 0;
 }
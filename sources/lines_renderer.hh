@@ -18,8 +18,14 @@ struct LinesRenderer
 {
   void setup(MemoryAllocator& allocator, uint32_t capacity);
   void teardown(MemoryAllocator& allocator);
-  void cache_lines(MemoryAllocator& allocator);
-  //void cache_lines(Line* tmp_helper_space);
+
+  //
+  // Position cache is placed in "cache_allocator" and lives as long as that memory does.
+  // Lines regenerated every frame use the frame arena, so the cache can be read directly by the gpu upload job.
+  // Caches placed in a persistent allocator have to be given back with "release_cache".
+  //
+  void cache_lines(MemoryAllocator& scratch, MemoryAllocator& cache_allocator);
+  void release_cache(MemoryAllocator& cache_allocator);
   void reset();
   void render(VkCommandBuffer cmd, VkPipelineLayout layout, uint32_t base_offset = 0) const;
 
@@ -17,6 +17,32 @@ bool IsInArgumentsList(const char** argv, const uint32_t argc, const char* searc
   return false;
 }
 
+const char* GetArgumentValue(const char** argv, const uint32_t argc, const char* search)
+{
+  for (uint32_t i = 1; i < (argc - 1); ++i)
+  {
+    if (0 == SDL_strcmp(argv[i], search))
+    {
+      return argv[i + 1];
+    }
+  }
+  return nullptr;
+}
+
+//
+// Main thread processes jobs too, so by default there is one worker for every other logical core.
+// "--workers N" overrides the detected count, "--workers 0" runs every job on the main thread.
+//
+uint32_t SelectWorkerThreadsCount(const char** argv, const uint32_t argc)
+{
+  const char* requested = GetArgumentValue(argv, argc, "--workers");
+  if (requested)
+  {
+    return static_cast<uint32_t>(SDL_max(SDL_strtol(requested, nullptr, 10), 0l));
+  }
+  return static_cast<uint32_t>(SDL_max(SDL_GetCPUCount() - 1, 0));
+}
+
 } // namespace
 
 int main(int argc, const char* argv[])
@@ -31,13 +57,23 @@ int main(int argc, const char* argv[])
 
   // ----- DEFAULT CONFIGS -----
   engine->MSAA_SAMPLE_COUNT            = VK_SAMPLE_COUNT_2_BIT;
+  engine->WORKER_THREADS_COUNT         = SelectWorkerThreadsCount(argv, argc);
+  engine->USE_BAKED_ASSETS             = not IsInArgumentsList(argv, argc, "--glb_assets");
   constexpr int desired_frames_per_sec = 60;
   // ---------------------------
 
   HierarchicalAllocator allocator;
   engine->generic_allocator = &allocator;
+  SDL_Log("Worker threads: %u", engine->WORKER_THREADS_COUNT);
+
+  // "--dry_run" together with "--glb_assets" compares startup with and without baked assets
+  const uint64_t startup_ticks = SDL_GetPerformanceCounter();
   engine->startup(IsInArgumentsList(argv, argc, "--validate"));
   game->startup(*engine);
+  SDL_Log("Startup took %.2f ms (%s assets)",
+          1000.0f * (static_cast<float>(SDL_GetPerformanceCounter() - startup_ticks) /
+                     static_cast<float>(SDL_GetPerformanceFrequency())),
+          engine->USE_BAKED_ASSETS ? "baked" : "glb");
 
   if (not IsInArgumentsList(argv, argc, "--dry_run"))
   {
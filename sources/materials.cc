@@ -1,5 +1,6 @@
 #include "materials.hh"
 #include "engine/cubemap.hh"
+#include "engine/asset_pipeline.hh"
 #include "game_constants.hh"
 #include "imgui.h"
 #include "terrain_as_a_function.hh"
@@ -69,23 +70,62 @@ void Materials::setup(Engine& engine)
   imgui_font_texture = engine.load_texture(ImguiFontSurface().surface);
 
   {
-    GpuMemoryBlock& block = engine.memory_blocks.host_coherent;
+    GpuMemoryBlock&     block     = engine.memory_blocks.host_coherent;
+    GpuMemoryAllocator& allocator = block.allocator;
     for (int i = 0; i < SWAPCHAIN_IMAGES_COUNT; ++i)
     {
-      imgui_vertex_buffer_offsets[i] = block.allocate_aligned(IMGUI_VERTEX_BUFFER_CAPACITY_BYTES);
-      imgui_index_buffer_offsets[i]  = block.allocate_aligned(IMGUI_INDEX_BUFFER_CAPACITY_BYTES);
+      imgui_vertex_buffer_offsets[i] = allocator.allocate_bytes(IMGUI_VERTEX_BUFFER_CAPACITY_BYTES, block.alignment);
+      imgui_index_buffer_offsets[i]  = allocator.allocate_bytes(IMGUI_INDEX_BUFFER_CAPACITY_BYTES, block.alignment);
     }
   }
 
-  rock         = loadGLB(engine, "../assets/rock.glb");
-  helmet       = loadGLB(engine, "../assets/DamagedHelmet.glb");
-  robot        = loadGLB(engine, "../assets/su-47.glb");
-  monster      = loadGLB(engine, "../assets/Monster.glb");
-  box          = loadGLB(engine, "../assets/Box.glb");
-  animatedBox  = loadGLB(engine, "../assets/BoxAnimated.glb");
-  riggedSimple = loadGLB(engine, "../assets/RiggedSimple.glb");
-  lil_arrow    = loadGLB(engine, "../assets/lil_arrow.glb");
+  {
+    AssetPipeline pipeline = {};
+    pipeline.setup(*engine.generic_allocator, engine.USE_BAKED_ASSETS);
+
+    pipeline.add_scene(rock, "../assets/rock.glb");
+    pipeline.add_scene(helmet, "../assets/DamagedHelmet.glb");
+    pipeline.add_scene(robot, "../assets/su-47.glb");
+    pipeline.add_scene(monster, "../assets/Monster.glb");
+    pipeline.add_scene(box, "../assets/Box.glb");
+    pipeline.add_scene(animatedBox, "../assets/BoxAnimated.glb");
+    pipeline.add_scene(riggedSimple, "../assets/RiggedSimple.glb");
+    pipeline.add_scene(lil_arrow, "../assets/lil_arrow.glb");
+
+    pipeline.add_texture(lucida_sans_sdf_image, "../assets/lucida_sans_sdf.png");
+    pipeline.add_texture(sand_albedo, "../assets/pbr_sand/sand_albedo.jpg");
+    pipeline.add_texture(sand_ambient_occlusion, "../assets/pbr_sand/sand_ambient_occlusion.jpg");
+    pipeline.add_texture(sand_metallic_roughness, "../assets/pbr_sand/sand_metallic_roughness.jpg");
+    pipeline.add_texture(sand_normal, "../assets/pbr_sand/sand_normal.jpg");
+    pipeline.add_texture(sand_emissive, "../assets/pbr_sand/sand_emissive.jpg");
+    pipeline.add_texture(water_normal, "../assets/pbr_water/normal_map.jpg");
+
+    pipeline.decode(engine.job_system);
+    pipeline.upload(engine);
+    pipeline.teardown();
+  }
+
+  //
+  // Clips big enough to stream through the cache every frame are played from quantized keyframes. The monster clip
+  // (3 s, 169 KB) is under CompressionSettings::min_raw_size and stays raw: it's faster sampled from floats.
+  //
+  {
+    const ArrayView<Animation>& animations = monster.animations;
+    const CompressionSettings   settings   = {};
+
+    const bool compress = std::all_of(animations.begin(), animations.end(),
+                                      [&settings](const Animation& it) { return should_compress(it, settings); });
+    monster_animations  = nullptr;
 
+    if (compress and (0 < animations.count))
+    {
+      monster_animations = engine.generic_allocator->allocate<CompressedAnimation>(animations.count);
+      for (uint32_t i = 0; i < animations.count; ++i)
+        monster_animations[i].setup(*engine.generic_allocator, animations[i], settings);
+    }
+  }
+
+  // cubemap rendering uses the box scene
   {
     int cubemap_size[2] = {512, 512};
     environment_cubemap = generate_cubemap(&engine, this, "../assets/mono_lake.jpg", cubemap_size);
@@ -94,43 +134,20 @@ void Materials::setup(Engine& engine)
     brdf_lookup         = generate_brdf_lookup(&engine, cubemap_size[0]);
   }
 
-  lucida_sans_sdf_image   = engine.load_texture("../assets/lucida_sans_sdf.png");
-  sand_albedo             = engine.load_texture("../assets/pbr_sand/sand_albedo.jpg");
-  sand_ambient_occlusion  = engine.load_texture("../assets/pbr_sand/sand_ambient_occlusion.jpg");
-  sand_metallic_roughness = engine.load_texture("../assets/pbr_sand/sand_metallic_roughness.jpg");
-  sand_normal             = engine.load_texture("../assets/pbr_sand/sand_normal.jpg");
-  sand_emissive           = engine.load_texture("../assets/pbr_sand/sand_emissive.jpg");
-  water_normal            = engine.load_texture("../assets/pbr_water/normal_map.jpg");
-
   const VkDeviceSize light_sources_ubo_size     = sizeof(LightSourcesSoA);
-  const VkDeviceSize skinning_matrices_ubo_size = 64 * sizeof(Mat4x4);
+  const VkDeviceSize skinning_matrices_ubo_size = MAX_SKINNING_MATRICES * sizeof(Affine3x4);
 
   {
-    GpuMemoryBlock& block = engine.memory_blocks.host_coherent_ubo;
-
-    block.allocate_aligned_ranged(pbr_dynamic_lights_ubo_offsets, SDL_arraysize(pbr_dynamic_lights_ubo_offsets),
-                                  light_sources_ubo_size);
+    GpuMemoryBlock&     block     = engine.memory_blocks.host_coherent_ubo;
+    GpuMemoryAllocator& allocator = block.allocator;
 
-    block.allocate_aligned_ranged(rig_skinning_matrices_ubo_offsets, SDL_arraysize(rig_skinning_matrices_ubo_offsets),
-                                  skinning_matrices_ubo_size);
+    allocator.allocate_bytes_ranged(cascade_view_proj_mat_ubo_offsets, SDL_arraysize(cascade_view_proj_mat_ubo_offsets),
+                                    sizeof(CascadeShadowMappingUbo), block.alignment);
 
-    block.allocate_aligned_ranged(fig_skinning_matrices_ubo_offsets, SDL_arraysize(fig_skinning_matrices_ubo_offsets),
-                                  skinning_matrices_ubo_size);
-
-    block.allocate_aligned_ranged(monster_skinning_matrices_ubo_offsets,
-                                  SDL_arraysize(monster_skinning_matrices_ubo_offsets), skinning_matrices_ubo_size);
-
-    block.allocate_aligned_ranged(cascade_view_proj_mat_ubo_offsets, SDL_arraysize(cascade_view_proj_mat_ubo_offsets),
-                                  SHADOWMAP_CASCADE_COUNT * sizeof(Mat4x4) + sizeof(Vec4));
-
-    block.allocate_aligned_ranged(frustum_planes_ubo_offsets, SDL_arraysize(frustum_planes_ubo_offsets),
-                                  6 * sizeof(Vec4));
+    allocator.allocate_bytes_ranged(frustum_planes_ubo_offsets, SDL_arraysize(frustum_planes_ubo_offsets),
+                                    6 * sizeof(Vec4), block.alignment);
   }
 
-  engine.memory_blocks.host_coherent.allocate_aligned_ranged(green_gui_rulers_buffer_offsets,
-                                                             SDL_arraysize(green_gui_rulers_buffer_offsets),
-                                                             MAX_ROBOT_GUI_LINES * sizeof(Vec2));
-
   // ----------------------------------------------------------------------------------------------
   // PBR Metallic workflow material descriptor sets
   // ----------------------------------------------------------------------------------------------
@@ -432,7 +449,7 @@ void Materials::setup(Engine& engine)
     VkDescriptorBufferInfo ubo = {
         .buffer = engine.gpu_host_coherent_ubo_memory_buffer,
         .offset = cascade_view_proj_mat_ubo_offsets[i],
-        .range  = SHADOWMAP_CASCADE_COUNT * sizeof(Mat4x4) + sizeof(Vec4),
+        .range  = sizeof(CascadeShadowMappingUbo),
     };
 
     VkWriteDescriptorSet write = {
@@ -539,31 +556,27 @@ void Materials::setup(Engine& engine)
 
     engine.memory_blocks.host_visible_transfer_source.allocator.reset();
 
-    VkDeviceSize vertices_host_offset =
-        engine.memory_blocks.host_visible_transfer_source.allocate_aligned(sizeof(vertices));
+    GpuMemoryBlock& host_block   = engine.memory_blocks.host_visible_transfer_source;
+    GpuMemoryBlock& device_block = engine.memory_blocks.device_local;
 
-    green_gui_billboard_vertex_buffer_offset = engine.memory_blocks.device_local.allocate_aligned(sizeof(vertices));
+    VkDeviceSize vertices_host_offset = host_block.allocator.allocate_bytes(sizeof(vertices), host_block.alignment);
 
-    {
-      void* data = nullptr;
-      vkMapMemory(engine.device, engine.memory_blocks.host_visible_transfer_source.memory, vertices_host_offset,
-                  sizeof(vertices), 0, &data);
-      SDL_memcpy(data, vertices, sizeof(vertices));
-      vkUnmapMemory(engine.device, engine.memory_blocks.host_visible_transfer_source.memory);
-    }
+    green_gui_billboard_vertex_buffer_offset =
+        device_block.allocator.allocate_bytes(sizeof(vertices), device_block.alignment);
+
+    SDL_memcpy(host_block.host_span<uint8_t>(vertices_host_offset, sizeof(vertices)).begin(), vertices,
+               sizeof(vertices));
+    host_block.flush(engine.device, vertices_host_offset, sizeof(vertices));
 
     VkDeviceSize cg_vertices_host_offset = 0;
 
-    cg_vertices_host_offset = engine.memory_blocks.host_visible_transfer_source.allocate_aligned(sizeof(cg_vertices));
-    regular_billboard_vertex_buffer_offset = engine.memory_blocks.device_local.allocate_aligned(sizeof(cg_vertices));
+    cg_vertices_host_offset = host_block.allocator.allocate_bytes(sizeof(cg_vertices), host_block.alignment);
+    regular_billboard_vertex_buffer_offset =
+        device_block.allocator.allocate_bytes(sizeof(cg_vertices), device_block.alignment);
 
-    {
-      void* data = nullptr;
-      vkMapMemory(engine.device, engine.memory_blocks.host_visible_transfer_source.memory, cg_vertices_host_offset,
-                  sizeof(cg_vertices), 0, &data);
-      SDL_memcpy(data, cg_vertices, sizeof(cg_vertices));
-      vkUnmapMemory(engine.device, engine.memory_blocks.host_visible_transfer_source.memory);
-    }
+    SDL_memcpy(host_block.host_span<uint8_t>(cg_vertices_host_offset, sizeof(cg_vertices)).begin(), cg_vertices,
+               sizeof(cg_vertices));
+    host_block.flush(engine.device, cg_vertices_host_offset, sizeof(cg_vertices));
 
     VkCommandBuffer cmd = VK_NULL_HANDLE;
 
@@ -648,14 +661,13 @@ void Materials::setup(Engine& engine)
   {
     const uint32_t layers = 10;
     tesselation_instances = tesellated_patches_nonindexed_calculate_count(layers);
-    tesselation_vb_offset =
-        engine.memory_blocks.host_coherent.allocator.allocate_bytes(sizeof(TerrainVertex) * tesselation_instances);
-
-    TerrainVertex* dst = nullptr;
-    vkMapMemory(engine.device, engine.memory_blocks.host_coherent.memory, tesselation_vb_offset,
-                sizeof(TerrainVertex) * tesselation_instances, 0, reinterpret_cast<void**>(&dst));
-    tesellated_patches_nonindexed_generate(layers, 100.0f, dst);
-    vkUnmapMemory(engine.device, engine.memory_blocks.host_coherent.memory);
+    tesselation_vb_offset = engine.memory_blocks.host_coherent.allocator.allocate_bytes(
+        sizeof(TerrainVertex) * tesselation_instances, engine.memory_blocks.host_coherent.alignment);
+
+    GpuMemoryBlock& block = engine.memory_blocks.host_coherent;
+    tesellated_patches_nonindexed_generate(
+        layers, 100.0f, block.host_span<TerrainVertex>(tesselation_vb_offset, tesselation_instances).begin());
+    block.flush(engine.device, tesselation_vb_offset, sizeof(TerrainVertex) * tesselation_instances);
   }
 
   {
@@ -695,5 +707,12 @@ void Materials::setup(Engine& engine)
 
 void Materials::teardown(Engine& engine)
 {
+  if (monster_animations)
+  {
+    for (uint32_t i = 0; i < monster.animations.count; ++i)
+      monster_animations[i].teardown(*engine.generic_allocator);
+    engine.generic_allocator->free(monster_animations, monster.animations.count);
+  }
+
   SDL_DestroyMutex(pbr_light_sources_cache_lock);
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "engine/compressed_animation.hh"
 #include "engine/engine.hh"
 #include "engine/gltf.hh"
 #include "engine/math.hh"
@@ -21,6 +22,15 @@ struct LightSourcesSoA
   void push(const LightSource* begin, const LightSource* end);
 };
 
+// same layout as CascadeShadowMappingUBO of the shaders, split depths of all cascades fill a single vec4
+struct CascadeShadowMappingUbo
+{
+  Mat4x4 cascade_view_proj_mat[SHADOWMAP_CASCADE_COUNT];
+  float  cascade_splits[SHADOWMAP_CASCADE_COUNT];
+};
+
+static_assert(sizeof(CascadeShadowMappingUbo) == (SHADOWMAP_CASCADE_COUNT * sizeof(Mat4x4) + sizeof(Vec4)));
+
 struct SdfChar
 {
   uint8_t  width;
@@ -68,13 +78,17 @@ struct Materials
   VkDescriptorSet cascade_view_proj_matrices_render_dset[SWAPCHAIN_IMAGES_COUNT];
 
   // ubos
-  VkDeviceSize rig_skinning_matrices_ubo_offsets[SWAPCHAIN_IMAGES_COUNT];
-  VkDeviceSize fig_skinning_matrices_ubo_offsets[SWAPCHAIN_IMAGES_COUNT];
-  VkDeviceSize monster_skinning_matrices_ubo_offsets[SWAPCHAIN_IMAGES_COUNT];
-  VkDeviceSize pbr_dynamic_lights_ubo_offsets[SWAPCHAIN_IMAGES_COUNT];
+  static constexpr uint32_t MAX_SKINNING_MATRICES = 64;
+
+  // bound through static descriptor sets, so those stay at fixed offsets
   VkDeviceSize cascade_view_proj_mat_ubo_offsets[SWAPCHAIN_IMAGES_COUNT];
   VkDeviceSize frustum_planes_ubo_offsets[SWAPCHAIN_IMAGES_COUNT];
 
+  // dynamic ubo offsets of the current frame, slices of Engine::host_coherent_ubo_ring
+  VkDeviceSize rig_skinning_matrices_ubo_offset;
+  VkDeviceSize monster_skinning_matrices_ubo_offset;
+  VkDeviceSize pbr_dynamic_lights_ubo_offset;
+
   // cascade shadow mapping
   Mat4x4 cascade_view_proj_mat[SHADOWMAP_CASCADE_COUNT];
   float  cascade_split_depths[SHADOWMAP_CASCADE_COUNT];
@@ -98,6 +112,9 @@ struct Materials
   SceneGraph rock;
   SceneGraph lil_arrow;
 
+  // one per animation of the model, nullptr when they are played raw (too short to be worth it or unsupported)
+  CompressedAnimation* monster_animations;
+
   // textures
   Texture environment_cubemap;
   Texture irradiance_cubemap;
@@ -119,7 +136,9 @@ struct Materials
   VkDeviceSize tesselation_vb_offset;
   uint32_t     tesselation_instances;
 
-  VkDeviceSize green_gui_rulers_buffer_offsets[SWAPCHAIN_IMAGES_COUNT];
+  // slices of Engine::host_coherent_ring, current frame only
+  VkDeviceSize green_gui_rulers_buffer_offset;
+  VkDeviceSize squadron_instances_offset;
 
   void setup(Engine& engine);
   void teardown(Engine& engine);
@@ -2,6 +2,18 @@
 #include <SDL2/SDL_log.h>
 #include <algorithm>
 
+void Profiler::setup(MemoryAllocator& allocator, uint32_t threads_count)
+{
+  workers       = reinterpret_cast<WorkerContext*>(allocator.Allocate(threads_count * sizeof(WorkerContext)));
+  workers_count = threads_count;
+  SDL_memset(workers, 0, threads_count * sizeof(WorkerContext));
+}
+
+void Profiler::teardown(MemoryAllocator& allocator)
+{
+  allocator.Free(workers, workers_count * sizeof(WorkerContext));
+}
+
 void Profiler::on_frame()
 {
   const uint64_t before_clear = SDL_AtomicSet(&last_marker_idx, 0);
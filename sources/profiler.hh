@@ -1,6 +1,7 @@
 #pragma once
 
 #include "engine/engine_constants.hh"
+#include "engine/memory_allocator.hh"
 #include <SDL2/SDL_atomic.h>
 #include <SDL2/SDL_stdinc.h>
 #include <SDL2/SDL_timer.h>
@@ -21,7 +22,9 @@ struct WorkerContext
 
 struct Profiler
 {
-  WorkerContext workers[WORKER_THREADS_COUNT + 1];
+  // one per job system thread, sized at runtime
+  WorkerContext* workers;
+  uint32_t       workers_count;
 
   //
   // configuration
@@ -46,6 +49,8 @@ struct Profiler
   uint32_t last_frame_markers_count;
   bool     paused;
 
+  void    setup(MemoryAllocator& allocator, uint32_t threads_count);
+  void    teardown(MemoryAllocator& allocator);
   void    on_frame();
   Marker* request_marker();
 };
@@ -22,7 +22,7 @@ void profiler_visualize(const Profiler& profiler, const char* context_name, cons
 
   ImGui::NewLine();
 
-  for (uint32_t thread_id = 0; thread_id < static_cast<uint32_t>(SDL_arraysize(profiler.workers)); ++thread_id)
+  for (uint32_t thread_id = 0; thread_id < profiler.workers_count; ++thread_id)
   {
     for(const Marker* it = markers_begin; it != markers_end; ++it)
     {
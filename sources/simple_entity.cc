@@ -1,231 +1,145 @@
 #include "simple_entity.hh"
 #include <SDL2/SDL_assert.h>
-#include <algorithm>
-
-namespace {
-
-void depth_first_node_parent_hierarchy(uint8_t* hierarchy, const Node* nodes, uint8_t parent_idx, uint8_t node_idx)
-{
-  for (int child_idx : nodes[node_idx].children)
-    depth_first_node_parent_hierarchy(hierarchy, nodes, node_idx, static_cast<uint8_t>(child_idx));
-  hierarchy[node_idx] = parent_idx;
-}
-
-void propagate_node_renderability_hierarchy(int node_idx, uint64_t& dst, const ArrayView<Node>& nodes)
-{
-  for (int child_idx : nodes[node_idx].children)
-    propagate_node_renderability_hierarchy(child_idx, dst, nodes);
-  dst |= (uint64_t(1) << static_cast<uint32_t>(node_idx));
-}
-
-void depth_first_node_transform(Mat4x4* transforms, Node* nodes, const int parent_node_idx, const int node_idx)
-{
-  transforms[node_idx] = transforms[parent_node_idx] * transforms[node_idx];
-  for (int child_idx : nodes[node_idx].children)
-    depth_first_node_transform(transforms, nodes, node_idx, child_idx);
-}
-
-//
-// https://github.com/KhronosGroup/glTF/blob/master/specification/2.0/README.md#appendix-c-spline-interpolation
-//
-
-[[nodiscard]] float hermite_cubic_spline(const Vec2& P, const Vec2& M, const float& t)
-{
-  const float a = (2.0f * P.x) + M.x + (-2.0f * P.y) + M.y;
-  const float b = (-3.0f * P.x) - (2.0f * M.x) + (3.0f * P.y) - M.y;
-  return (a * t * t * t) + (b * t * t) + (M.x * t) + P.x;
-}
-
-//
-// Keyframe data layout:
-//   Vec<DIM> in_tangent
-//   Vec<DIM> spline vertex
-//   Vec<DIM> out_tangent
-//
-void hermite_cubic_spline_interpolation(const float a_in[], const float b_in[], float result[], int dim, float t,
-                                        float total_duration)
-{
-  const float* a_spline_vertex = &a_in[dim];
-  const float* a_out_tangent   = &a_in[2 * dim];
-
-  const float* b_in_tangent    = &b_in[0];
-  const float* b_spline_vertex = &b_in[dim];
-
-  for (int i = 0; i < dim; ++i)
-  {
-    const Vec2 P = Vec2(a_spline_vertex[i], b_spline_vertex[i]);
-    const Vec2 M = Vec2(a_out_tangent[i], b_in_tangent[i]).scale(total_duration);
-    result[i]    = hermite_cubic_spline(P, M, t);
-  }
-}
-
-bool is_sampler_active(const AnimationSampler& sampler, const float& animation_time)
-{
-  return (sampler.time_frame[0] < animation_time) and (sampler.time_frame[1] > animation_time);
-}
-
-} // namespace
 
 void SimpleEntity::init(HierarchicalAllocator& allocator, const SceneGraph& model)
 {
-  const uint32_t nodes_count = static_cast<const uint32_t>(model.nodes.count);
-  SDL_assert(nodes_count < 64);
+  const uint32_t nodes_count = model.nodes.count;
 
-  node_parent_hierarchy = allocator.allocate<uint8_t>(nodes_count);
-  node_transforms       = allocator.allocate<Mat4x4>(nodes_count);
+  node_transforms = allocator.allocate<Mat4x4>(nodes_count);
+  world_space_nodes.setup(allocator, nodes_count);
+  node_renderabilities.setup(allocator, nodes_count);
+  node_anim_rotation_applicability.setup(allocator, nodes_count);
+  node_anim_translation_applicability.setup(allocator, nodes_count);
+  node_anim_scale_applicability.setup(allocator, nodes_count);
 
-  //
-  // TODO: move this to scenegraph
-  //
   for (int scene_node_idx : model.scenes[0].nodes)
   {
-    propagate_node_renderability_hierarchy(scene_node_idx, node_renderabilities, model.nodes);
+    world_space_nodes.set(scene_node_idx);
+    node_renderabilities.set(scene_node_idx);
   }
 
-  for (uint8_t i = 0; i < nodes_count; ++i)
+  // scene nodes and everything below them, parents are always visited first
+  for (int node_idx : model.node_order)
   {
-    node_parent_hierarchy[i] = i;
-  }
-
-  for (uint8_t node_idx = 0; node_idx < nodes_count; ++node_idx)
-  {
-    for (int child_idx : model.nodes[node_idx].children)
-    {
-      depth_first_node_parent_hierarchy(node_parent_hierarchy, model.nodes.data, node_idx,
-                                        static_cast<uint8_t>(child_idx));
-    }
+    const int parent_idx = model.node_parents[node_idx];
+    if ((0 <= parent_idx) and node_renderabilities.test(parent_idx))
+      node_renderabilities.set(node_idx);
   }
 
   if (model.skins.count)
   {
-    joint_matrices = allocator.allocate<Mat4x4>(static_cast<uint32_t>(model.skins[0].joints.count));
-  }
+    const int skeleton_node_idx   = model.skins[0].skeleton;
+    const int skeleton_parent_idx = model.node_parents[skeleton_node_idx];
+    world_space_nodes.set((0 <= skeleton_parent_idx) ? skeleton_parent_idx : skeleton_node_idx);
 
-  if (std::any_of(model.animations.begin(), model.animations.end(), [](const Animation& a) { return a.has_rotations; }))
-  {
-    node_rotations  = allocator.allocate<Quaternion>(static_cast<uint32_t>(model.nodes.count));
-    flags.rotations = true;
+    joint_matrices = allocator.allocate<Affine3x4>(static_cast<uint32_t>(model.skins[0].joints.count));
   }
 
-  if (std::any_of(model.animations.begin(), model.animations.end(),
-                  [](const Animation& a) { return a.has_translations; }))
+  if (model.animations.count)
   {
-    node_translations  = allocator.allocate<Vec3>(static_cast<uint32_t>(model.nodes.count));
-    flags.translations = true;
-  }
-}
+    // shared by every animation, cursors are sized for the one with the most tracks (samplers when compressed)
+    uint32_t cursors_count = 1;
+    for (const Animation& animation : model.animations)
+      cursors_count = SDL_max(cursors_count, SDL_max(animation.tracks_count, animation.samplers.count));
 
-void SimpleEntity::recalculate_node_transforms(const SceneGraph& model, const Mat4x4& world_transform)
-{
-  const ArrayView<Node>& nodes = model.nodes;
+    animation_cursors = allocator.allocate_zeroed<uint32_t>(cursors_count);
 
-  Mat4x4 transforms[64];
-  std::for_each(transforms, transforms + nodes.count, [](Mat4x4& it) { it.identity(); });
+    pose_pool.setup(allocator, nodes_count, 3);
 
-  for (int node_idx : model.scenes[0].nodes)
-  {
-    transforms[node_idx] = world_transform;
+    const Pose animated = pose_pool.acquire();
+    node_rotations      = animated.rotations;
+    node_translations   = animated.translations;
+    node_scales         = animated.scales;
+    clip_pose           = pose_pool.acquire();
+    crossfade_pose      = pose_pool.acquire();
   }
+}
 
-  if (not model.skins.empty())
-  {
-    int skeleton_node_idx           = model.skins[0].skeleton;
-    int skeleton_parent_idx         = node_parent_hierarchy[skeleton_node_idx];
-    transforms[skeleton_parent_idx] = world_transform;
-  }
+void SimpleEntity::recalculate_node_transforms(const SceneGraph& model, const Mat4x4& world_transform)
+{
+  const ArrayView<Node>& nodes       = model.nodes;
+  const uint32_t         nodes_count = nodes.count;
 
   //////////////////////////////////////////////////////////////////////////////
-  /// Apply Translations
+  /// Gather local TRS of every node (animated values take precedence),
+  /// composed in batches small enough for the stack
   //////////////////////////////////////////////////////////////////////////////
-  for (uint32_t i = 0; i < nodes.count; ++i)
-  {
-    Mat4x4 translation_matrix;
-    translation_matrix.identity();
+  constexpr uint32_t batch_size = 64;
 
-    if (flags.translations | flags.anim_translation_applicability)
-    {
-      if (node_anim_translation_applicability & (uint64_t(1) << static_cast<uint32_t>(i)))
-      {
-        translation_matrix.translate(node_translations[i]);
-      }
-      else if (nodes[i].flags.translation)
-      {
-        translation_matrix.translate(nodes[i].translation);
-      }
-    }
-    else if (nodes[i].flags.translation)
-    {
-      translation_matrix.translate(nodes[i].translation);
-    }
+  Vec3       translations[batch_size];
+  Quaternion rotations[batch_size];
+  Vec3       scales[batch_size];
 
-    transforms[i] = transforms[i] * translation_matrix;
-  }
+  Quaternion identity_rotation;
+  identity_rotation.data.w = 1.0f;
 
-  //////////////////////////////////////////////////////////////////////////////
-  /// Apply Rotations
-  //////////////////////////////////////////////////////////////////////////////
-  for (uint32_t i = 0; i < nodes.count; ++i)
+  const bool use_anim_translations = flags.anim_translation_applicability;
+  const bool use_anim_rotations    = flags.anim_rotation_applicability;
+  const bool use_anim_scales       = flags.anim_scale_applicability;
+
+  for (uint32_t batch_start = 0; batch_start < nodes_count; batch_start += batch_size)
   {
-    Mat4x4 rotation_matrix;
-    rotation_matrix.identity();
+    const uint32_t batch_count = SDL_min(batch_size, nodes_count - batch_start);
 
-    if (flags.rotations | flags.anim_translation_applicability)
-    {
-      if (node_anim_rotation_applicability & (uint64_t(1) << static_cast<uint32_t>(i)))
-      {
-        rotation_matrix = Mat4x4(node_rotations[i]);
-      }
-      else if (nodes[i].flags.rotation)
-      {
-        rotation_matrix = Mat4x4(nodes[i].rotation);
-      }
-    }
-    else if (nodes[i].flags.rotation)
+    for (uint32_t j = 0; j < batch_count; ++j)
     {
-      rotation_matrix = Mat4x4(nodes[i].rotation);
+      const uint32_t i    = batch_start + j;
+      const Node&    node = nodes[i];
+
+      if (use_anim_translations and node_anim_translation_applicability.test(i))
+        translations[j] = node_translations[i];
+      else if (node.flags.translation)
+        translations[j] = node.translation;
+      else
+        translations[j] = Vec3();
+
+      if (use_anim_rotations and node_anim_rotation_applicability.test(i))
+        rotations[j] = node_rotations[i];
+      else if (node.flags.rotation)
+        rotations[j] = node.rotation;
+      else
+        rotations[j] = identity_rotation;
+
+      if (use_anim_scales and node_anim_scale_applicability.test(i))
+        scales[j] = node_scales[i];
+      else if (node.flags.scale)
+        scales[j] = node.scale;
+      else
+        scales[j] = Vec3(1.0f);
     }
 
-    transforms[i] = transforms[i] * rotation_matrix;
+    compose_trs(translations, rotations, scales, &node_transforms[batch_start], batch_count);
   }
 
   //////////////////////////////////////////////////////////////////////////////
-  /// Apply Scaling
+  /// Scene roots (and skeleton parent) are placed in the world
   //////////////////////////////////////////////////////////////////////////////
-  for (uint32_t i = 0; i < nodes.count; ++i)
-  {
-    if (nodes[i].flags.scale)
-    {
-      Mat4x4 scale_matrix;
-      scale_matrix.identity();
-      scale_matrix.scale(nodes[i].scale);
-      transforms[i] = transforms[i] * scale_matrix;
-    }
-  }
+  world_space_nodes.for_each(
+      [&](uint32_t node_idx) { node_transforms[node_idx] = world_transform * node_transforms[node_idx]; });
 
-  for (uint8_t node_idx = 0; node_idx < nodes.count; ++node_idx)
+  //////////////////////////////////////////////////////////////////////////////
+  /// Single pass down the hierarchy, parents are already final when reached
+  //////////////////////////////////////////////////////////////////////////////
+  for (int node_idx : model.node_order)
   {
-    if (node_idx == node_parent_hierarchy[node_idx])
-    {
-      for (int child_idx : nodes[node_idx].children)
-      {
-        depth_first_node_transform(transforms, nodes.data, node_idx, child_idx);
-      }
-    }
+    const int parent_idx = model.node_parents[node_idx];
+    if (0 <= parent_idx)
+      node_transforms[node_idx] = node_transforms[parent_idx] * node_transforms[node_idx];
   }
 
-  std::copy(transforms, transforms + nodes.count, node_transforms);
-
   // recalculate_skinning_matrices
   if (joint_matrices)
   {
-    Skin skin = model.skins[0];
+    const Skin&    skin         = model.skins[0];
+    const uint32_t joints_count = skin.joints.count;
 
-    const Mat4x4 inverted_world_transform = world_transform.invert();
-    for (uint32_t joint_id = 0; joint_id < skin.joints.count; ++joint_id)
+    for (uint32_t joint_id = 0; joint_id < joints_count; ++joint_id)
     {
-      joint_matrices[joint_id] =
-          inverted_world_transform * node_transforms[skin.joints[joint_id]] * skin.inverse_bind_matrices[joint_id];
+      joint_matrices[joint_id] = Affine3x4(node_transforms[skin.joints[joint_id]]);
     }
+
+    mul_many(Affine3x4(world_transform).invert(), joint_matrices, joint_matrices, joints_count);
+    mul_many(joint_matrices, skin.inverse_bind_matrices.data, joint_matrices, joints_count);
   }
 }
 
@@ -241,102 +155,92 @@ void SimpleEntity::animate(const SceneGraph& scene_graph, float current_time_sec
     return;
   }
 
-  const Animation& animation      = scene_graph.animations.data[0];
+  const Animation& animation      = scene_graph.animations.data[animation_idx];
   const float      animation_time = current_time_sec - animation_start_time;
 
   //
   // If animation was started, but it reached the end time - then it should be stopped.
   //
 
-  if (std::none_of(
-          animation.samplers.begin(), animation.samplers.end(),
-          [animation_time](const AnimationSampler& sampler) { return sampler.time_frame[1] > animation_time; }))
+  if (animation.duration <= animation_time)
   {
     flags.anim_rotation_applicability    = false;
     flags.anim_translation_applicability = false;
+    flags.anim_scale_applicability       = false;
     flags.animation_start_time           = false;
+    flags.clip_pose_ready                = false;
+    flags.crossfade                      = false;
     animation_start_time                 = 0.0f;
-    node_anim_rotation_applicability     = 0;
-    node_anim_translation_applicability  = 0;
+    node_anim_rotation_applicability.clear();
+    node_anim_translation_applicability.clear();
+    node_anim_scale_applicability.clear();
     return;
   }
 
-  for (const AnimationChannel& channel : animation.channels)
+  //
+  // First frame of the animation. Clip is sampled on top of the rest pose, so nodes targeted by channels which
+  // did not start yet look the same as if they weren't animated at all. Nodes of the animation faded out stay
+  // applicable, they get the rest pose once the crossfade is over.
+  //
+
+  if (not flags.clip_pose_ready)
   {
-    const AnimationSampler& sampler = animation.samplers[channel.sampler_idx];
+    rest_pose(scene_graph, clip_pose);
+    SDL_memset(animation_cursors, 0, sizeof(uint32_t) * SDL_max(animation.tracks_count, animation.samplers.count));
 
-    if (not is_sampler_active(sampler, animation_time))
+    for (const AnimationChannel& channel : animation.channels)
     {
-      continue;
+      if (AnimationChannel::Path::Rotation == channel.target_path)
+        node_anim_rotation_applicability.set(channel.target_node_idx);
+      else if (AnimationChannel::Path::Translation == channel.target_path)
+        node_anim_translation_applicability.set(channel.target_node_idx);
+      else
+        node_anim_scale_applicability.set(channel.target_node_idx);
     }
 
-    int keyframe_upper = std::distance(
-        sampler.times, std::lower_bound(sampler.times, sampler.times + sampler.keyframes_count, animation_time));
-    int keyframe_lower = keyframe_upper - 1;
+    flags.anim_rotation_applicability    = flags.anim_rotation_applicability or animation.has_rotations;
+    flags.anim_translation_applicability = flags.anim_translation_applicability or animation.has_translations;
+    flags.anim_scale_applicability       = flags.anim_scale_applicability or animation.has_scales;
+    flags.clip_pose_ready                = true;
+  }
 
-    float time_between_keyframes = sampler.times[keyframe_upper] - sampler.times[keyframe_lower];
-    float keyframe_uniform_time  = (animation_time - sampler.times[keyframe_lower]) / time_between_keyframes;
+  if (compressed_animations)
+    sample_compressed_animation(compressed_animations[animation_idx], animation_time, animation_cursors, clip_pose);
+  else
+    sample_animation(animation, animation_time, animation_cursors, clip_pose);
 
-    if (AnimationChannel::Path::Rotation == channel.target_path)
-    {
-      if (not flags.anim_rotation_applicability)
-      {
-        std::fill(node_rotations, node_rotations + scene_graph.nodes.count, Quaternion());
-        flags.anim_rotation_applicability = true;
-      }
-
-      node_anim_rotation_applicability |= (uint64_t(1) << static_cast<uint64_t>(channel.target_node_idx));
-
-      if (AnimationSampler::Interpolation::Linear == sampler.interpolation)
-      {
-        const Vec4* samples = reinterpret_cast<Vec4*>(sampler.values);
-        const Vec4& a       = samples[keyframe_lower];
-        const Vec4& b       = samples[keyframe_upper];
-
-        Vec4* c = reinterpret_cast<Vec4*>(&node_rotations[channel.target_node_idx].data.x);
-
-        *c = a.lerp(b, keyframe_uniform_time).normalize();
-      }
-      else if (AnimationSampler::Interpolation::CubicSpline == sampler.interpolation)
-      {
-        float* a = &sampler.values[3 * 4 * keyframe_lower];
-        float* b = &sampler.values[3 * 4 * keyframe_upper];
-        float* c = &node_rotations[channel.target_node_idx].data.x;
-
-        hermite_cubic_spline_interpolation(a, b, c, 4, keyframe_uniform_time,
-                                           sampler.time_frame[1] - sampler.time_frame[0]);
-
-        Vec4* c_as_vec4 = reinterpret_cast<Vec4*>(c);
-        *c_as_vec4      = c_as_vec4->normalize();
-      }
-    }
-    else if (AnimationChannel::Path::Translation == channel.target_path)
-    {
-      if (not flags.anim_translation_applicability)
-      {
-        std::fill(node_translations, node_translations + scene_graph.nodes.count, Vec3());
-        flags.anim_translation_applicability = true;
-      }
-
-      node_anim_translation_applicability |= (uint64_t(1) << static_cast<uint64_t>(channel.target_node_idx));
-
-      if (AnimationSampler::Interpolation::Linear == sampler.interpolation)
-      {
-        Vec3* a = reinterpret_cast<Vec3*>(&sampler.values[3 * keyframe_lower]);
-        Vec3* b = reinterpret_cast<Vec3*>(&sampler.values[3 * keyframe_upper]);
-        Vec3* c = reinterpret_cast<Vec3*>(&node_translations[channel.target_node_idx].x);
-
-        *c = a->lerp(*b, keyframe_uniform_time);
-      }
-      else if (AnimationSampler::Interpolation::CubicSpline == sampler.interpolation)
-      {
-        float* a = &sampler.values[3 * 3 * keyframe_lower];
-        float* b = &sampler.values[3 * 3 * keyframe_upper];
-        float* c = &node_translations[channel.target_node_idx].x;
-
-        hermite_cubic_spline_interpolation(a, b, c, 3, keyframe_uniform_time,
-                                           sampler.time_frame[1] - sampler.time_frame[0]);
-      }
-    }
+  if (flags.crossfade and (crossfade_duration <= animation_time))
+    flags.crossfade = false;
+
+  //
+  // Crossfade blends the clip over the pose frozen at the moment it started, otherwise the clip is copied as is.
+  //
+
+  const PoseLayer layers[] = {
+      {.pose = &crossfade_pose, .weight = 1.0f, .mode = PoseLayer::Mode::Override},
+      {.pose   = &clip_pose,
+       .weight = flags.crossfade ? (animation_time / crossfade_duration) : 1.0f,
+       .mode   = PoseLayer::Mode::Override},
+  };
+
+  if (flags.crossfade)
+    blend_poses(layers, 2, pose_pool.nodes_count, animated_pose());
+  else
+    blend_poses(&layers[1], 1, pose_pool.nodes_count, animated_pose());
+}
+
+void SimpleEntity::play_animation(uint32_t idx, float current_time_sec, float crossfade_duration_sec)
+{
+  // animated pose is complete only after the playing animation was sampled at least once
+  if (flags.clip_pose_ready and (0.0f < crossfade_duration_sec))
+  {
+    copy_pose(animated_pose(), crossfade_pose, pose_pool.nodes_count);
+    crossfade_duration = crossfade_duration_sec;
+    flags.crossfade    = true;
   }
+
+  animation_idx              = idx;
+  animation_start_time       = current_time_sec;
+  flags.animation_start_time = true;
+  flags.clip_pose_ready      = false;
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "engine/animation.hh"
+#include "engine/bitset.hh"
+#include "engine/compressed_animation.hh"
 #include "engine/free_list_allocator.hh"
 #include "engine/gltf.hh"
 
@@ -9,29 +12,49 @@ struct SimpleEntity
   void recalculate_node_transforms(const SceneGraph& model, const Mat4x4& world_transform);
   void animate(const SceneGraph& scene_graph, float current_time_sec);
 
+  // starts animation "idx", pose of the animation which is already playing fades out over "crossfade_duration_sec"
+  void play_animation(uint32_t idx, float current_time_sec, float crossfade_duration_sec);
+
+  [[nodiscard]] Pose animated_pose() const
+  {
+    return {node_rotations, node_translations, node_scales};
+  }
+
   // elements which will always be guaranteed to be present for entity
-  uint8_t* node_parent_hierarchy;
-  Mat4x4*  node_transforms;
-  Mat4x4*  joint_matrices;
+  Mat4x4*    node_transforms;
+  Affine3x4* joint_matrices;
+  Bitset     world_space_nodes; // scene roots and skeleton parent
 
   // initialized at first usage in animation system
   Quaternion* node_rotations;
   Vec3*       node_translations;
+  Vec3*       node_scales;
+  uint32_t*   animation_cursors; // keyframe interval of every track (or sampler, when compressed) at the last "animate"
+  PosePool    pose_pool;         // animated pose (arrays above), sampled clip and the pose faded out from
+  Pose        clip_pose;
+  Pose        crossfade_pose;
+
+  // one per animation of the model, played instead of the parsed ones when set
+  const CompressedAnimation* compressed_animations;
 
   // state
-  uint64_t node_renderabilities;
-  uint64_t node_anim_rotation_applicability;
-  uint64_t node_anim_translation_applicability;
+  Bitset   node_renderabilities;
+  Bitset   node_anim_rotation_applicability;
+  Bitset   node_anim_translation_applicability;
+  Bitset   node_anim_scale_applicability;
+  uint32_t animation_idx; // played by "animate"
   float    animation_start_time;
+  float    crossfade_duration;
   Vec4     color;
 
   struct Flags
   {
-    bool rotations : 1;
-    bool translations : 1;
     bool anim_rotation_applicability : 1;
     bool anim_translation_applicability : 1;
+    bool anim_scale_applicability : 1;
     bool animation_start_time : 1;
+    bool clip_pose_ready : 1;
+    bool crossfade : 1;
   };
 
   Flags flags;
@@ -1,26 +1,34 @@
 #define SDL_MAIN_HANDLED
+#include "../sources/engine/block_allocator.hh"
 #include "../sources/engine/free_list_allocator.hh"
+#include "../sources/engine/hierarchical_allocator.hh"
 #include <SDL2/SDL.h>
 #include <algorithm>
 
+constexpr uint32_t FREELIST_ALLOCATOR_CAPACITY_BYTES = 256;
+
 void print_as_offset(FreeListAllocator* allocator, uint8_t* ptr)
 {
   SDL_Log("%u", static_cast<uint32_t>(ptr - allocator->pool));
 }
 
-void print_freelist(FreeListAllocator* allocator)
+void print_blocks(const FreeListAllocator* allocator)
 {
   SDL_Log("BEGIN");
-  FreeListAllocator::Node* current = allocator->head.next;
-  while (current)
-  {
-    SDL_Log("offset: %u, size: %u", static_cast<uint32_t>(reinterpret_cast<uint8_t*>(current) - allocator->pool),
-            current->size);
-    current = current->next;
-  }
+  allocator->for_each_block([allocator](const uint8_t* begin, uint64_t size, bool is_free) {
+    SDL_Log("offset: %u, size: %u, %s", static_cast<uint32_t>(begin - allocator->pool), static_cast<uint32_t>(size),
+            is_free ? "free" : "used");
+  });
   SDL_Log("END");
 }
 
+uint32_t count_blocks(const FreeListAllocator* allocator)
+{
+  uint32_t result = 0;
+  allocator->for_each_block([&result](const uint8_t*, uint64_t, bool) { result += 1; });
+  return result;
+}
+
 template <typename T> bool is_memory_zeroed(const T* begin, const T* end)
 {
   return std::none_of(begin, end, [](const T& elem) { return T(0) != elem; });
@@ -72,13 +80,15 @@ void validate(const Allocation* begin, const Allocation* end)
   }
 }
 
-int main()
+void test_free_list()
 {
-  SDL_Log("INITIAL SIZE: %u", FreeListAllocator::FREELIST_ALLOCATOR_CAPACITY_BYTES);
-  FreeListAllocator* allocator = reinterpret_cast<FreeListAllocator*>(SDL_calloc(1, sizeof(FreeListAllocator)));
-  SDL_assert(is_memory_zeroed(allocator->pool, allocator->pool + FreeListAllocator::FREELIST_ALLOCATOR_CAPACITY_BYTES));
+  SDL_Log("INITIAL SIZE: %u", FREELIST_ALLOCATOR_CAPACITY_BYTES);
+  FreeListAllocator* allocator = new FreeListAllocator(FREELIST_ALLOCATOR_CAPACITY_BYTES);
+
+  // pool comes straight from the heap, everything past the first free block header is expected to be zeroed below
+  SDL_memset(allocator->pool + sizeof(FreeListAllocator::Block), 0,
+             FREELIST_ALLOCATOR_CAPACITY_BYTES - sizeof(FreeListAllocator::Block));
 
-  allocator->init();
   constexpr uint32_t CAPACITY = 0x02;
 
   Allocation allocs[CAPACITY] = {};
@@ -93,14 +103,14 @@ int main()
   {
     Allocation& a = allocs[i];
     SDL_Log("Allocating %u bytes and filling memory with 0x%X", a.size, i + 1);
-    a.ptr = allocator->allocate<uint8_t>(a.size);
+    a.ptr = reinterpret_cast<uint8_t*>(allocator->Allocate(a.size));
     validate(allocs, &allocs[i + 1]);
     SDL_assert(is_memory_zeroed(a.ptr, a.ptr + a.size));
     std::fill(a.ptr, a.ptr + a.size, i + 1);
   }
   SDL_Log("Allocating memory ... DONE");
 
-  print_mem(allocator->pool, FreeListAllocator::FREELIST_ALLOCATOR_CAPACITY_BYTES);
+  print_mem(allocator->pool, FREELIST_ALLOCATOR_CAPACITY_BYTES);
 
   for (uint32_t i = 0; i < CAPACITY / 2; i += 2)
   {
@@ -112,16 +122,680 @@ int main()
   {
     SDL_assert(same_value_in_memory(a.ptr, a.ptr + a.size));
     std::fill(a.ptr, a.ptr + a.size, 0u);
-    allocator->free(a.ptr, a.size);
+    allocator->Free(a.ptr, a.size);
   }
   SDL_Log("Freeing memory ... DONE");
 
-  print_mem(allocator->pool, FreeListAllocator::FREELIST_ALLOCATOR_CAPACITY_BYTES);
+  print_mem(allocator->pool, FREELIST_ALLOCATOR_CAPACITY_BYTES);
+
+  print_blocks(allocator);
+
+  // everything coalesced back into a single free block spanning the whole pool
+  const FreeListAllocator::Block* first = reinterpret_cast<const FreeListAllocator::Block*>(allocator->pool);
+  SDL_assert(1 == count_blocks(allocator));
+  SDL_assert(first->is_free());
+  SDL_assert(FREELIST_ALLOCATOR_CAPACITY_BYTES == first->size());
+
+  delete allocator;
+}
+uint32_t next_random(uint32_t& state, uint32_t max)
+{
+  state = state * 1664525u + 1013904223u;
+  return (state >> 8) % max;
+}
+
+// sizes spread evenly over powers of two, from 16 bytes up to "max_log2"
+uint32_t random_size(uint32_t& state, uint32_t max_log2)
+{
+  const uint32_t log2 = 4 + next_random(state, max_log2 - 3);
+  return (1u << log2) + next_random(state, 1u << log2);
+}
+
+//
+// Random allocations and frees. Each allocation is filled with its own value which has to survive until it's freed.
+//
+void test_free_list_random()
+{
+  constexpr uint32_t MAX_LIVE = 512;
+  FreeListAllocator  allocator(1024 * 1024);
+  Allocation         live[MAX_LIVE] = {};
+  uint32_t           live_count     = 0;
+  uint32_t           state          = 42;
+
+  for (uint32_t iteration = 0; iteration < 20000; ++iteration)
+  {
+    const bool do_allocate = (0 == live_count) or ((MAX_LIVE != live_count) and (0 == next_random(state, 2)));
+    if (do_allocate)
+    {
+      Allocation& a = live[live_count];
+      a.size        = random_size(state, 11);
+      a.ptr         = reinterpret_cast<uint8_t*>(allocator.Allocate(a.size));
+      SDL_assert(0 == (reinterpret_cast<uintptr_t>(a.ptr) % FreeListAllocator::ALIGNMENT));
+      std::fill(a.ptr, a.ptr + a.size, static_cast<uint8_t>(iteration));
+      live_count += 1;
+    }
+    else
+    {
+      const uint32_t idx = next_random(state, live_count);
+      Allocation&    a   = live[idx];
+      SDL_assert(same_value_in_memory(a.ptr, a.ptr + a.size));
+      allocator.Free(a.ptr, a.size);
+      a = live[--live_count];
+    }
+
+    if (0 == (iteration % 1000))
+      validate(live, live + live_count);
+  }
+
+  for (uint32_t i = 0; i < live_count; ++i)
+  {
+    SDL_assert(same_value_in_memory(live[i].ptr, live[i].ptr + live[i].size));
+    allocator.Free(live[i].ptr, live[i].size);
+  }
+
+  SDL_assert(1 == count_blocks(&allocator));
+}
+
+void test_free_list_reallocate()
+{
+  FreeListAllocator allocator(4096);
+
+  // blocks are cut from the end of the pool, so "b" ends up right before "a"
+  uint8_t* a = reinterpret_cast<uint8_t*>(allocator.Allocate(100));
+  uint8_t* b = reinterpret_cast<uint8_t*>(allocator.Allocate(100));
+  SDL_assert(b < a);
+  std::fill(b, b + 100, 0xBB);
+
+  // shrinking always stays in place
+  SDL_assert(b == allocator.Reallocate(b, 40));
+  SDL_assert(same_value_in_memory(b, b + 40));
+
+  // can't grow in place while "a" is next to it
+  uint8_t* moved = reinterpret_cast<uint8_t*>(allocator.Reallocate(b, 200));
+  SDL_assert(moved != b);
+  SDL_assert(same_value_in_memory(moved, moved + 40));
+  std::fill(moved, moved + 200, 0xCC);
+
+  // with "a" gone the block in front of it absorbs the free neighbour
+  uint8_t* c = reinterpret_cast<uint8_t*>(allocator.Allocate(64));
+  allocator.Free(a, 100);
+  allocator.Free(c, 64);
+  uint8_t* d = reinterpret_cast<uint8_t*>(allocator.Allocate(100));
+  std::fill(d, d + 100, 0xDD);
+  uint8_t* e = reinterpret_cast<uint8_t*>(allocator.Allocate(32));
+  allocator.Free(d, 100);
+  SDL_assert(e == allocator.Reallocate(e, 120));
+
+  allocator.Free(e, 120);
+  allocator.Free(moved, 200);
+  SDL_assert(1 == count_blocks(&allocator));
+}
+
+SDL_AssertState ignore_assertion(const SDL_AssertData*, void*)
+{
+  return SDL_ASSERTION_IGNORE;
+}
+
+//
+// Growing past what the pool has left fails like realloc: nullptr and the old block still valid, content included.
+//
+void test_free_list_reallocate_out_of_memory()
+{
+  FreeListAllocator allocator(4096);
+
+  uint8_t* a = reinterpret_cast<uint8_t*>(allocator.Allocate(100));
+  uint8_t* b = reinterpret_cast<uint8_t*>(allocator.Allocate(100));
+  std::fill(b, b + 100, 0xBB);
+
+  SDL_SetAssertionHandler(ignore_assertion, nullptr);
+  void* grown = allocator.Reallocate(b, 8192);
+  SDL_SetAssertionHandler(nullptr, nullptr);
+
+  SDL_assert(nullptr == grown);
+  SDL_assert(same_value_in_memory(b, b + 100));
+  SDL_assert(3 == count_blocks(&allocator));
+
+  allocator.Free(b, 100);
+  allocator.Free(a, 100);
+  SDL_assert(1 == count_blocks(&allocator));
+}
+
+//
+// Churn over a live set of mixed size allocations. Throughput is compared against the C heap,
+// fragmentation is reported as the part of free memory which is NOT in the largest free block.
+//
+void benchmark_free_list()
+{
+  constexpr uint32_t MAX_LIVE   = 2048;
+  constexpr uint32_t OPERATIONS = 1000000;
+
+  auto to_ns = [](uint64_t ticks) {
+    return 1000000000.0 * static_cast<double>(ticks) / static_cast<double>(SDL_GetPerformanceFrequency());
+  };
 
-  SDL_assert(is_memory_zeroed(allocator->pool + sizeof(FreeListAllocator::Node), allocator->pool + FreeListAllocator::FREELIST_ALLOCATOR_CAPACITY_BYTES));
-  SDL_assert(reinterpret_cast<uint8_t*>(allocator->head.next) == allocator->pool);
-  SDL_assert(FreeListAllocator::FREELIST_ALLOCATOR_CAPACITY_BYTES == allocator->head.next->size);
+  const uint32_t max_size_logs[] = {8, 12, 14};
+
+  for (uint32_t max_size_log2 : max_size_logs)
+  {
+    FreeListAllocator allocator(64 * 1024 * 1024);
+    Allocation*       live   = reinterpret_cast<Allocation*>(SDL_malloc(MAX_LIVE * sizeof(Allocation)));
+    uint32_t          state  = 7;
+    uint32_t          count  = 0;
+    uint64_t          tlsf   = 0;
+    uint64_t          c_heap = 0;
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+      state                = 7;
+      count                = 0;
+      const uint64_t start = SDL_GetPerformanceCounter();
+
+      for (uint32_t op = 0; op < OPERATIONS; ++op)
+      {
+        if ((0 == count) or ((MAX_LIVE != count) and (0 == next_random(state, 2))))
+        {
+          Allocation& a = live[count++];
+          a.size        = random_size(state, max_size_log2);
+          a.ptr         = reinterpret_cast<uint8_t*>((0 == pass) ? allocator.Allocate(a.size) : SDL_malloc(a.size));
+        }
+        else
+        {
+          Allocation& a = live[next_random(state, count)];
+          if (0 == pass)
+            allocator.Free(a.ptr, a.size);
+          else
+            SDL_free(a.ptr);
+          a = live[--count];
+        }
+      }
+
+      ((0 == pass) ? tlsf : c_heap) = SDL_GetPerformanceCounter() - start;
+
+      if (0 == pass)
+      {
+        uint64_t free_bytes   = 0;
+        uint64_t largest_free = 0;
+        uint32_t free_blocks  = 0;
+        allocator.for_each_block([&](const uint8_t*, uint64_t size, bool is_free) {
+          if (is_free)
+          {
+            free_bytes += size;
+            largest_free = SDL_max(largest_free, size);
+            free_blocks += 1;
+          }
+        });
+        SDL_Log("up to %5u B | %4u live, %5u free blocks, fragmentation %5.2f%%", 2u << max_size_log2, count,
+                free_blocks, 100.0 * (1.0 - static_cast<double>(largest_free) / static_cast<double>(free_bytes)));
+
+        for (uint32_t i = 0; i < count; ++i)
+          allocator.Free(live[i].ptr, live[i].size);
+      }
+      else
+      {
+        for (uint32_t i = 0; i < count; ++i)
+          SDL_free(live[i].ptr);
+      }
+    }
+
+    SDL_Log("up to %5u B | TLSF %6.1f ns / op | C heap %6.1f ns / op", 2u << max_size_log2, to_ns(tlsf) / OPERATIONS,
+            to_ns(c_heap) / OPERATIONS);
+    SDL_free(live);
+  }
+}
+
+//
+// Every block handed out has to be unique and inside of the pool, no matter the capacity.
+// Capacities cover partial last words and more than one word of the second bitmap level (above 4096 blocks).
+//
+void test_block_allocator()
+{
+  const uint32_t capacities[] = {1, 63, 64, 65, 1280, 4096, 5000};
+
+  for (uint32_t capacity : capacities)
+  {
+    BlockAllocator allocator(16, capacity);
+    uint8_t**      blocks = reinterpret_cast<uint8_t**>(SDL_malloc(capacity * sizeof(uint8_t*)));
+
+    for (uint32_t i = 0; i < capacity; ++i)
+    {
+      blocks[i] = reinterpret_cast<uint8_t*>(allocator.Allocate(16));
+      SDL_assert(allocator.m_Data <= blocks[i]);
+      SDL_assert(&allocator.m_Data[16 * capacity] > blocks[i]);
+      SDL_assert(0 == ((blocks[i] - allocator.m_Data) % 16));
+      SDL_memset(blocks[i], static_cast<int>(i & 0xFF), 16);
+    }
+
+    SDL_assert(capacity == allocator.count_used_blocks());
+
+    for (uint32_t i = 0; i < capacity; ++i)
+      SDL_assert(same_value_in_memory(blocks[i], blocks[i] + 16));
+
+    // every third block goes back and has to be handed out again
+    for (uint32_t i = 0; i < capacity; i += 3)
+      allocator.Free(blocks[i], 16);
+
+    for (uint32_t i = 0; i < capacity; i += 3)
+      blocks[i] = reinterpret_cast<uint8_t*>(allocator.Allocate(16));
+
+    SDL_assert(capacity == allocator.count_used_blocks());
+    std::sort(blocks, blocks + capacity);
+    SDL_assert(std::adjacent_find(blocks, blocks + capacity) == (blocks + capacity));
+
+    for (uint32_t i = 0; i < capacity; ++i)
+      allocator.Free(blocks[i], 16);
+
+    SDL_assert(0 == allocator.count_used_blocks());
+    SDL_free(blocks);
+  }
+}
+
+//
+// Previous implementation, testing each bit one at a time. Kept as a baseline for the benchmark.
+//
+struct LinearScanBlockAllocator
+{
+  explicit LinearScanBlockAllocator(uint32_t new_block_count)
+      : bitmaps(reinterpret_cast<uint64_t*>(SDL_calloc((new_block_count + 63) / 64, sizeof(uint64_t))))
+      , block_count(new_block_count)
+  {
+  }
+
+  ~LinearScanBlockAllocator()
+  {
+    SDL_free(bitmaps);
+  }
+
+  uint32_t allocate()
+  {
+    for (uint32_t i = 0; i < block_count; ++i)
+    {
+      uint64_t& bitmap = bitmaps[i / 64];
+      if (!(bitmap & (uint64_t(1) << (i % 64))))
+      {
+        bitmap |= (uint64_t(1) << (i % 64));
+        return i;
+      }
+    }
+    SDL_assert(false);
+    return 0;
+  }
+
+  void release(uint32_t idx)
+  {
+    bitmaps[idx / 64] &= ~(uint64_t(1) << (idx % 64));
+  }
+
+  uint64_t* bitmaps;
+  uint32_t  block_count;
+};
+
+//
+// Allocator is prefilled up to a given level with randomly scattered holes, then bursts of allocations
+// are made and released in random order. Only the bursts are timed.
+//
+void benchmark_block_allocator()
+{
+  constexpr uint32_t BLOCK_COUNT = 1280;
+  constexpr uint32_t BURST       = 32;
+  constexpr uint32_t ROUNDS      = 20000;
+  const uint32_t     fill_percentages[] = {0, 50, 90, 97};
+
+  auto to_ns = [](uint64_t ticks) {
+    return 1000000000.0 * static_cast<double>(ticks) / static_cast<double>(SDL_GetPerformanceFrequency());
+  };
+
+  for (uint32_t fill_percentage : fill_percentages)
+  {
+    BlockAllocator           allocator(64, BLOCK_COUNT);
+    LinearScanBlockAllocator baseline(BLOCK_COUNT);
+
+    // allocate everything, then give back a random subset so the free blocks are scattered
+    void*    blocks[BLOCK_COUNT];
+    uint32_t indices[BLOCK_COUNT];
+    for (uint32_t i = 0; i < BLOCK_COUNT; ++i)
+    {
+      blocks[i]  = allocator.Allocate(64);
+      indices[i] = baseline.allocate();
+    }
 
-  SDL_free(allocator);
+    uint32_t random_state = 1234;
+    auto     next_random  = [&random_state](uint32_t max) {
+      random_state = random_state * 1664525u + 1013904223u;
+      return (random_state >> 8) % max;
+    };
+
+    for (uint32_t i = BLOCK_COUNT - 1; 0 < i; --i)
+    {
+      const uint32_t j = next_random(i + 1);
+      std::swap(blocks[i], blocks[j]);
+      std::swap(indices[i], indices[j]);
+    }
+
+    const uint32_t used = (BLOCK_COUNT * fill_percentage) / 100;
+    for (uint32_t i = used; i < BLOCK_COUNT; ++i)
+    {
+      allocator.Free(blocks[i], 64);
+      baseline.release(indices[i]);
+    }
+
+    const uint32_t burst = SDL_min(BURST, BLOCK_COUNT - used);
+    uint64_t       bitmap_ticks   = 0;
+    uint64_t       baseline_ticks = 0;
+
+    for (uint32_t round = 0; round < ROUNDS; ++round)
+    {
+      const uint32_t shift = next_random(burst);
+
+      uint64_t start = SDL_GetPerformanceCounter();
+      for (uint32_t i = 0; i < burst; ++i)
+        blocks[used + i] = allocator.Allocate(64);
+      for (uint32_t i = 0; i < burst; ++i)
+        allocator.Free(blocks[used + ((i + shift) % burst)], 64);
+      bitmap_ticks += SDL_GetPerformanceCounter() - start;
+
+      start = SDL_GetPerformanceCounter();
+      for (uint32_t i = 0; i < burst; ++i)
+        indices[used + i] = baseline.allocate();
+      for (uint32_t i = 0; i < burst; ++i)
+        baseline.release(indices[used + ((i + shift) % burst)]);
+      baseline_ticks += SDL_GetPerformanceCounter() - start;
+    }
+
+    SDL_assert(used == allocator.count_used_blocks());
+
+    const double pairs = static_cast<double>(ROUNDS) * burst;
+    SDL_Log("%2u%% full | bitmap scan %7.1f ns / alloc+free | linear scan %7.1f ns / alloc+free", fill_percentage,
+            to_ns(bitmap_ticks) / pairs, to_ns(baseline_ticks) / pairs);
+  }
+}
+
+//
+// Threads allocate from the shared allocator, keep a window of live allocations and free them in random order.
+// Every other allocation is handed to the neighbouring thread which frees it, so blocks migrate between caches.
+// The same workload runs against both block tiers guarded by a single spinlock, which is what sharing
+// the allocator would take without thread caches.
+//
+
+struct LockedBlockTiers
+{
+  LockedBlockTiers()
+      : small(1024, 512)
+      , normal(10 * 1024, 512)
+      , lock(0)
+  {
+  }
+
+  void* Allocate(uint64_t size)
+  {
+    SDL_AtomicLock(&lock);
+    void* result = (1024 >= size) ? small.Allocate(size) : normal.Allocate(size);
+    SDL_AtomicUnlock(&lock);
+    return result;
+  }
+
+  void Free(void* ptr, uint64_t size)
+  {
+    SDL_AtomicLock(&lock);
+    if (1024 >= size)
+      small.Free(ptr, size);
+    else
+      normal.Free(ptr, size);
+    SDL_AtomicUnlock(&lock);
+  }
+
+  BlockAllocator small;
+  BlockAllocator normal;
+  SDL_SpinLock   lock;
+};
+
+constexpr uint32_t MT_MAX_THREADS      = 16;
+constexpr uint32_t MT_WINDOW           = 8;
+constexpr uint32_t MT_OPERATIONS       = 100000;
+constexpr uint32_t MT_HANDOFF_CAPACITY = 64;
+
+struct Handoff
+{
+  SDL_SpinLock lock;
+  Allocation   items[MT_HANDOFF_CAPACITY];
+  uint32_t     count;
+  uint8_t      padding[64];
+};
+
+HierarchicalAllocator* mt_allocator;
+LockedBlockTiers*      mt_locked;
+Handoff                mt_handoffs[MT_MAX_THREADS];
+uint32_t               mt_threads_count;
+SDL_atomic_t           mt_threads_ready;
+
+template <typename Allocator> void mt_workload(Allocator& allocator, uint32_t thread_idx)
+{
+  Allocation window[MT_WINDOW] = {};
+  uint32_t   state             = 1000 + thread_idx;
+  Handoff&   mine              = mt_handoffs[thread_idx];
+  Handoff&   neighbour         = mt_handoffs[(thread_idx + 1) % mt_threads_count];
+
+  SDL_AtomicIncRef(&mt_threads_ready);
+  while (static_cast<uint32_t>(SDL_AtomicGet(&mt_threads_ready)) < mt_threads_count)
+    SDL_Delay(0);
+
+  for (uint32_t op = 0; op < MT_OPERATIONS; ++op)
+  {
+    Allocation& slot = window[next_random(state, MT_WINDOW)];
+    if (slot.ptr)
+    {
+      SDL_assert(same_value_in_memory(slot.ptr, slot.ptr + 16));
+
+      bool handed_off = false;
+      if (op & 1)
+      {
+        SDL_AtomicLock(&neighbour.lock);
+        if (MT_HANDOFF_CAPACITY != neighbour.count)
+        {
+          neighbour.items[neighbour.count++] = slot;
+          handed_off                         = true;
+        }
+        SDL_AtomicUnlock(&neighbour.lock);
+      }
+
+      if (not handed_off)
+        allocator.Free(slot.ptr, slot.size);
+      slot.ptr = nullptr;
+    }
+    else
+    {
+      slot.size = (0 == next_random(state, 4)) ? 4096 : 256;
+      slot.ptr  = reinterpret_cast<uint8_t*>(allocator.Allocate(slot.size));
+      SDL_memset(slot.ptr, static_cast<int>(thread_idx + 1), 16);
+    }
+
+    if (0 == (op % 16))
+    {
+      SDL_AtomicLock(&mine.lock);
+      for (uint32_t i = 0; i < mine.count; ++i)
+        allocator.Free(mine.items[i].ptr, mine.items[i].size);
+      mine.count = 0;
+      SDL_AtomicUnlock(&mine.lock);
+    }
+  }
+
+  for (Allocation& a : window)
+    if (a.ptr)
+      allocator.Free(a.ptr, a.size);
+}
+
+int mt_hierarchical_thread(void* arg)
+{
+  mt_workload(*mt_allocator, static_cast<uint32_t>(reinterpret_cast<uintptr_t>(arg)));
+  mt_allocator->flush_thread_cache();
   return 0;
-}
\ No newline at end of file
+}
+
+int mt_locked_thread(void* arg)
+{
+  mt_workload(*mt_locked, static_cast<uint32_t>(reinterpret_cast<uintptr_t>(arg)));
+  return 0;
+}
+
+template <typename Allocator> uint64_t run_mt(SDL_ThreadFunction fn, Allocator& allocator)
+{
+  SDL_Thread* threads[MT_MAX_THREADS] = {};
+  SDL_AtomicSet(&mt_threads_ready, 0);
+  SDL_memset(mt_handoffs, 0, sizeof(mt_handoffs));
+
+  const uint64_t start = SDL_GetPerformanceCounter();
+  for (uint32_t i = 0; i < mt_threads_count; ++i)
+    threads[i] = SDL_CreateThread(fn, "alloc", reinterpret_cast<void*>(static_cast<uintptr_t>(i)));
+  for (uint32_t i = 0; i < mt_threads_count; ++i)
+    SDL_WaitThread(threads[i], nullptr);
+  const uint64_t ticks = SDL_GetPerformanceCounter() - start;
+
+  // whatever was handed off after the last drain
+  for (uint32_t i = 0; i < mt_threads_count; ++i)
+    for (uint32_t j = 0; j < mt_handoffs[i].count; ++j)
+      allocator.Free(mt_handoffs[i].items[j].ptr, mt_handoffs[i].items[j].size);
+
+  return ticks;
+}
+
+void benchmark_hierarchical_threads()
+{
+  const uint32_t thread_counts[] = {1, 2, 4, static_cast<uint32_t>(SDL_min(SDL_max(SDL_GetCPUCount(), 1), 16))};
+
+  auto to_ns = [](uint64_t ticks) {
+    return 1000000000.0 * static_cast<double>(ticks) / static_cast<double>(SDL_GetPerformanceFrequency());
+  };
+
+  for (uint32_t threads_count : thread_counts)
+  {
+    mt_threads_count = threads_count;
+    mt_allocator     = new HierarchicalAllocator;
+    mt_locked        = new LockedBlockTiers;
+
+    const uint64_t cached_ticks = run_mt(mt_hierarchical_thread, *mt_allocator);
+    mt_allocator->flush_thread_cache();
+    const uint64_t locked_ticks = run_mt(mt_locked_thread, *mt_locked);
+
+    // every block went back, either to the depot or to the backing allocator
+    const AllocatorStats small  = mt_allocator->block_allocator_1kb.get_stats();
+    const AllocatorStats normal = mt_allocator->block_allocator_10kb.get_stats();
+    SDL_assert(small.used_bytes == small.cached_bytes);
+    SDL_assert(normal.used_bytes == normal.cached_bytes);
+    SDL_assert(small.allocations_count == small.frees_count);
+    SDL_assert(normal.allocations_count == normal.frees_count);
+    SDL_assert(0 == mt_locked->small.count_used_blocks());
+    SDL_assert(0 == mt_locked->normal.count_used_blocks());
+
+    const double ops = static_cast<double>(threads_count) * MT_OPERATIONS;
+    SDL_Log("%2u threads | thread caches %6.1f ns / op | single lock %6.1f ns / op", threads_count,
+            to_ns(cached_ticks) / ops, to_ns(locked_ticks) / ops);
+
+    delete mt_locked;
+    delete mt_allocator;
+    mt_locked    = nullptr;
+    mt_allocator = nullptr;
+  }
+}
+
+void test_hierarchical_reallocate()
+{
+  HierarchicalAllocator allocator;
+
+  uint8_t* a = reinterpret_cast<uint8_t*>(allocator.Allocate(100));
+  std::fill(a, a + 100, 0xAA);
+
+  // still fits the 1KB block
+  SDL_assert(a == allocator.Reallocate(a, 1000));
+
+  // moves to 10KB tier and later to the free list tier, content goes along
+  uint8_t* b = reinterpret_cast<uint8_t*>(allocator.Reallocate(a, 5000));
+  SDL_assert(allocator.block_allocator_10kb.contains(b));
+  SDL_assert(same_value_in_memory(b, b + 100));
+
+  uint8_t* c = reinterpret_cast<uint8_t*>(allocator.Reallocate(b, 50000));
+  SDL_assert(not allocator.block_allocator_10kb.contains(c));
+  SDL_assert(same_value_in_memory(c, c + 100));
+
+  uint8_t* d = reinterpret_cast<uint8_t*>(allocator.Reallocate(c, 80000));
+  SDL_assert(same_value_in_memory(d, d + 100));
+
+  // and back down to the small tier
+  uint8_t* e = reinterpret_cast<uint8_t*>(allocator.Reallocate(d, 64));
+  SDL_assert(allocator.block_allocator_1kb.contains(e));
+  SDL_assert(same_value_in_memory(e, e + 64));
+  allocator.Free(e, 64);
+
+  SDL_assert(0 == allocator.get_free_list_stats().used_bytes);
+}
+
+//
+// Once every block of a tier is taken allocations of that size fail with nullptr, both for threads with a cache
+// and for threads which go straight to the backing allocator. Blocks given back can be taken again.
+//
+void test_hierarchical_exhausted_tier()
+{
+  HierarchicalAllocator allocator;
+  BlockTier&            tier     = allocator.block_allocator_10kb;
+  const uint32_t        capacity = tier.backing.m_BlockCapacity;
+  void**                blocks   = reinterpret_cast<void**>(SDL_malloc(capacity * sizeof(void*)));
+
+  for (uint32_t i = 0; i < capacity; ++i)
+  {
+    blocks[i] = allocator.Allocate(5000);
+    SDL_assert(tier.contains(blocks[i]));
+  }
+
+  SDL_assert(nullptr == allocator.Allocate(5000));
+  SDL_assert(nullptr == allocator.Allocate(5000));
+  SDL_assert(nullptr == tier.acquire(-1));
+
+  // failed reallocation keeps the old block
+  void* small_block = allocator.Allocate(100);
+  SDL_assert(nullptr == allocator.Reallocate(small_block, 5000));
+  allocator.Free(small_block, 100);
+
+  // same for free list blocks growing past what is left of the 5MB free list
+  constexpr uint32_t big_size  = 1024 * 1024;
+  uint8_t*           big_block = reinterpret_cast<uint8_t*>(allocator.Allocate(big_size));
+  std::fill(big_block, big_block + big_size, 0xBB);
+  const uint64_t used_bytes = allocator.get_free_list_stats().used_bytes;
+
+  SDL_SetAssertionHandler(ignore_assertion, nullptr);
+  void* grown = allocator.Reallocate(big_block, 6 * big_size);
+  SDL_SetAssertionHandler(nullptr, nullptr);
+
+  SDL_assert(nullptr == grown);
+  SDL_assert(used_bytes == allocator.get_free_list_stats().used_bytes);
+  SDL_assert(same_value_in_memory(big_block, big_block + big_size));
+  allocator.Free(big_block, big_size);
+  SDL_assert(0 == allocator.get_free_list_stats().used_bytes);
+
+  allocator.Free(blocks[0], 5000);
+  blocks[0] = allocator.Allocate(5000);
+  SDL_assert(tier.contains(blocks[0]));
+
+  for (uint32_t i = 0; i < capacity; ++i)
+    allocator.Free(blocks[i], 5000);
+  allocator.flush_thread_cache();
+
+  // whatever wasn't drained to the backing allocator waits in the depot
+  const AllocatorStats stats = tier.get_stats();
+  SDL_assert(stats.used_bytes == stats.cached_bytes);
+  SDL_assert(stats.allocations_count == stats.frees_count);
+
+  SDL_free(blocks);
+}
+
+int main()
+{
+  test_free_list();
+  test_free_list_random();
+  test_free_list_reallocate();
+  test_free_list_reallocate_out_of_memory();
+  test_block_allocator();
+  test_hierarchical_reallocate();
+  test_hierarchical_exhausted_tier();
+  benchmark_free_list();
+  benchmark_block_allocator();
+  benchmark_hierarchical_threads();
+  return 0;
+}
@@ -0,0 +1,231 @@
+#define SDL_MAIN_HANDLED
+#include "../sources/engine/animation.hh"
+#include "../sources/engine/bitset.hh"
+#include "../sources/engine/hierarchical_allocator.hh"
+#include "../sources/simple_entity.hh"
+#include "benchmark_helpers.hh"
+#include <SDL2/SDL.h>
+#include <algorithm>
+
+//
+// Monster.glb animation played by 1 to 1000 instances with staggered start times, a few seconds at 60 fps.
+// Reference is the sampling SimpleEntity::animate did before cursors: a binary search over the keyframes of every
+// channel and a scan of every sampler for the end of the animation. Both have to produce the same pose.
+//
+
+namespace {
+
+constexpr uint32_t MAX_INSTANCES = 1000;
+constexpr int      FRAMES        = 240;
+constexpr float    FRAME_TIME    = 1.0f / 60.0f;
+
+//
+// Linear interpolation only, which is what Monster.glb uses
+//
+bool reference_sample(const Animation& animation, float animation_time, Quaternion* rotations, Vec3* translations,
+                      Bitset& rotated_nodes, Bitset& translated_nodes)
+{
+  if (std::none_of(
+          animation.samplers.begin(), animation.samplers.end(),
+          [animation_time](const AnimationSampler& sampler) { return sampler.time_frame[1] > animation_time; }))
+    return false;
+
+  for (const AnimationChannel& channel : animation.channels)
+  {
+    const AnimationSampler& sampler = animation.samplers[channel.sampler_idx];
+
+    if ((sampler.time_frame[0] >= animation_time) or (sampler.time_frame[1] <= animation_time))
+      continue;
+
+    int keyframe_upper = std::distance(
+        sampler.times, std::lower_bound(sampler.times, sampler.times + sampler.keyframes_count, animation_time));
+    int keyframe_lower = keyframe_upper - 1;
+
+    float time_between_keyframes = sampler.times[keyframe_upper] - sampler.times[keyframe_lower];
+    float keyframe_uniform_time  = (animation_time - sampler.times[keyframe_lower]) / time_between_keyframes;
+
+    if (AnimationChannel::Path::Rotation == channel.target_path)
+    {
+      const Vec4* samples = reinterpret_cast<Vec4*>(sampler.values);
+      rotations[channel.target_node_idx].data =
+          samples[keyframe_lower].lerp(samples[keyframe_upper], keyframe_uniform_time).normalize();
+      rotated_nodes.set(channel.target_node_idx);
+    }
+    else if (AnimationChannel::Path::Translation == channel.target_path)
+    {
+      const Vec3* samples = reinterpret_cast<Vec3*>(sampler.values);
+      translations[channel.target_node_idx] =
+          samples[keyframe_lower].lerp(samples[keyframe_upper], keyframe_uniform_time);
+      translated_nodes.set(channel.target_node_idx);
+    }
+  }
+
+  return true;
+}
+
+// instances start at different points of the animation and loop it
+float instance_time(const Animation& animation, uint32_t instance_idx, int frame)
+{
+  const float offset = 0.37f * static_cast<float>(instance_idx);
+  return SDL_fmodf(offset + (FRAME_TIME * static_cast<float>(frame)), animation.duration);
+}
+
+float max_pose_difference(const Pose& a, const Pose& b, uint32_t nodes_count)
+{
+  float max_error = 0.0f;
+  for (uint32_t i = 0; i < nodes_count; ++i)
+  {
+    for (uint32_t j = 0; j < 4; ++j)
+      max_error = SDL_max(max_error, SDL_fabsf(a.rotations[i].data[j] - b.rotations[i].data[j]));
+    max_error = SDL_max(max_error, (a.translations[i] - b.translations[i]).len());
+    max_error = SDL_max(max_error, (a.scales[i] - b.scales[i]).len());
+  }
+  return max_error;
+}
+
+//
+// Restarting the animation of an entity fades out of the pose it had at that moment. Right at the restart nothing
+// changes, once the crossfade is over the pose is the clip sampled from the start.
+//
+void test_crossfade(HierarchicalAllocator& allocator, const SceneGraph& graph)
+{
+  const Animation& animation   = graph.animations[0];
+  const uint32_t   nodes_count = graph.nodes.count;
+  const float      restart     = 0.5f * animation.duration;
+  const float      crossfade   = 0.25f * animation.duration;
+
+  SimpleEntity entity = {};
+  entity.init(allocator, graph);
+
+  PosePool pool = {};
+  pool.setup(allocator, nodes_count, 2);
+  const Pose before_restart = pool.acquire();
+  const Pose expected       = pool.acquire();
+
+  entity.play_animation(0, 0.0f, crossfade);
+  entity.animate(graph, restart);
+  copy_pose(entity.animated_pose(), before_restart, nodes_count);
+
+  entity.play_animation(0, restart, crossfade);
+  SDL_assert(entity.flags.crossfade);
+  entity.animate(graph, restart);
+  SDL_assert(1e-6f > max_pose_difference(entity.animated_pose(), before_restart, nodes_count));
+
+  entity.animate(graph, restart + (0.5f * crossfade));
+  SDL_assert(entity.flags.crossfade);
+
+  uint32_t cursors[64] = {};
+  SDL_assert(animation.tracks_count <= SDL_arraysize(cursors));
+  const float after_crossfade = restart + (1.1f * crossfade);
+  rest_pose(graph, expected);
+  sample_animation(animation, after_crossfade - restart, cursors, expected);
+
+  entity.animate(graph, after_crossfade);
+  SDL_assert(not entity.flags.crossfade);
+  SDL_assert(1e-6f > max_pose_difference(entity.animated_pose(), expected, nodes_count));
+
+  pool.teardown(allocator);
+}
+
+} // namespace
+
+int main()
+{
+  HierarchicalAllocator allocator;
+  SceneGraph            graph = {};
+
+  if (not load_scene_graph(graph, allocator, "Monster.glb"))
+  {
+    SDL_Log("Monster.glb not found, run from the repository root or the build directory");
+    return 1;
+  }
+
+  const Animation& animation      = graph.animations[0];
+  const uint32_t   nodes_count    = graph.nodes.count;
+  const uint32_t   tracks_count   = animation.tracks_count;
+
+  uint32_t shared_samplers = 0;
+  for (uint32_t i = 1; i < animation.channels.count; ++i)
+    if (animation.channels[i].sampler_idx == animation.channels[i - 1].sampler_idx)
+      shared_samplers += 1;
+
+  SDL_Log("Monster.glb: %u nodes, %u channels, %u samplers (%u channels share a sampler) on %u tracks, %.2f s",
+          nodes_count, animation.channels.count, animation.samplers.count, shared_samplers, tracks_count,
+          static_cast<double>(animation.duration));
+
+  test_crossfade(allocator, graph);
+
+  //
+  // Structure of arrays pose buffers for every instance. Animated node bits of the reference are the same for every
+  // instance, so a single pair of bitsets is shared.
+  //
+  const uint32_t pose_count = MAX_INSTANCES * nodes_count;
+
+  Quaternion* reference_rotations    = reinterpret_cast<Quaternion*>(SDL_calloc(pose_count, sizeof(Quaternion)));
+  Vec3*       reference_translations = reinterpret_cast<Vec3*>(SDL_calloc(pose_count, sizeof(Vec3)));
+  Quaternion* rotations              = reinterpret_cast<Quaternion*>(SDL_calloc(pose_count, sizeof(Quaternion)));
+  Vec3*       translations           = reinterpret_cast<Vec3*>(SDL_calloc(pose_count, sizeof(Vec3)));
+  Vec3*       scales                 = reinterpret_cast<Vec3*>(SDL_calloc(pose_count, sizeof(Vec3)));
+  uint32_t*   cursors = reinterpret_cast<uint32_t*>(SDL_calloc(MAX_INSTANCES * tracks_count, sizeof(uint32_t)));
+
+  Bitset rotated_nodes    = {};
+  Bitset translated_nodes = {};
+  rotated_nodes.setup(allocator, nodes_count);
+  translated_nodes.setup(allocator, nodes_count);
+
+  for (uint32_t instances_count = 1; instances_count <= MAX_INSTANCES; instances_count *= 10)
+  {
+    uint64_t reference_ticks = 0;
+    uint64_t cursor_ticks    = 0;
+
+    for (int frame = 0; frame < FRAMES; ++frame)
+    {
+      uint64_t start = SDL_GetPerformanceCounter();
+      for (uint32_t i = 0; i < instances_count; ++i)
+        reference_sample(animation, instance_time(animation, i, frame), &reference_rotations[i * nodes_count],
+                         &reference_translations[i * nodes_count], rotated_nodes, translated_nodes);
+      reference_ticks += SDL_GetPerformanceCounter() - start;
+
+      start = SDL_GetPerformanceCounter();
+      for (uint32_t i = 0; i < instances_count; ++i)
+      {
+        const float animation_time = instance_time(animation, i, frame);
+        const Pose  pose           = {&rotations[i * nodes_count], &translations[i * nodes_count],
+                                      &scales[i * nodes_count]};
+        if (animation.duration > animation_time)
+          sample_animation(animation, animation_time, &cursors[i * tracks_count], pose);
+      }
+      cursor_ticks += SDL_GetPerformanceCounter() - start;
+    }
+
+    float max_error = 0.0f;
+    for (uint32_t i = 0; i < instances_count * nodes_count; ++i)
+    {
+      const float* a = &rotations[i].data.x;
+      const float* b = &reference_rotations[i].data.x;
+      for (int j = 0; j < 4; ++j)
+        max_error = SDL_max(max_error, SDL_fabsf(a[j] - b[j]));
+
+      const Vec3 translation_delta = translations[i] - reference_translations[i];
+      max_error                    = SDL_max(max_error, translation_delta.len());
+    }
+
+    const double reference_us = to_microseconds(reference_ticks) / FRAMES;
+    const double cursor_us    = to_microseconds(cursor_ticks) / FRAMES;
+
+    SDL_Log("%4u instances | binary search %9.2f us | cursors %9.2f us (%6.1f ns/instance) | speedup %.2fx | "
+            "max error %g",
+            instances_count, reference_us, cursor_us, 1000.0 * cursor_us / instances_count, reference_us / cursor_us,
+            static_cast<double>(max_error));
+
+    SDL_assert(0.0f == max_error);
+  }
+
+  SDL_free(cursors);
+  SDL_free(scales);
+  SDL_free(translations);
+  SDL_free(rotations);
+  SDL_free(reference_translations);
+  SDL_free(reference_rotations);
+  return 0;
+}
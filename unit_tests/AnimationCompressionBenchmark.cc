@@ -0,0 +1,342 @@
+#define SDL_MAIN_HANDLED
+#include "../sources/engine/compressed_animation.hh"
+#include "../sources/engine/hierarchical_allocator.hh"
+#include "../sources/simple_entity.hh"
+#include "benchmark_helpers.hh"
+#include <SDL2/SDL.h>
+
+//
+// Memory and sampling throughput of compressed animations against the raw samplers they were built from.
+// Clips are Monster.glb and a generated minute of 60 fps motion capture like data on a 60 bone skeleton (every bone
+// keyed on every frame, a quarter of them not moving at all). Both paths sample the same times with cursors,
+// the compressed pose has to stay within the compression tolerance of the raw one.
+//
+
+namespace {
+
+constexpr uint32_t INSTANCES  = 100;
+constexpr int      FRAMES     = 240;
+constexpr float    FRAME_TIME = 1.0f / 60.0f;
+
+// sampled times fall between keyframes, rounding of the interpolated floats comes on top of the tolerance
+constexpr float ROUNDING_SLACK = 1e-5f;
+
+constexpr uint32_t MOCAP_BONES     = 60;
+constexpr uint32_t MOCAP_KEYFRAMES = 3600;
+constexpr float    MOCAP_FPS       = 60.0f;
+
+uint32_t random_state = 0x12345678u;
+
+uint32_t next_random()
+{
+  random_state = (1664525u * random_state) + 1013904223u;
+  return random_state >> 8;
+}
+
+float random_float()
+{
+  return static_cast<float>(next_random() & 0xffff) / 65535.0f;
+}
+
+Vec3 random_axis()
+{
+  return Vec3(random_float() - 0.5f, random_float() - 0.5f, random_float() - 0.5f).normalize();
+}
+
+//
+// Rotation, translation and scale sampler for every bone, each with its own copy of the keyframe times like in
+// exported files. Bones sway with two overlapping frequencies, root walks forward.
+//
+Animation generate_mocap_clip(MemoryAllocator& allocator)
+{
+  constexpr uint32_t samplers_count = 3 * MOCAP_BONES;
+
+  Animation clip = {};
+  clip.channels  = {reinterpret_cast<AnimationChannel*>(allocator.Allocate(sizeof(AnimationChannel) * samplers_count)),
+                    samplers_count};
+  clip.samplers  = {reinterpret_cast<AnimationSampler*>(allocator.Allocate(sizeof(AnimationSampler) * samplers_count)),
+                    samplers_count};
+
+  const AnimationChannel::Path paths[] = {AnimationChannel::Path::Rotation, AnimationChannel::Path::Translation,
+                                          AnimationChannel::Path::Scale};
+
+  for (uint32_t sampler_idx = 0; sampler_idx < samplers_count; ++sampler_idx)
+  {
+    const uint32_t               bone_idx = sampler_idx / 3;
+    const AnimationChannel::Path path     = paths[sampler_idx % 3];
+    const int                    dim      = (AnimationChannel::Path::Rotation == path) ? 4 : 3;
+
+    float* times  = reinterpret_cast<float*>(allocator.Allocate(sizeof(float) * MOCAP_KEYFRAMES));
+    float* values = reinterpret_cast<float*>(allocator.Allocate(sizeof(float) * dim * MOCAP_KEYFRAMES));
+
+    const Quaternion rest      = Quaternion(random_float(), random_axis());
+    const Vec3       offset    = Vec3(0.0f, 0.1f + (0.2f * random_float()), 0.0f);
+    const Vec3       axis      = random_axis();
+    const float      amplitude = (0 == (next_random() % 4)) ? 0.0f : 0.5f * random_float();
+    const float      phase     = 6.28f * random_float();
+
+    for (uint32_t i = 0; i < MOCAP_KEYFRAMES; ++i)
+    {
+      const float time  = static_cast<float>(i) / MOCAP_FPS;
+      const float swing = (SDL_sinf(phase + (2.0f * time)) + (0.3f * SDL_sinf(7.0f * time))) * amplitude;
+      float*      value = &values[dim * i];
+
+      times[i] = time;
+
+      if (AnimationChannel::Path::Rotation == path)
+      {
+        const Quaternion rotation = rest * Quaternion(swing, axis);
+        SDL_memcpy(value, &rotation.data.x, sizeof(Vec4));
+      }
+      else if (AnimationChannel::Path::Translation == path)
+      {
+        const Vec3 translation = (0 == bone_idx) ? Vec3(0.0f, 1.0f + (0.05f * swing), 1.4f * time) : offset;
+        SDL_memcpy(value, &translation.x, sizeof(Vec3));
+      }
+      else
+      {
+        const Vec3 scale = Vec3(1.0f);
+        SDL_memcpy(value, &scale.x, sizeof(Vec3));
+      }
+    }
+
+    clip.channels[sampler_idx] = {
+        .sampler_idx     = static_cast<int>(sampler_idx),
+        .target_node_idx = static_cast<int>(bone_idx),
+        .target_path     = path,
+    };
+
+    clip.samplers[sampler_idx] = {
+        .time_frame      = {times[0], times[MOCAP_KEYFRAMES - 1]},
+        .keyframes_count = static_cast<int>(MOCAP_KEYFRAMES),
+        .values_count    = dim * static_cast<int>(MOCAP_KEYFRAMES),
+        .times           = times,
+        .values          = values,
+        .interpolation   = AnimationSampler::Interpolation::Linear,
+        .track_idx       = 0,
+    };
+  }
+
+  clip.duration         = static_cast<float>(MOCAP_KEYFRAMES - 1) / MOCAP_FPS;
+  clip.tracks_count     = 1;
+  clip.has_rotations    = true;
+  clip.has_translations = true;
+  clip.has_scales       = true;
+  return clip;
+}
+
+void free_mocap_clip(MemoryAllocator& allocator, Animation& clip)
+{
+  for (AnimationSampler& sampler : clip.samplers)
+  {
+    allocator.Free(sampler.times, sizeof(float) * sampler.keyframes_count);
+    allocator.Free(sampler.values, sizeof(float) * sampler.values_count);
+  }
+
+  allocator.Free(clip.samplers.data, sizeof(AnimationSampler) * clip.samplers.count);
+  allocator.Free(clip.channels.data, sizeof(AnimationChannel) * clip.channels.count);
+}
+
+// instances start at different points of the animation and loop it
+float instance_time(float duration, uint32_t instance_idx, int frame)
+{
+  const float offset = 0.37f * static_cast<float>(instance_idx);
+  return SDL_fmodf(offset + (FRAME_TIME * static_cast<float>(frame)), duration);
+}
+
+Pose allocate_pose(MemoryAllocator& allocator, uint32_t count)
+{
+  Pose pose = {
+      .rotations    = reinterpret_cast<Quaternion*>(allocator.Allocate(sizeof(Quaternion) * count)),
+      .translations = reinterpret_cast<Vec3*>(allocator.Allocate(sizeof(Vec3) * count)),
+      .scales       = reinterpret_cast<Vec3*>(allocator.Allocate(sizeof(Vec3) * count)),
+  };
+
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    pose.rotations[i].data = Vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    pose.translations[i]   = Vec3(0.0f);
+    pose.scales[i]         = Vec3(1.0f);
+  }
+
+  return pose;
+}
+
+void free_pose(MemoryAllocator& allocator, const Pose& pose, uint32_t count)
+{
+  allocator.Free(pose.scales, sizeof(Vec3) * count);
+  allocator.Free(pose.translations, sizeof(Vec3) * count);
+  allocator.Free(pose.rotations, sizeof(Quaternion) * count);
+}
+
+void run(MemoryAllocator& allocator, const char* name, const Animation& animation, uint32_t nodes_count)
+{
+  const CompressionSettings settings = {};
+
+  CompressedAnimation compressed = {};
+  compressed.setup(allocator, animation, settings);
+
+  uint32_t raw_keyframes        = 0;
+  uint32_t compressed_keyframes = 0;
+  for (uint32_t i = 0; i < animation.samplers.count; ++i)
+  {
+    raw_keyframes += static_cast<uint32_t>(animation.samplers[i].keyframes_count);
+    compressed_keyframes += compressed.samplers[i].keyframes_count;
+  }
+
+  const uint64_t raw_size = animation_memory_size(animation);
+
+  SDL_Log("%s: %u samplers, %.2f s | raw %8.1f KB | compressed %7.1f KB (%5.1f%% saved) | keyframes kept %u / %u",
+          name, animation.samplers.count, static_cast<double>(animation.duration), raw_size / 1024.0,
+          compressed.memory_size / 1024.0, 100.0 * (1.0 - (static_cast<double>(compressed.memory_size) / raw_size)),
+          compressed_keyframes, raw_keyframes);
+
+  //
+  // Every instance owns its cursors and poses, all start from the identity pose
+  //
+  const uint32_t raw_cursors_count        = SDL_max(animation.tracks_count, 1u);
+  const uint32_t compressed_cursors_count = SDL_max(compressed.samplers.count, 1u);
+  const uint32_t pose_count               = INSTANCES * nodes_count;
+
+  uint32_t* raw_cursors = reinterpret_cast<uint32_t*>(SDL_calloc(INSTANCES * raw_cursors_count, sizeof(uint32_t)));
+  uint32_t* compressed_cursors =
+      reinterpret_cast<uint32_t*>(SDL_calloc(INSTANCES * compressed_cursors_count, sizeof(uint32_t)));
+
+  const Pose raw_poses        = allocate_pose(allocator, pose_count);
+  const Pose compressed_poses = allocate_pose(allocator, pose_count);
+
+  uint64_t raw_ticks             = 0;
+  uint64_t compressed_ticks      = 0;
+  float    max_rotation_error    = 0.0f;
+  float    max_translation_error = 0.0f;
+
+  for (int frame = 0; frame < FRAMES; ++frame)
+  {
+    uint64_t start = SDL_GetPerformanceCounter();
+    for (uint32_t i = 0; i < INSTANCES; ++i)
+    {
+      const Pose pose = {&raw_poses.rotations[i * nodes_count], &raw_poses.translations[i * nodes_count],
+                         &raw_poses.scales[i * nodes_count]};
+      sample_animation(animation, instance_time(animation.duration, i, frame), &raw_cursors[i * raw_cursors_count],
+                       pose);
+    }
+    raw_ticks += SDL_GetPerformanceCounter() - start;
+
+    start = SDL_GetPerformanceCounter();
+    for (uint32_t i = 0; i < INSTANCES; ++i)
+    {
+      const Pose pose = {&compressed_poses.rotations[i * nodes_count], &compressed_poses.translations[i * nodes_count],
+                         &compressed_poses.scales[i * nodes_count]};
+      sample_compressed_animation(compressed, instance_time(animation.duration, i, frame),
+                                  &compressed_cursors[i * compressed_cursors_count], pose);
+    }
+    compressed_ticks += SDL_GetPerformanceCounter() - start;
+
+    for (uint32_t i = 0; i < pose_count; ++i)
+    {
+      const Vec4& a    = raw_poses.rotations[i].data;
+      const Vec4& b    = compressed_poses.rotations[i].data;
+      const float sign = (0.0f > a.mul_inner(b)) ? -1.0f : 1.0f;
+
+      max_rotation_error = SDL_max(max_rotation_error, SDL_fabsf(a.x - (sign * b.x)));
+      max_rotation_error = SDL_max(max_rotation_error, SDL_fabsf(a.y - (sign * b.y)));
+      max_rotation_error = SDL_max(max_rotation_error, SDL_fabsf(a.z - (sign * b.z)));
+      max_rotation_error = SDL_max(max_rotation_error, SDL_fabsf(a.w - (sign * b.w)));
+
+      max_translation_error =
+          SDL_max(max_translation_error, (raw_poses.translations[i] - compressed_poses.translations[i]).len());
+      max_translation_error = SDL_max(max_translation_error, (raw_poses.scales[i] - compressed_poses.scales[i]).len());
+    }
+  }
+
+  const double raw_us        = to_microseconds(raw_ticks) / FRAMES;
+  const double compressed_us = to_microseconds(compressed_ticks) / FRAMES;
+
+  SDL_Log("%s: %u instances | raw %8.2f us | compressed %8.2f us (%.2fx) | max error rotation %g, translation %g",
+          name, INSTANCES, raw_us, compressed_us, raw_us / compressed_us, static_cast<double>(max_rotation_error),
+          static_cast<double>(max_translation_error));
+
+  SDL_assert(max_rotation_error <= (settings.rotation_tolerance + ROUNDING_SLACK));
+  SDL_assert(max_translation_error <= (settings.translation_tolerance + ROUNDING_SLACK));
+
+  free_pose(allocator, compressed_poses, pose_count);
+  free_pose(allocator, raw_poses, pose_count);
+  SDL_free(compressed_cursors);
+  SDL_free(raw_cursors);
+  compressed.teardown(allocator);
+}
+
+//
+// Entity given compressed animations plays them in place of the parsed ones, the pose stays as close to an entity
+// playing the raw clip as sampling both directly does.
+//
+void test_entity_playback(HierarchicalAllocator& allocator, MemoryAllocator& compressed_allocator,
+                          const SceneGraph& graph)
+{
+  const CompressionSettings settings   = {};
+  const uint32_t            nodes_count = graph.nodes.count;
+
+  CompressedAnimation compressed = {};
+  compressed.setup(compressed_allocator, graph.animations[0], settings);
+
+  SimpleEntity raw_entity        = {};
+  SimpleEntity compressed_entity = {};
+  raw_entity.init(allocator, graph);
+  compressed_entity.init(allocator, graph);
+  compressed_entity.compressed_animations = &compressed;
+
+  raw_entity.play_animation(0, 0.0f, 0.0f);
+  compressed_entity.play_animation(0, 0.0f, 0.0f);
+
+  float max_error = 0.0f;
+  for (float time = 0.0f; time < graph.animations[0].duration; time += FRAME_TIME)
+  {
+    raw_entity.animate(graph, time);
+    compressed_entity.animate(graph, time);
+
+    const Pose a = raw_entity.animated_pose();
+    const Pose b = compressed_entity.animated_pose();
+    for (uint32_t i = 0; i < nodes_count; ++i)
+    {
+      const float sign = (0.0f > a.rotations[i].data.mul_inner(b.rotations[i].data)) ? -1.0f : 1.0f;
+      for (uint32_t j = 0; j < 4; ++j)
+        max_error = SDL_max(max_error, SDL_fabsf(a.rotations[i].data[j] - (sign * b.rotations[i].data[j])));
+      max_error = SDL_max(max_error, (a.translations[i] - b.translations[i]).len());
+      max_error = SDL_max(max_error, (a.scales[i] - b.scales[i]).len());
+    }
+  }
+
+  // quantization always leaves some error, none at all would mean the raw clip was played
+  SDL_assert(0.0f < max_error);
+  SDL_assert(max_error <= (settings.translation_tolerance + ROUNDING_SLACK));
+
+  compressed.teardown(compressed_allocator);
+}
+
+} // namespace
+
+int main()
+{
+  HierarchicalAllocator allocator;
+  MallocAllocator       malloc_allocator;
+  SceneGraph            graph = {};
+
+  if (not load_scene_graph(graph, allocator, "Monster.glb"))
+  {
+    SDL_Log("Monster.glb not found, run from the repository root or the build directory");
+    return 1;
+  }
+
+  // Monster is compressed here for comparison only, it is too short to be worth it in game
+  SDL_assert(CompressedAnimation::is_supported(graph.animations[0]));
+  SDL_assert(not should_compress(graph.animations[0], CompressionSettings()));
+  run(malloc_allocator, "Monster.glb", graph.animations[0], graph.nodes.count);
+  test_entity_playback(allocator, malloc_allocator, graph);
+
+  Animation mocap = generate_mocap_clip(malloc_allocator);
+  SDL_assert(should_compress(mocap, CompressionSettings()));
+  run(malloc_allocator, "mocap", mocap, MOCAP_BONES);
+  free_mocap_clip(malloc_allocator, mocap);
+
+  return 0;
+}
@@ -0,0 +1,160 @@
+#define SDL_MAIN_HANDLED
+#define STB_IMAGE_IMPLEMENTATION
+#include "../sources/engine/asset_pipeline.hh"
+#include "../sources/engine/hierarchical_allocator.hh"
+#include "../sources/engine/job_scheduler.hh"
+#include "stb_image.h"
+#include <SDL2/SDL.h>
+
+//
+// Cpu side of the startup asset loading (reading, parsing and image decoding) with the same assets Materials::setup
+// uses. Single thread run is the old sequential loading, the rest are the pipeline running on worker threads.
+// Baked files are used when asset_baker was run before, glb files otherwise.
+//
+
+namespace {
+
+constexpr int REPEATS = 3;
+
+const char* scene_names[] = {
+    "rock.glb",         "DamagedHelmet.glb", "su-47.glb",        "Monster.glb",
+    "Box.glb",          "BoxAnimated.glb",   "RiggedSimple.glb", "lil_arrow.glb",
+};
+
+const char* texture_names[] = {
+    "lucida_sans_sdf.png",
+    "pbr_sand/sand_albedo.jpg",
+    "pbr_sand/sand_ambient_occlusion.jpg",
+    "pbr_sand/sand_metallic_roughness.jpg",
+    "pbr_sand/sand_normal.jpg",
+    "pbr_sand/sand_emissive.jpg",
+    "pbr_water/normal_map.jpg",
+};
+
+char scene_paths[SDL_arraysize(scene_names)][256];
+char texture_paths[SDL_arraysize(texture_names)][256];
+
+SceneGraph scene_destinations[SDL_arraysize(scene_names)];
+Texture    texture_destinations[SDL_arraysize(texture_names)];
+
+bool find_assets()
+{
+  const char* directories[] = {"assets/", "../assets/"};
+
+  for (const char* directory : directories)
+  {
+    char probe[256] = {};
+    SDL_snprintf(probe, sizeof(probe), "%s%s", directory, scene_names[0]);
+
+    SDL_RWops* ctx = SDL_RWFromFile(probe, "rb");
+    if (nullptr == ctx)
+      continue;
+    SDL_RWclose(ctx);
+
+    for (uint32_t i = 0; i < SDL_arraysize(scene_names); ++i)
+      SDL_snprintf(scene_paths[i], sizeof(scene_paths[i]), "%s%s", directory, scene_names[i]);
+
+    for (uint32_t i = 0; i < SDL_arraysize(texture_names); ++i)
+      SDL_snprintf(texture_paths[i], sizeof(texture_paths[i]), "%s%s", directory, texture_names[i]);
+
+    return true;
+  }
+
+  return false;
+}
+
+double to_milliseconds(uint64_t ticks)
+{
+  return 1000.0 * static_cast<double>(ticks) / static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+double run(JobScheduler& scheduler, bool use_baked_assets, uint32_t& baked_count)
+{
+  uint64_t ticks = 0;
+
+  for (int repeat = 0; repeat < REPEATS; ++repeat)
+  {
+    // parsed scene graphs are never released, every repeat starts with a fresh allocator
+    HierarchicalAllocator allocator;
+    AssetPipeline         pipeline = {};
+    pipeline.setup(allocator, use_baked_assets);
+
+    for (uint32_t i = 0; i < SDL_arraysize(scene_names); ++i)
+      pipeline.add_scene(scene_destinations[i], scene_paths[i]);
+
+    for (uint32_t i = 0; i < SDL_arraysize(texture_names); ++i)
+      pipeline.add_texture(texture_destinations[i], texture_paths[i]);
+
+    const uint64_t start = SDL_GetPerformanceCounter();
+    pipeline.decode(scheduler);
+    ticks += SDL_GetPerformanceCounter() - start;
+
+    baked_count = 0;
+    for (uint32_t i = 0; i < pipeline.scenes_count; ++i)
+    {
+      BakedScene& baked = pipeline.scenes[i].baked;
+      if (baked.data)
+      {
+        baked_count += 1;
+        baked.unmap();
+      }
+    }
+
+    pipeline.teardown();
+  }
+
+  return to_milliseconds(ticks) / REPEATS;
+}
+
+} // namespace
+
+int main()
+{
+  if (not find_assets())
+  {
+    SDL_Log("assets directory not found, run from the repository root or the build directory");
+    return 1;
+  }
+
+  // pipeline logs every run, only the summary is interesting here
+  SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_WARN);
+
+  HierarchicalAllocator allocator;
+  JobScheduler*         scheduler = reinterpret_cast<JobScheduler*>(SDL_calloc(1, sizeof(JobScheduler)));
+
+  const uint32_t cpu_count = static_cast<uint32_t>(SDL_max(SDL_GetCPUCount(), 2));
+  const bool     modes[]   = {false, true};
+
+  uint32_t threads_counts[32]   = {};
+  uint32_t threads_counts_count = 0;
+
+  for (uint32_t threads_count = 1; threads_count < cpu_count; threads_count *= 2)
+    threads_counts[threads_counts_count++] = threads_count;
+  threads_counts[threads_counts_count++] = cpu_count;
+
+  for (const bool use_baked_assets : modes)
+  {
+    double sequential_ms = 0.0;
+
+    for (uint32_t sweep_idx = 0; sweep_idx < threads_counts_count; ++sweep_idx)
+    {
+      const uint32_t threads_count = threads_counts[sweep_idx];
+      scheduler->setup(allocator, threads_count - 1, 16, 0);
+
+      uint32_t     baked_count = 0;
+      const double elapsed_ms  = run(*scheduler, use_baked_assets, baked_count);
+
+      scheduler->teardown();
+
+      if (1 == threads_count)
+        sequential_ms = elapsed_ms;
+
+      SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "%-5s (%u/%u baked) | %2u threads %8.2f ms | speedup %.2fx",
+                  use_baked_assets ? "baked" : "glb", baked_count, static_cast<uint32_t>(SDL_arraysize(scene_names)),
+                  threads_count, elapsed_ms, sequential_ms / elapsed_ms);
+    }
+  }
+
+  SDL_free(scheduler);
+  return 0;
+}
@@ -0,0 +1,218 @@
+#define SDL_MAIN_HANDLED
+#include "../sources/engine/atomic_stack.hh"
+#include "../sources/engine/hierarchical_allocator.hh"
+#include "../sources/engine/mpmc_ring.hh"
+#include "../sources/engine/segmented_stack.hh"
+#include <SDL2/SDL.h>
+
+namespace {
+
+//
+// Every thread pushes values unique to itself. Afterwards each value has to be found exactly once,
+// which catches both lost and duplicated elements.
+//
+
+constexpr uint32_t MAX_THREADS       = 16;
+constexpr uint32_t PUSHES_PER_THREAD = 20000;
+constexpr uint32_t MAX_ELEMENTS      = MAX_THREADS * PUSHES_PER_THREAD;
+constexpr uint32_t RING_CAPACITY     = 1024;
+constexpr int      REPEATS           = 10;
+
+using BaselineStack = AtomicStack<uint32_t, MAX_ELEMENTS>;
+using Segmented     = SegmentedStack<uint32_t, 1024, MAX_ELEMENTS / 1024>;
+using BoundedStack  = SegmentedStack<uint32_t, 64, 8>;
+
+BaselineStack      baseline;
+Segmented          segmented;
+BoundedStack       bounded;
+MPMCRing<uint32_t> ring;
+
+uint32_t     threads_count;
+SDL_atomic_t threads_ready;
+SDL_atomic_t consumed_count;
+SDL_atomic_t failed_count;
+uint8_t      seen[MAX_ELEMENTS];
+
+void wait_for_all_threads()
+{
+  SDL_AtomicIncRef(&threads_ready);
+  while (static_cast<uint32_t>(SDL_AtomicGet(&threads_ready)) < threads_count)
+    SDL_Delay(0);
+}
+
+int push_to_baseline(void* arg)
+{
+  const uint32_t first = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(arg)) * PUSHES_PER_THREAD;
+  wait_for_all_threads();
+  for (uint32_t i = 0; i < PUSHES_PER_THREAD; ++i)
+    baseline.push(first + i);
+  return 0;
+}
+
+int push_to_segmented(void* arg)
+{
+  const uint32_t first = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(arg)) * PUSHES_PER_THREAD;
+  wait_for_all_threads();
+  for (uint32_t i = 0; i < PUSHES_PER_THREAD; ++i)
+  {
+    // sized for every push of every thread
+    const bool pushed = segmented.push(first + i);
+    SDL_assert(pushed);
+  }
+  return 0;
+}
+
+int push_to_bounded(void* arg)
+{
+  const uint32_t first = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(arg)) * PUSHES_PER_THREAD;
+  wait_for_all_threads();
+  for (uint32_t i = 0; i < PUSHES_PER_THREAD; ++i)
+    if (not bounded.push(first + i))
+      SDL_AtomicIncRef(&failed_count);
+  return 0;
+}
+
+//
+// Half of the threads produce, the other half consume. Consumers mark what they got, producers spin on full ring.
+//
+int ring_producer_or_consumer(void* arg)
+{
+  const uint32_t thread_idx      = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(arg));
+  const uint32_t producers_count = threads_count / 2;
+  const uint32_t total           = producers_count * PUSHES_PER_THREAD;
+  wait_for_all_threads();
+
+  if (thread_idx < producers_count)
+  {
+    const uint32_t first = thread_idx * PUSHES_PER_THREAD;
+    for (uint32_t i = 0; i < PUSHES_PER_THREAD; ++i)
+      while (not ring.try_push(first + i))
+        SDL_Delay(0);
+  }
+  else
+  {
+    uint32_t value = 0;
+    while (static_cast<uint32_t>(SDL_AtomicGet(&consumed_count)) < total)
+    {
+      if (ring.try_pop(value))
+      {
+        seen[value] += 1;
+        SDL_AtomicIncRef(&consumed_count);
+      }
+      else
+      {
+        SDL_Delay(0);
+      }
+    }
+  }
+
+  return 0;
+}
+
+double run_threads(SDL_ThreadFunction fn)
+{
+  SDL_Thread* threads[MAX_THREADS] = {};
+  SDL_AtomicSet(&threads_ready, 0);
+
+  const uint64_t start = SDL_GetPerformanceCounter();
+  for (uint32_t i = 0; i < threads_count; ++i)
+    threads[i] = SDL_CreateThread(fn, "bench", reinterpret_cast<void*>(static_cast<uintptr_t>(i)));
+  for (uint32_t i = 0; i < threads_count; ++i)
+    SDL_WaitThread(threads[i], nullptr);
+  const uint64_t end = SDL_GetPerformanceCounter();
+
+  return 1000000000.0 * static_cast<double>(end - start) / static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+template <typename Stack> void verify_each_value_once(Stack& stack, uint32_t expected_count)
+{
+  SDL_assert(expected_count == stack.size());
+  SDL_memset(seen, 0, sizeof(seen));
+  for (uint32_t value : stack)
+    seen[value] += 1;
+  for (uint32_t i = 0; i < expected_count; ++i)
+    SDL_assert(1 == seen[i]);
+}
+
+//
+// Stack which runs out of room, either because every one of its segments is full or because the pool is empty.
+// Pushes past that point have to fail, everything before has to be there exactly once with no holes.
+//
+void test_exhaustion(MemoryAllocator& allocator, uint32_t pool_segments_count)
+{
+  SegmentPool pool = {};
+  pool.setup(allocator, sizeof(BoundedStack::Segment), pool_segments_count);
+  bounded.setup(pool);
+
+  threads_count = 4;
+  SDL_AtomicSet(&failed_count, 0);
+  run_threads(push_to_bounded);
+
+  const uint32_t capacity = 64 * SDL_min(8u, pool_segments_count);
+  SDL_assert(capacity == bounded.size());
+  SDL_assert((threads_count * PUSHES_PER_THREAD) == (bounded.size() + SDL_AtomicGet(&failed_count)));
+
+  SDL_memset(seen, 0, sizeof(seen));
+  for (uint32_t value : bounded)
+    seen[value] += 1;
+  for (uint32_t value : bounded)
+    SDL_assert(1 == seen[value]);
+
+  bounded.teardown();
+  pool.teardown(allocator);
+}
+
+} // namespace
+
+int main()
+{
+  HierarchicalAllocator allocator;
+  SegmentPool           pool = {};
+
+  test_exhaustion(allocator, 16);
+  test_exhaustion(allocator, 3);
+
+  pool.setup(allocator, sizeof(Segmented::Segment), MAX_ELEMENTS / 1024);
+  segmented.setup(pool);
+  ring.init(allocator, RING_CAPACITY);
+
+  const uint32_t thread_counts[] = {2, 4, static_cast<uint32_t>(SDL_min(SDL_max(SDL_GetCPUCount(), 2), 16))};
+
+  for (uint32_t tested_threads_count : thread_counts)
+  {
+    threads_count = tested_threads_count;
+
+    const uint32_t pushes       = threads_count * PUSHES_PER_THREAD;
+    double         baseline_ns  = 0.0;
+    double         segmented_ns = 0.0;
+    double         ring_ns      = 0.0;
+
+    for (int repeat = 0; repeat < REPEATS; ++repeat)
+    {
+      baseline.reset();
+      baseline_ns += run_threads(push_to_baseline);
+      verify_each_value_once(baseline, pushes);
+
+      segmented.reset();
+      segmented_ns += run_threads(push_to_segmented);
+      verify_each_value_once(segmented, pushes);
+
+      ring.reset();
+      SDL_AtomicSet(&consumed_count, 0);
+      SDL_memset(seen, 0, sizeof(seen));
+      ring_ns += run_threads(ring_producer_or_consumer);
+      for (uint32_t i = 0; i < (threads_count / 2) * PUSHES_PER_THREAD; ++i)
+        SDL_assert(1 == seen[i]);
+    }
+
+    const double ring_ops = static_cast<double>((threads_count / 2) * PUSHES_PER_THREAD);
+    SDL_Log("%2u threads | AtomicStack %6.1f ns / push | SegmentedStack %6.1f ns / push | MPMCRing %6.1f ns / push+pop",
+            threads_count, baseline_ns / (REPEATS * pushes), segmented_ns / (REPEATS * pushes),
+            ring_ns / (REPEATS * ring_ops));
+  }
+
+  ring.teardown(allocator);
+  segmented.teardown();
+  pool.teardown(allocator);
+  return 0;
+}
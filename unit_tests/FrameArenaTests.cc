@@ -0,0 +1,138 @@
+#define SDL_MAIN_HANDLED
+#include "../sources/engine/frame_arena.hh"
+#include "../sources/engine/hierarchical_allocator.hh"
+#include "../sources/engine/job_scheduler.hh"
+#include <SDL2/SDL.h>
+#include <utility>
+
+namespace {
+
+//
+// Two frames in flight, just like the swapchain. Producer job writes into its thread's arena of the current image,
+// consumer job reads the very same memory. Previous image has to stay untouched until it is reset again.
+//
+
+constexpr uint32_t IMAGES_COUNT    = 2;
+constexpr uint32_t VALUES_COUNT    = 1000;
+constexpr uint32_t PRODUCERS_COUNT = 8;
+
+FrameArenas arenas;
+uint32_t    current_image;
+uint32_t    current_frame;
+uint32_t*   handoff[IMAGES_COUNT][PRODUCERS_COUNT];
+uint32_t    handoff_frame[IMAGES_COUNT];
+
+template <uint32_t PRODUCER> void producer_job(ThreadJobData tjd)
+{
+  FrameArena& arena  = arenas.get(tjd.thread_id, current_image);
+  uint32_t*   values = reinterpret_cast<uint32_t*>(arena.Allocate(VALUES_COUNT * sizeof(uint32_t)));
+
+  for (uint32_t i = 0; i < VALUES_COUNT; ++i)
+    values[i] = current_frame * PRODUCERS_COUNT + PRODUCER + i;
+
+  handoff[current_image][PRODUCER] = values;
+}
+
+template <uint32_t PRODUCER> void consumer_job(ThreadJobData)
+{
+  const uint32_t* values = handoff[current_image][PRODUCER];
+  for (uint32_t i = 0; i < VALUES_COUNT; ++i)
+    SDL_assert(values[i] == current_frame * PRODUCERS_COUNT + PRODUCER + i);
+}
+
+template <uint32_t... IDX> void add_frame(JobScheduler& scheduler, std::integer_sequence<uint32_t, IDX...>)
+{
+  (scheduler.add_job(consumer_job<IDX>, {scheduler.add_job(producer_job<IDX>)}), ...);
+}
+
+void verify_previous_image_intact()
+{
+  const uint32_t previous_image = (current_image + IMAGES_COUNT - 1) % IMAGES_COUNT;
+  if (nullptr == handoff[previous_image][0])
+    return;
+
+  for (uint32_t producer = 0; producer < PRODUCERS_COUNT; ++producer)
+    for (uint32_t i = 0; i < VALUES_COUNT; ++i)
+      SDL_assert(handoff[previous_image][producer][i] ==
+                 handoff_frame[previous_image] * PRODUCERS_COUNT + producer + i);
+}
+
+void test_handoff_between_jobs(JobScheduler& scheduler)
+{
+  SDL_memset(handoff, 0, sizeof(handoff));
+
+  for (current_frame = 0; current_frame < 100; ++current_frame)
+  {
+    current_image = current_frame % IMAGES_COUNT;
+    arenas.reset(current_image);
+
+    scheduler.clear_jobs();
+    add_frame(scheduler, std::make_integer_sequence<uint32_t, PRODUCERS_COUNT>());
+    scheduler.start();
+    scheduler.wait_for_finish();
+
+    handoff_frame[current_image] = current_frame;
+    verify_previous_image_intact();
+  }
+
+  uint64_t high_water = 0;
+  for (uint32_t thread_id = 0; thread_id < arenas.threads_count; ++thread_id)
+    high_water = SDL_max(high_water, arenas.thread_high_water(thread_id));
+  SDL_assert(VALUES_COUNT * sizeof(uint32_t) <= high_water);
+}
+
+void test_reset_and_high_water(MemoryAllocator& allocator)
+{
+  FrameArenas local = {};
+  local.setup(allocator, 1, IMAGES_COUNT, 1024);
+
+  FrameArena& arena = local.get(0, 1);
+  void*       a     = arena.Allocate(100);
+  void*       b     = arena.Allocate(200);
+  SDL_assert(a != b);
+
+  // last allocation grows in place
+  SDL_assert(b == arena.Reallocate(b, 400));
+  arena.Free(a, 100);
+  const uint64_t used = arena.get_used();
+  SDL_assert(500 <= used);
+
+  local.reset(1);
+  SDL_assert(0 == arena.get_used());
+  SDL_assert(used == local.thread_last_frame_used(0));
+  SDL_assert(used == local.thread_high_water(0));
+
+  // arena memory is reused from the start after reset
+  SDL_assert(a == arena.Allocate(8));
+  local.reset(1);
+  SDL_assert(used == local.thread_high_water(0));
+
+  local.teardown(allocator);
+}
+
+} // namespace
+
+int main()
+{
+  HierarchicalAllocator allocator;
+  JobScheduler*         scheduler = reinterpret_cast<JobScheduler*>(SDL_calloc(1, sizeof(JobScheduler)));
+
+  test_reset_and_high_water(allocator);
+
+  const uint32_t worker_threads_counts[] = {0, 1, 3, static_cast<uint32_t>(SDL_max(SDL_GetCPUCount() - 1, 0))};
+
+  for (uint32_t worker_threads_count : worker_threads_counts)
+  {
+    SDL_Log("workers: %u", worker_threads_count);
+    scheduler->setup(allocator, worker_threads_count, 4, 4);
+    arenas.setup(allocator, scheduler->threads_count, IMAGES_COUNT, 64 * 1024);
+
+    test_handoff_between_jobs(*scheduler);
+
+    arenas.teardown(allocator);
+    scheduler->teardown();
+  }
+
+  SDL_free(scheduler);
+  return 0;
+}
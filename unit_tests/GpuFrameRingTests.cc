@@ -0,0 +1,258 @@
+#define SDL_MAIN_HANDLED
+#include "../sources/engine/gpu_frame_ring.hh"
+#include <SDL2/SDL.h>
+
+namespace {
+
+//
+// Headless stand-in for VkFence. The ring only passes handles around, so any unique pointer will do.
+//
+struct FakeFence
+{
+  bool signaled;
+};
+
+VkFence as_fence(FakeFence& fake)
+{
+  return reinterpret_cast<VkFence>(&fake);
+}
+
+bool is_fake_fence_signaled(VkFence fence)
+{
+  return reinterpret_cast<FakeFence*>(fence)->signaled;
+}
+
+uint32_t random_state = 1234;
+
+uint32_t next_random(uint32_t max)
+{
+  random_state = random_state * 1664525u + 1013904223u;
+  return (random_state >> 8) % max;
+}
+
+uint32_t failed_assertions = 0;
+
+SDL_AssertState count_failed_assertion(const SDL_AssertData*, void*)
+{
+  failed_assertions += 1;
+  return SDL_ASSERTION_IGNORE;
+}
+
+struct Slice
+{
+  VkDeviceSize offset;
+  VkDeviceSize size;
+};
+
+bool overlaps(const Slice& lhs, const Slice& rhs)
+{
+  return (lhs.offset < (rhs.offset + rhs.size)) and (rhs.offset < (lhs.offset + lhs.size));
+}
+
+//
+// Swapchain like loop: image fences are waited on in round robin order, gpu finishes frames with a random delay.
+// Every slice handed out has to be aligned, stay inside the ring and never overlap a slice of a frame in flight.
+//
+void test_frames_in_flight()
+{
+  constexpr uint32_t     IMAGES_COUNT = 3;
+  constexpr uint32_t     FRAMES_COUNT = 2000;
+  constexpr uint32_t     MAX_SLICES   = 32;
+  constexpr VkDeviceSize BASE_OFFSET  = 4096;
+  constexpr VkDeviceSize CAPACITY     = 64 * 1024;
+  constexpr VkDeviceSize ALIGNMENT    = 256;
+
+  GpuFrameRing ring = {};
+  ring.setup(BASE_OFFSET, CAPACITY, ALIGNMENT);
+
+  FakeFence fences[IMAGES_COUNT] = {{true}, {true}, {true}};
+  Slice     slices[IMAGES_COUNT][MAX_SLICES];
+  uint32_t  slices_count[IMAGES_COUNT] = {};
+
+  // frames submitted but not yet finished by the "gpu", oldest first
+  uint32_t pending[IMAGES_COUNT] = {};
+  uint32_t pending_count         = 0;
+
+  for (uint32_t frame = 0; frame < FRAMES_COUNT; ++frame)
+  {
+    const uint32_t image = frame % IMAGES_COUNT;
+
+    // gpu makes some progress, always in submition order
+    const uint32_t finished = next_random(pending_count + 1);
+    for (uint32_t i = 0; i < finished; ++i)
+      fences[pending[i]].signaled = true;
+    for (uint32_t i = finished; i < pending_count; ++i)
+      pending[i - finished] = pending[i];
+    pending_count -= finished;
+
+    // vkWaitForFences on the acquired image
+    while (not fences[image].signaled)
+    {
+      fences[pending[0]].signaled = true;
+      for (uint32_t i = 1; i < pending_count; ++i)
+        pending[i - 1] = pending[i];
+      pending_count -= 1;
+    }
+
+    ring.reclaim(is_fake_fence_signaled);
+    fences[image].signaled = false;
+    slices_count[image]    = 0;
+
+    const uint32_t count = 1 + next_random(MAX_SLICES);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      const VkDeviceSize size   = 1 + next_random(1000);
+      const Slice        result = {ring.allocate(size), size};
+
+      SDL_assert(0 == (result.offset % ALIGNMENT));
+      SDL_assert(BASE_OFFSET <= result.offset);
+      SDL_assert((result.offset + result.size) <= (BASE_OFFSET + CAPACITY));
+
+      for (uint32_t j = 0; j < i; ++j)
+        SDL_assert(not overlaps(result, slices[image][j]));
+
+      for (uint32_t p = 0; p < pending_count; ++p)
+        for (uint32_t j = 0; j < slices_count[pending[p]]; ++j)
+          SDL_assert(not overlaps(result, slices[pending[p]][j]));
+
+      slices[image][slices_count[image]++] = result;
+    }
+
+    ring.end_frame(as_fence(fences[image]));
+    pending[pending_count++] = image;
+  }
+
+  SDL_assert(ring.high_water <= CAPACITY);
+  SDL_assert(ring.get_used() <= CAPACITY);
+}
+
+//
+// Gpu never finishes. Ring has to refuse instead of handing out memory still in use, and recover once fences signal.
+//
+void test_exhaustion()
+{
+  constexpr VkDeviceSize CAPACITY = 1024;
+
+  GpuFrameRing ring = {};
+  ring.setup(0, CAPACITY, 16);
+
+  FakeFence stuck = {false};
+
+  SDL_assert(0 == ring.allocate(512));
+  SDL_assert(512 == ring.allocate(256));
+  ring.end_frame(as_fence(stuck));
+
+  SDL_assert(768 == ring.allocate(256));
+
+  SDL_SetAssertionHandler(count_failed_assertion, nullptr);
+  const VkDeviceSize refused = ring.allocate(16);
+  SDL_SetAssertionHandler(nullptr, nullptr);
+
+  SDL_assert(GpuFrameRing::INVALID_OFFSET == refused);
+  SDL_assert((0 == failed_assertions) or (1 == failed_assertions));
+
+  ring.reclaim(is_fake_fence_signaled);
+  SDL_assert(CAPACITY == ring.get_used());
+
+  stuck.signaled = true;
+  ring.reclaim(is_fake_fence_signaled);
+  SDL_assert(256 == ring.get_used());
+
+  // 512 bytes won't fit before the end of the range, remainder gets skipped and slice starts at the beginning
+  SDL_assert(0 == ring.allocate(512));
+}
+
+//
+// More frames submitted than can be tracked. Frame without a slot of its own is released with the one after it,
+// never earlier.
+//
+void test_untracked_frame()
+{
+  GpuFrameRing ring = {};
+  ring.setup(0, 4096, 16);
+
+  FakeFence fences[GpuFrameRing::MAX_FRAMES_IN_FLIGHT + 1] = {};
+
+  for (uint32_t i = 0; i < GpuFrameRing::MAX_FRAMES_IN_FLIGHT; ++i)
+  {
+    ring.allocate(64);
+    ring.end_frame(as_fence(fences[i]));
+  }
+
+  // table is full, this frame gets no fence of its own
+  const VkDeviceSize untracked = ring.allocate(64);
+  ring.end_frame(as_fence(fences[GpuFrameRing::MAX_FRAMES_IN_FLIGHT]));
+  SDL_assert(GpuFrameRing::INVALID_OFFSET != untracked);
+
+  for (uint32_t i = 0; i < GpuFrameRing::MAX_FRAMES_IN_FLIGHT; ++i)
+    fences[i].signaled = true;
+
+  ring.reclaim(is_fake_fence_signaled);
+  SDL_assert(64 == ring.get_used());
+
+  FakeFence next = {false};
+  ring.allocate(64);
+  ring.end_frame(as_fence(next));
+
+  ring.reclaim(is_fake_fence_signaled);
+  SDL_assert(128 == ring.get_used());
+
+  next.signaled = true;
+  ring.reclaim(is_fake_fence_signaled);
+  SDL_assert(0 == ring.get_used());
+}
+
+//
+// Several jobs record the same frame concurrently.
+//
+constexpr uint32_t THREADS_COUNT     = 4;
+constexpr uint32_t SLICES_PER_THREAD = 2000;
+constexpr uint32_t THREAD_SLICE_SIZE = 48;
+
+GpuFrameRing concurrent_ring;
+Slice        concurrent_slices[THREADS_COUNT][SLICES_PER_THREAD];
+
+int allocate_concurrently(void* arg)
+{
+  const uint32_t thread_idx = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(arg));
+  for (Slice& slice : concurrent_slices[thread_idx])
+    slice = {concurrent_ring.allocate(THREAD_SLICE_SIZE), THREAD_SLICE_SIZE};
+  return 0;
+}
+
+void test_concurrent_allocations()
+{
+  concurrent_ring = {};
+  concurrent_ring.setup(0, THREADS_COUNT * SLICES_PER_THREAD * 64, 64);
+
+  SDL_Thread* threads[THREADS_COUNT] = {};
+  for (uint32_t i = 0; i < THREADS_COUNT; ++i)
+    threads[i] = SDL_CreateThread(allocate_concurrently, "ring", reinterpret_cast<void*>(static_cast<uintptr_t>(i)));
+  for (SDL_Thread* thread : threads)
+    SDL_WaitThread(thread, nullptr);
+
+  // every 64 byte step of the ring got exactly one slice
+  static uint8_t used[THREADS_COUNT * SLICES_PER_THREAD];
+  SDL_memset(used, 0, sizeof(used));
+
+  for (const auto& thread_slices : concurrent_slices)
+    for (const Slice& slice : thread_slices)
+    {
+      SDL_assert(0 == (slice.offset % 64));
+      used[slice.offset / 64] += 1;
+    }
+
+  for (uint8_t count : used)
+    SDL_assert(1 == count);
+}
+
+} // namespace
+
+int main()
+{
+  test_frames_in_flight();
+  test_exhaustion();
+  test_untracked_frame();
+  test_concurrent_allocations();
+  return 0;
+}
@@ -0,0 +1,398 @@
+#define SDL_MAIN_HANDLED
+#include "../sources/engine/allocators.hh"
+#include "../sources/engine/gpu_memory_allocator.hh"
+#include <SDL2/SDL.h>
+#include <utility>
+
+namespace {
+
+uint32_t random_state = 1234;
+
+uint32_t next_random(uint32_t max)
+{
+  random_state = random_state * 1664525u + 1013904223u;
+  return (random_state >> 8) % max;
+}
+
+uint32_t failed_assertions = 0;
+
+SDL_AssertState count_failed_assertion(const SDL_AssertData*, void*)
+{
+  failed_assertions += 1;
+  return SDL_ASSERTION_IGNORE;
+}
+
+//
+// Reference model: one byte per byte of the managed memory. Free ranges reported by the allocator have to be exactly
+// the maximal runs of unused bytes, which proves both that nothing overlaps and that coalescing is complete.
+//
+constexpr VkDeviceSize REFERENCE_POOL_SIZE = 64 * 1024;
+uint8_t                reference_usage[REFERENCE_POOL_SIZE];
+
+void verify_against_reference(const GpuMemoryAllocator& allocator)
+{
+  VkDeviceSize expected_offset = 0;
+  VkDeviceSize total_free      = 0;
+  uint32_t     ranges          = 0;
+
+  allocator.for_each_free_range([&](VkDeviceSize offset, VkDeviceSize size) {
+    // whatever is between ranges has to be in use
+    for (VkDeviceSize i = expected_offset; i < offset; ++i)
+      SDL_assert(1 == reference_usage[i]);
+
+    for (VkDeviceSize i = offset; i < (offset + size); ++i)
+      SDL_assert(0 == reference_usage[i]);
+
+    // ranges are maximal, two free ranges never touch
+    SDL_assert((0 == ranges) or (expected_offset < offset));
+
+    expected_offset = offset + size;
+    total_free += size;
+    ranges += 1;
+  });
+
+  for (VkDeviceSize i = expected_offset; i < allocator.max_size; ++i)
+    SDL_assert(1 == reference_usage[i]);
+
+  SDL_assert(total_free == allocator.free_size);
+  SDL_assert(ranges == allocator.free_ranges_count);
+}
+
+struct Allocation
+{
+  VkDeviceSize offset;
+  VkDeviceSize size;
+};
+
+void test_random_aligned()
+{
+  GpuMemoryAllocator allocator = {};
+  allocator.init(REFERENCE_POOL_SIZE);
+  SDL_memset(reference_usage, 0, sizeof(reference_usage));
+
+  constexpr uint32_t MAX_LIVE     = 512;
+  const VkDeviceSize alignments[] = {1, 4, 16, 256, 1024};
+  Allocation         live[MAX_LIVE];
+  uint32_t           live_count = 0;
+
+  for (uint32_t step = 0; step < 20000; ++step)
+  {
+    const bool want_allocation = (0 == live_count) or ((MAX_LIVE > live_count) and (0 != next_random(3)));
+
+    if (want_allocation)
+    {
+      const VkDeviceSize size      = 1 + next_random(700);
+      const VkDeviceSize alignment = alignments[next_random(SDL_arraysize(alignments))];
+
+      // running out of memory asserts, it is fine only when no free range could hold the request
+      SDL_SetAssertionHandler(count_failed_assertion, nullptr);
+      const VkDeviceSize offset = allocator.allocate_bytes(size, alignment);
+      SDL_SetAssertionHandler(nullptr, nullptr);
+
+      if (GpuMemoryAllocator::INVALID_OFFSET == offset)
+      {
+        allocator.for_each_free_range([&](VkDeviceSize range_offset, VkDeviceSize range_size) {
+          SDL_assert((range_offset + range_size) < (align(range_offset, alignment) + size));
+        });
+        continue;
+      }
+
+      SDL_assert(0 == (offset % alignment));
+      SDL_assert((offset + size) <= REFERENCE_POOL_SIZE);
+
+      for (VkDeviceSize i = offset; i < (offset + size); ++i)
+      {
+        SDL_assert(0 == reference_usage[i]);
+        reference_usage[i] = 1;
+      }
+
+      live[live_count++] = {offset, size};
+    }
+    else
+    {
+      const uint32_t   idx  = next_random(live_count);
+      const Allocation it   = live[idx];
+      live[idx]             = live[--live_count];
+
+      allocator.free_bytes(it.offset, it.size);
+      SDL_memset(&reference_usage[it.offset], 0, it.size);
+    }
+
+    if (0 == (step % 64))
+      verify_against_reference(allocator);
+  }
+
+  while (live_count)
+  {
+    const Allocation it = live[--live_count];
+    allocator.free_bytes(it.offset, it.size);
+    SDL_memset(&reference_usage[it.offset], 0, it.size);
+  }
+
+  verify_against_reference(allocator);
+  SDL_assert(1 == allocator.free_ranges_count);
+  SDL_assert(REFERENCE_POOL_SIZE == allocator.largest_free_range());
+  allocator.teardown();
+}
+
+//
+// Smallest range fitting the size is misaligned, the next one by size is aligned already and has to be found even
+// though it is shorter than the worst case padding would need.
+//
+void test_aligned_range_below_worst_case()
+{
+  GpuMemoryAllocator allocator = {};
+  allocator.init(622);
+
+  SDL_assert(0 == allocator.allocate_bytes(622));
+  allocator.free_bytes(1, 100);
+  allocator.free_bytes(512, 110);
+
+  SDL_assert(512 == allocator.allocate_bytes(100, 64));
+  SDL_assert(2 == allocator.free_ranges_count);
+  SDL_assert(110 == allocator.free_size);
+
+  allocator.teardown();
+}
+
+//
+// Old implementation silently overflowed past 128 free ranges. Every second allocation freed leaves one hole each.
+//
+void test_many_free_ranges()
+{
+  constexpr uint32_t     COUNT = 10000;
+  constexpr VkDeviceSize SIZE  = 256;
+
+  GpuMemoryAllocator allocator = {};
+  allocator.init(COUNT * SIZE);
+
+  VkDeviceSize offsets[COUNT];
+  for (VkDeviceSize& offset : offsets)
+    offset = allocator.allocate_bytes(SIZE, SIZE);
+
+  SDL_assert(0 == allocator.free_ranges_count);
+  SDL_assert(0 == allocator.free_size);
+
+  for (uint32_t i = 0; i < COUNT; i += 2)
+    allocator.free_bytes(offsets[i], SIZE);
+
+  SDL_assert((COUNT / 2) == allocator.free_ranges_count);
+  SDL_assert(SIZE == allocator.largest_free_range());
+
+  for (uint32_t i = 1; i < COUNT; i += 2)
+    allocator.free_bytes(offsets[i], SIZE);
+
+  SDL_assert(1 == allocator.free_ranges_count);
+  SDL_assert((COUNT * SIZE) == allocator.free_size);
+  allocator.teardown();
+}
+
+void test_double_free_and_overlap()
+{
+  GpuMemoryAllocator allocator = {};
+  allocator.init(4096);
+
+  const VkDeviceSize a = allocator.allocate_bytes(1024);
+  const VkDeviceSize b = allocator.allocate_bytes(1024);
+  const VkDeviceSize c = allocator.allocate_bytes(1024);
+  allocator.free_bytes(b, 1024);
+
+  const VkDeviceSize free_before   = allocator.free_size;
+  const uint32_t     ranges_before = allocator.free_ranges_count;
+
+  failed_assertions = 0;
+  SDL_SetAssertionHandler(count_failed_assertion, nullptr);
+
+  // exact double free
+  allocator.free_bytes(b, 1024);
+  // partially overlapping the free range from the left and from the right
+  allocator.free_bytes(a + 512, 1024);
+  allocator.free_bytes(b + 512, 1024);
+  // range swallowing the free one
+  allocator.free_bytes(a, 3072);
+
+  SDL_SetAssertionHandler(nullptr, nullptr);
+
+  // asserts might be compiled out, but the bookkeeping has to survive either way
+  SDL_assert((0 == failed_assertions) or (4 == failed_assertions));
+  SDL_assert(free_before == allocator.free_size);
+  SDL_assert(ranges_before == allocator.free_ranges_count);
+
+  allocator.free_bytes(a, 1024);
+  allocator.free_bytes(c, 1024);
+  SDL_assert(1 == allocator.free_ranges_count);
+  SDL_assert(4096 == allocator.free_size);
+  allocator.teardown();
+}
+
+//
+// Sorted array with first fit scan and memmove on insertion, what GpuMemoryAllocator used to do (minus the 128 cap).
+//
+struct SortedArrayAllocator
+{
+  Allocation*  ranges;
+  uint32_t     count;
+  uint32_t     capacity;
+  VkDeviceSize max_size;
+
+  explicit SortedArrayAllocator(VkDeviceSize size)
+      : ranges(reinterpret_cast<Allocation*>(SDL_malloc(16 * sizeof(Allocation))))
+      , count(1)
+      , capacity(16)
+      , max_size(size)
+  {
+    ranges[0] = {0, size};
+  }
+
+  ~SortedArrayAllocator()
+  {
+    SDL_free(ranges);
+  }
+
+  VkDeviceSize allocate_bytes(VkDeviceSize size, VkDeviceSize alignment)
+  {
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      Allocation&        it      = ranges[i];
+      const VkDeviceSize aligned = align(it.offset, alignment);
+      if ((aligned + size) > (it.offset + it.size))
+        continue;
+
+      const VkDeviceSize end = it.offset + it.size;
+      if (aligned > it.offset)
+      {
+        it.size = aligned - it.offset;
+        if ((aligned + size) < end)
+          insert_at(i + 1, {aligned + size, end - aligned - size});
+      }
+      else if ((aligned + size) < end)
+      {
+        it = {aligned + size, end - aligned - size};
+      }
+      else
+      {
+        SDL_memmove(&ranges[i], &ranges[i + 1], sizeof(Allocation) * (count - i - 1));
+        count -= 1;
+      }
+      return aligned;
+    }
+
+    SDL_assert(false);
+    return GpuMemoryAllocator::INVALID_OFFSET;
+  }
+
+  void free_bytes(VkDeviceSize offset, VkDeviceSize size)
+  {
+    uint32_t i = 0;
+    while ((i < count) and (ranges[i].offset < offset))
+      ++i;
+
+    const bool merge_prev = (0 < i) and ((ranges[i - 1].offset + ranges[i - 1].size) == offset);
+    const bool merge_next = (i < count) and ((offset + size) == ranges[i].offset);
+
+    if (merge_prev and merge_next)
+    {
+      ranges[i - 1].size += size + ranges[i].size;
+      SDL_memmove(&ranges[i], &ranges[i + 1], sizeof(Allocation) * (count - i - 1));
+      count -= 1;
+    }
+    else if (merge_prev)
+    {
+      ranges[i - 1].size += size;
+    }
+    else if (merge_next)
+    {
+      ranges[i].offset = offset;
+      ranges[i].size += size;
+    }
+    else
+    {
+      insert_at(i, {offset, size});
+    }
+  }
+
+  void insert_at(uint32_t i, Allocation range)
+  {
+    if (count == capacity)
+    {
+      capacity *= 2;
+      ranges = reinterpret_cast<Allocation*>(SDL_realloc(ranges, capacity * sizeof(Allocation)));
+    }
+    SDL_memmove(&ranges[i + 1], &ranges[i], sizeof(Allocation) * (count - i));
+    ranges[i] = range;
+    count += 1;
+  }
+};
+
+//
+// Keeps "live_count" allocations of random size alive and replaces a random one each round, which scatters free
+// ranges over the whole pool the way resource streaming does.
+//
+template <typename Allocator> double run_churn(Allocator& allocator, Allocation* live, uint32_t live_count)
+{
+  constexpr uint32_t ROUNDS = 20000;
+
+  random_state = 4321;
+  for (uint32_t i = 0; i < live_count; ++i)
+  {
+    const VkDeviceSize size = 256 * (1 + next_random(64));
+    live[i]                 = {allocator.allocate_bytes(size, 256), size};
+  }
+
+  const uint64_t start = SDL_GetPerformanceCounter();
+  for (uint32_t round = 0; round < ROUNDS; ++round)
+  {
+    Allocation& it = live[next_random(live_count)];
+    allocator.free_bytes(it.offset, it.size);
+
+    const VkDeviceSize size = 256 * (1 + next_random(64));
+    it                      = {allocator.allocate_bytes(size, 256), size};
+  }
+  const uint64_t end = SDL_GetPerformanceCounter();
+
+  for (uint32_t i = 0; i < live_count; ++i)
+    allocator.free_bytes(live[i].offset, live[i].size);
+
+  return 1000000000.0 * static_cast<double>(end - start) /
+         (static_cast<double>(SDL_GetPerformanceFrequency()) * 2.0 * ROUNDS);
+}
+
+void benchmark_churn()
+{
+  constexpr VkDeviceSize POOL_SIZE    = VkDeviceSize(1) << 32;
+  const uint32_t         live_counts[] = {64, 256, 1024, 4096, 16384};
+
+  Allocation* live = reinterpret_cast<Allocation*>(SDL_malloc(16384 * sizeof(Allocation)));
+
+  for (uint32_t live_count : live_counts)
+  {
+    GpuMemoryAllocator allocator = {};
+    allocator.init(POOL_SIZE);
+    const double tree_ns = run_churn(allocator, live, live_count);
+    SDL_assert(1 == allocator.free_ranges_count);
+
+    const uint32_t peak_ranges = allocator.nodes_capacity;
+    allocator.teardown();
+
+    SortedArrayAllocator baseline(POOL_SIZE);
+    const double         array_ns = run_churn(baseline, live, live_count);
+    SDL_assert(1 == baseline.count);
+
+    SDL_Log("%5u live allocations | treaps %6.1f ns / op (%5u nodes) | sorted array %8.1f ns / op", live_count,
+            tree_ns, peak_ranges, array_ns);
+  }
+
+  SDL_free(live);
+}
+
+} // namespace
+
+int main()
+{
+  test_random_aligned();
+  test_aligned_range_below_worst_case();
+  test_many_free_ranges();
+  test_double_free_and_overlap();
+  benchmark_churn();
+  return 0;
+}
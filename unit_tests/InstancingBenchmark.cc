@@ -0,0 +1,106 @@
+#define SDL_MAIN_HANDLED
+#include "../sources/engine/hierarchical_allocator.hh"
+#include "../sources/instance_pool.hh"
+#include "../sources/simple_entity.hh"
+#include "benchmark_helpers.hh"
+#include <SDL2/SDL.h>
+
+//
+// Crowd of su-47 copies, 10 to 10000 instances. Reference is what the level did before instance pools:
+// a SimpleEntity walk per instance with mesh node transforms gathered for per node draws.
+// Both have to produce the same model matrices, draw calls are counted for the gpu side.
+//
+
+namespace {
+
+constexpr uint32_t MAX_INSTANCES = 10000;
+constexpr int      REPEATS       = 50;
+
+void place(InstancePool& pool, uint32_t instances_count)
+{
+  pool.count = 0;
+  for (uint32_t i = 0; i < instances_count; ++i)
+  {
+    const float angle = 0.01f * static_cast<float>(i);
+    pool.spawn(Vec3(static_cast<float>(i % 100), 0.0f, static_cast<float>(i / 100)),
+               Quaternion(angle, Vec3(0.0f, 1.0f, 0.0f)), Vec3(0.5f));
+  }
+}
+
+// one entity walked over and over, every instance has the same hierarchy anyway
+void reference_transforms(SimpleEntity& entity, const SceneGraph& graph, const InstancePool& pool, Mat4x4* dst)
+{
+  for (uint32_t i = 0; i < pool.count; ++i)
+  {
+    const Mat4x4 world_transform =
+        Mat4x4::Translation(pool.positions[i]) * Mat4x4(pool.orientations[i]) * Mat4x4::Scale(pool.scales[i]);
+    entity.recalculate_node_transforms(graph, world_transform);
+
+    for (uint32_t rendered_idx = 0; rendered_idx < pool.rendered_nodes_count; ++rendered_idx)
+      dst[(rendered_idx * pool.count) + i] = entity.node_transforms[pool.rendered_nodes[rendered_idx]];
+  }
+}
+
+} // namespace
+
+int main()
+{
+  HierarchicalAllocator allocator;
+  MallocAllocator       malloc_allocator;
+  SceneGraph            graph = {};
+
+  if (not load_scene_graph(graph, allocator, "su-47.glb"))
+  {
+    SDL_Log("su-47.glb not found, run from the repository root or the build directory");
+    return 1;
+  }
+
+  SimpleEntity entity = {};
+  entity.init(allocator, graph);
+
+  InstancePool pool = {};
+  pool.setup(malloc_allocator, graph, MAX_INSTANCES);
+
+  Mat4x4* reference = reinterpret_cast<Mat4x4*>(SDL_malloc(pool.rendered_nodes_count * MAX_INSTANCES * sizeof(Mat4x4)));
+
+  SDL_Log("su-47.glb: %u nodes, %u rendered", graph.nodes.count, pool.rendered_nodes_count);
+
+  for (uint32_t instances_count = 10; instances_count <= MAX_INSTANCES; instances_count *= 10)
+  {
+    place(pool, instances_count);
+
+    uint64_t reference_ticks = 0;
+    uint64_t pool_ticks      = 0;
+
+    for (int repeat = 0; repeat < REPEATS; ++repeat)
+    {
+      uint64_t start = SDL_GetPerformanceCounter();
+      reference_transforms(entity, graph, pool, reference);
+      reference_ticks += SDL_GetPerformanceCounter() - start;
+
+      start = SDL_GetPerformanceCounter();
+      pool.update();
+      pool_ticks += SDL_GetPerformanceCounter() - start;
+    }
+
+    float max_error = 0.0f;
+    for (uint32_t i = 0; i < pool.transforms_count(); ++i)
+      for (int column = 0; column < 4; ++column)
+        for (int row = 0; row < 4; ++row)
+          max_error = SDL_max(max_error, SDL_fabsf(pool.transforms[i].at(row, column) - reference[i].at(row, column)));
+
+    const double reference_us = to_microseconds(reference_ticks) / REPEATS;
+    const double pool_us      = to_microseconds(pool_ticks) / REPEATS;
+
+    SDL_Log("%5u instances | per entity %9.2f us | pool %9.2f us (%5.1f ns/instance) | speedup %5.2fx | "
+            "draws %6u -> %2u | max error %g",
+            instances_count, reference_us, pool_us, 1000.0 * pool_us / instances_count, reference_us / pool_us,
+            instances_count * pool.rendered_nodes_count, pool.rendered_nodes_count, static_cast<double>(max_error));
+
+    SDL_assert(max_error < 1e-3f);
+  }
+
+  SDL_free(reference);
+  pool.teardown(malloc_allocator);
+  return 0;
+}
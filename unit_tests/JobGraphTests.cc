@@ -0,0 +1,340 @@
+#define SDL_MAIN_HANDLED
+#include "../sources/engine/hierarchical_allocator.hh"
+#include "../sources/engine/job_scheduler.hh"
+#include "benchmark_helpers.hh"
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <array>
+#include <utility>
+
+namespace {
+
+//
+// Frame modeled after ExampleLevel: update jobs followed by render jobs, where most of render jobs
+// only need output of a single update job. Durations are in microseconds.
+//
+
+constexpr uint32_t UPDATE_JOBS_COUNT = 8;
+constexpr uint32_t RENDER_JOBS_COUNT = 12;
+constexpr uint32_t JOBS_COUNT        = UPDATE_JOBS_COUNT + RENDER_JOBS_COUNT;
+constexpr uint32_t NO_PREDECESSOR    = ~0u;
+
+const uint32_t durations[JOBS_COUNT] = {
+    // update
+    2000, 300, 300, 200, 600, 200, 100, 300,
+    // render
+    300, 200, 1500, 200, 100, 400, 300, 200, 200, 300, 100, 200,
+};
+
+// for each render job: index of the update job it reads
+const uint32_t render_predecessors[RENDER_JOBS_COUNT] = {
+    NO_PREDECESSOR, NO_PREDECESSOR, 1, 2, 2, 3, 4, NO_PREDECESSOR, 5, 0, 7, NO_PREDECESSOR,
+};
+
+uint64_t job_begin[JOBS_COUNT];
+uint64_t job_end[JOBS_COUNT];
+
+uint64_t microseconds_to_ticks(uint32_t us)
+{
+  return (SDL_GetPerformanceFrequency() * us) / 1000000u;
+}
+
+template <uint32_t IDX> void timed_job(ThreadJobData)
+{
+  job_begin[IDX]       = SDL_GetPerformanceCounter();
+  const uint64_t until = job_begin[IDX] + microseconds_to_ticks(durations[IDX]);
+  while (SDL_GetPerformanceCounter() < until)
+    ;
+  job_end[IDX] = SDL_GetPerformanceCounter();
+}
+
+template <uint32_t... IDX> constexpr auto make_timed_jobs(std::integer_sequence<uint32_t, IDX...>)
+{
+  return std::array<Job, sizeof...(IDX)>{timed_job<IDX>...};
+}
+
+const auto timed_jobs = make_timed_jobs(std::make_integer_sequence<uint32_t, JOBS_COUNT>());
+
+Job* copy_update_jobs(Job* dst)
+{
+  return std::copy(timed_jobs.begin(), timed_jobs.begin() + UPDATE_JOBS_COUNT, dst);
+}
+
+Job* copy_render_jobs(Job* dst)
+{
+  return std::copy(timed_jobs.begin() + UPDATE_JOBS_COUNT, timed_jobs.end(), dst);
+}
+
+void add_frame_graph(JobScheduler& scheduler)
+{
+  scheduler.clear_jobs();
+
+  JobHandle update_handles[UPDATE_JOBS_COUNT] = {};
+  for (uint32_t i = 0; i < UPDATE_JOBS_COUNT; ++i)
+    update_handles[i] = scheduler.add_job(timed_jobs[i]);
+
+  for (uint32_t i = 0; i < RENDER_JOBS_COUNT; ++i)
+  {
+    const JobHandle handle = scheduler.add_job(timed_jobs[UPDATE_JOBS_COUNT + i]);
+    if (NO_PREDECESSOR != render_predecessors[i])
+      scheduler.add_dependency(handle, update_handles[render_predecessors[i]]);
+  }
+}
+
+void reset_timings()
+{
+  std::fill(job_begin, job_begin + JOBS_COUNT, 0);
+  std::fill(job_end, job_end + JOBS_COUNT, 0);
+}
+
+bool all_jobs_executed()
+{
+  return std::none_of(job_end, job_end + JOBS_COUNT, [](uint64_t end) { return 0 == end; });
+}
+
+uint64_t makespan()
+{
+  return *std::max_element(job_end, job_end + JOBS_COUNT) - *std::min_element(job_begin, job_begin + JOBS_COUNT);
+}
+
+uint32_t graph_critical_path_us()
+{
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < UPDATE_JOBS_COUNT; ++i)
+    result = SDL_max(result, durations[i]);
+
+  for (uint32_t i = 0; i < RENDER_JOBS_COUNT; ++i)
+  {
+    const uint32_t predecessor = render_predecessors[i];
+    const uint32_t before      = (NO_PREDECESSOR == predecessor) ? 0u : durations[predecessor];
+    result                     = SDL_max(result, before + durations[UPDATE_JOBS_COUNT + i]);
+  }
+
+  return result;
+}
+
+uint32_t two_barriers_critical_path_us()
+{
+  return *std::max_element(durations, durations + UPDATE_JOBS_COUNT) +
+         *std::max_element(durations + UPDATE_JOBS_COUNT, durations + JOBS_COUNT);
+}
+
+void test_dependencies_are_respected(JobScheduler& scheduler)
+{
+  SDL_Log("test_dependencies_are_respected");
+
+  for (int frame = 0; frame < 20; ++frame)
+  {
+    reset_timings();
+    add_frame_graph(scheduler);
+    scheduler.start();
+    scheduler.wait_for_finish();
+
+    SDL_assert(all_jobs_executed());
+    for (uint32_t i = 0; i < RENDER_JOBS_COUNT; ++i)
+    {
+      const uint32_t predecessor = render_predecessors[i];
+      if (NO_PREDECESSOR != predecessor)
+        SDL_assert(job_end[predecessor] <= job_begin[UPDATE_JOBS_COUNT + i]);
+    }
+  }
+}
+
+void test_chain_runs_in_order(JobScheduler& scheduler)
+{
+  SDL_Log("test_chain_runs_in_order");
+
+  reset_timings();
+  scheduler.clear_jobs();
+
+  JobHandle previous = scheduler.add_job(timed_jobs[0]);
+  for (uint32_t i = 1; i < JOBS_COUNT; ++i)
+    previous = scheduler.add_job(timed_jobs[i], {previous});
+
+  scheduler.start();
+  scheduler.wait_for_finish();
+
+  SDL_assert(all_jobs_executed());
+  for (uint32_t i = 1; i < JOBS_COUNT; ++i)
+    SDL_assert(job_end[i - 1] <= job_begin[i]);
+}
+
+void test_diamond(JobScheduler& scheduler)
+{
+  SDL_Log("test_diamond");
+
+  reset_timings();
+  scheduler.clear_jobs();
+
+  const JobHandle top    = scheduler.add_job(timed_jobs[0]);
+  const JobHandle left   = scheduler.add_job(timed_jobs[1], {top});
+  const JobHandle right  = scheduler.add_job(timed_jobs[2], {top});
+  const JobHandle bottom = scheduler.add_job(timed_jobs[3], {left, right});
+
+  scheduler.start();
+  scheduler.wait_for_finish();
+
+  SDL_assert(job_end[top] <= job_begin[left]);
+  SDL_assert(job_end[top] <= job_begin[right]);
+  SDL_assert(job_end[left] <= job_begin[bottom]);
+  SDL_assert(job_end[right] <= job_begin[bottom]);
+}
+
+SDL_atomic_t counted_jobs;
+
+void counting_job(ThreadJobData)
+{
+  SDL_AtomicIncRef(&counted_jobs);
+}
+
+void test_arrays_grow(JobScheduler& scheduler)
+{
+  SDL_Log("test_arrays_grow");
+
+  constexpr uint32_t count = 1000;
+  SDL_AtomicSet(&counted_jobs, 0);
+  scheduler.clear_jobs();
+
+  scheduler.add_job(counting_job);
+  scheduler.add_job(counting_job, {0});
+  for (uint32_t i = 2; i < count; ++i)
+    scheduler.add_job(counting_job, {i - 2, i - 1});
+
+  SDL_assert(count <= scheduler.jobs_capacity);
+  SDL_assert((2 * count - 3) <= scheduler.dependencies_capacity);
+
+  scheduler.start();
+  scheduler.wait_for_finish();
+
+  SDL_assert(static_cast<int>(count) == SDL_AtomicGet(&counted_jobs));
+}
+
+constexpr uint32_t FORKED_CHILDREN_COUNT = 16;
+
+uint64_t     forked_child_end[FORKED_CHILDREN_COUNT];
+SDL_atomic_t forked_children_run;
+uint64_t     coroutine_end;
+uint64_t     coroutine_successor_begin;
+
+void forked_child(ThreadJobData, void*, uint32_t begin, uint32_t end)
+{
+  for (uint32_t i = begin; i < end; ++i)
+  {
+    const uint64_t until = SDL_GetPerformanceCounter() + microseconds_to_ticks(50);
+    while (SDL_GetPerformanceCounter() < until)
+      ;
+    forked_child_end[i] = SDL_GetPerformanceCounter();
+    SDL_AtomicIncRef(&forked_children_run);
+  }
+}
+
+CoroutineJob forking_job(ThreadJobData tjd)
+{
+  constexpr int half        = FORKED_CHILDREN_COUNT / 2;
+  const int     already_run = SDL_AtomicGet(&forked_children_run);
+
+  const ThreadJobData first = co_await tjd.scheduler->async_parallel_for(tjd, 0, half, 1, forked_child, nullptr);
+  SDL_assert((already_run + half) == SDL_AtomicGet(&forked_children_run));
+
+  const ThreadJobData second =
+      co_await first.scheduler->async_parallel_for(first, half, FORKED_CHILDREN_COUNT, 1, forked_child, nullptr);
+  SDL_assert((already_run + 2 * half) == SDL_AtomicGet(&forked_children_run));
+
+  (void)second;
+  coroutine_end = SDL_GetPerformanceCounter();
+}
+
+void coroutine_successor_job(ThreadJobData)
+{
+  coroutine_successor_begin = SDL_GetPerformanceCounter();
+}
+
+void test_coroutine_waits_for_children(JobScheduler& scheduler)
+{
+  SDL_Log("test_coroutine_waits_for_children");
+
+  for (int frame = 0; frame < 100; ++frame)
+  {
+    SDL_AtomicSet(&forked_children_run, 0);
+    SDL_AtomicSet(&counted_jobs, 0);
+    scheduler.clear_jobs();
+
+    const JobHandle first  = scheduler.add_job(forking_job);
+    const JobHandle second = scheduler.add_job(forking_job, {first});
+    scheduler.add_job(coroutine_successor_job, {second});
+    for (uint32_t i = 0; i < 8; ++i)
+      scheduler.add_job(counting_job);
+
+    scheduler.start();
+    scheduler.wait_for_finish();
+
+    SDL_assert(8 == SDL_AtomicGet(&counted_jobs));
+    SDL_assert(0 == SDL_AtomicGet(&scheduler.coroutine_frames.used_count));
+    SDL_assert(coroutine_end <= coroutine_successor_begin);
+    for (uint64_t child_end : forked_child_end)
+      SDL_assert(child_end <= coroutine_end);
+  }
+}
+
+void measure_critical_path(JobScheduler& scheduler)
+{
+  constexpr int FRAMES_COUNT = 50;
+
+  uint64_t two_barriers_ticks = 0;
+  uint64_t graph_ticks        = 0;
+
+  for (int frame = 0; frame < FRAMES_COUNT; ++frame)
+  {
+    reset_timings();
+    scheduler.fill_jobs(copy_update_jobs);
+    scheduler.start();
+    scheduler.wait_for_finish();
+    scheduler.fill_jobs(copy_render_jobs);
+    scheduler.start();
+    scheduler.wait_for_finish();
+    two_barriers_ticks += makespan();
+
+    reset_timings();
+    add_frame_graph(scheduler);
+    scheduler.start();
+    scheduler.wait_for_finish();
+    graph_ticks += makespan();
+  }
+
+  SDL_Log("critical path | two barriers: %u us | graph: %u us", two_barriers_critical_path_us(),
+          graph_critical_path_us());
+  SDL_Log("measured frame | two barriers: %.1f us | graph: %.1f us (%d threads)",
+          to_microseconds(two_barriers_ticks) / FRAMES_COUNT, to_microseconds(graph_ticks) / FRAMES_COUNT,
+          scheduler.threads_count);
+}
+
+} // namespace
+
+int main()
+{
+  HierarchicalAllocator allocator;
+  JobScheduler*         scheduler = reinterpret_cast<JobScheduler*>(SDL_calloc(1, sizeof(JobScheduler)));
+
+  //
+  // Graph tests are run against every pool size, including main thread working on its own.
+  //
+  const uint32_t worker_threads_counts[] = {0, 1, 3, static_cast<uint32_t>(SDL_max(SDL_GetCPUCount() - 1, 0))};
+
+  for (uint32_t worker_threads_count : worker_threads_counts)
+  {
+    SDL_Log("workers: %u", worker_threads_count);
+    scheduler->setup(allocator, worker_threads_count, 4, 4);
+
+    test_dependencies_are_respected(*scheduler);
+    test_chain_runs_in_order(*scheduler);
+    test_diamond(*scheduler);
+    test_arrays_grow(*scheduler);
+    test_coroutine_waits_for_children(*scheduler);
+    measure_critical_path(*scheduler);
+
+    scheduler->teardown();
+  }
+
+  SDL_free(scheduler);
+  return 0;
+}
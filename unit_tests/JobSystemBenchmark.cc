@@ -0,0 +1,90 @@
+#define SDL_MAIN_HANDLED
+#include "../sources/engine/hierarchical_allocator.hh"
+#include "../sources/engine/job_scheduler.hh"
+#include "benchmark_helpers.hh"
+#include <SDL2/SDL.h>
+
+namespace {
+
+constexpr uint32_t MAX_JOBS     = 10000;
+constexpr uint32_t FRAMES_COUNT = 500;
+
+uint32_t     jobs_to_generate;
+SDL_atomic_t jobs_executed;
+
+void tiny_job(ThreadJobData)
+{
+  SDL_AtomicIncRef(&jobs_executed);
+}
+
+Job* generate_tiny_jobs(Job* dst)
+{
+  for (uint32_t i = 0; i < jobs_to_generate; ++i)
+    *dst++ = tiny_job;
+  return dst;
+}
+
+Job* generate_no_jobs(Job* dst)
+{
+  return dst;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const uint32_t worker_threads_count = (1 < argc) ? static_cast<uint32_t>(SDL_atoi(argv[1]))
+                                                   : static_cast<uint32_t>(SDL_max(SDL_GetCPUCount() - 1, 0));
+
+  HierarchicalAllocator allocator;
+  JobScheduler*         scheduler = reinterpret_cast<JobScheduler*>(SDL_calloc(1, sizeof(JobScheduler)));
+  scheduler->setup(allocator, worker_threads_count, MAX_JOBS, 0);
+
+  SDL_Log("threads: %u (main thread + %u workers)", scheduler->threads_count, scheduler->worker_threads_count);
+
+  {
+    scheduler->fill_jobs(generate_no_jobs);
+    const uint64_t start_ticks = SDL_GetPerformanceCounter();
+    for (uint32_t frame = 0; frame < FRAMES_COUNT; ++frame)
+    {
+      scheduler->start();
+      scheduler->wait_for_finish();
+    }
+    const uint64_t end_ticks = SDL_GetPerformanceCounter();
+    SDL_Log("%5u jobs | %9.2f us / frame", 0u, to_microseconds(end_ticks - start_ticks) / FRAMES_COUNT);
+  }
+
+  const uint32_t jobs_counts[] = {10, 100, 1000, 10000};
+
+  for (uint32_t jobs_count : jobs_counts)
+  {
+    jobs_to_generate = jobs_count;
+    SDL_AtomicSet(&jobs_executed, 0);
+
+    uint64_t fill_ticks     = 0;
+    uint64_t dispatch_ticks = 0;
+
+    for (uint32_t frame = 0; frame < FRAMES_COUNT; ++frame)
+    {
+      const uint64_t fill_start = SDL_GetPerformanceCounter();
+      scheduler->fill_jobs(generate_tiny_jobs);
+      const uint64_t dispatch_start = SDL_GetPerformanceCounter();
+      scheduler->start();
+      scheduler->wait_for_finish();
+      const uint64_t dispatch_end = SDL_GetPerformanceCounter();
+
+      fill_ticks += dispatch_start - fill_start;
+      dispatch_ticks += dispatch_end - dispatch_start;
+    }
+
+    SDL_assert(static_cast<int>(jobs_count * FRAMES_COUNT) == SDL_AtomicGet(&jobs_executed));
+
+    const double frame_us = to_microseconds(dispatch_ticks) / FRAMES_COUNT;
+    SDL_Log("%5u jobs | %9.2f us / frame | %7.1f ns / job | fill %7.2f us / frame", jobs_count, frame_us,
+            1000.0 * frame_us / jobs_count, to_microseconds(fill_ticks) / FRAMES_COUNT);
+  }
+
+  scheduler->teardown();
+  SDL_free(scheduler);
+  return 0;
+}
@@ -0,0 +1,694 @@
+#define SDL_MAIN_HANDLED
+#include "../sources/engine/math.hh"
+#include "../sources/engine/simd.hh"
+#include <SDL2/SDL.h>
+
+namespace {
+
+//
+// Scalar reference, same formulas math.cc uses when built without VVNE_SIMD. Kept out of line so the benchmark
+// compares calls with calls, engine math lives in another translation unit.
+//
+[[gnu::noinline]] Mat4x4 reference_mul(const Mat4x4& lhs, const Mat4x4& rhs)
+{
+  Mat4x4 result;
+  for (uint32_t c = 0; c < 4; ++c)
+    for (uint32_t r = 0; r < 4; ++r)
+      for (uint32_t k = 0; k < 4; ++k)
+        result.columns[c][r] += lhs.columns[k][r] * rhs.columns[c][k];
+  return result;
+}
+
+[[gnu::noinline]] Vec4 reference_mul(const Mat4x4& lhs, const Vec4& rhs)
+{
+  Vec4 result;
+  for (uint32_t r = 0; r < 4; ++r)
+    for (uint32_t k = 0; k < 4; ++k)
+      result[r] += lhs.columns[k][r] * rhs[k];
+  return result;
+}
+
+[[gnu::noinline]] Quaternion reference_mul(const Quaternion& lhs, const Quaternion& rhs)
+{
+  const Vec3& a = lhs.data.as_vec3();
+  const Vec3& b = rhs.data.as_vec3();
+
+  Quaternion r;
+  r.data.as_vec3() = a.mul_cross(b) + a.scale(rhs.data.w) + b.scale(lhs.data.w);
+  r.data.w         = lhs.data.w * rhs.data.w - a.mul_inner(b);
+  return r;
+}
+
+[[gnu::noinline]] Mat4x4 reference_from_quaternion(const Quaternion& q)
+{
+  const float a  = q.data.w;
+  const float b  = q.data.x;
+  const float c  = q.data.y;
+  const float d  = q.data.z;
+  const float a2 = a * a;
+  const float b2 = b * b;
+  const float c2 = c * c;
+  const float d2 = d * d;
+
+  Mat4x4 r;
+  r.columns[0]   = Vec4(a2 + b2 - c2 - d2, 2.0f * (b * c + a * d), 2.0f * (b * d - a * c), 0.0f);
+  r.columns[1]   = Vec4(2.0f * (b * c - a * d), a2 - b2 + c2 - d2, 2.0f * (c * d + a * b), 0.0f);
+  r.columns[2]   = Vec4(2.0f * (b * d + a * c), 2.0f * (c * d - a * b), a2 - b2 - c2 + d2, 0.0f);
+  r.columns[3].w = 1.0f;
+  return r;
+}
+
+[[gnu::noinline]] Mat4x4 reference_invert(const Mat4x4& m)
+{
+  const Vec4* v = m.columns;
+
+  float s[6];
+  float c[6];
+
+  s[0] = v[0][0] * v[1][1] - v[1][0] * v[0][1];
+  s[1] = v[0][0] * v[1][2] - v[1][0] * v[0][2];
+  s[2] = v[0][0] * v[1][3] - v[1][0] * v[0][3];
+  s[3] = v[0][1] * v[1][2] - v[1][1] * v[0][2];
+  s[4] = v[0][1] * v[1][3] - v[1][1] * v[0][3];
+  s[5] = v[0][2] * v[1][3] - v[1][2] * v[0][3];
+
+  c[0] = v[2][0] * v[3][1] - v[3][0] * v[2][1];
+  c[1] = v[2][0] * v[3][2] - v[3][0] * v[2][2];
+  c[2] = v[2][0] * v[3][3] - v[3][0] * v[2][3];
+  c[3] = v[2][1] * v[3][2] - v[3][1] * v[2][2];
+  c[4] = v[2][1] * v[3][3] - v[3][1] * v[2][3];
+  c[5] = v[2][2] * v[3][3] - v[3][2] * v[2][3];
+
+  Mat4x4 r;
+
+  // clang-format off
+  r.columns[0][0] =  v[1][1] * c[5] - v[1][2] * c[4] + v[1][3] * c[3];
+  r.columns[0][1] = -v[0][1] * c[5] + v[0][2] * c[4] - v[0][3] * c[3];
+  r.columns[0][2] =  v[3][1] * s[5] - v[3][2] * s[4] + v[3][3] * s[3];
+  r.columns[0][3] = -v[2][1] * s[5] + v[2][2] * s[4] - v[2][3] * s[3];
+  r.columns[1][0] = -v[1][0] * c[5] + v[1][2] * c[2] - v[1][3] * c[1];
+  r.columns[1][1] =  v[0][0] * c[5] - v[0][2] * c[2] + v[0][3] * c[1];
+  r.columns[1][2] = -v[3][0] * s[5] + v[3][2] * s[2] - v[3][3] * s[1];
+  r.columns[1][3] =  v[2][0] * s[5] - v[2][2] * s[2] + v[2][3] * s[1];
+  r.columns[2][0] =  v[1][0] * c[4] - v[1][1] * c[2] + v[1][3] * c[0];
+  r.columns[2][1] = -v[0][0] * c[4] + v[0][1] * c[2] - v[0][3] * c[0];
+  r.columns[2][2] =  v[3][0] * s[4] - v[3][1] * s[2] + v[3][3] * s[0];
+  r.columns[2][3] = -v[2][0] * s[4] + v[2][1] * s[2] - v[2][3] * s[0];
+  r.columns[3][0] = -v[1][0] * c[3] + v[1][1] * c[1] - v[1][2] * c[0];
+  r.columns[3][1] =  v[0][0] * c[3] - v[0][1] * c[1] + v[0][2] * c[0];
+  r.columns[3][2] = -v[3][0] * s[3] + v[3][1] * s[1] - v[3][2] * s[0];
+  r.columns[3][3] =  v[2][0] * s[3] - v[2][1] * s[1] + v[2][2] * s[0];
+  // clang-format on
+
+  const float idet = 1.0f / (s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] - s[4] * c[1] + s[5] * c[0]);
+  for (Vec4& it : r.columns)
+    for (uint32_t i = 0; i < 4; ++i)
+      it[i] *= idet;
+
+  return r;
+}
+
+[[gnu::noinline]] void reference_frustum_planes(const Mat4x4& m, Vec4 planes[6])
+{
+  const Vec4 r0 = m.row(0);
+  const Vec4 r1 = m.row(1);
+  const Vec4 r2 = m.row(2);
+  const Vec4 r3 = m.row(3);
+
+  for (uint32_t i = 0; i < 4; ++i)
+  {
+    planes[0][i] = r3[i] + r0[i];
+    planes[1][i] = r3[i] - r0[i];
+    planes[2][i] = r3[i] - r1[i];
+    planes[3][i] = r3[i] + r1[i];
+    planes[4][i] = r3[i] + r2[i];
+    planes[5][i] = r3[i] - r2[i];
+  }
+
+  for (uint32_t i = 0; i < 6; ++i)
+    planes[i] = planes[i].scale(1.0f / planes[i].as_vec3().len());
+}
+
+uint32_t random_state = 1234;
+
+float next_random(float min, float max)
+{
+  random_state = random_state * 1664525u + 1013904223u;
+  return min + (max - min) * static_cast<float>(random_state >> 8) / static_cast<float>(1u << 24);
+}
+
+Vec4 random_vec4()
+{
+  return {next_random(-10.0f, 10.0f), next_random(-10.0f, 10.0f), next_random(-10.0f, 10.0f),
+          next_random(-10.0f, 10.0f)};
+}
+
+Mat4x4 random_mat4x4()
+{
+  Mat4x4 r;
+  for (Vec4& column : r.columns)
+    column = random_vec4();
+  return r;
+}
+
+Quaternion random_quaternion()
+{
+  return Quaternion(next_random(-M_PI, M_PI), Vec3(random_vec4().as_vec3()).normalize());
+}
+
+// rotation, non uniform scale and translation, always invertible and reasonably conditioned
+Mat4x4 random_transform()
+{
+  const Vec3 scale(next_random(0.2f, 5.0f), next_random(0.2f, 5.0f), next_random(0.2f, 5.0f));
+  return Mat4x4::Translation(random_vec4().as_vec3()) * Mat4x4(random_quaternion()) * Mat4x4::Scale(scale);
+}
+
+// tolerance relative to the magnitude of the values involved
+bool nearly_equal(float a, float b, float magnitude)
+{
+  return SDL_fabsf(a - b) <= (1e-5f * SDL_max(1.0f, magnitude));
+}
+
+bool nearly_equal(const Vec4& a, const Vec4& b, float magnitude)
+{
+  for (uint32_t i = 0; i < 4; ++i)
+    if (not nearly_equal(a[i], b[i], magnitude))
+      return false;
+  return true;
+}
+
+bool nearly_equal(const Mat4x4& a, const Mat4x4& b, float magnitude)
+{
+  for (uint32_t i = 0; i < 4; ++i)
+    if (not nearly_equal(a.columns[i], b.columns[i], magnitude))
+      return false;
+  return true;
+}
+
+float max_abs(const Mat4x4& m)
+{
+  float result = 0.0f;
+  for (const Vec4& column : m.columns)
+    for (uint32_t i = 0; i < 4; ++i)
+      result = SDL_max(result, SDL_fabsf(column[i]));
+  return result;
+}
+
+constexpr uint32_t CORRECTNESS_ITERATIONS = 10000;
+
+//
+// Compile time evaluation. Failures here break the build instead of the run.
+//
+constexpr bool constexpr_nearly_equal(float a, float b, float tolerance = 1e-6f)
+{
+  return ((a - b) <= tolerance) and ((b - a) <= tolerance);
+}
+
+constexpr bool constexpr_nearly_equal(const Vec4& a, const Vec4& b, float tolerance = 1e-6f)
+{
+  for (uint32_t i = 0; i < 4; ++i)
+    if (not constexpr_nearly_equal(a[i], b[i], tolerance))
+      return false;
+  return true;
+}
+
+constexpr bool constexpr_nearly_equal(const Mat4x4& a, const Mat4x4& b, float tolerance = 1e-6f)
+{
+  for (uint32_t i = 0; i < 4; ++i)
+    if (not constexpr_nearly_equal(a.columns[i], b.columns[i], tolerance))
+      return false;
+  return true;
+}
+
+static_assert(0.0f == constexpr_sinf(0.0f));
+static_assert(constexpr_nearly_equal(constexpr_sinf(to_rad(30.0f)), 0.5f));
+static_assert(constexpr_nearly_equal(constexpr_cosf(to_rad(60.0f)), 0.5f));
+static_assert(constexpr_nearly_equal(constexpr_sinf(to_rad(-270.0f)), 1.0f));
+static_assert(constexpr_nearly_equal(constexpr_cosf(to_rad(180.0f)), -1.0f));
+static_assert(constexpr_nearly_equal(constexpr_sinf(10.5f * M_PI), 1.0f, 1e-5f));
+static_assert(constexpr_nearly_equal(constexpr_sqrtf(2.0f), 1.41421356f));
+static_assert(constexpr_nearly_equal(constexpr_sqrtf(0.0625f), 0.25f));
+static_assert(0.0f == constexpr_sqrtf(0.0f));
+
+// quarter turn around z takes x axis onto y axis, both ways of building it agree
+constexpr Mat4x4 QUARTER_TURN_Z = Mat4x4(Quaternion(to_rad(90.0f), Vec3(0.0f, 0.0f, 1.0f)));
+static_assert(constexpr_nearly_equal(QUARTER_TURN_Z * Vec4(1.0f, 0.0f, 0.0f, 1.0f), Vec4(0.0f, 1.0f, 0.0f, 1.0f)));
+static_assert(constexpr_nearly_equal(QUARTER_TURN_Z, Mat4x4::RotationZ(to_rad(90.0f))));
+
+// quaternion product composes rotations
+constexpr Quaternion EIGHTH_TURN_Z = Quaternion(to_rad(45.0f), Vec3(0.0f, 0.0f, 1.0f));
+static_assert(constexpr_nearly_equal(Mat4x4(EIGHTH_TURN_Z * EIGHTH_TURN_Z), QUARTER_TURN_Z));
+
+// translation * rotation * scale applied to a point: scaled first, translated last
+constexpr Mat4x4 TRS = Mat4x4::Translation(Vec3(1.0f, 2.0f, 3.0f)) * QUARTER_TURN_Z * Mat4x4::Scale(Vec3(2.0f));
+static_assert(constexpr_nearly_equal(TRS * Vec4(1.0f, 0.0f, 0.0f, 1.0f), Vec4(1.0f, 4.0f, 3.0f, 1.0f)));
+
+// camera looking down -z from (0, 0, 5) sees origin 5 units in front of it
+constexpr Mat4x4 VIEW = Mat4x4::LookAt(Vec3(0.0f, 0.0f, 5.0f), Vec3(0.0f), Vec3(0.0f, 1.0f, 0.0f));
+static_assert(constexpr_nearly_equal(VIEW * Vec4(0.0f, 0.0f, 0.0f, 1.0f), Vec4(0.0f, 0.0f, -5.0f, 1.0f)));
+
+// lookup tables can be baked too
+struct SinTable
+{
+  static constexpr uint32_t SIZE  = 256;
+  static constexpr float    RANGE = 8.0f * M_PI;
+
+  [[nodiscard]] static constexpr float angle(uint32_t i)
+  {
+    return RANGE * (static_cast<float>(i) / static_cast<float>(SIZE) - 0.5f);
+  }
+
+  float values[SIZE] = {};
+};
+
+constexpr SinTable generate_sin_table()
+{
+  SinTable table;
+  for (uint32_t i = 0; i < SinTable::SIZE; ++i)
+    table.values[i] = constexpr_sinf(SinTable::angle(i));
+  return table;
+}
+
+constexpr SinTable SIN_TABLE = generate_sin_table();
+
+//
+// Constant evaluated results against the runtime (SDL / simd) implementations.
+//
+void test_constexpr_matches_runtime()
+{
+  for (uint32_t i = 0; i < SinTable::SIZE; ++i)
+    SDL_assert(nearly_equal(SIN_TABLE.values[i], SDL_sinf(SinTable::angle(i)), 1.0f));
+
+  // same expressions as above, but automatic variables aren't constant evaluated
+  const Mat4x4 trs = Mat4x4::Translation(Vec3(1.0f, 2.0f, 3.0f)) *
+                     Mat4x4(Quaternion(to_rad(90.0f), Vec3(0.0f, 0.0f, 1.0f))) * Mat4x4::Scale(Vec3(2.0f));
+  SDL_assert(nearly_equal(trs, TRS, 4.0f));
+
+  const Mat4x4 view = Mat4x4::LookAt(Vec3(0.0f, 0.0f, 5.0f), Vec3(0.0f), Vec3(0.0f, 1.0f, 0.0f));
+  SDL_assert(nearly_equal(view, VIEW, 5.0f));
+}
+
+void test_multiply()
+{
+  for (uint32_t i = 0; i < CORRECTNESS_ITERATIONS; ++i)
+  {
+    const Mat4x4 a = random_mat4x4();
+    const Mat4x4 b = random_mat4x4();
+    const Vec4   v = random_vec4();
+
+    // every element is a sum of 4 products of values up to 10
+    SDL_assert(nearly_equal(a * b, reference_mul(a, b), 400.0f));
+    SDL_assert(nearly_equal(a * v, reference_mul(a, v), 400.0f));
+  }
+}
+
+void test_quaternions()
+{
+  for (uint32_t i = 0; i < CORRECTNESS_ITERATIONS; ++i)
+  {
+    const Quaternion a = random_quaternion();
+    const Quaternion b = random_quaternion();
+
+    SDL_assert(nearly_equal((a * b).data, reference_mul(a, b).data, 1.0f));
+    SDL_assert(nearly_equal(Mat4x4(a), reference_from_quaternion(a), 1.0f));
+
+    // unnormalized quaternions have to follow the same formulas
+    Quaternion scaled = a;
+    scaled.data       = scaled.data.scale(next_random(0.5f, 2.0f));
+    SDL_assert(nearly_equal(Mat4x4(scaled), reference_from_quaternion(scaled), 4.0f));
+  }
+}
+
+void test_invert()
+{
+  Mat4x4 identity;
+  identity.identity();
+
+  for (uint32_t i = 0; i < CORRECTNESS_ITERATIONS; ++i)
+  {
+    const Mat4x4 m         = random_transform();
+    const Mat4x4 inverted  = m.invert();
+    const Mat4x4 reference = reference_invert(m);
+
+    SDL_assert(nearly_equal(inverted, reference, 10.0f * max_abs(reference)));
+    SDL_assert(nearly_equal(m * inverted, identity, 10.0f * max_abs(m) * max_abs(inverted)));
+  }
+
+  // perspective projection * view, the way cascade shadow mapping uses it
+  for (uint32_t i = 0; i < 100; ++i)
+  {
+    Mat4x4 projection;
+    projection.perspective(next_random(0.5f, 2.5f), to_rad(next_random(45.0f, 100.0f)), 0.1f, 500.0f);
+
+    const Mat4x4 m         = projection * random_transform();
+    const Mat4x4 inverted  = m.invert();
+    const Mat4x4 reference = reference_invert(m);
+
+    SDL_assert(nearly_equal(inverted, reference, 100.0f * max_abs(reference)));
+  }
+}
+
+void test_frustum_planes()
+{
+  for (uint32_t i = 0; i < CORRECTNESS_ITERATIONS; ++i)
+  {
+    Mat4x4 projection;
+    projection.perspective(next_random(0.5f, 2.5f), to_rad(next_random(45.0f, 100.0f)), 0.1f, 500.0f);
+
+    const Mat4x4 m = projection * random_transform();
+
+    Vec4 planes[6];
+    Vec4 reference[6];
+    m.generate_frustum_planes(planes);
+    reference_frustum_planes(m, reference);
+
+    for (uint32_t p = 0; p < 6; ++p)
+      SDL_assert(nearly_equal(planes[p], reference[p], SDL_fabsf(reference[p].w)));
+  }
+}
+
+void test_batched_kernels()
+{
+  constexpr uint32_t COUNT = 64;
+
+  Vec3       translations[COUNT];
+  Quaternion rotations[COUNT];
+  Vec3       scales[COUNT];
+  Mat4x4     parents[COUNT];
+  Mat4x4     composed[COUNT];
+  Mat4x4     results[COUNT];
+
+  for (uint32_t i = 0; i < COUNT; ++i)
+  {
+    translations[i] = random_vec4().as_vec3();
+    rotations[i]    = random_quaternion();
+    scales[i]       = Vec3(next_random(0.2f, 5.0f), next_random(0.2f, 5.0f), next_random(0.2f, 5.0f));
+    parents[i]      = random_transform();
+  }
+
+  compose_trs(translations, rotations, scales, composed, COUNT);
+  for (uint32_t i = 0; i < COUNT; ++i)
+  {
+    const Mat4x4 expected = reference_mul(reference_mul(Mat4x4::Translation(translations[i]),
+                                                        reference_from_quaternion(rotations[i])),
+                                          Mat4x4::Scale(scales[i]));
+    SDL_assert(nearly_equal(composed[i], expected, max_abs(expected)));
+  }
+
+  mul_many(parents, composed, results, COUNT);
+  for (uint32_t i = 0; i < COUNT; ++i)
+    SDL_assert(nearly_equal(results[i], reference_mul(parents[i], composed[i]), 100.0f));
+
+  mul_many(parents[0], composed, results, COUNT);
+  for (uint32_t i = 0; i < COUNT; ++i)
+    SDL_assert(nearly_equal(results[i], reference_mul(parents[0], composed[i]), 100.0f));
+
+  mul_many(parents, composed[0], results, COUNT);
+  for (uint32_t i = 0; i < COUNT; ++i)
+    SDL_assert(nearly_equal(results[i], reference_mul(parents[i], composed[0]), 100.0f));
+
+  // in place, output overwriting either input
+  SDL_memcpy(results, composed, sizeof(results));
+  mul_many(parents, results, results, COUNT);
+  for (uint32_t i = 0; i < COUNT; ++i)
+    SDL_assert(nearly_equal(results[i], reference_mul(parents[i], composed[i]), 100.0f));
+
+  SDL_memcpy(results, parents, sizeof(results));
+  mul_many(results, composed, results, COUNT);
+  for (uint32_t i = 0; i < COUNT; ++i)
+    SDL_assert(nearly_equal(results[i], reference_mul(parents[i], composed[i]), 100.0f));
+
+  SDL_memcpy(results, parents, sizeof(results));
+  mul_many(results, composed[0], results, COUNT);
+  for (uint32_t i = 0; i < COUNT; ++i)
+    SDL_assert(nearly_equal(results[i], reference_mul(parents[i], composed[0]), 100.0f));
+
+  // every other target on the opposite hemisphere, blending has to take the shortest path anyway
+  Quaternion targets[COUNT];
+  Quaternion blended[COUNT];
+  Vec3       lerped[COUNT];
+  float      weights[COUNT];
+
+  for (uint32_t i = 0; i < COUNT; ++i)
+  {
+    targets[i].data = random_quaternion().data.scale((i % 2) ? -1.0f : 1.0f);
+    weights[i]      = next_random(0.0f, 1.0f);
+  }
+
+  nlerp_many(rotations, targets, weights, blended, COUNT);
+  for (uint32_t i = 0; i < COUNT; ++i)
+  {
+    const Vec4& from     = rotations[i].data;
+    const Vec4  to       = (0.0f > from.mul_inner(targets[i].data)) ? targets[i].data.scale(-1.0f) : targets[i].data;
+    const Vec4  expected = from.lerp(to, weights[i]).normalize();
+    SDL_assert(nearly_equal(blended[i].data, expected, 1.0f));
+  }
+
+  lerp_many(translations, scales, weights, lerped, COUNT);
+  for (uint32_t i = 0; i < COUNT; ++i)
+    SDL_assert(nearly_equal(Vec4(lerped[i], 0.0f), Vec4(translations[i].lerp(scales[i], weights[i]), 0.0f), 5.0f));
+}
+
+// Mat4x4 -> Affine3x4 -> Mat4x4 for affine input
+bool bitwise_equal(const Mat4x4& a, const Mat4x4& b)
+{
+  return 0 == SDL_memcmp(&a, &b, sizeof(Mat4x4));
+}
+
+void test_affine()
+{
+  Mat4x4 identity;
+  identity.identity();
+
+  for (uint32_t i = 0; i < CORRECTNESS_ITERATIONS; ++i)
+  {
+    const Mat4x4 a = random_transform();
+    const Mat4x4 b = random_transform();
+
+    const Affine3x4 affine_a(a);
+    const Affine3x4 affine_b(b);
+
+    SDL_assert(bitwise_equal(affine_a.to_mat4x4(), a));
+    SDL_assert(nearly_equal((affine_a * affine_b).to_mat4x4(), reference_mul(a, b), 100.0f * max_abs(b)));
+
+    const Vec3 point      = random_vec4().as_vec3();
+    const Vec4 reference  = reference_mul(a, Vec4(point, 1.0f));
+    const Vec3 translated = affine_a.transform_point(point);
+    SDL_assert(nearly_equal(Vec4(translated, 1.0f), reference, 100.0f));
+
+    const Mat4x4 inverted = affine_a.invert().to_mat4x4();
+    SDL_assert(nearly_equal(inverted, reference_invert(a), 10.0f * max_abs(inverted)));
+    SDL_assert(nearly_equal(reference_mul(a, inverted), identity, 10.0f * max_abs(a) * max_abs(inverted)));
+
+    // without scale the transposed rotation is the inverse
+    const Affine3x4 rigid(Mat4x4::Translation(random_vec4().as_vec3()) * Mat4x4(random_quaternion()));
+    const Mat4x4    rigid_inverted = rigid.invert_rigid().to_mat4x4();
+    SDL_assert(nearly_equal(rigid_inverted, reference_invert(rigid.to_mat4x4()), 10.0f * max_abs(rigid_inverted)));
+    SDL_assert(nearly_equal(rigid_inverted, rigid.invert().to_mat4x4(), 10.0f * max_abs(rigid_inverted)));
+  }
+
+  constexpr uint32_t COUNT = 64;
+
+  Affine3x4 parents[COUNT];
+  Affine3x4 children[COUNT];
+  Affine3x4 results[COUNT];
+
+  for (uint32_t i = 0; i < COUNT; ++i)
+  {
+    parents[i]  = Affine3x4(random_transform());
+    children[i] = Affine3x4(random_transform());
+  }
+
+  mul_many(parents, children, results, COUNT);
+  for (uint32_t i = 0; i < COUNT; ++i)
+    SDL_assert(bitwise_equal(results[i].to_mat4x4(), (parents[i] * children[i]).to_mat4x4()));
+
+  mul_many(parents[0], children, results, COUNT);
+  for (uint32_t i = 0; i < COUNT; ++i)
+    SDL_assert(bitwise_equal(results[i].to_mat4x4(), (parents[0] * children[i]).to_mat4x4()));
+
+  // in place, output overwriting either input
+  SDL_memcpy(results, children, sizeof(results));
+  mul_many(parents, results, results, COUNT);
+  for (uint32_t i = 0; i < COUNT; ++i)
+    SDL_assert(bitwise_equal(results[i].to_mat4x4(), (parents[i] * children[i]).to_mat4x4()));
+
+  SDL_memcpy(results, parents, sizeof(results));
+  mul_many(results, children, results, COUNT);
+  for (uint32_t i = 0; i < COUNT; ++i)
+    SDL_assert(bitwise_equal(results[i].to_mat4x4(), (parents[i] * children[i]).to_mat4x4()));
+}
+
+//
+// Micro benchmarks. Inputs live in arrays big enough to defeat constant folding, but small enough to stay in L1.
+//
+constexpr uint32_t BENCHMARK_ELEMENTS = 256;
+constexpr uint32_t BENCHMARK_ROUNDS   = 4000;
+
+Mat4x4     bench_matrices[BENCHMARK_ELEMENTS];
+Mat4x4     bench_results[BENCHMARK_ELEMENTS];
+Vec4       bench_vectors[BENCHMARK_ELEMENTS];
+Vec4       bench_vector_results[BENCHMARK_ELEMENTS];
+Quaternion bench_quaternions[BENCHMARK_ELEMENTS];
+Quaternion bench_quaternion_results[BENCHMARK_ELEMENTS];
+Vec4       bench_planes[6];
+Affine3x4  bench_affines[BENCHMARK_ELEMENTS];
+Affine3x4  bench_affine_results[BENCHMARK_ELEMENTS];
+
+//
+// Results are never read, so the optimizer is told after every round that something outside its view might read
+// them. Without it rounds which only overwrite the previous one could be dropped.
+//
+void keep_results_alive()
+{
+  asm volatile(""
+               :
+               : "r"(bench_results), "r"(bench_vector_results), "r"(bench_quaternion_results), "r"(bench_planes),
+                 "r"(bench_affine_results)
+               : "memory");
+}
+
+template <typename Fcn> double measure_ns(Fcn fcn)
+{
+  const uint64_t start = SDL_GetPerformanceCounter();
+  for (uint32_t round = 0; round < BENCHMARK_ROUNDS; ++round)
+  {
+    for (uint32_t i = 0; i < BENCHMARK_ELEMENTS; ++i)
+      fcn(i);
+    keep_results_alive();
+  }
+  const uint64_t end = SDL_GetPerformanceCounter();
+
+  return 1000000000.0 * static_cast<double>(end - start) /
+         (static_cast<double>(SDL_GetPerformanceFrequency()) * BENCHMARK_ROUNDS * BENCHMARK_ELEMENTS);
+}
+
+template <typename Engine, typename Reference> void benchmark(const char* name, Engine engine, Reference reference)
+{
+  const double engine_ns    = measure_ns(engine);
+  const double reference_ns = measure_ns(reference);
+  SDL_Log("%-24s | engine %6.2f ns | scalar reference %6.2f ns | x%.2f", name, engine_ns, reference_ns,
+          reference_ns / engine_ns);
+}
+
+void run_benchmarks()
+{
+  for (uint32_t i = 0; i < BENCHMARK_ELEMENTS; ++i)
+  {
+    bench_matrices[i]    = random_transform();
+    bench_vectors[i]     = random_vec4();
+    bench_quaternions[i] = random_quaternion();
+    bench_affines[i]     = Affine3x4(bench_matrices[i]);
+  }
+
+  constexpr uint32_t MASK = BENCHMARK_ELEMENTS - 1;
+
+  SDL_Log("engine math backend: %s", VVNE_SIMD ? "simd" : "scalar");
+
+  benchmark(
+      "mat4x4 * mat4x4",
+      [](uint32_t i) { bench_results[i] = bench_matrices[i] * bench_matrices[(i + 1) & MASK]; },
+      [](uint32_t i) { bench_results[i] = reference_mul(bench_matrices[i], bench_matrices[(i + 1) & MASK]); });
+
+  benchmark(
+      "mat4x4 * vec4 (point)", [](uint32_t i) { bench_vector_results[i] = bench_matrices[i] * bench_vectors[i]; },
+      [](uint32_t i) { bench_vector_results[i] = reference_mul(bench_matrices[i], bench_vectors[i]); });
+
+  benchmark(
+      "mat4x4 invert", [](uint32_t i) { bench_results[i] = bench_matrices[i].invert(); },
+      [](uint32_t i) { bench_results[i] = reference_invert(bench_matrices[i]); });
+
+  benchmark(
+      "frustum planes", [](uint32_t i) { bench_matrices[i].generate_frustum_planes(bench_planes); },
+      [](uint32_t i) { reference_frustum_planes(bench_matrices[i], bench_planes); });
+
+  benchmark(
+      "quaternion to mat4x4", [](uint32_t i) { bench_results[i] = Mat4x4(bench_quaternions[i]); },
+      [](uint32_t i) { bench_results[i] = reference_from_quaternion(bench_quaternions[i]); });
+
+  benchmark(
+      "quaternion * quaternion",
+      [](uint32_t i) { bench_quaternion_results[i] = bench_quaternions[i] * bench_quaternions[(i + 1) & MASK]; },
+      [](uint32_t i) {
+        bench_quaternion_results[i] = reference_mul(bench_quaternions[i], bench_quaternions[(i + 1) & MASK]);
+      });
+
+  //
+  // Local node transforms the way SimpleEntity used to build them: three full products per node, against composing
+  // them in one pass. Per node numbers, batches of 64 nodes.
+  //
+  static Vec3 translations[BENCHMARK_ELEMENTS];
+  static Vec3 scales[BENCHMARK_ELEMENTS];
+  for (uint32_t i = 0; i < BENCHMARK_ELEMENTS; ++i)
+  {
+    translations[i] = bench_vectors[i].as_vec3();
+    scales[i]       = Vec3(1.0f + bench_vectors[i].w * 0.01f);
+  }
+
+  constexpr uint32_t BATCH = 64;
+
+  benchmark(
+      "trs compose",
+      [](uint32_t i) {
+        if (0 == (i % BATCH))
+          compose_trs(&translations[i], &bench_quaternions[i], &scales[i], &bench_results[i], BATCH);
+      },
+      [](uint32_t i) {
+        bench_results[i] = Mat4x4::Translation(translations[i]) * Mat4x4(bench_quaternions[i]) *
+                           Mat4x4::Scale(scales[i]);
+      });
+
+  // reference column is the per call operator* here, same backend
+  benchmark(
+      "mul_many",
+      [](uint32_t i) {
+        if (0 == (i % BATCH))
+          mul_many(&bench_matrices[i], &bench_matrices[(i + BATCH) & MASK], &bench_results[i], BATCH);
+      },
+      [](uint32_t i) { bench_results[i] = bench_matrices[i] * bench_matrices[(i + BATCH) & MASK]; });
+
+  //
+  // Affine3x4 against the Mat4x4 operations it replaces for node and joint transforms, same backend
+  //
+  benchmark(
+      "affine3x4 * affine3x4",
+      [](uint32_t i) { bench_affine_results[i] = bench_affines[i] * bench_affines[(i + 1) & MASK]; },
+      [](uint32_t i) { bench_results[i] = bench_matrices[i] * bench_matrices[(i + 1) & MASK]; });
+
+  benchmark(
+      "affine3x4 invert", [](uint32_t i) { bench_affine_results[i] = bench_affines[i].invert(); },
+      [](uint32_t i) { bench_results[i] = bench_matrices[i].invert(); });
+
+  // skinning: inverted world * joint node transform * inverse bind matrix, per joint numbers, batches of 64 joints
+  benchmark(
+      "joint matrices",
+      [](uint32_t i) {
+        if (0 == (i % BATCH))
+        {
+          mul_many(bench_affines[0], &bench_affines[i], &bench_affine_results[i], BATCH);
+          mul_many(&bench_affine_results[i], &bench_affines[(i + BATCH) & MASK], &bench_affine_results[i], BATCH);
+        }
+      },
+      [](uint32_t i) {
+        if (0 == (i % BATCH))
+        {
+          mul_many(bench_matrices[0], &bench_matrices[i], &bench_results[i], BATCH);
+          mul_many(&bench_results[i], &bench_matrices[(i + BATCH) & MASK], &bench_results[i], BATCH);
+        }
+      });
+}
+
+} // namespace
+
+int main()
+{
+  test_multiply();
+  test_quaternions();
+  test_invert();
+  test_frustum_planes();
+  test_batched_kernels();
+  test_affine();
+  test_constexpr_matches_runtime();
+  run_benchmarks();
+  return 0;
+}
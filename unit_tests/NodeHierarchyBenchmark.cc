@@ -0,0 +1,161 @@
+#define SDL_MAIN_HANDLED
+#include "../sources/engine/hierarchical_allocator.hh"
+#include "../sources/simple_entity.hh"
+#include "benchmark_helpers.hh"
+#include <SDL2/SDL.h>
+
+//
+// Node transform propagation of SimpleEntity on generated skeleton-like hierarchies, 64 to 4096 nodes.
+// Reference is the recursive depth first walk the entity used before hierarchies were flattened at load time,
+// it also checks that both give the same transforms.
+//
+
+namespace {
+
+constexpr uint32_t MAX_NODES = 4096;
+constexpr int      REPEATS   = 200;
+
+uint32_t random_state = 0x12345678u;
+
+uint32_t next_random()
+{
+  random_state = (1664525u * random_state) + 1013904223u;
+  return random_state >> 8;
+}
+
+float random_float()
+{
+  return static_cast<float>(next_random() & 0xffff) / 65535.0f;
+}
+
+//
+// Chains of a few nodes branching from random earlier nodes, like limbs and fingers of a rig. Node indices are
+// shuffled, glTF files don't keep parents before children either.
+//
+SceneGraph generate_hierarchy(HierarchicalAllocator& allocator, uint32_t nodes_count)
+{
+  SceneGraph graph = {};
+
+  graph.nodes  = {allocator.allocate_zeroed<Node>(nodes_count), nodes_count};
+  graph.scenes = {allocator.allocate_zeroed<Scene>(1), 1};
+
+  uint32_t* permutation = allocator.allocate<uint32_t>(nodes_count);
+  uint32_t* parents     = allocator.allocate<uint32_t>(nodes_count);
+  uint32_t* counts      = allocator.allocate_zeroed<uint32_t>(nodes_count);
+  int*      children    = allocator.allocate<int>(nodes_count);
+
+  for (uint32_t i = 0; i < nodes_count; ++i)
+    permutation[i] = i;
+
+  for (uint32_t i = nodes_count - 1; 0 < i; --i)
+    std::swap(permutation[i], permutation[next_random() % (i + 1)]);
+
+  for (uint32_t i = 1; i < nodes_count; ++i)
+  {
+    parents[i] = (0 == (next_random() % 4)) ? (next_random() % i) : (i - 1);
+    counts[parents[i]] += 1;
+  }
+
+  // children arrays share one allocation, the way parseGLB does it
+  for (uint32_t i = 0, children_usage = 0; i < nodes_count; children_usage += counts[i++])
+  {
+    Node& node = graph.nodes[permutation[i]];
+
+    node.children       = {&children[children_usage], 0};
+    node.translation    = Vec3(random_float(), random_float(), random_float());
+    node.rotation       = Quaternion(random_float() * 6.28f, Vec3(0.0f, 1.0f, 0.0f));
+    node.scale          = Vec3(1.0f);
+    node.flags.rotation = node.flags.translation = true;
+  }
+
+  for (uint32_t i = 1; i < nodes_count; ++i)
+  {
+    Node& parent                             = graph.nodes[permutation[parents[i]]];
+    parent.children[parent.children.count++] = static_cast<int>(permutation[i]);
+  }
+
+  graph.scenes[0].nodes    = {allocator.allocate<int>(1), 1};
+  graph.scenes[0].nodes[0] = static_cast<int>(permutation[0]);
+
+  build_node_hierarchy(graph, allocator);
+  return graph;
+}
+
+void reference_depth_first(Mat4x4* transforms, const Node* nodes, int parent_idx, int node_idx)
+{
+  transforms[node_idx] = transforms[parent_idx] * transforms[node_idx];
+  for (int child_idx : nodes[node_idx].children)
+    reference_depth_first(transforms, nodes, node_idx, child_idx);
+}
+
+void reference_transforms(const SceneGraph& graph, const Mat4x4& world_transform, Mat4x4* transforms)
+{
+  static Vec3       translations[MAX_NODES];
+  static Quaternion rotations[MAX_NODES];
+  static Vec3       scales[MAX_NODES];
+
+  for (uint32_t i = 0; i < graph.nodes.count; ++i)
+  {
+    translations[i] = graph.nodes[i].translation;
+    rotations[i]    = graph.nodes[i].rotation;
+    scales[i]       = graph.nodes[i].scale;
+  }
+
+  compose_trs(translations, rotations, scales, transforms, graph.nodes.count);
+
+  const int root_idx   = graph.scenes[0].nodes[0];
+  transforms[root_idx] = world_transform * transforms[root_idx];
+
+  for (int child_idx : graph.nodes[root_idx].children)
+    reference_depth_first(transforms, graph.nodes.data, root_idx, child_idx);
+}
+
+} // namespace
+
+int main()
+{
+  const Mat4x4 world_transform = Mat4x4::Translation(Vec3(1.0f, 2.0f, 3.0f)) * Mat4x4::RotationY(0.5f);
+  Mat4x4*      reference       = reinterpret_cast<Mat4x4*>(SDL_malloc(MAX_NODES * sizeof(Mat4x4)));
+
+  for (uint32_t nodes_count = 64; nodes_count <= MAX_NODES; nodes_count *= 2)
+  {
+    // fresh allocator for every size, generated graphs are never released
+    HierarchicalAllocator allocator;
+    const SceneGraph      graph  = generate_hierarchy(allocator, nodes_count);
+    SimpleEntity          entity = {};
+    entity.init(allocator, graph);
+
+    uint64_t reference_ticks = 0;
+    uint64_t flattened_ticks = 0;
+
+    for (int repeat = 0; repeat < REPEATS; ++repeat)
+    {
+      uint64_t start = SDL_GetPerformanceCounter();
+      reference_transforms(graph, world_transform, reference);
+      reference_ticks += SDL_GetPerformanceCounter() - start;
+
+      start = SDL_GetPerformanceCounter();
+      entity.recalculate_node_transforms(graph, world_transform);
+      flattened_ticks += SDL_GetPerformanceCounter() - start;
+    }
+
+    float max_error = 0.0f;
+    for (uint32_t i = 0; i < nodes_count; ++i)
+      for (int column = 0; column < 4; ++column)
+        for (int row = 0; row < 4; ++row)
+          max_error = SDL_max(max_error, SDL_fabsf(entity.node_transforms[i].at(row, column) -
+                                                   reference[i].at(row, column)));
+
+    const double reference_us = to_microseconds(reference_ticks) / REPEATS;
+    const double flattened_us = to_microseconds(flattened_ticks) / REPEATS;
+
+    SDL_Log("%4u nodes | recursive %8.2f us | flattened %8.2f us (%5.1f ns/node) | speedup %.2fx | max error %g",
+            nodes_count, reference_us, flattened_us, 1000.0 * flattened_us / nodes_count,
+            reference_us / flattened_us, static_cast<double>(max_error));
+
+    SDL_assert(max_error < 1e-3f);
+  }
+
+  SDL_free(reference);
+  return 0;
+}
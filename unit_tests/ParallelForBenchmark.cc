@@ -0,0 +1,133 @@
+#define SDL_MAIN_HANDLED
+#include "../sources/engine/hierarchical_allocator.hh"
+#include "../sources/engine/job_scheduler.hh"
+#include "../sources/engine/math.hh"
+#include "benchmark_helpers.hh"
+#include <SDL2/SDL.h>
+#include <algorithm>
+
+namespace {
+
+constexpr uint32_t MAX_TRANSFORMS = 100000;
+constexpr uint32_t GRAIN          = 256;
+constexpr int      REPEATS        = 20;
+
+struct TransformBatch
+{
+  Mat4x4*  parents;
+  Mat4x4*  locals;
+  Mat4x4*  results;
+  uint32_t count;
+};
+
+TransformBatch batch;
+uint64_t       parallel_ticks;
+
+void transform_range(const TransformBatch& b, uint32_t begin, uint32_t end)
+{
+  for (uint32_t i = begin; i < end; ++i)
+    b.results[i] = b.parents[i] * b.locals[i];
+}
+
+void parallel_transforms_job(ThreadJobData tjd)
+{
+  JobScheduler*  scheduler = reinterpret_cast<JobScheduler*>(tjd.user_data);
+  const uint64_t start     = SDL_GetPerformanceCounter();
+
+  scheduler->parallel_for(tjd, 0, batch.count, GRAIN,
+                          [](ThreadJobData, uint32_t begin, uint32_t end) { transform_range(batch, begin, end); });
+
+  parallel_ticks += SDL_GetPerformanceCounter() - start;
+}
+
+Job* generate_parallel_transforms_job(Job* dst)
+{
+  *dst++ = parallel_transforms_job;
+  return dst;
+}
+
+} // namespace
+
+int main()
+{
+  HierarchicalAllocator allocator;
+  JobScheduler*         scheduler = reinterpret_cast<JobScheduler*>(SDL_calloc(1, sizeof(JobScheduler)));
+
+  batch.parents = reinterpret_cast<Mat4x4*>(SDL_malloc(MAX_TRANSFORMS * sizeof(Mat4x4)));
+  batch.locals  = reinterpret_cast<Mat4x4*>(SDL_malloc(MAX_TRANSFORMS * sizeof(Mat4x4)));
+  batch.results = reinterpret_cast<Mat4x4*>(SDL_malloc(MAX_TRANSFORMS * sizeof(Mat4x4)));
+  Mat4x4* reference = reinterpret_cast<Mat4x4*>(SDL_malloc(MAX_TRANSFORMS * sizeof(Mat4x4)));
+
+  for (uint32_t i = 0; i < MAX_TRANSFORMS; ++i)
+  {
+    const float f    = static_cast<float>(i);
+    batch.parents[i] = Mat4x4::Translation(Vec3(f, 2.0f * f, 0.5f)) * Mat4x4::RotationY(0.01f * f);
+    batch.locals[i]  = Mat4x4::RotationX(0.02f * f) * Mat4x4::Scale(Vec3(1.0f + 0.001f * f));
+  }
+
+  const uint32_t cpu_count = static_cast<uint32_t>(SDL_max(SDL_GetCPUCount(), 2));
+  SDL_Log("grain: %u, logical cores: %d", GRAIN, SDL_GetCPUCount());
+
+  const uint32_t counts[] = {1000, 10000, 100000};
+  double         serial_us[SDL_arraysize(counts)];
+
+  for (uint32_t i = 0; i < SDL_arraysize(counts); ++i)
+  {
+    const uint64_t serial_start = SDL_GetPerformanceCounter();
+    for (int repeat = 0; repeat < REPEATS; ++repeat)
+    {
+      TransformBatch serial = batch;
+      serial.results        = reference;
+      transform_range(serial, 0, counts[i]);
+    }
+    serial_us[i] = to_microseconds(SDL_GetPerformanceCounter() - serial_start) / REPEATS;
+  }
+
+  //
+  // Thread count sweep: powers of two below the number of logical cores, then the core count itself.
+  //
+  uint32_t threads_counts[32]   = {};
+  uint32_t threads_counts_count = 0;
+
+  for (uint32_t threads_count = 1; threads_count < cpu_count; threads_count *= 2)
+    threads_counts[threads_counts_count++] = threads_count;
+  threads_counts[threads_counts_count++] = cpu_count;
+
+  for (uint32_t sweep_idx = 0; sweep_idx < threads_counts_count; ++sweep_idx)
+  {
+    const uint32_t threads_count = threads_counts[sweep_idx];
+
+    scheduler->setup(allocator, threads_count - 1, 16, 0);
+    scheduler->user_data = scheduler;
+
+    for (uint32_t i = 0; i < SDL_arraysize(counts); ++i)
+    {
+      batch.count = counts[i];
+      std::fill(batch.results, &batch.results[counts[i]], Mat4x4());
+
+      parallel_ticks = 0;
+      for (int repeat = 0; repeat < REPEATS; ++repeat)
+      {
+        scheduler->fill_jobs(generate_parallel_transforms_job);
+        scheduler->start();
+        scheduler->wait_for_finish();
+      }
+
+      SDL_assert(0 == SDL_memcmp(reference, batch.results, counts[i] * sizeof(Mat4x4)));
+
+      const double parallel_us = to_microseconds(parallel_ticks) / REPEATS;
+      SDL_Log("%6u matrices | serial %9.1f us | %2u threads %9.1f us | speedup %.2fx", counts[i], serial_us[i],
+              threads_count, parallel_us, serial_us[i] / parallel_us);
+    }
+
+    scheduler->teardown();
+  }
+
+  SDL_free(reference);
+  SDL_free(batch.results);
+  SDL_free(batch.locals);
+  SDL_free(batch.parents);
+
+  SDL_free(scheduler);
+  return 0;
+}
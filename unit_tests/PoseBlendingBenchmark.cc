@@ -0,0 +1,330 @@
+#define SDL_MAIN_HANDLED
+#include "../sources/engine/animation.hh"
+#include "../sources/engine/hierarchical_allocator.hh"
+#include "benchmark_helpers.hh"
+#include <SDL2/SDL.h>
+
+//
+// Layered pose evaluation on a generated 200 bone skeleton with four clips keying rotation, translation and scale of
+// every bone. Four layers are blended on top of the rest pose: the base clip, a crossfade into a second clip, an upper
+// body override and an additive clip. Blending should stay under twice the cost of sampling a single clip, timing
+// depends on the machine so going over is only reported.
+// Reference is a straightforward node by node, layer by layer blend, both have to give the same pose.
+//
+
+namespace {
+
+constexpr uint32_t NODES_COUNT     = 200;
+constexpr uint32_t CLIPS_COUNT     = 4;
+constexpr uint32_t KEYFRAMES_COUNT = 60;
+constexpr float    KEYFRAME_TIME   = 1.0f / 30.0f;
+constexpr int      FRAMES          = 2000;
+constexpr float    FRAME_TIME      = 1.0f / 60.0f;
+
+uint32_t random_state = 0x12345678u;
+
+uint32_t next_random()
+{
+  random_state = (1664525u * random_state) + 1013904223u;
+  return random_state >> 8;
+}
+
+float random_float()
+{
+  return static_cast<float>(next_random() & 0xffff) / 65535.0f;
+}
+
+Vec3 random_axis()
+{
+  return Vec3(random_float() - 0.5f, random_float() - 0.5f, random_float() - 0.5f).normalize();
+}
+
+SceneGraph generate_skeleton(HierarchicalAllocator& allocator)
+{
+  SceneGraph graph = {};
+  graph.nodes      = {allocator.allocate_zeroed<Node>(NODES_COUNT), NODES_COUNT};
+
+  for (Node& node : graph.nodes)
+  {
+    node.rotation          = Quaternion(random_float(), random_axis());
+    node.translation       = Vec3(0.0f, 0.2f + random_float(), 0.0f);
+    node.scale             = Vec3(1.0f);
+    node.flags.rotation    = true;
+    node.flags.translation = true;
+  }
+
+  return graph;
+}
+
+//
+// Every bone swings around its own axis, the way exporters write clips: one linear sampler per channel, all of them
+// keyed at the same times so they share a single track.
+//
+Animation generate_clip(HierarchicalAllocator& allocator, const SceneGraph& skeleton)
+{
+  constexpr uint32_t channels_count = 3 * NODES_COUNT;
+
+  Animation clip = {};
+  clip.channels  = {allocator.allocate<AnimationChannel>(channels_count), channels_count};
+  clip.samplers  = {allocator.allocate<AnimationSampler>(channels_count), channels_count};
+
+  // values of every sampler in one allocation, the way parseGLB keeps them in the binary chunk
+  float* times      = allocator.allocate<float>(KEYFRAMES_COUNT);
+  float* values     = allocator.allocate<float>(NODES_COUNT * (4 + 3 + 3) * KEYFRAMES_COUNT);
+  float* values_end = values;
+  for (uint32_t i = 0; i < KEYFRAMES_COUNT; ++i)
+    times[i] = KEYFRAME_TIME * static_cast<float>(i);
+
+  const AnimationChannel::Path paths[] = {AnimationChannel::Path::Rotation, AnimationChannel::Path::Translation,
+                                          AnimationChannel::Path::Scale};
+
+  for (uint32_t channel_idx = 0; channel_idx < channels_count; ++channel_idx)
+  {
+    const uint32_t               node_idx  = channel_idx / 3;
+    const AnimationChannel::Path path      = paths[channel_idx % 3];
+    const Node&                  node      = skeleton.nodes[node_idx];
+    const int                    dim       = (AnimationChannel::Path::Rotation == path) ? 4 : 3;
+    float*                       keyframes = values_end;
+
+    const Vec3  axis  = random_axis();
+    const float phase = 6.28f * random_float();
+
+    for (uint32_t i = 0; i < KEYFRAMES_COUNT; ++i)
+    {
+      const float swing = SDL_sinf(phase + (0.2f * static_cast<float>(i)));
+      float*      value = &keyframes[dim * i];
+
+      if (AnimationChannel::Path::Rotation == path)
+      {
+        const Quaternion rotation = node.rotation * Quaternion(0.4f * swing, axis);
+        SDL_memcpy(value, &rotation.data.x, sizeof(Vec4));
+      }
+      else if (AnimationChannel::Path::Translation == path)
+      {
+        const Vec3 translation = node.translation + axis.scale(0.05f * swing);
+        SDL_memcpy(value, &translation.x, sizeof(Vec3));
+      }
+      else
+      {
+        const Vec3 scale = Vec3(1.0f + (0.1f * swing));
+        SDL_memcpy(value, &scale.x, sizeof(Vec3));
+      }
+    }
+
+    clip.channels[channel_idx] = {
+        .sampler_idx     = static_cast<int>(channel_idx),
+        .target_node_idx = static_cast<int>(node_idx),
+        .target_path     = path,
+    };
+
+    clip.samplers[channel_idx] = {
+        .time_frame      = {times[0], times[KEYFRAMES_COUNT - 1]},
+        .keyframes_count = static_cast<int>(KEYFRAMES_COUNT),
+        .values_count    = static_cast<int>(KEYFRAMES_COUNT),
+        .times           = times,
+        .values          = keyframes,
+        .interpolation   = AnimationSampler::Interpolation::Linear,
+        .track_idx       = 0,
+    };
+
+    values_end += dim * KEYFRAMES_COUNT;
+  }
+
+  clip.duration         = times[KEYFRAMES_COUNT - 1];
+  clip.tracks_count     = 1;
+  clip.has_rotations    = true;
+  clip.has_translations = true;
+  clip.has_scales       = true;
+  return clip;
+}
+
+Quaternion reference_nlerp(const Quaternion& a, const Quaternion& b, float t)
+{
+  const Vec4 to = (0.0f > a.data.mul_inner(b.data)) ? b.data.scale(-1.0f) : b.data;
+
+  Quaternion result;
+  result.data = a.data.lerp(to, t).normalize();
+  return result;
+}
+
+void reference_blend(const PoseLayer* layers, uint32_t layers_count, const Pose& dst)
+{
+  for (uint32_t i = 0; i < NODES_COUNT; ++i)
+  {
+    for (uint32_t layer_idx = 0; layer_idx < layers_count; ++layer_idx)
+    {
+      const PoseLayer& layer  = layers[layer_idx];
+      const float      weight = layer.mask ? (layer.weight * layer.mask[i]) : layer.weight;
+      const Pose&      src    = *layer.pose;
+
+      if (0.0f == weight)
+        continue;
+
+      if (PoseLayer::Mode::Override == layer.mode)
+      {
+        dst.rotations[i]    = reference_nlerp(dst.rotations[i], src.rotations[i], weight);
+        dst.translations[i] = dst.translations[i].lerp(src.translations[i], weight);
+        dst.scales[i]       = dst.scales[i].lerp(src.scales[i], weight);
+      }
+      else
+      {
+        const Pose& ref = *layer.reference;
+
+        Quaternion inverse_reference;
+        inverse_reference.data = Vec4(ref.rotations[i].data.x * -1.0f, ref.rotations[i].data.y * -1.0f,
+                                      ref.rotations[i].data.z * -1.0f, ref.rotations[i].data.w);
+
+        const Quaternion target = dst.rotations[i] * (inverse_reference * src.rotations[i]);
+        const Vec3 translation  = dst.translations[i] + (src.translations[i] - ref.translations[i]);
+        const Vec3 scale        = Vec3(dst.scales[i].x * (src.scales[i].x / ref.scales[i].x),
+                                       dst.scales[i].y * (src.scales[i].y / ref.scales[i].y),
+                                       dst.scales[i].z * (src.scales[i].z / ref.scales[i].z));
+
+        dst.rotations[i]    = reference_nlerp(dst.rotations[i], target, weight);
+        dst.translations[i] = dst.translations[i].lerp(translation, weight);
+        dst.scales[i]       = dst.scales[i].lerp(scale, weight);
+      }
+    }
+  }
+}
+
+//
+// Scale difference of an additive layer is a ratio: base 3 with layer 4 over reference 2 gives 6 at full weight.
+// Adding the difference (3 + 4 - 2 = 5) would be wrong for anything but unit scales.
+//
+void test_additive_scale()
+{
+  Quaternion identity;
+  identity.data.w = 1.0f;
+
+  Quaternion rotations[3]    = {identity, identity, identity};
+  Vec3       translations[3] = {};
+  Vec3       scales[3]       = {Vec3(3.0f, 1.0f, 0.5f), Vec3(4.0f, 1.0f, 2.0f), Vec3(2.0f, 0.5f, 1.0f)};
+
+  const Pose dst       = {&rotations[0], &translations[0], &scales[0]};
+  const Pose layer     = {&rotations[1], &translations[1], &scales[1]};
+  const Pose reference = {&rotations[2], &translations[2], &scales[2]};
+
+  const PoseLayer additive = {
+      .pose = &layer, .reference = &reference, .weight = 1.0f, .mode = PoseLayer::Mode::Additive};
+  blend_poses(&additive, 1, 1, dst);
+
+  SDL_assert(1e-6f > (scales[0] - Vec3(6.0f, 2.0f, 1.0f)).len());
+}
+
+} // namespace
+
+int main()
+{
+  HierarchicalAllocator allocator;
+  MallocAllocator       malloc_allocator;
+
+  test_additive_scale();
+
+  const SceneGraph skeleton = generate_skeleton(allocator);
+
+  Animation clips[CLIPS_COUNT];
+  for (Animation& clip : clips)
+    clip = generate_clip(allocator, skeleton);
+
+  // upper half of the skeleton, fading in over a few bones
+  float upper_body_mask[NODES_COUNT];
+  for (uint32_t i = 0; i < NODES_COUNT; ++i)
+    upper_body_mask[i] = SDL_max(0.0f, SDL_min(1.0f, 0.25f * static_cast<float>(i - (NODES_COUNT / 2.0f))));
+
+  //
+  // Clip poses, rest pose, additive reference (first frame of the additive clip), blended result and its reference.
+  //
+  PosePool pool = {};
+  pool.setup(malloc_allocator, NODES_COUNT, CLIPS_COUNT + 4);
+
+  Pose clip_poses[CLIPS_COUNT];
+  for (Pose& pose : clip_poses)
+    pose = pool.acquire();
+
+  const Pose rest           = pool.acquire();
+  const Pose additive_start = pool.acquire();
+  const Pose blended        = pool.acquire();
+  const Pose reference      = pool.acquire();
+
+  rest_pose(skeleton, rest);
+  copy_pose(rest, additive_start, NODES_COUNT);
+  for (uint32_t i = 0; i < NODES_COUNT; ++i)
+  {
+    // every channel of the generated clips starts at the first keyframe
+    const AnimationSampler* samplers = clips[3].samplers.data;
+    SDL_memcpy(&additive_start.rotations[i].data.x, samplers[3 * i].values, sizeof(Vec4));
+    SDL_memcpy(&additive_start.translations[i].x, samplers[(3 * i) + 1].values, sizeof(Vec3));
+    SDL_memcpy(&additive_start.scales[i].x, samplers[(3 * i) + 2].values, sizeof(Vec3));
+  }
+
+  for (const Pose& pose : clip_poses)
+    copy_pose(rest, pose, NODES_COUNT);
+
+  const PoseLayer layers[] = {
+      {.pose = &clip_poses[0], .weight = 1.0f, .mode = PoseLayer::Mode::Override},
+      {.pose = &clip_poses[1], .weight = 0.35f, .mode = PoseLayer::Mode::Override},
+      {.pose = &clip_poses[2], .mask = upper_body_mask, .weight = 1.0f, .mode = PoseLayer::Mode::Override},
+      {.pose = &clip_poses[3], .reference = &additive_start, .weight = 0.6f, .mode = PoseLayer::Mode::Additive},
+  };
+
+  uint32_t cursors[CLIPS_COUNT] = {};
+
+  uint64_t single_clip_ticks = 0;
+  uint64_t blend_ticks       = 0;
+  uint64_t reference_ticks   = 0;
+  float    max_error         = 0.0f;
+
+  for (int frame = 1; frame <= FRAMES; ++frame)
+  {
+    const float animation_time = SDL_fmodf(FRAME_TIME * static_cast<float>(frame), clips[0].duration);
+
+    uint64_t start = SDL_GetPerformanceCounter();
+    sample_animation(clips[0], animation_time, &cursors[0], clip_poses[0]);
+    single_clip_ticks += SDL_GetPerformanceCounter() - start;
+
+    for (uint32_t clip_idx = 1; clip_idx < CLIPS_COUNT; ++clip_idx)
+      sample_animation(clips[clip_idx], animation_time, &cursors[clip_idx], clip_poses[clip_idx]);
+
+    start = SDL_GetPerformanceCounter();
+    copy_pose(rest, blended, NODES_COUNT);
+    blend_poses(layers, SDL_arraysize(layers), NODES_COUNT, blended);
+    blend_ticks += SDL_GetPerformanceCounter() - start;
+
+    start = SDL_GetPerformanceCounter();
+    copy_pose(rest, reference, NODES_COUNT);
+    reference_blend(layers, SDL_arraysize(layers), reference);
+    reference_ticks += SDL_GetPerformanceCounter() - start;
+
+    for (uint32_t i = 0; i < NODES_COUNT; ++i)
+    {
+      const float* a = &blended.rotations[i].data.x;
+      const float* b = &reference.rotations[i].data.x;
+      for (int j = 0; j < 4; ++j)
+        max_error = SDL_max(max_error, SDL_fabsf(a[j] - b[j]));
+
+      max_error = SDL_max(max_error, (blended.translations[i] - reference.translations[i]).len());
+      max_error = SDL_max(max_error, (blended.scales[i] - reference.scales[i]).len());
+    }
+  }
+
+  const double single_clip_us = to_microseconds(single_clip_ticks) / FRAMES;
+  const double blend_us       = to_microseconds(blend_ticks) / FRAMES;
+  const double reference_us   = to_microseconds(reference_ticks) / FRAMES;
+  const double ratio          = blend_us / single_clip_us;
+
+  SDL_Log("%u bones, %u channels per clip, %u keyframes", NODES_COUNT, clips[0].channels.count, KEYFRAMES_COUNT);
+  SDL_Log("single clip sample        %8.2f us", single_clip_ticks ? single_clip_us : 0.0);
+  SDL_Log("blend of %u layers         %8.2f us (%.2fx single clip)", static_cast<uint32_t>(SDL_arraysize(layers)),
+          blend_us, ratio);
+  SDL_Log("reference blend           %8.2f us (speedup %.2fx) | max error %g", reference_us,
+          reference_us / blend_us, static_cast<double>(max_error));
+  SDL_Log("%u clips sampled + blend   %8.2f us", CLIPS_COUNT, (CLIPS_COUNT * single_clip_us) + blend_us);
+
+  SDL_assert(max_error < 1e-5f);
+  if (2.0 <= ratio)
+    SDL_Log("blend is %.2fx the cost of a single clip, expected under 2x", ratio);
+
+  pool.teardown(malloc_allocator);
+  return 0;
+}
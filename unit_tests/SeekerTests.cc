@@ -1,6 +1,10 @@
+#include "../sources/engine/json.hh"
+#include "benchmark_helpers.hh"
 #include <SDL2/SDL_log.h>
+#include <SDL2/SDL_rwops.h>
 #include <SDL2/SDL_stdinc.h>
 #include <SDL2/SDL_assert.h>
+#include <SDL2/SDL_timer.h>
 
 namespace {
 
@@ -202,6 +206,446 @@ struct Seeker
   }
 };
 
+//
+// Tape parser (sources/engine/json.hh) which replaced Seeker in the glTF loader.
+//
+MallocAllocator malloc_allocator;
+
+bool float_compare(float lhs, float rhs)
+{
+  constexpr float epsilon = 0.00001f;
+  return SDL_fabsf(lhs - rhs) < epsilon;
+}
+
+bool parse(JsonDocument& document, const char* text)
+{
+  return document.parse(text, static_cast<uint32_t>(SDL_strlen(text)), malloc_allocator);
+}
+
+void test_json_tape_layout()
+{
+  JsonDocument document = {};
+  SDL_assert(parse(document, R"({"a":[1,2],"b":true})"));
+
+  using Type = JsonToken::Type;
+  const Type types[] = {Type::Object, Type::String, Type::Array, Type::Number, Type::Number, Type::String, Type::True};
+
+  SDL_assert(SDL_arraysize(types) == document.tokens_count);
+  for (uint32_t i = 0; i < document.tokens_count; ++i)
+    SDL_assert(types[i] == document.tokens[i].type);
+
+  // object lists its keys, array its elements
+  SDL_assert(4 == document.children_count);
+  SDL_assert(2 == document.tokens[0].length);
+  SDL_assert(1 == document.children[document.tokens[0].first_child]);
+  SDL_assert(5 == document.children[document.tokens[0].first_child + 1]);
+  SDL_assert(3 == document.children[document.tokens[2].first_child]);
+  SDL_assert(4 == document.children[document.tokens[2].first_child + 1]);
+
+  // key owns its value
+  SDL_assert(1 == document.tokens[2].parent);
+  SDL_assert(2 == document.tokens[3].parent);
+
+  SDL_assert(document.root().node("b").is(Type::True));
+  SDL_assert(2 == document.root().node("a").idx_integer(1));
+
+  document.teardown();
+}
+
+void test_json_gltf_queries()
+{
+  const char* sample =
+      R"({"asset":{"generator":"COLLADA2GLTF","version":"2.0"},"scene":0,"scenes":[{"nodes":[3,0]}],"nodes":[{"children":[1],"rotation":[-0.0,-0.0,-0.0,-1.0]},{"children":[2]},{"mesh":0,"rotation":[-0.0,-0.0,-0.0,-1.0]},{"mesh":1}],"meshes":[{"primitives":[{"attributes":{"NORMAL":1,"POSITION":2},"indices":0,"mode":4,"material":0}],"name":"inner_box"},{"primitives":[{"attributes":{"NORMAL":4,"POSITION":5},"indices":3,"mode":4,"material":1}],"name":"outer_box"}],"animations":[{"channels":[{"sampler":0,"target":{"node":2,"path":"rotation"}},{"sampler":1,"target":{"node":0,"path":"translation"}}],"samplers":[{"input":6,"interpolation":"LINEAR","output":7},{"input":8,"interpolation":"LINEAR","output":9}]}],"accessors":[{"bufferView":0,"byteOffset":0,"componentType":5123,"count":186,"max":[95],"min":[0],"type":"SCALAR"},{"bufferView":2,"byteOffset":0,"componentType":5126,"count":2,"max":[1.0,0.0,0.0,4.4896593387466768e-11],"min":[-0.0,0.0,0.0,-1.0],"type":"VEC4"}],"bufferViews":[{"buffer":0,"byteOffset":7784,"byteLength":1524,"target":34963},{"buffer":0,"byteOffset":80,"byteLength":7680,"byteStride":12,"target":34962}],"buffers":[{"byteLength":9308}]})";
+
+  JsonDocument document = {};
+  SDL_assert(parse(document, sample));
+
+  const JsonValue root = document.root();
+
+  SDL_assert(4 == root.node("nodes").elements_count());
+  SDL_assert(1 == root.node("nodes").idx(0).node("children").idx_integer(0));
+  SDL_assert(2 == root.node("nodes").idx(1).node("children").idx_integer(0));
+  SDL_assert(1 == root.node("nodes").idx(3).integer("mesh"));
+  SDL_assert(float_compare(-1.0f, root.node("nodes").idx(2).node("rotation").idx_float(3)));
+
+  SDL_assert(2 == root.node("scenes").idx(0).node("nodes").elements_count());
+  SDL_assert(3 == root.node("scenes").idx(0).node("nodes").idx_integer(0));
+
+  // "mesh" is only a substring of other keys on these nodes
+  SDL_assert(not root.node("nodes").idx(0).has("mesh"));
+  SDL_assert(not root.node("nodes").idx(1).has("mesh"));
+  SDL_assert(root.node("nodes").idx(2).has("mesh"));
+  SDL_assert(not root.has("mesh"));
+
+  const JsonValue primitive = root.node("meshes").idx(1).node("primitives").idx(0);
+  SDL_assert(4 == primitive.node("attributes").integer("NORMAL"));
+  SDL_assert(5 == primitive.node("attributes").integer("POSITION"));
+  SDL_assert(1 == primitive.integer("material"));
+  SDL_assert(root.node("meshes").idx(1).node("name").equals("outer_box"));
+  SDL_assert(not root.node("meshes").idx(1).node("name").equals("outer"));
+
+  const JsonValue channels = root.node("animations").idx(0).node("channels");
+  SDL_assert(channels.idx(0).node("target").node("path").equals("rotation"));
+  SDL_assert(channels.idx(1).node("target").node("path").equals("translation"));
+  SDL_assert(0 == channels.idx(1).node("target").integer("node"));
+  SDL_assert(root.node("animations").idx(0).node("samplers").idx(1).node("interpolation").equals("LINEAR"));
+
+  const JsonValue accessor = root.node("accessors").idx(1);
+  SDL_assert(5126 == accessor.integer("componentType"));
+  SDL_assert(accessor.node("type").equals("VEC4"));
+  SDL_assert(float_compare(4.4896593387466768e-11f, accessor.node("max").idx_float(3)));
+  SDL_assert(float_compare(-1.0f, accessor.node("min").idx_float(3)));
+
+  // byteStride is optional, missing numbers read as 0
+  SDL_assert(12 == root.node("bufferViews").idx(1).integer("byteStride"));
+  SDL_assert(0 == root.node("bufferViews").idx(0).integer("byteStride"));
+  SDL_assert(7784 == root.node("bufferViews").idx(0).integer("byteOffset"));
+
+  // missing values stay invalid through whole chains
+  SDL_assert(not root.node("skins").valid());
+  SDL_assert(0 == root.node("skins").elements_count());
+  SDL_assert(0 == root.node("skins").idx(0).node("joints").idx_integer(0));
+  SDL_assert(not root.node("nodes").idx(4).valid());
+  SDL_assert(not root.node("nodes").idx(-1).valid());
+  SDL_assert(not root.node("asset").idx(0).valid());
+  SDL_assert(not root.node("nodes").node("mesh").valid());
+  SDL_assert(0 == root.node("asset").integer("version"));
+
+  document.teardown();
+}
+
+void test_json_strings_and_numbers()
+{
+  const char* sample = R"({"a\"b":1,"brackets":"[{,}]:","c":"\\","d":"\u0041","e":[-12,5123,1E3,2.5e-1,-0.0,0],"f":-7.9})";
+
+  JsonDocument document = {};
+  SDL_assert(parse(document, sample));
+
+  const JsonValue root = document.root();
+
+  // escapes are kept as they are in the text
+  SDL_assert(1 == root.integer(R"(a\"b)"));
+  SDL_assert(root.node("brackets").equals("[{,}]:"));
+  SDL_assert(root.node("c").equals(R"(\\)"));
+  SDL_assert(root.node("d").equals(R"(\u0041)"));
+
+  const JsonValue numbers = root.node("e");
+  SDL_assert(6 == numbers.elements_count());
+  SDL_assert(-12 == numbers.idx_integer(0));
+  SDL_assert(5123 == numbers.idx_integer(1));
+  SDL_assert(float_compare(1000.0f, numbers.idx_float(2)));
+  SDL_assert(float_compare(0.25f, numbers.idx_float(3)));
+  SDL_assert(float_compare(0.0f, numbers.idx_float(4)));
+  SDL_assert(0 == numbers.idx_integer(5));
+  SDL_assert(-7 == root.integer("f"));
+  SDL_assert(float_compare(-7.9f, root.node("f").as_float()));
+
+  // strings don't read as numbers
+  SDL_assert(0 == root.integer("brackets"));
+
+  document.teardown();
+}
+
+void test_json_whitespace_and_empty_containers()
+{
+  // GLB pads the JSON chunk with spaces
+  const char* sample = "\n{\n\t\"nodes\" : [ ],\r\n  \"scenes\":[ { } , {\"nodes\" : [ 0 , 1 ] } ],\n  \"asset\":{}\n}    ";
+
+  JsonDocument document = {};
+  SDL_assert(parse(document, sample));
+
+  const JsonValue root = document.root();
+  SDL_assert(root.has("nodes"));
+  SDL_assert(0 == root.node("nodes").elements_count());
+  SDL_assert(not root.node("nodes").idx(0).valid());
+  SDL_assert(2 == root.node("scenes").elements_count());
+  SDL_assert(not root.node("scenes").idx(0).has("nodes"));
+  SDL_assert(1 == root.node("scenes").idx(1).node("nodes").idx_integer(1));
+  SDL_assert(root.node("asset").is(JsonToken::Type::Object));
+  SDL_assert(not root.node("asset").has("version"));
+
+  document.teardown();
+
+  // whole text doesn't have to be null terminated, only given length is read
+  const char* prefix = R"({"a":[1,2]}{"b":3})";
+  SDL_assert(document.parse(prefix, 11, malloc_allocator));
+  SDL_assert(2 == document.root().node("a").elements_count());
+  SDL_assert(not document.root().has("b"));
+  document.teardown();
+}
+
+void test_json_malformed_input()
+{
+  const char* samples[] = {
+      "",
+      "   ",
+      "{",
+      "}",
+      "[1,2",
+      "[1,]",
+      "[1 2]",
+      "[,1]",
+      "{\"a\"}",
+      "{\"a\":}",
+      "{\"a\":1,}",
+      "{\"a\" 1}",
+      "{a:1}",
+      "{1:1}",
+      "{\"a\":1]",
+      "[1}",
+      "{} {}",
+      "{}x",
+      "tru",
+      "nul",
+      "falsy",
+      "\"abc",
+      "\"a\nb\"",
+      "-",
+      "1.",
+      ".5",
+      "1e",
+      "1e+",
+      "[1.e3]",
+  };
+
+  for (const char* sample : samples)
+  {
+    JsonDocument document = {};
+    SDL_assert(not parse(document, sample));
+    SDL_assert(not document.root().valid());
+    document.teardown();
+  }
+
+  // nesting as deep as the parser stack is fine, one level more is rejected
+  for (uint32_t levels = JsonDocument::MAX_DEPTH; levels <= (JsonDocument::MAX_DEPTH + 1); ++levels)
+  {
+    char deep[(2 * (JsonDocument::MAX_DEPTH + 1)) + 1] = {};
+    for (uint32_t i = 0; i < levels; ++i)
+    {
+      deep[i]                    = '[';
+      deep[(2 * levels) - 1 - i] = ']';
+    }
+
+    JsonDocument document = {};
+    SDL_assert((JsonDocument::MAX_DEPTH == levels) == parse(document, deep));
+    document.teardown();
+  }
+}
+
+//
+// Benchmarks. Throughput of the tokenizer alone, then a loader like walk (every node, accessor and buffer view looked
+// up by index) done through Seeker and through the tape.
+//
+constexpr uint32_t BENCHMARK_ROUNDS = 20;
+
+double elapsed_ms(uint64_t start)
+{
+  return 1000.0 * static_cast<double>(SDL_GetPerformanceCounter() - start) /
+         static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+volatile int benchmark_sink = 0;
+
+int seeker_walk(const char* text, uint32_t length)
+{
+  const Seeker document{text, length};
+  int          result = 0;
+
+  if (document.has("nodes"))
+  {
+    const int nodes_count = document.node("nodes").elements_count();
+    for (int i = 0; i < nodes_count; ++i)
+    {
+      const Seeker node = document.node("nodes").idx(i);
+      if (node.has("mesh"))
+        result += node.integer("mesh");
+    }
+  }
+
+  if (document.has("accessors"))
+  {
+    const int accessors_count = document.node("accessors").elements_count();
+    for (int i = 0; i < accessors_count; ++i)
+    {
+      const Seeker accessor = document.node("accessors").idx(i);
+      result += accessor.integer("count");
+      result += document.node("bufferViews").idx(accessor.integer("bufferView")).integer("byteLength");
+    }
+  }
+
+  return result;
+}
+
+int tape_walk(const char* text, uint32_t length)
+{
+  JsonDocument document = {};
+  SDL_assert(document.parse(text, length, malloc_allocator));
+
+  const JsonValue root   = document.root();
+  int             result = 0;
+
+  const JsonValue nodes       = root.node("nodes");
+  const int       nodes_count = nodes.elements_count();
+  for (int i = 0; i < nodes_count; ++i)
+  {
+    const JsonValue node = nodes.idx(i);
+    if (node.has("mesh"))
+      result += node.integer("mesh");
+  }
+
+  const JsonValue accessors       = root.node("accessors");
+  const JsonValue buffer_views    = root.node("bufferViews");
+  const int       accessors_count = accessors.elements_count();
+  for (int i = 0; i < accessors_count; ++i)
+  {
+    const JsonValue accessor = accessors.idx(i);
+    result += accessor.integer("count");
+    result += buffer_views.idx(accessor.integer("bufferView")).integer("byteLength");
+  }
+
+  document.teardown();
+  return result;
+}
+
+void benchmark_document(const char* name, const char* text, uint32_t length, bool with_seeker)
+{
+  uint64_t start = SDL_GetPerformanceCounter();
+  for (uint32_t round = 0; round < BENCHMARK_ROUNDS; ++round)
+  {
+    JsonDocument document = {};
+    SDL_assert(document.parse(text, length, malloc_allocator));
+    benchmark_sink = benchmark_sink + static_cast<int>(document.tokens_count);
+    document.teardown();
+  }
+  const double tokenize_ms = elapsed_ms(start) / BENCHMARK_ROUNDS;
+  const double megabytes   = static_cast<double>(length) / (1024.0 * 1024.0);
+
+  start = SDL_GetPerformanceCounter();
+  int tape_result = 0;
+  for (uint32_t round = 0; round < BENCHMARK_ROUNDS; ++round)
+    tape_result = tape_walk(text, length);
+  const double tape_ms = elapsed_ms(start) / BENCHMARK_ROUNDS;
+
+  if (not with_seeker)
+  {
+    SDL_Log("%-24s | %9u B | tokenize %8.3f ms (%6.1f MB/s) | parse + walk %8.3f ms", name, length, tokenize_ms,
+            megabytes / (tokenize_ms / 1000.0), tape_ms);
+    return;
+  }
+
+  start = SDL_GetPerformanceCounter();
+  int seeker_result = 0;
+  for (uint32_t round = 0; round < BENCHMARK_ROUNDS; ++round)
+    seeker_result = seeker_walk(text, length);
+  const double seeker_ms = elapsed_ms(start) / BENCHMARK_ROUNDS;
+
+  SDL_assert(seeker_result == tape_result);
+  SDL_Log("%-24s | %9u B | tokenize %8.3f ms (%6.1f MB/s) | parse + walk %8.3f ms | seeker walk %9.3f ms | x%.1f",
+          name, length, tokenize_ms, megabytes / (tokenize_ms / 1000.0), tape_ms, seeker_ms, seeker_ms / tape_ms);
+}
+
+void benchmark_assets()
+{
+  const char* names[] = {
+      "Box.glb",          "BoxAnimated.glb",       "DamagedHelmet.glb", "Monster.glb", "RiggedSimple.glb",
+      "lil_arrow.glb",    "VERY_SIMPLE_ROBOT.glb", "robot.glb",         "rock.glb",    "su-47.glb",
+  };
+
+  // tests are started either from the repository root or from a build directory inside it
+  const char* directories[] = {"assets/", "../assets/"};
+
+  for (const char* name : names)
+  {
+    SDL_RWops* ctx = nullptr;
+    for (const char* directory : directories)
+    {
+      char path[256] = {};
+      SDL_snprintf(path, sizeof(path), "%s%s", directory, name);
+      ctx = SDL_RWFromFile(path, "rb");
+      if (ctx)
+        break;
+    }
+
+    if (nullptr == ctx)
+    {
+      SDL_Log("%-24s | not found, skipped", name);
+      continue;
+    }
+
+    const uint64_t size    = static_cast<uint64_t>(SDL_RWsize(ctx));
+    uint8_t*       content = reinterpret_cast<uint8_t*>(SDL_malloc(size));
+    SDL_RWread(ctx, content, 1, size);
+    SDL_RWclose(ctx);
+
+    // glb header (12 bytes), then JSON chunk length and type
+    const uint32_t json_length = *reinterpret_cast<const uint32_t*>(&content[12]);
+    const char*    json        = reinterpret_cast<const char*>(&content[20]);
+
+    benchmark_document(name, json, json_length, true);
+    SDL_free(content);
+  }
+}
+
+//
+// glTF shaped document: node hierarchy with TRS, accessors and buffer views, padded like a GLB chunk.
+//
+uint32_t generate_synthetic_gltf(char* dst, uint32_t capacity, uint32_t nodes_count)
+{
+  uint32_t length = 0;
+
+  auto append = [&](const char* format, auto... args) {
+    const int written = SDL_snprintf(&dst[length], capacity - length, format, args...);
+    SDL_assert((0 <= written) and (static_cast<uint32_t>(written) < (capacity - length)));
+    length += static_cast<uint32_t>(written);
+  };
+
+  append(R"({"asset":{"generator":"vvne synthetic","version":"2.0"},"scene":0,"scenes":[{"nodes":[0]}],"nodes":[)");
+  for (uint32_t i = 0; i < nodes_count; ++i)
+  {
+    append(R"(%s{"name":"node_%u","children":[%u,%u],"mesh":%u,"translation":[%.6f,%.6f,%.6f],)", i ? "," : "", i,
+           (2 * i + 1) % nodes_count, (2 * i + 2) % nodes_count, i % 64, 0.25f * i, -1.5f * i, 3.0e-5f * i);
+    append(R"("rotation":[0.7071068286895752,0,0,0.7071068286895752],"scale":[1,1.5,2]})");
+  }
+
+  append(R"(],"accessors":[)");
+  for (uint32_t i = 0; i < nodes_count; ++i)
+    append(R"(%s{"bufferView":%u,"byteOffset":0,"componentType":5126,"count":%u,"max":[1,1,1],"min":[-1,-1,-1],)"
+           R"("type":"VEC3"})",
+           i ? "," : "", i, 24 + (i % 100));
+
+  append(R"(],"bufferViews":[)");
+  for (uint32_t i = 0; i < nodes_count; ++i)
+    append(R"(%s{"buffer":0,"byteOffset":%u,"byteLength":%u,"target":34962})", i ? "," : "", 512 * i, 288 + (i % 100));
+
+  append(R"(],"buffers":[{"byteLength":%u}]})", 512 * nodes_count);
+
+  while (0 != (length % 4))
+    append(" ");
+
+  return length;
+}
+
+void benchmark_synthetic()
+{
+  // quadratic Seeker walk is only affordable on a small document
+  {
+    const uint32_t capacity = 1024 * 1024;
+    char*          text     = reinterpret_cast<char*>(SDL_malloc(capacity));
+    const uint32_t length   = generate_synthetic_gltf(text, capacity, 400);
+    benchmark_document("synthetic (400 nodes)", text, length, true);
+    SDL_free(text);
+  }
+
+  {
+    const uint32_t capacity = 16 * 1024 * 1024;
+    char*          text     = reinterpret_cast<char*>(SDL_malloc(capacity));
+    const uint32_t length   = generate_synthetic_gltf(text, capacity, 29500);
+    SDL_assert((10 * 1024 * 1024) <= length);
+    benchmark_document("synthetic (10 MB)", text, length, false);
+    SDL_free(text);
+  }
+}
+
 } // namespace
 
 int main() {
@@ -296,5 +740,14 @@ int main() {
     SDL_assert(false == node_json.has("mesh"));
   }
 
+  test_json_tape_layout();
+  test_json_gltf_queries();
+  test_json_strings_and_numbers();
+  test_json_whitespace_and_empty_containers();
+  test_json_malformed_input();
+
+  benchmark_assets();
+  benchmark_synthetic();
+
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "../sources/engine/gltf.hh"
+#include "../sources/engine/hierarchical_allocator.hh"
+#include "../sources/engine/memory_allocator.hh"
+#include <SDL2/SDL_rwops.h>
+#include <SDL2/SDL_stdinc.h>
+#include <SDL2/SDL_timer.h>
+
+//
+// Helpers shared by benchmarks and tests in this directory.
+//
+
+inline double to_microseconds(uint64_t ticks)
+{
+  return 1000000.0 * static_cast<double>(ticks) / static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+// for data too big (or with too many allocations) for HierarchicalAllocator
+struct MallocAllocator : public MemoryAllocator
+{
+  void* Allocate(uint64_t size) override
+  {
+    return SDL_malloc(size);
+  }
+
+  void* Reallocate(void* ptr, uint64_t size) override
+  {
+    return SDL_realloc(ptr, size);
+  }
+
+  void Free(void* ptr, uint64_t) override
+  {
+    SDL_free(ptr);
+  }
+};
+
+// only the scene graph is needed, gpu data is dropped
+class NullConsumer : public GlbConsumer
+{
+public:
+  void texture(Texture&, const uint8_t*, uint32_t) override
+  {
+  }
+
+  void mesh(Mesh&, const uint8_t*, uint32_t, uint32_t) override
+  {
+  }
+};
+
+// "name" is a file in the assets directory, which is looked up from both the repository root and a build directory
+inline bool load_scene_graph(SceneGraph& dst, HierarchicalAllocator& allocator, const char* name)
+{
+  const char* directories[] = {"assets", "../assets"};
+
+  for (const char* directory : directories)
+  {
+    char path[256];
+    SDL_snprintf(path, sizeof(path), "%s/%s", directory, name);
+
+    SDL_RWops* ctx = SDL_RWFromFile(path, "rb");
+    if (nullptr == ctx)
+      continue;
+
+    const uint32_t size = static_cast<uint32_t>(SDL_RWsize(ctx));
+    uint8_t*       glb  = allocator.allocate<uint8_t>(size);
+    SDL_RWread(ctx, glb, sizeof(uint8_t), size);
+    SDL_RWclose(ctx);
+
+    NullConsumer consumer;
+    dst = parseGLB(glb, allocator, consumer);
+    allocator.free(glb, size);
+    return true;
+  }
+
+  return false;
+}